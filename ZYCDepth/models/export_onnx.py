@@ -1,12 +1,20 @@
 #!/usr/bin/env python3
 """
-Export Depth Anything 3 to ONNX (fixed square resolution).
+Export Depth Anything 3 to ONNX (fixed resolution).
 
 Example:
     python export_onnx.py \
         --model depth-anything/DA3-SMALL \
         --process-res 504 \
         --output DA3-SMALL-504.onnx
+
+Multiple fixed shapes (HxW, multiples of the ViT patch size 14), one file each,
+named <output stem>-HxW.onnx. The app picks the one whose aspect ratio best
+matches the captured window:
+    python export_onnx.py \
+        --model depth-anything/DA3-SMALL \
+        --shapes 336x588,252x448,504x896 \
+        --output DA3-SMALL.onnx
 """
 
 import argparse
@@ -64,6 +72,38 @@ class OnnxWrapper(torch.nn.Module):
         return depth, intrinsics, extrinsics
 
 
+PATCH_SIZE = 14
+
+
+def parse_shapes(text):
+    shapes = []
+    for item in text.split(","):
+        h, w = (int(v) for v in item.lower().strip().split("x"))
+        if h % PATCH_SIZE or w % PATCH_SIZE:
+            raise ValueError("Shape {}x{} must be a multiple of {}".format(h, w, PATCH_SIZE))
+        shapes.append((h, w))
+    return shapes
+
+
+def export_shape(wrapper, height, width, output, opset, device):
+    # 创建固定形状的dummy input
+    dummy_input = torch.randn(1, 3, height, width, device=device)
+
+    print("Exporting {}x{} to ONNX with intrinsics...".format(height, width))
+    torch.onnx.export(
+        wrapper,
+        dummy_input,
+        output,
+        input_names=["image"],
+        output_names=["depth", "intrinsics", "extrinsics"],  # 增加输出名
+        opset_version=opset,
+        do_constant_folding=True,
+        training=torch.onnx.TrainingMode.EVAL,
+        export_params=True,
+    )
+    print("Saved ONNX model to {}".format(output))
+
+
 def parse_args():
     parser = argparse.ArgumentParser(description="Export Depth Anything 3 to ONNX")
     parser.add_argument(
@@ -78,6 +118,12 @@ def parse_args():
         default=504,
         help="Fixed square resolution (matches run_depth_inference.py)",
     )
+    parser.add_argument(
+        "--shapes",
+        type=str,
+        default="",
+        help="Comma separated HxW list, e.g. 336x588,252x448,504x896 (overrides --process-res)",
+    )
     parser.add_argument(
         "--output",
         type=str,
@@ -108,24 +154,17 @@ def main():
     wrapper = OnnxWrapper(pt_model)
     wrapper.eval()  # 确保wrapper也处于eval模式
 
-    # 创建固定形状的dummy input
-    dummy_input = torch.randn(1, 3, args.process_res, args.process_res, device=device)
-
     os.makedirs(os.path.dirname(args.output) or ".", exist_ok=True)
 
-    print("Exporting to ONNX with intrinsics...")
-    torch.onnx.export(
-        wrapper,
-        dummy_input,
-        args.output,
-        input_names=["image"],
-        output_names=["depth", "intrinsics", "extrinsics"],  # 增加输出名
-        opset_version=args.opset,
-        do_constant_folding=True,
-        training=torch.onnx.TrainingMode.EVAL,
-        export_params=True,
-    )
-    print("Saved ONNX model to {}".format(args.output))
+    if args.shapes:
+        shapes = parse_shapes(args.shapes)
+        stem, ext = os.path.splitext(args.output)
+        targets = [(h, w, "{}-{}x{}{}".format(stem, h, w, ext or ".onnx")) for h, w in shapes]
+    else:
+        targets = [(args.process_res, args.process_res, args.output)]
+
+    for height, width, output in targets:
+        export_shape(wrapper, height, width, output, args.opset, device)
 
 
 if __name__ == "__main__":
@@ -0,0 +1,199 @@
+#!/usr/bin/env python3
+"""
+Static INT8 (QDQ) quantization of the Depth Anything 3 ONNX model.
+
+Calibration frames are the PNG/JPG files recorded by the app
+("Record Calib Frames", default models/calib_frames).
+
+Example:
+    python quantize_onnx.py \
+        --model DA3-SMALL-504.onnx \
+        --frames calib_frames \
+        --output DA3-SMALL-504.int8.onnx
+
+After quantization the script runs both models on the CPU execution provider
+over the calibration set and reports latency and depth error (AbsRel vs FP32).
+Run the app with --int8 to use the quantized model.
+"""
+
+import argparse
+import os
+import sys
+import time
+from pathlib import Path
+
+import cv2
+import numpy as np
+import onnxruntime as ort
+from onnxruntime.quantization import (
+    CalibrationDataReader,
+    CalibrationMethod,
+    QuantFormat,
+    QuantType,
+    quantize_static,
+)
+from onnxruntime.quantization.shape_inference import quant_pre_process
+
+# 与 C++ 端 FusedPreprocessor 一致：ImageNet 均值/方差，RGB 顺序
+MEAN = np.array([0.485, 0.456, 0.406], dtype=np.float32)
+STD = np.array([0.229, 0.224, 0.225], dtype=np.float32)
+IMAGE_EXTS = {".png", ".jpg", ".jpeg", ".bmp"}
+
+
+def list_frames(frames_dir, max_frames):
+    files = sorted(p for p in Path(frames_dir).iterdir() if p.suffix.lower() in IMAGE_EXTS)
+    if max_frames > 0 and len(files) > max_frames:
+        # 均匀抽样，保持场景覆盖
+        idx = np.linspace(0, len(files) - 1, max_frames).astype(int)
+        files = [files[i] for i in idx]
+    return files
+
+
+def model_input_size(path, fallback):
+    # 输入尺寸以模型为准 (export_onnx.py 导出为固定形状)，动态维度回退到 --process-res
+    shape = ort.InferenceSession(path, providers=["CPUExecutionProvider"]).get_inputs()[0].shape
+    h = shape[2] if isinstance(shape[2], int) else fallback
+    w = shape[3] if isinstance(shape[3], int) else fallback
+    return h, w
+
+
+def preprocess(path, size):
+    bgr = cv2.imread(str(path), cv2.IMREAD_COLOR)
+    if bgr is None:
+        raise RuntimeError("Failed to read {}".format(path))
+    bgr = cv2.resize(bgr, (size[1], size[0]), interpolation=cv2.INTER_LINEAR)
+    rgb = cv2.cvtColor(bgr, cv2.COLOR_BGR2RGB).astype(np.float32) / 255.0
+    rgb = (rgb - MEAN) / STD
+    return np.ascontiguousarray(rgb.transpose(2, 0, 1)[None])
+
+
+class FrameReader(CalibrationDataReader):
+    def __init__(self, files, input_name, size):
+        self.files = files
+        self.input_name = input_name
+        self.size = size
+        self.iter = iter(files)
+
+    def get_next(self):
+        path = next(self.iter, None)
+        if path is None:
+            return None
+        return {self.input_name: preprocess(path, self.size)}
+
+    def rewind(self):
+        self.iter = iter(self.files)
+
+
+def cpu_session(path, threads):
+    options = ort.SessionOptions()
+    options.graph_optimization_level = ort.GraphOptimizationLevel.ORT_ENABLE_ALL
+    if threads > 0:
+        options.intra_op_num_threads = threads
+    return ort.InferenceSession(path, options, providers=["CPUExecutionProvider"])
+
+
+def evaluate(fp32_path, int8_path, files, size, threads, warmup):
+    fp32 = cpu_session(fp32_path, threads)
+    int8 = cpu_session(int8_path, threads)
+    input_name = fp32.get_inputs()[0].name
+
+    def run(session, x):
+        start = time.perf_counter()
+        depth = session.run(["depth"], {input_name: x})[0]
+        return depth, (time.perf_counter() - start) * 1000.0
+
+    x0 = preprocess(files[0], size)
+    for _ in range(warmup):
+        run(fp32, x0)
+        run(int8, x0)
+
+    fp32_ms, int8_ms, abs_rel = [], [], []
+    for path in files:
+        x = preprocess(path, size)
+        ref, t_ref = run(fp32, x)
+        out, t_out = run(int8, x)
+        fp32_ms.append(t_ref)
+        int8_ms.append(t_out)
+        valid = ref > 1e-6
+        abs_rel.append(float(np.mean(np.abs(out[valid] - ref[valid]) / ref[valid])))
+
+    def stats(samples):
+        s = np.asarray(samples)
+        return np.median(s), np.percentile(s, 95)
+
+    f_med, f_p95 = stats(fp32_ms)
+    q_med, q_p95 = stats(int8_ms)
+    print("")
+    print("Frames evaluated : {}".format(len(files)))
+    print("FP32 latency     : median {:.1f} ms, p95 {:.1f} ms".format(f_med, f_p95))
+    print("INT8 latency     : median {:.1f} ms, p95 {:.1f} ms".format(q_med, q_p95))
+    print("Speedup (median) : {:.2f}x".format(f_med / q_med))
+    print("AbsRel vs FP32   : mean {:.4f}, max {:.4f}".format(np.mean(abs_rel), np.max(abs_rel)))
+
+
+def parse_args():
+    parser = argparse.ArgumentParser(description="Static INT8 quantization of Depth Anything 3 ONNX")
+    parser.add_argument("--model", type=str, default="DA3-SMALL-504.onnx", help="FP32 ONNX path (export_onnx.py output)")
+    parser.add_argument("--frames", type=str, default="calib_frames", help="Directory of recorded calibration frames")
+    parser.add_argument("--output", type=str, default="DA3-SMALL-504.int8.onnx", help="Output INT8 ONNX path")
+    parser.add_argument("--process-res", type=int, default=504, help="Fallback resolution for models with dynamic input shape")
+    parser.add_argument("--max-frames", type=int, default=200, help="Maximum calibration frames (0 = all)")
+    parser.add_argument(
+        "--method",
+        type=str,
+        default="percentile",
+        choices=["minmax", "entropy", "percentile"],
+        help="Calibration method",
+    )
+    parser.add_argument("--per-channel", action="store_true", help="Per-channel weight quantization")
+    parser.add_argument("--threads", type=int, default=0, help="intra_op_num_threads for evaluation (0 = ORT default)")
+    parser.add_argument("--warmup", type=int, default=3, help="Warmup runs before timing")
+    parser.add_argument("--eval-only", action="store_true", help="Skip quantization, only evaluate --output")
+    return parser.parse_args()
+
+
+def main():
+    args = parse_args()
+    files = list_frames(args.frames, args.max_frames)
+    if not files:
+        print("No calibration frames found in {}".format(args.frames))
+        sys.exit(1)
+
+    size = model_input_size(args.model, args.process_res)
+
+    if not args.eval_only:
+        # 先做符号形状推理与图优化，否则部分 MatMul/LayerNorm 前后无法插入 QDQ
+        prep_path = os.path.splitext(args.output)[0] + ".prep.onnx"
+        print("Pre-processing model: {}".format(args.model))
+        quant_pre_process(args.model, prep_path, skip_symbolic_shape=False)
+
+        input_name = ort.InferenceSession(prep_path, providers=["CPUExecutionProvider"]).get_inputs()[0].name
+        reader = FrameReader(files, input_name, size)
+        method = {
+            "minmax": CalibrationMethod.MinMax,
+            "entropy": CalibrationMethod.Entropy,
+            "percentile": CalibrationMethod.Percentile,
+        }[args.method]
+
+        print("Calibrating on {} frames ({})...".format(len(files), args.method))
+        quantize_static(
+            prep_path,
+            args.output,
+            reader,
+            quant_format=QuantFormat.QDQ,
+            # ViT 主干的计算量几乎都在 MatMul / Conv 上，其余算子保持浮点以控制误差
+            op_types_to_quantize=["MatMul", "Conv", "Gemm"],
+            activation_type=QuantType.QUInt8,
+            weight_type=QuantType.QInt8,
+            per_channel=args.per_channel,
+            calibrate_method=method,
+            extra_options={"CalibPercentile": 99.99} if args.method == "percentile" else {},
+        )
+        os.remove(prep_path)
+        print("Saved INT8 model to {}".format(args.output))
+
+    evaluate(args.model, args.output, files, size, args.threads, args.warmup)
+
+
+if __name__ == "__main__":
+    main()
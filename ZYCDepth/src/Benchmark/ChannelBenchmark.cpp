@@ -0,0 +1,128 @@
+﻿#include "ChannelBenchmark.h"
+#include "Data/CommonTypes.h"
+#include "Data/LatestChannel.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    // 原实现：一把互斥锁保护 FrameData，读者每次拷贝整个结构
+    class MutexChannel {
+    public:
+        void publish(FrameData&& frame) {
+            std::lock_guard<std::mutex> lock(mtx);
+            if (frame.sequenceID > current.sequenceID) current = std::move(frame);
+        }
+        FrameData load() const {
+            std::lock_guard<std::mutex> lock(mtx);
+            return current;
+        }
+    private:
+        mutable std::mutex mtx;
+        FrameData current;
+    };
+
+    class LockFreeChannel {
+    public:
+        void publish(FrameData&& frame) {
+            long long id = frame.sequenceID;
+            channel.publish(std::make_shared<const FrameData>(std::move(frame)), id);
+        }
+        FrameHandle load() const { return channel.load(); }
+    private:
+        LatestChannel<FrameHandle> channel{ std::make_shared<const FrameData>() };
+    };
+
+    struct Percentiles {
+        double p50 = 0, p99 = 0, max = 0;
+        size_t count = 0;
+    };
+
+    Percentiles summarize(std::vector<double>& samples) {
+        Percentiles p;
+        p.count = samples.size();
+        if (samples.empty()) return p;
+        std::sort(samples.begin(), samples.end());
+        p.p50 = samples[samples.size() / 2];
+        p.p99 = samples[std::min(samples.size() - 1, (size_t)(samples.size() * 0.99))];
+        p.max = samples.back();
+        return p;
+    }
+
+    template <typename Channel>
+    void runCase(const char* name, int readers, int publishHz, int durationMs, const std::vector<std::shared_ptr<cv::Mat>>& images) {
+        Channel channel;
+        std::atomic<bool> running{ true };
+        std::vector<std::vector<double>> readSamples(readers);
+        std::vector<std::thread> threads;
+        for (int r = 0; r < readers; ++r) {
+            threads.emplace_back([&, r] {
+                auto& samples = readSamples[r];
+                samples.reserve(1 << 20);
+                while (running.load(std::memory_order_relaxed)) {
+                    auto start = Clock::now();
+                    auto frame = channel.load();
+                    auto ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+                    if (samples.size() < samples.capacity()) samples.push_back(ns);
+                }
+            });
+        }
+
+        std::vector<double> writeSamples;
+        const auto interval = std::chrono::nanoseconds(1000000000LL / std::max(1, publishHz));
+        auto next = Clock::now();
+        auto end = next + std::chrono::milliseconds(durationMs);
+        long long seq = 0;
+        while (Clock::now() < end) {
+            // 与截图线程一致：帧带图像、原始深度与内外参
+            FrameData frame;
+            frame.image = images[seq % images.size()];
+            frame.rawDepth = images[(seq + 1) % images.size()];
+            frame.intrinsics = cv::Mat::eye(3, 3, CV_32F);
+            frame.extrinsics = cv::Mat::zeros(3, 4, CV_32F);
+            frame.sequenceID = ++seq;
+            auto start = Clock::now();
+            channel.publish(std::move(frame));
+            writeSamples.push_back(std::chrono::duration<double, std::nano>(Clock::now() - start).count());
+            next += interval;
+            while (Clock::now() < next) std::this_thread::yield();
+        }
+        running = false;
+        for (auto& t : threads) t.join();
+
+        std::vector<double> allReads;
+        for (auto& s : readSamples) allReads.insert(allReads.end(), s.begin(), s.end());
+        Percentiles w = summarize(writeSamples);
+        Percentiles rd = summarize(allReads);
+        printf("%-10s readers=%-2d | publish p50 %8.0f ns  p99 %8.0f ns  max %9.0f ns | read p50 %6.0f ns  p99 %8.0f ns  max %9.0f ns  (%.1f M reads/s)\n",
+            name, readers, w.p50, w.p99, w.max, rd.p50, rd.p99, rd.max, rd.count / (durationMs * 1000.0));
+    }
+}
+
+int runChannelBenchmark(int argc, char** argv) {
+    int publishHz = 1000;
+    int durationMs = 2000;
+    for (int i = 1; i + 1 < argc; ++i) {
+        if (strcmp(argv[i], "--bench-hz") == 0) publishHz = atoi(argv[i + 1]);
+        if (strcmp(argv[i], "--bench-ms") == 0) durationMs = atoi(argv[i + 1]);
+    }
+    std::vector<std::shared_ptr<cv::Mat>> images;
+    for (int i = 0; i < 4; ++i) images.push_back(std::make_shared<cv::Mat>(64, 64, CV_8UC4));
+
+    printf("Frame exchange benchmark: publish %d Hz, %d ms per case\n", publishHz, durationMs);
+    unsigned int cores = std::max(2u, std::thread::hardware_concurrency());
+    for (int readers : { 1, 2, 4, 8 }) {
+        if ((unsigned)readers >= cores) break;
+        runCase<MutexChannel>("mutex", readers, publishHz, durationMs, images);
+        runCase<LockFreeChannel>("lock-free", readers, publishHz, durationMs, images);
+    }
+    return 0;
+}
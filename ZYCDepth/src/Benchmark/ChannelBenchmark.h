@@ -0,0 +1,10 @@
+﻿#pragma once
+
+/**
+ * @brief 帧交换通道竞争基准（命令行 --bench-channel）
+ * @details 1 个写者以固定频率发布帧句柄，N 个读者在忙循环中读取最新帧，
+ *          分别统计写者发布延迟与读者读取延迟的 p50 / p99 / max，
+ *          对比无锁 LatestChannel 与原先“互斥锁 + FrameData 整体拷贝”的方式。
+ * @return 进程退出码
+ */
+int runChannelBenchmark(int argc, char** argv);
@@ -0,0 +1,170 @@
+﻿#include "TsdfBenchmark.h"
+#include "Mapping/IcpTracker.h"
+#include "Mapping/TsdfVolume.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+
+namespace {
+    constexpr int kWidth = 504;
+    constexpr int kHeight = 280;
+    constexpr float kFocal = 400.0f;
+    constexpr float kStepPerFrame = 0.15f;   // 相机每帧前进距离（米）
+    constexpr float kHalfWidth = 4.0f;       // 走廊半宽
+    constexpr float kFloorY = 1.5f;          // 相机系 y 向下：地面在相机下方 1.5 米
+    constexpr float kCeilingY = -2.5f;
+    constexpr float kFarDepth = 40.0f;       // 视线没碰到任何面时的远处截断
+    constexpr float kPillarSpacing = 6.0f;   // 两侧墙边每隔这么远一根方柱（给沿走廊方向的跟踪提供约束）
+    constexpr float kPillarSize = 0.8f;
+    constexpr double kNetworkNoiseM = 0.03;    // --bench-track：模拟网络外参的逐帧平移噪声（米）
+    constexpr double kNetworkNoiseDeg = 0.5;   // 逐帧旋转噪声（度）
+
+    // 第 frame 帧的相机位姿：沿世界 z 前进，绕 y 轴左右摆动 ±25°
+    cv::Mat cameraPose(int frame) {
+        const float yaw = 0.45f * std::sin(frame * 0.05f);
+        cv::Mat Rt = cv::Mat::zeros(3, 4, CV_32F);
+        Rt.at<float>(0, 0) = std::cos(yaw);  Rt.at<float>(0, 2) = std::sin(yaw);
+        Rt.at<float>(1, 1) = 1.0f;
+        Rt.at<float>(2, 0) = -std::sin(yaw); Rt.at<float>(2, 2) = std::cos(yaw);
+        Rt.at<float>(2, 3) = frame * kStepPerFrame;
+        return Rt;
+    }
+
+    // 解析渲染走廊的 z 深度：每条视线与四个面求交取最近
+    void renderDepth(const cv::Mat& Rt, cv::Mat& depth) {
+        depth.create(kHeight, kWidth, CV_32F);
+        const float tx = Rt.at<float>(0, 3), ty = Rt.at<float>(1, 3);
+        for (int v = 0; v < kHeight; ++v) {
+            float* row = depth.ptr<float>(v);
+            for (int u = 0; u < kWidth; ++u) {
+                // 单位 z 深度的视线方向变换到世界系，求交参数 s 即 z 深度
+                const float rx = (u - kWidth * 0.5f) / kFocal, ry = (v - kHeight * 0.5f) / kFocal;
+                const float dx = Rt.at<float>(0, 0) * rx + Rt.at<float>(0, 1) * ry + Rt.at<float>(0, 2);
+                const float dy = Rt.at<float>(1, 0) * rx + Rt.at<float>(1, 1) * ry + Rt.at<float>(1, 2);
+                float s = kFarDepth;
+                if (dx > 1e-6f) s = std::min(s, (kHalfWidth - tx) / dx);
+                if (dx < -1e-6f) s = std::min(s, (-kHalfWidth - tx) / dx);
+                if (dy > 1e-6f) s = std::min(s, (kFloorY - ty) / dy);
+                if (dy < -1e-6f) s = std::min(s, (kCeilingY - ty) / dy);
+                // 方柱从地面到天花板，只需在 x-z 平面上与矩形求交（slab 法）
+                const float dz = Rt.at<float>(2, 0) * rx + Rt.at<float>(2, 1) * ry + Rt.at<float>(2, 2);
+                const float tz = Rt.at<float>(2, 3);
+                const int first = (int)std::floor((tz - kFarDepth) / kPillarSpacing), last = (int)std::ceil((tz + kFarDepth) / kPillarSpacing);
+                for (int k = first; k <= last; ++k) {
+                    for (float x0 : { kHalfWidth - kPillarSize, -kHalfWidth }) {
+                        const float z0 = k * kPillarSpacing;
+                        float enter = 0.0f, exit = s;
+                        if (std::abs(dx) > 1e-6f) {
+                            float a = (x0 - tx) / dx, b = (x0 + kPillarSize - tx) / dx;
+                            enter = std::max(enter, std::min(a, b));
+                            exit = std::min(exit, std::max(a, b));
+                        }
+                        else if (tx < x0 || tx > x0 + kPillarSize) continue;
+                        if (std::abs(dz) > 1e-6f) {
+                            float a = (z0 - tz) / dz, b = (z0 + kPillarSize - tz) / dz;
+                            enter = std::max(enter, std::min(a, b));
+                            exit = std::min(exit, std::max(a, b));
+                        }
+                        else if (tz < z0 || tz > z0 + kPillarSize) continue;
+                        if (enter > 0.0f && enter < exit) s = enter;
+                    }
+                }
+                row[u] = s;
+            }
+        }
+    }
+}
+
+int runTsdfBenchmark(int argc, char** argv) {
+    int frameCount = 400;
+    float voxelSize = 0.1f;
+    int threads = 0;
+    bool track = false;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--bench-track") == 0) track = true;
+        if (i + 1 >= argc) continue;
+        if (strcmp(argv[i], "--bench-frames") == 0) frameCount = std::max(1, atoi(argv[i + 1]));
+        if (strcmp(argv[i], "--bench-voxel") == 0) voxelSize = (float)atof(argv[i + 1]);
+        if (strcmp(argv[i], "--bench-threads") == 0) threads = atoi(argv[i + 1]);
+    }
+    if (threads > 0) cv::setNumThreads(threads);
+
+    MappingConfig config;
+    config.voxelSize = voxelSize;
+    TsdfVolume volume(config);
+    IcpTracker tracker;
+    std::mt19937 rng(7);
+    std::normal_distribution<double> noise(0.0, 1.0);
+    cv::Mat K = cv::Mat::eye(3, 3, CV_32F);
+    K.at<float>(0, 0) = kFocal; K.at<float>(1, 1) = kFocal;
+    K.at<float>(0, 2) = kWidth * 0.5f - 0.5f; K.at<float>(1, 2) = kHeight * 0.5f - 0.5f;
+
+    printf("TSDF integration benchmark: %dx%d depth, voxel %.3f m, truncation %.2f m, %d frames, %d threads\n",
+        kWidth, kHeight, volume.config().voxelSize, volume.config().truncation(), frameCount, cv::getNumThreads());
+    if (track) {
+        printf("tracking: ICP against the map, network extrinsics jittered per frame (sigma %.0f cm / %.1f deg)\n",
+            kNetworkNoiseM * 100.0, kNetworkNoiseDeg);
+        printf("%7s %9s %9s %10s %10s %10s %9s %12s %12s\n", "frames", "blocks", "touched", "fuse ms", "icp ms", "model ms", "lost",
+            "net err cm", "icp err cm");
+    }
+    else {
+        printf("%7s %9s %9s %9s %10s %10s %10s\n", "frames", "blocks", "MB", "touched", "alloc ms", "fuse ms", "total ms");
+    }
+
+    const int reportEvery = std::max(1, frameCount / 10);
+    double allocSum = 0, fuseSum = 0, touchedSum = 0;
+    double icpSum = 0, modelSum = 0, netErrSum = 0, icpErrSum = 0;
+    int lost = 0;
+    double firstTotal = -1, lastTotal = 0;
+    cv::Mat depth;
+    for (int frame = 0; frame < frameCount; ++frame) {
+        cv::Mat Rt = cameraPose(frame);
+        renderDepth(Rt, depth);
+        TsdfVolume::IntegrateStats stats;
+        if (track) {
+            // 模拟网络外参：真值上叠加逐帧独立的噪声（第一帧不加，跟踪轨迹与真值同起点）
+            const RigidTransform truth = RigidTransform::fromMat(Rt);
+            const double sr = frame ? kNetworkNoiseDeg * CV_PI / 180.0 : 0.0, st = frame ? kNetworkNoiseM : 0.0;
+            const double xi[6] = { noise(rng) * sr, noise(rng) * sr, noise(rng) * sr, noise(rng) * st, noise(rng) * st, noise(rng) * st };
+            const RigidTransform network = truth * RigidTransform::fromTwist(xi);
+            IcpTracker::Result result = tracker.track(depth, cv::Rect(), K, network.toMat());
+            stats = volume.integrate(depth, cv::Rect(), K, result.pose.toMat());
+            modelSum += tracker.updateModel(volume);
+            icpSum += result.ms;
+            lost += frame > 0 && !result.tracked;
+            netErrSum += (truth.inverse() * network).translationNorm();
+            icpErrSum += (truth.inverse() * result.pose).translationNorm();
+        }
+        else {
+            stats = volume.integrate(depth, cv::Rect(), K, Rt);
+        }
+        allocSum += stats.allocateMs;
+        fuseSum += stats.integrateMs;
+        touchedSum += (double)stats.touchedBlocks;
+
+        const int done = frame + 1;
+        if (done % reportEvery == 0 || done == frameCount) {
+            const int n = (done % reportEvery == 0) ? reportEvery : done % reportEvery;
+            const double total = (allocSum + fuseSum) / n;
+            if (track) {
+                printf("%7d %9zu %9.0f %10.2f %10.2f %10.2f %9d %12.2f %12.2f\n", done, volume.blockCount(), touchedSum / n, total,
+                    icpSum / n, modelSum / n, lost, netErrSum / n * 100.0, icpErrSum / n * 100.0);
+            }
+            else {
+                printf("%7d %9zu %9.1f %9.0f %10.2f %10.2f %10.2f\n", done, volume.blockCount(), volume.memoryBytes() / (1024.0 * 1024.0),
+                    touchedSum / n, allocSum / n, fuseSum / n, total);
+            }
+            if (firstTotal < 0) firstTotal = total;
+            lastTotal = total;
+            allocSum = fuseSum = touchedSum = 0;
+            icpSum = modelSum = netErrSum = icpErrSum = 0;
+            lost = 0;
+        }
+    }
+    printf("per-frame cost, last interval vs first: %.2fx (map grew to %zu blocks)\n",
+        firstTotal > 0 ? lastTotal / firstTotal : 0.0, volume.blockCount());
+    return 0;
+}
@@ -0,0 +1,13 @@
+﻿#pragma once
+
+/**
+ * @brief TSDF 融合基准（命令行 --bench-tsdf）
+ * @details 相机沿一条合成走廊（两侧墙、地面、天花板、墙边方柱，视线左右摆动）前进，逐帧融合解析生成的深度图，
+ *          地图随帧数不断增大；按区间输出已分配块数、内存、每帧触及块数与分配/融合耗时，
+ *          用来确认单帧耗时只取决于视野内的表面、不随地图总大小增长。
+ *          可选 --bench-frames N --bench-voxel 米 --bench-threads N（0 为 OpenCV 默认线程数）。
+ *          加 --bench-track 时给真值外参叠加逐帧噪声作为“网络外参”，用 ICP 跟踪后再融合，
+ *          输出跟踪与模型光线投射耗时、跟丢帧数，以及网络外参与跟踪位姿相对真值的平移误差。
+ * @return 进程退出码
+ */
+int runTsdfBenchmark(int argc, char** argv);
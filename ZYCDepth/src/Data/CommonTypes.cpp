@@ -1,6 +1,9 @@
 ﻿#include "CommonTypes.h"
 #include "Log/Logger.h"
 #include"WebSocket/WebSocketServer.h"
+#include "Data/DepthColormap.h"
+#include "Profiler/TraceProfiler.h"
+#include <cmath>
 /**
  * @brief 获取SharedContext单例实例
  * @details C++11及以上保证局部静态变量初始化线程安全，实现饿汉式单例
@@ -22,6 +25,17 @@ void SharedContext::setCurrentCaptureConfig(CaptureConfig config)
 {
     std::lock_guard<std::mutex> lock(mtx);
 
+    // 回放模式不依赖窗口句柄，直接使用回放源
+    if (config.Method == CaptureMethod::Replay) {
+        config.targetHwnd = nullptr;
+        if (this->currentCaptureConfig != config) {
+            this->currentCaptureConfig = config;
+            this->configVersion++;
+            LOG_INFO("配置已更新: 回放源[" + config.replaySource + "] " + (config.replayRealtime ? "实时回放" : "全速回放"), true);
+        }
+        return;
+    }
+
     // 1. 将网页传来的 UTF-8 窗口名转回 ANSI (GBK)，否则 FindWindowA 找不到中文标题
     std::string ansiWindowName = Utf8ToGbk(config.targetWindowName);
 
@@ -46,6 +60,42 @@ uint64_t SharedContext::getCaptureConfigVersion() const {
     return configVersion.load(std::memory_order_acquire);
 }
 
+InferenceConfig SharedContext::getInferenceConfig() const
+{
+    std::lock_guard<std::mutex> lock(mtx);
+    return currentInferenceConfig;
+}
+
+void SharedContext::setInferenceConfig(const InferenceConfig& config)
+{
+    std::lock_guard<std::mutex> lock(mtx);
+    currentInferenceConfig = config;
+}
+
+PipelineConfig SharedContext::getPipelineConfig() const
+{
+    std::lock_guard<std::mutex> lock(mtx);
+    return currentPipelineConfig;
+}
+
+void SharedContext::setPipelineConfig(const PipelineConfig& config)
+{
+    std::lock_guard<std::mutex> lock(mtx);
+    currentPipelineConfig = config;
+}
+
+MappingConfig SharedContext::getMappingConfig() const
+{
+    std::lock_guard<std::mutex> lock(mtx);
+    return currentMappingConfig;
+}
+
+void SharedContext::setMappingConfig(const MappingConfig& config)
+{
+    std::lock_guard<std::mutex> lock(mtx);
+    currentMappingConfig = config;
+}
+
 
 
 // ========== 建图状态 访问接口 ==========
@@ -61,12 +111,12 @@ bool SharedContext::getIsMapping() const
 /**
  * @brief 设置建图状态
  * @param state 目标建图状态（true-开始建图，false-停止建图）
- * @details 状态变更时唤醒所有阻塞在cv_new_frame的线程，避免线程永久阻塞
+ * @details 状态变更时唤醒所有阻塞等待新帧的线程，避免线程永久阻塞
  */
 void SharedContext::setIsMapping(bool state)
 {
     isMapping = state;
-    cv_new_frame.notify_all(); // 状态改变时唤醒所有卡住的线程（关键）
+    rawChannel.wakeAll(); // 状态改变时唤醒所有卡住的线程（关键）
 }
 
 // ========== 帧数据 写入接口（截图线程专用） ==========
@@ -76,72 +126,114 @@ void SharedContext::setIsMapping(bool state)
  * @details 1. 移动语义写入，无图像拷贝开销
  *          2. 序列号防回退检查：仅当新帧序列号>当前帧时才更新
  *             （避免截图线程异常导致序列号回退，引发建图线程永久阻塞）
- *          3. 锁外通知等待线程：避免等待线程唤醒后竞争锁，提升并发效率
- *          4. 即使新帧被丢弃，少量无效通知无影响（等待条件会再次校验）
+ *          3. 无锁发布：多个读者（推理/UI/网页）不会阻塞截图线程
  */
-void SharedContext::setCurrentFrame(FrameData&& frame)
-{
-    {
-        std::lock_guard<std::mutex> lock(mtx);
-        // 序列号防回退检查：仅更新更大序列号的帧
-        if (frame.sequenceID > currentFrame.sequenceID)
-        {
-            currentFrame = std::move(frame);
-        }
-        // 若新帧序列号<=当前帧，直接丢弃，不更新、不通知
-    }
-    // 锁外通知：提升并发效率
-    cv_new_frame.notify_all();
+FrameHandle SharedContext::setCurrentFrame(FrameData&& frame)
+{
+    // 序列号防回退检查：通道只接受递增的版本号，序列号<=当前帧的直接丢弃
+    long long id = frame.sequenceID;
+    FrameHandle handle = std::make_shared<const FrameData>(std::move(frame));
+    rawChannel.publish(handle, id);
+    return handle;
 }
 
 // ========== 帧数据 读取接口（非阻塞，Web GUI/显示模块专用） ==========
 /**
  * @brief 非阻塞读取当前帧数据
- * @return FrameData 当前帧数据拷贝
- * @details 拷贝仅包含智能指针+double+long long，性能开销可忽略
+ * @return FrameHandle 当前帧句柄
+ * @details 无锁读取，只增加一次引用计数
  *          适用于Web GUI、显示模块等非实时性读取场景
  */
-FrameData SharedContext::getCurrentFrame() const
+FrameHandle SharedContext::getCurrentFrame() const
 {
-    std::lock_guard<std::mutex> lock(mtx);
-    return currentFrame;
+    return rawChannel.load();
 }
 
 // ========== 帧数据 阻塞读取接口（建图算法专用，核心接口） ==========
 /**
  * @brief 阻塞等待新帧数据（建图算法专用）
  * @param lastID 上一次处理的帧序列号
- * @return FrameData 新帧数据（停止建图返回空帧）
+ * @return FrameHandle 新帧句柄（停止建图返回 nullptr）
  * @details 1. 阻塞条件：有新帧（sequenceID > lastID） 或 停止建图（isMapping=false）
- *          2. 停止建图时返回空帧（image=null，sequenceID=-1）
+ *          2. 停止建图时返回 nullptr
  *          3. 保证建图算法只处理递增的有效帧
  */
-FrameData SharedContext::waitForNewFrame(long long lastID)
-{
-    std::unique_lock<std::mutex> lock(mtx);
-    cv_new_frame.wait(lock, [this, lastID]
-        {
-            return (!currentFrame.empty() && currentFrame.sequenceID > lastID) || !isMapping;
-        });
-
-    // 停止推理返回空帧
-    if (!isInferencing)
-    {
-        return FrameData(); // 空帧：image=null，sequenceID=-1
+FrameHandle SharedContext::waitForNewFrame(long long lastID)
+{
+    ZYC_PROFILE_SCOPE("SharedContext::waitForNewFrame");
+    FrameHandle frame;
+    while (isMapping) {
+        if (rawChannel.waitForNewer(lastID, frame, std::chrono::milliseconds(100))) {
+            return isMapping ? frame : nullptr;
+        }
     }
+    // 停止建图返回空句柄
+    return nullptr;
+}
 
-    // 有新帧时返回当前帧
-    return currentFrame;
+FrameHandle SharedContext::waitForNewFrameFor(long long lastID, int timeoutMs)
+{
+    ZYC_PROFILE_SCOPE("SharedContext::waitForNewFrameFor");
+    FrameHandle frame;
+    // 超时或停止推理都返回空句柄，调用方据此重新检查退出条件
+    if (!isInferencing) return nullptr;
+    if (!rawChannel.waitForNewer(lastID, frame, std::chrono::milliseconds(timeoutMs))) return nullptr;
+    if (!isInferencing) return nullptr;
+    return frame;
 }
 
-void SharedContext::setCurrentDepthFrame(FrameData&& frame) {
-    std::lock_guard<std::mutex> lock(mtx);
-    currentDepthFrame = std::move(frame);
+std::shared_ptr<cv::Mat> FrameData::displayImage() const {
+    if (image || !rawDepth || !depthVisual) return image;
+    std::call_once(depthVisual->once, [this] {
+        ZYC_PROFILE_SCOPE("DepthColormap::render");
+        auto visual = std::make_shared<cv::Mat>();
+        DepthColormap::render(*rawDepth, *visual);
+        depthVisual->image = visual;
+    });
+    return depthVisual->image;
 }
 
-FrameData SharedContext::getCurrentDepthFrame() const {
-    std::lock_guard<std::mutex> lock(mtx);
-    return currentDepthFrame;
+cv::Rect CaptureConfig::roiRect(cv::Size frame) const {
+    const cv::Rect full(0, 0, frame.width, frame.height);
+    cv::Rect rect((int)std::lround(roi.x * frame.width), (int)std::lround(roi.y * frame.height),
+        (int)std::lround(roi.width * frame.width), (int)std::lround(roi.height * frame.height));
+    rect &= full;
+    return (rect.width < 16 || rect.height < 16) ? full : rect;
+}
+
+std::vector<cv::Rect> CaptureConfig::maskRects(cv::Size frame) const {
+    const cv::Rect region = roiRect(frame);
+    std::vector<cv::Rect> rects;
+    for (const auto& mask : excludeMasks) {
+        cv::Rect rect((int)std::floor(mask.x * frame.width), (int)std::floor(mask.y * frame.height),
+            (int)std::ceil(mask.width * frame.width), (int)std::ceil(mask.height * frame.height));
+        rect &= region;
+        if (!rect.empty()) rects.push_back(rect);
+    }
+    return rects;
+}
+
+void applyExclusionMasks(cv::Mat& depth, const cv::Rect& roi, const std::vector<cv::Rect>& masks) {
+    if (depth.empty() || roi.empty()) return;
+    const double sx = (double)depth.cols / roi.width, sy = (double)depth.rows / roi.height;
+    const cv::Rect bounds(0, 0, depth.cols, depth.rows);
+    for (const auto& mask : masks) {
+        // 向外取整：与排除区域有交叠的深度像素都置 0
+        int x0 = (int)std::floor((mask.x - roi.x) * sx), y0 = (int)std::floor((mask.y - roi.y) * sy);
+        int x1 = (int)std::ceil((mask.x + mask.width - roi.x) * sx), y1 = (int)std::ceil((mask.y + mask.height - roi.y) * sy);
+        cv::Rect rect = cv::Rect(x0, y0, x1 - x0, y1 - y0) & bounds;
+        if (!rect.empty()) depth(rect).setTo(0.0f);
+    }
+}
+
+void SharedContext::setCurrentDepthFrame(FrameHandle frame) {
+    // 多个推理工作者可能乱序完成，序列号回退的深度帧被通道忽略
+    long long id = frame->sequenceID;
+    depthChannel.publish(std::move(frame), id);
+}
+
+FrameHandle SharedContext::getCurrentDepthFrame() const {
+    return depthChannel.load();
 }
 
 bool SharedContext::getIsInferencing() const
@@ -151,8 +243,9 @@ bool SharedContext::getIsInferencing() const
 
 void SharedContext::setIsInferencing(bool state)
 {
-    cv_new_frame.notify_all(); // 状态改变时唤醒所有卡住的线程（关键）
+    if (state && !isInferencing.exchange(true)) inferenceEnabledAt = std::chrono::steady_clock::now().time_since_epoch().count();
     isInferencing = state;
+    rawChannel.wakeAll(); // 状态改变时唤醒所有卡住的线程（关键）
 }
 
 
@@ -1,11 +1,18 @@
 ﻿#pragma once
+#include <map>
 #include <mutex>
 #include <string>
+#include <vector>
 #include <memory>
 #include <condition_variable>
 #include <atomic>
+#include <chrono>
 #include <opencv2/opencv.hpp>
 #include <windows.h>
+#include "Data/LatestChannel.h"
+#include "Data/FrameTrace.h"
+#include "Data/PipelineMetrics.h"
+#include "Data/MapMesh.h"
 /**
  * @brief 截图方法枚举类型
  * @details 支持三种主流Windows窗口截图方式，适配不同场景的性能/兼容性需求
@@ -14,7 +21,8 @@ enum class CaptureMethod
 {
     GDI,        ///< GDI截图：兼容性最好，性能中等
     DirectX,    ///< DirectX截图：性能最优，适配DirectX渲染窗口
-    WinGC       ///< WinGC截图：适配Windows Graphics Capture接口（Win10+）
+    WinGC,      ///< WinGC截图：适配Windows Graphics Capture接口（Win10+）
+    Replay      ///< 录制回放：从视频文件或图片序列读取帧，用于可复现的离线性能测试
 };
 
 /**
@@ -26,13 +34,41 @@ struct CaptureConfig
     std::string targetWindowName = "GameProcess";      ///< 目标截图窗口名称，默认"GameProcess"
     HWND targetHwnd = nullptr;      ///< 目标窗口句柄
     int captureFps = 30;//截图频率
+    bool adaptivePacing = false;     ///< 自适应节拍：截图节奏锁定到推理等下游的实际消费速度（captureFps 作为上限）
+
+    // 回放配置（仅 Method == Replay 时生效）
+    std::string replaySource;        ///< 回放源：视频文件路径，或存放图片序列的目录
+    bool replayRealtime = true;      ///< true-按源帧率实时回放（模拟真实窗口），false-尽可能快地逐帧输出
+    double replayFps = 0.0;          ///< 实时回放的帧率，<=0 时使用视频自带帧率（图片序列默认 30）
+    bool replayLoop = true;          ///< 播放结束后是否从头循环
+
+    // 画面变化检测：静止的菜单/暂停画面不再重复推理，复用上一个深度帧
+    double changeThreshold = 2.0;    ///< 缩略图每格平均灰度差 (0~255) 超过该值才算变化，<0 关闭检测（每帧都推理）
+    int staticRefreshMs = 1000;      ///< 画面静止时至少每隔多久仍推理一次，<=0 不强制
+
+    // 推理区域：模型的固定分辨率只花在画面中有用的部分（去掉边框、底部 HUD 等），坐标相对客户区归一化
+    cv::Rect2f roi{ 0.0f, 0.0f, 1.0f, 1.0f };
+    std::vector<cv::Rect2f> excludeMasks;   ///< 排除区域（小地图、血条等 HUD），对应的深度置 0，回投与建图跳过，变化检测忽略
+
+    // 按原图尺寸换算成像素坐标：ROI 裁到画面内，过小（< 16 像素）时退回整幅；排除区域只保留与 ROI 相交的部分
+    cv::Rect roiRect(cv::Size frame) const;
+    std::vector<cv::Rect> maskRects(cv::Size frame) const;
 
     // 重载!= 运算符
     bool operator!=(const CaptureConfig& other) const {
         return (this->Method != other.Method) ||
             (this->targetWindowName != other.targetWindowName) ||
             (this->targetHwnd != other.targetHwnd) || 
-            (this->captureFps != other.captureFps);
+            (this->captureFps != other.captureFps) ||
+            (this->adaptivePacing != other.adaptivePacing) ||
+            (this->replaySource != other.replaySource) ||
+            (this->replayRealtime != other.replayRealtime) ||
+            (this->replayFps != other.replayFps) ||
+            (this->replayLoop != other.replayLoop) ||
+            (this->changeThreshold != other.changeThreshold) ||
+            (this->staticRefreshMs != other.staticRefreshMs) ||
+            (this->roi != other.roi) ||
+            (this->excludeMasks != other.excludeMasks);
     }
 
     // 重载== 运算符（!=的反向逻辑，保证运算符完整性）
@@ -42,23 +78,243 @@ struct CaptureConfig
 
 };
 
+/**
+ * @brief 推理精度
+ */
+enum class InferencePrecision {
+    FP32,   ///< 原始浮点模型，可用 CUDA
+    INT8    ///< 静态量化 (QDQ) 模型，固定走 CPU 执行后端
+};
+
+/**
+ * @brief 深度推理配置
+ * @details 推理线程启动时读取，修改后需重启推理线程生效
+ */
+struct InferenceConfig
+{
+    std::string modelPath = "models/DA3-SMALL-504.onnx";  ///< 模型路径
+    InferencePrecision precision = InferencePrecision::FP32;
+    std::string int8ModelPath = "models/DA3-SMALL-504.int8.onnx"; ///< INT8 模型路径，由 models/quantize_onnx.py 生成
+
+    // 多尺寸模型：由 models/export_onnx.py --shapes 导出，文件不存在时跳过（INT8 模式下使用同名 .int8.onnx）
+    std::vector<std::string> modelVariants = {
+        "models/DA3-SMALL-336x588.onnx",
+        "models/DA3-SMALL-252x448.onnx",
+        "models/DA3-SMALL-504x896.onnx",
+    };
+    double latencyBudgetMs = 0.0; ///< 单帧推理延迟预算，按预热耗时筛选模型尺寸；0 表示不限制（取宽高比最接近中分辨率最高者）
+    int pipelineDepth = 3;      ///< 流水线在途帧数：1-串行，2-双缓冲（预处理与推理重叠），3-三缓冲（预处理/推理/后处理全重叠）
+
+    // 关键帧深度传播：完整网络只跑关键帧，中间帧用光流搬运关键帧深度（启动参数 --propagate）
+    bool depthPropagation = false;
+    int propagationFlowWidth = 320;     ///< 光流图宽度（高度按原图比例）
+    int keyframeMaxGap = 8;             ///< 连续传播多少帧后强制关键帧
+    double keyframeMaxWarpError = 6.0;  ///< 光流回投的平均灰度误差 (0~255) 超过该值时请求关键帧
+    double keyframeMaxInvalid = 0.2;    ///< 映射落到关键帧外的像素比例超过该值时请求关键帧
+
+    // 执行后端/线程自动调优
+    bool autoTune = true;       ///< 启动时自动选择 p95 延迟最低的后端与线程配置，结果按模型哈希+CPU 签名缓存
+    int autoTuneWarmupRuns = 2; ///< 每组候选配置的预热次数
+    int autoTuneMeasureRuns = 10; ///< 每组候选配置的计时次数
+    std::string tuningCachePath = "models/tuning_cache.json"; ///< 调优结果缓存文件
+
+    // 快速启动
+    bool cacheOptimizedModel = true; ///< 把图优化后的模型以 ORT 格式缓存到源模型旁边，之后映射加载
+    int warmupRuns = 3;         ///< 流水线就绪前的预热推理次数（触发 ORT 惰性内核选择/内存规划）
+
+    // 量化校准帧录制
+    std::string calibrationDir = "models/calib_frames"; ///< 校准帧输出目录
+    int calibrationInterval = 15;   ///< 每隔多少帧保存一帧，避免相邻帧高度重复
+    int calibrationMaxFrames = 300; ///< 最多保存的帧数
+
+    const std::string& activeModelPath() const { return precision == InferencePrecision::INT8 ? int8ModelPath : modelPath; }
+};
+
+/**
+ * @brief 流水线阶段的调度参数
+ */
+struct StageTuning {
+    int concurrency = 1;     ///< 该阶段最多同时运行的实例数（如 2 个推理工作者）
+    double cpuBudget = 0.0;  ///< CPU 预算（核数，0.5 表示平均最多占半个核），0 表示不限制
+};
+
+/**
+ * @brief 流水线图配置
+ * @details 阶段名见 SystemManager::buildPipeline；未列出的阶段使用默认值（并发 1，不限预算）。
+ *          截图与发布阶段是单写者，并发数固定为 1。系统启动时读取。
+ */
+struct PipelineConfig {
+    int workerThreads = 0;   ///< 共享工作线程数，0 表示取各阶段并发数之和（保证每个阶段随时有线程可用）
+    std::map<std::string, StageTuning> stages = {
+        { "infer",  { 1, 0.0 } },
+        { "encode", { 1, 1.0 } },  // 网页编码（JPEG/Base64）最多占一个核，不和推理抢 CPU
+    };
+
+    StageTuning stage(const std::string& name) const {
+        auto it = stages.find(name);
+        return it != stages.end() ? it->second : StageTuning();
+    }
+};
+
+/**
+ * @brief 建图（TSDF 融合）配置
+ * @details 建图阶段每帧读取；体素尺寸或截断距离变化时清空已有地图重新融合
+ */
+struct MappingConfig {
+    float voxelSize = 0.1f;          ///< 体素边长（米），体素块为 8³ 个体素
+    float truncationVoxels = 4.0f;   ///< 截断距离（体素数），表面前后各这么厚的一层参与融合
+    float minDepth = 0.1f;           ///< 有效深度范围（米），范围外的深度不参与融合
+    float maxDepth = 50.0f;
+    float maxWeight = 64.0f;         ///< 体素权重上限：地图在场景变化后能以约 1/maxWeight 的速度更新
+    int allocationStride = 2;        ///< 分配体素块时深度图的采样步长（像素），融合本身逐体素投影，不受影响
+    int meshIntervalMs = 200;        ///< 增量提取网格的最小间隔，期间多次融合的块只三角化一次；<0 不提取网格
+    bool icpTracking = true;         ///< 融合前用帧到模型 ICP 修正网络外参；关闭时直接用网络外参
+    // 特征点视觉里程计：在截图帧上与推理并行运行，给 ICP 提供比网络外参更准的帧间运动
+    bool featureOdometry = true;
+    int odometryWidth = 640;         ///< 特征提取的工作宽度（ROI 缩放到该宽度）
+    int odometryFeatures = 1000;     ///< 每帧目标特征点数（各金字塔层按面积分配）
+    // 关键帧：只有关键帧融合进地图，其余帧只做跟踪（需要 ICP 跟踪）
+    bool keyframeMapping = true;
+    float keyframeDistance = 0.3f;   ///< 相对上一关键帧的平移超过该值（米）即成为关键帧
+    float keyframeAngleDeg = 10.0f;  ///< 相对上一关键帧的旋转超过该值（度）即成为关键帧
+    float keyframeMinOverlap = 0.7f; ///< ICP 内点比例低于该值（视野里新内容变多）即成为关键帧
+    bool loopClosure = true;         ///< 关键帧地点识别 + 位姿图优化，闭合回环后把地图块搬到校正后的位置
+
+    float truncation() const { return voxelSize * truncationVoxels; }
+};
+
+/**
+ * @brief 建图统计（建图阶段写入，UI 读取）
+ */
+struct MappingStats {
+    size_t blocks = 0;           ///< 已分配的体素块数
+    size_t memoryBytes = 0;      ///< 体素块占用的内存
+    size_t touchedBlocks = 0;    ///< 最近一帧融合的体素块数
+    double allocateMs = 0.0;     ///< 最近一帧：分配（找出截断带覆盖的体素块）耗时
+    double integrateMs = 0.0;    ///< 最近一帧：逐体素融合耗时
+    uint64_t frames = 0;         ///< 已融合的帧数
+    size_t meshChunks = 0;       ///< 非空的网格分块数
+    size_t meshTriangles = 0;
+    size_t remeshedBlocks = 0;   ///< 最近一次增量提取重新三角化的块数
+    double meshMs = 0.0;         ///< 最近一次增量提取耗时
+    bool tracking = false;       ///< 最近一帧 ICP 跟踪成功（关闭跟踪时为 false）
+    bool odometryPrior = false;  ///< 最近一帧 ICP 初值的帧间运动来自视觉里程计
+    float icpRms = 0.0f;         ///< 最近一帧点到平面残差均方根（米）
+    float icpInlierRatio = 0.0f;
+    double icpMs = 0.0;          ///< 最近一帧 ICP 耗时
+    double raycastMs = 0.0;      ///< 最近一帧模型光线投射耗时
+    uint64_t lostFrames = 0;     ///< 跟踪丢失（退回网络外参）的累计帧数
+    size_t keyframes = 0;        ///< 关键帧数（关闭关键帧时为 0）
+    uint64_t loops = 0;          ///< 已闭合的回环数
+    double loopMs = 0.0;         ///< 最近一次回环检测（含验证与位姿图优化）耗时
+    size_t reanchoredBlocks = 0; ///< 最近一次闭合回环后搬动的体素块数
+};
+
+/**
+ * @brief 视觉里程计统计（odometry 阶段写入，UI 读取）
+ */
+struct OdometryStats {
+    bool tracked = false;        ///< 最近一帧 PnP 成功
+    int features = 0;            ///< 最近一帧提取的特征点数
+    int matches = 0;             ///< 最近一帧与参考关键帧的匹配数
+    int inliers = 0;             ///< 最近一帧 PnP 内点数
+    int referencePoints = 0;     ///< 参考关键帧中有深度的特征点数
+    double extractMs = 0.0;      ///< 最近一帧特征提取耗时
+    double trackMs = 0.0;        ///< 最近一帧匹配 + PnP 耗时
+    uint64_t lostFrames = 0;     ///< 有参考关键帧却没跟上的累计帧数
+};
+
+/**
+ * @brief 推理启动耗时统计（毫秒），加载、预热、首帧三段分别计时
+ */
+struct StartupMetrics {
+    double modelLoadMs = 0.0;        ///< 会话创建耗时（含调优、图优化或缓存加载）
+    double warmupMs = 0.0;           ///< 预热推理耗时
+    double readyMs = 0.0;            ///< 从加载线程启动到流水线就绪
+    double firstDepthFrameMs = -1.0; ///< 从推理放行（就绪且已开启推理，取较晚者）到首个深度帧发布，-1 表示尚未产生
+    bool optimizedCacheHit = false;  ///< 是否命中优化模型缓存
+};
+
+/**
+ * @brief 帧缓冲池统计
+ */
+struct FramePoolStats {
+    uint64_t hits = 0;      ///< 从池中复用到缓冲的次数
+    uint64_t misses = 0;    ///< 池中无可用缓冲而新分配的次数
+    uint64_t exhausted = 0; ///< 缓冲全部借出、本帧被丢弃的次数
+    int64_t inFlight = 0;   ///< 已借出、尚未归还的缓冲数
+    size_t pooled = 0;      ///< 池中空闲缓冲数
+};
+
+/**
+ * @brief 深度帧的延迟可视化结果
+ * @details 同一序列号的所有 FrameData 拷贝共享一个实例，第一个需要显示的消费者负责生成，
+ *          其余消费者直接复用；没有消费者（无界面/无网页客户端）时不产生任何开销。
+ */
+struct LazyDepthVisual {
+    std::once_flag once;
+    std::shared_ptr<cv::Mat> image;
+};
+
 /**
  * @brief 帧数据结构
  * @details 封装图像数据、时间戳、序列号，用于多模块跨线程共享帧数据
  *          采用智能指针避免图像拷贝，序列号保证帧的递增唯一性
  */
 struct FrameData {
-    std::shared_ptr<cv::Mat> image;      // 对于原图是 BGR，对于深度图是可视化图
+    std::shared_ptr<cv::Mat> image;      // 原图 (BGRA)；深度帧为空，可视化图通过 displayImage() 按需生成
     std::shared_ptr<cv::Mat> rawDepth;   // [新增] 原始 float32 深度数据
+    std::shared_ptr<LazyDepthVisual> depthVisual; // 深度帧的可视化图（按需生成，每个序列号最多一次）
     cv::Mat intrinsics;                  // [新增] 3x3 内参
     cv::Mat extrinsics;                  // [新增] 3x4 外参
 
+    std::shared_ptr<FrameTrace> trace;   // 逐阶段单调时钟时间戳，原图帧与对应深度帧共享
+
     long long sequenceID = -1;
-    double timestamp = 0.0;
+    bool unchanged = false;              // 截图阶段判定与上一个关键帧相比画面未变化，不再送去推理
+    bool propagated = false;             // 深度帧由光流从关键帧深度传播而来（非网络直接输出）
+
+    // 推理区域（原图像素坐标）：原图帧为截图时按配置换算的 ROI，为空表示整幅；深度帧为深度图覆盖的原图区域
+    cv::Rect roi;
+    cv::Size frameSize;                  // 原图尺寸（深度帧没有 image，靠它与 roi 把深度像素映射回原图）
+    std::vector<cv::Rect> masks;         // 排除区域（原图像素坐标），深度帧中对应的深度已置 0
+    double timestamp = 0.0;              // 系统时钟毫秒（墙钟，给网页显示用）；延迟统计用 trace
     double captureDurationMs = 0.0;
-    inline bool empty() const { return !image || image->empty(); }
+    inline bool empty() const { return (!image || image->empty()) && (!rawDepth || rawDepth->empty()); }
+
+    /**
+     * @brief 用于显示的图像
+     * @details 原图帧直接返回 image；深度帧首次调用时生成伪彩色图（线程安全），之后直接返回缓存
+     */
+    std::shared_ptr<cv::Mat> displayImage() const;
+
+    // 原图帧中送去推理的区域：roi 为空时取整幅
+    cv::Rect region() const { return roi.empty() && image ? cv::Rect(0, 0, image->cols, image->rows) : roi; }
+
+    /**
+     * @brief 深度图像素 (u, v) 对应的原图像素坐标（像素中心对齐）
+     * @details 内参是原图像素坐标系下的，回投前先用它换算：x = (frame.x - cx) * z / fx
+     */
+    cv::Point2f depthToFrame(float u, float v) const {
+        float sx = (float)roi.width / rawDepth->cols, sy = (float)roi.height / rawDepth->rows;
+        return { roi.x + (u + 0.5f) * sx - 0.5f, roi.y + (v + 0.5f) * sy - 0.5f };
+    }
 };
 
+/**
+ * @brief 把排除区域对应的深度置 0（下游回投与建图按 z <= 0 跳过）
+ * @param depth 深度图，覆盖原图中的 roi 区域
+ * @param roi 深度图覆盖的原图区域（像素）
+ * @param masks 排除区域（原图像素坐标）
+ */
+void applyExclusionMasks(cv::Mat& depth, const cv::Rect& roi, const std::vector<cv::Rect>& masks);
+
+/**
+ * @brief 帧句柄
+ * @details 帧发布后不可修改，各模块通过句柄共享同一份 FrameData，读取时只有一次引用计数开销
+ */
+using FrameHandle = std::shared_ptr<const FrameData>;
+
 /**
  * @brief 多模块共享上下文类
  * @details 单例模式，线程安全，封装所有全局共享状态
@@ -83,16 +339,34 @@ private:
     SharedContext& operator=(SharedContext&&) = delete;
 
     // 共享状态成员（私有，仅通过加锁接口访问）
-    mutable std::mutex mtx;                  ///< 可变互斥锁：支持const成员函数中加锁操作
-    std::condition_variable cv_new_frame;    ///< 条件变量：截图线程通知新帧，解决建图线程忙等待问题
+    mutable std::mutex mtx;                  ///< 可变互斥锁：保护截图/推理配置（帧数据走无锁通道，不再使用该锁）
     std::atomic<uint64_t> configVersion{ 0 }; // <--- 截图配置版本号（原子变量）用来判断配置是否更改过
     CaptureConfig currentCaptureConfig;     ///< 截图配置
+    InferenceConfig currentInferenceConfig; ///< 推理配置
+    PipelineConfig currentPipelineConfig;   ///< 流水线图配置
+    MappingConfig currentMappingConfig;     ///< 建图配置
     std::atomic<bool> isMapping = false;               ///< 建图状态（原子变量）：true-建图中，false-停止建图
     std::atomic<bool> isInferencing = false;               ///< 建图状态（原子变量）：true-建图中，false-停止建图
-    FrameData currentFrame;                             ///< 核心共享数据：当前帧（截图线程写入，多模块读取）
-    FrameData currentDepthFrame; // 存储最新的深度估计结果
+    std::atomic<std::chrono::steady_clock::rep> inferenceEnabledAt{ 0 }; ///< 最近一次开启推理的时刻（steady_clock 计数）
+    std::atomic<bool> isRecording = false;              ///< 校准帧录制状态（原子变量）
+    std::atomic<int> recordedFrames = 0;                ///< 已录制的校准帧数
+    // 核心共享数据：原图 / 深度两路“最新值”通道，单写者（截图线程 / 推理后处理线程）、多读者，无锁
+    // 初始值为空帧句柄，读者拿到的句柄永远非空
+    LatestChannel<FrameHandle> rawChannel{ std::make_shared<const FrameData>() };
+    LatestChannel<FrameHandle> depthChannel{ std::make_shared<const FrameData>() };
     std::atomic<double> lastCaptureTimeMs{ 0.0 };
     std::atomic<double> lastInferenceTimeMs{ 0.0 };
+    mutable std::mutex poolStatsMtx;
+    FramePoolStats framePoolStats;           ///< 截图帧池统计（截图线程写入，UI 读取）
+    mutable std::mutex startupMtx;
+    StartupMetrics startupMetrics;           ///< 推理启动耗时（推理线程写入，UI 读取）
+    mutable std::mutex mappingStatsMtx;
+    MappingStats mappingStats;               ///< 建图统计（建图阶段写入，UI 读取）
+    mutable std::mutex odometryStatsMtx;
+    OdometryStats odometryStats;             ///< 视觉里程计统计（odometry 阶段写入，UI 读取）
+    LatestChannel<MapMeshHandle> meshChannel{ std::make_shared<const MapMeshSnapshot>() };   ///< 最新地图网格（建图阶段写入，UI/网页读取）
+    LatencyTracker latencyTracker;           ///< 端到端延迟直方图（发布/网页编码阶段写入，UI 与 /metrics 读取，无锁）
+    PipelineMetrics pipelineMetrics;         ///< 帧率、发送字节数等计数（各阶段写入，/metrics 读取，无锁）
 
 public:
     /**
@@ -114,6 +388,18 @@ public:
 
     uint64_t getCaptureConfigVersion() const;
 
+    InferenceConfig getInferenceConfig() const;
+
+    void setInferenceConfig(const InferenceConfig& config);
+
+    PipelineConfig getPipelineConfig() const;
+
+    void setPipelineConfig(const PipelineConfig& config);
+
+    MappingConfig getMappingConfig() const;
+
+    void setMappingConfig(const MappingConfig& config);
+
     // ========== 建图状态 访问接口 ==========
     /**
      * @brief 获取建图状态
@@ -124,7 +410,7 @@ public:
     /**
      * @brief 设置建图状态
      * @param state 目标建图状态（true-开始建图，false-停止建图）
-     * @details 状态变更时会唤醒所有阻塞在cv_new_frame的线程，避免线程永久阻塞
+     * @details 状态变更时会唤醒所有阻塞等待新帧的线程，避免线程永久阻塞
      */
     void setIsMapping(bool state);
 
@@ -134,37 +420,58 @@ public:
      * @param frame 待写入的帧数据（右值引用，移动语义）
      * @details 1. 移动语义写入，无图像拷贝开销
      *          2. 序列号防回退检查：仅当新帧序列号>当前帧时才更新
-     *          3. 锁外通知等待线程，提升并发效率
+     *          3. 无锁发布，读者不会阻塞截图线程
+     * @return FrameHandle 发布出去的帧句柄，供截图阶段继续传给下游
      */
-    void setCurrentFrame(FrameData&& frame);
+    FrameHandle setCurrentFrame(FrameData&& frame);
 
     // ========== 帧数据 读取接口（非阻塞，Web GUI/显示模块专用） ==========
     /**
      * @brief 非阻塞读取当前帧数据
-     * @return FrameData 当前帧数据拷贝（仅包含智能指针+基础类型，开销可忽略）
-     * @details 适用于Web GUI、显示模块等非实时性读取场景，不阻塞调用线程
+     * @return FrameHandle 当前帧句柄（永远非空，尚无帧时指向空帧）
+     * @details 无锁，仅一次引用计数开销；适用于Web GUI、显示模块等非实时性读取场景
      */
-    FrameData getCurrentFrame() const;
+    FrameHandle getCurrentFrame() const;
 
     // ========== 帧数据 阻塞读取接口（算法专用，核心接口） ==========
     /**
      * @brief 阻塞等待新帧数据（算法专用）
      * @param lastID 上一次处理的帧序列号
-     * @return FrameData 新帧数据（若停止建图则返回空帧）
+     * @return FrameHandle 新帧句柄（若停止建图则返回 nullptr）
      * @details 1. 阻塞直到有新帧（sequenceID > lastID）或停止建图
-     *          2. 停止建图时返回空帧（image=null，sequenceID=-1）
+     *          2. 停止建图时返回 nullptr
      *          3. 是算法消费新帧的核心接口，保证帧的时序性
      */
-    FrameData waitForNewFrame(long long lastID);
+    FrameHandle waitForNewFrame(long long lastID);
+
+    /**
+     * @brief 带超时的阻塞等待新帧
+     * @param lastID 上一次处理的帧序列号
+     * @param timeoutMs 最长等待时间（毫秒）
+     * @return FrameHandle 新帧句柄；超时、停止推理时返回 nullptr
+     * @details 供需要周期性检查自身退出标志的工作线程使用（如推理流水线）
+     */
+    FrameHandle waitForNewFrameFor(long long lastID, int timeoutMs);
 
-    void setCurrentDepthFrame(FrameData&& frame);
+    // 写入深度帧（推理后处理线程专用），序列号为对应原图帧的序列号
+    void setCurrentDepthFrame(FrameHandle frame);
 
-    FrameData getCurrentDepthFrame() const;
+    FrameHandle getCurrentDepthFrame() const;
 
     bool getIsInferencing() const;
 
     void setIsInferencing(bool state);
 
+    // 最近一次由关闭变为开启推理的时刻，从未开启时为 time_point 零值
+    std::chrono::steady_clock::time_point getInferenceEnabledTime() const {
+        return std::chrono::steady_clock::time_point(std::chrono::steady_clock::duration(inferenceEnabledAt.load()));
+    }
+
+    bool getIsRecording() const { return isRecording.load(); }
+    void setIsRecording(bool state) { isRecording = state; }
+    int getRecordedFrames() const { return recordedFrames.load(); }
+    void setRecordedFrames(int count) { recordedFrames = count; }
+
     static std::string Utf8ToGbk(const std::string& strUtf8);
 
     static std::string GbkToUtf8(const std::string& strGbk);
@@ -173,4 +480,16 @@ public:
     double getCaptureTime() const { return lastCaptureTimeMs.load(); }
     void setInferenceTime(double ms) { lastInferenceTimeMs = ms; }
     double getInferenceTime() const { return lastInferenceTimeMs.load(); }
+    void setFramePoolStats(const FramePoolStats& stats) { std::lock_guard<std::mutex> lock(poolStatsMtx); framePoolStats = stats; }
+    FramePoolStats getFramePoolStats() const { std::lock_guard<std::mutex> lock(poolStatsMtx); return framePoolStats; }
+    void setStartupMetrics(const StartupMetrics& metrics) { std::lock_guard<std::mutex> lock(startupMtx); startupMetrics = metrics; }
+    StartupMetrics getStartupMetrics() const { std::lock_guard<std::mutex> lock(startupMtx); return startupMetrics; }
+    void setMappingStats(const MappingStats& stats) { std::lock_guard<std::mutex> lock(mappingStatsMtx); mappingStats = stats; }
+    MappingStats getMappingStats() const { std::lock_guard<std::mutex> lock(mappingStatsMtx); return mappingStats; }
+    void setOdometryStats(const OdometryStats& stats) { std::lock_guard<std::mutex> lock(odometryStatsMtx); odometryStats = stats; }
+    OdometryStats getOdometryStats() const { std::lock_guard<std::mutex> lock(odometryStatsMtx); return odometryStats; }
+    void setMapMesh(MapMeshHandle mesh) { long long version = (long long)mesh->version; meshChannel.publish(std::move(mesh), version); }
+    MapMeshHandle getMapMesh() const { return meshChannel.load(); }
+    LatencyTracker& getLatencyTracker() { return latencyTracker; }
+    PipelineMetrics& getPipelineMetrics() { return pipelineMetrics; }
 };
\ No newline at end of file
@@ -0,0 +1,84 @@
+﻿#include "DepthColormap.h"
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <vector>
+
+namespace {
+    // INFERNO 调色板，首次使用时由 OpenCV 内置色表生成一次
+    const std::array<cv::Vec3b, 256>& infernoPalette() {
+        static const std::array<cv::Vec3b, 256> palette = [] {
+            cv::Mat ramp(1, 256, CV_8UC1);
+            for (int i = 0; i < 256; ++i) ramp.at<uchar>(0, i) = (uchar)i;
+            cv::Mat colored;
+            cv::applyColorMap(ramp, colored, cv::COLORMAP_INFERNO);
+            std::array<cv::Vec3b, 256> table;
+            for (int i = 0; i < 256; ++i) table[i] = colored.at<cv::Vec3b>(0, i);
+            return table;
+        }();
+        return palette;
+    }
+}
+
+void DepthColormap::render(const cv::Mat& depth, cv::Mat& dst, float lowPercentile, float highPercentile) {
+    CV_Assert(depth.type() == CV_32FC1);
+    const auto& palette = infernoPalette();
+    dst.create(depth.size(), CV_8UC3);
+
+    double minV, maxV;
+    cv::minMaxLoc(depth, &minV, &maxV);
+    if (!(maxV > minV)) {
+        dst.setTo(cv::Scalar(palette[0][0], palette[0][1], palette[0][2]));
+        return;
+    }
+
+    // 1. 直方图（1024 桶）求分位数
+    constexpr int kBins = 1024;
+    std::vector<uint32_t> hist(kBins, 0);
+    const float lo0 = (float)minV, hi0 = (float)maxV;
+    const float binScale = (kBins - 1) / (hi0 - lo0);
+    uint64_t valid = 0;
+    for (int y = 0; y < depth.rows; ++y) {
+        const float* row = depth.ptr<float>(y);
+        for (int x = 0; x < depth.cols; ++x) {
+            float v = row[x];
+            if (!(v >= lo0 && v <= hi0)) continue; // 跳过 NaN
+            hist[(int)((v - lo0) * binScale)]++;
+            valid++;
+        }
+    }
+    const uint64_t lowCount = (uint64_t)(lowPercentile * valid);
+    const uint64_t highCount = (uint64_t)(highPercentile * valid);
+    int lowBin = 0, highBin = kBins - 1;
+    uint64_t cumulative = 0;
+    bool lowFound = false;
+    for (int b = 0; b < kBins; ++b) {
+        cumulative += hist[b];
+        if (!lowFound && cumulative > lowCount) {
+            lowBin = b;
+            lowFound = true;
+        }
+        if (cumulative >= highCount) {
+            highBin = b;
+            break;
+        }
+    }
+    float lo = lo0 + lowBin / binScale;
+    float hi = lo0 + (highBin + 1) / binScale;
+    if (!(hi > lo)) hi = lo + 1e-6f;
+
+    // 2. 量化 + 查表，按行并行；超出分位区间的像素由 saturate_cast 截断到两端颜色
+    const double scale = 255.0 / (hi - lo);
+    const double offset = -lo * scale;
+    cv::parallel_for_(cv::Range(0, depth.rows), [&](const cv::Range& range) {
+        std::vector<uchar> indices(depth.cols);
+        cv::Mat indexRow(1, depth.cols, CV_8UC1, indices.data());
+        for (int y = range.start; y < range.end; ++y) {
+            depth.row(y).convertTo(indexRow, CV_8U, scale, offset);
+            uchar* out = dst.ptr<uchar>(y);
+            for (int x = 0; x < depth.cols; ++x) {
+                std::memcpy(out + 3 * x, palette[indices[x]].val, 3);
+            }
+        }
+    });
+}
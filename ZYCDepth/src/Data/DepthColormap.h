@@ -0,0 +1,19 @@
+﻿#pragma once
+#include <opencv2/opencv.hpp>
+
+/**
+ * @brief 深度图伪彩色可视化
+ * @details 1. 直方图求分位数做鲁棒归一化（默认 1%~99%），少量离群像素（天空、近处遮挡）不会压缩整体对比度
+ *          2. 归一化直接用 convertTo (SIMD) 量化到 8 位索引，再查 256 色 INFERNO 调色板，按行并行
+ *          不产生中间整图，输出 CV_8UC3 (BGR)。
+ */
+class DepthColormap {
+public:
+    /**
+     * @param depth 原始深度图 (CV_32FC1)
+     * @param dst 输出 BGR 伪彩色图，尺寸与 depth 相同
+     * @param lowPercentile 映射到调色板起点的分位数
+     * @param highPercentile 映射到调色板终点的分位数
+     */
+    static void render(const cv::Mat& depth, cv::Mat& dst, float lowPercentile = 0.01f, float highPercentile = 0.99f);
+};
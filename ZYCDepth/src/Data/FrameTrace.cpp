@@ -0,0 +1,157 @@
+﻿#include "FrameTrace.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+    constexpr double kMinMs = 1e-3;        // 1 µs
+    constexpr double kGrowth = 1.05;       // 相邻桶宽 5%
+    const double kLogGrowth = std::log(kGrowth);
+    // 1 µs * 1.05^n >= 100 s
+    const int kBucketCount = (int)std::ceil(std::log(1e5 / kMinMs) / std::log(kGrowth)) + 1;
+}
+
+LatencyHistogram::LatencyHistogram() {
+    for (auto& slice : slices) {
+        slice.counts = std::make_unique<std::atomic<uint32_t>[]>(kBucketCount);
+        for (int i = 0; i < kBucketCount; ++i) slice.counts[i].store(0, std::memory_order_relaxed);
+    }
+    lifetime = std::make_unique<std::atomic<uint64_t>[]>(kBucketCount);
+    for (int i = 0; i < kBucketCount; ++i) lifetime[i].store(0, std::memory_order_relaxed);
+}
+
+int64_t LatencyHistogram::nowSecond() {
+    return std::chrono::duration_cast<std::chrono::seconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+int LatencyHistogram::bucketOf(double ms) {
+    if (ms <= kMinMs) return 0;
+    return std::min(kBucketCount - 1, (int)(std::log(ms / kMinMs) / kLogGrowth) + 1);
+}
+
+double LatencyHistogram::bucketValue(int bucket) {
+    if (bucket == 0) return kMinMs;
+    // 桶 b 覆盖 (kMinMs * g^(b-1), kMinMs * g^b]，取几何中点
+    return kMinMs * std::pow(kGrowth, bucket - 0.5);
+}
+
+double LatencyHistogram::bucketUpper(int bucket) {
+    return kMinMs * std::pow(kGrowth, bucket);
+}
+
+void LatencyHistogram::record(double ms) {
+    if (ms < 0.0) return;
+    const int bucket = bucketOf(ms);
+    const int64_t second = nowSecond();
+    Slice& slice = slices[(size_t)(second % kWindowSeconds)];
+    int64_t sliceSecond = slice.second.load(std::memory_order_acquire);
+    // 分片已过期：抢到换秒权的写入者负责清零
+    if (sliceSecond != second && slice.second.compare_exchange_strong(sliceSecond, second, std::memory_order_acq_rel)) {
+        for (int i = 0; i < kBucketCount; ++i) slice.counts[i].store(0, std::memory_order_relaxed);
+        slice.max.store(0.0, std::memory_order_relaxed);
+    }
+    slice.counts[bucket].fetch_add(1, std::memory_order_relaxed);
+    double prevMax = slice.max.load(std::memory_order_relaxed);
+    while (ms > prevMax && !slice.max.compare_exchange_weak(prevMax, ms, std::memory_order_relaxed)) {}
+
+    lifetime[bucket].fetch_add(1, std::memory_order_relaxed);
+    lifetimeTotal.fetch_add(1, std::memory_order_relaxed);
+    lifetimeSumNs.fetch_add((uint64_t)(ms * 1e6), std::memory_order_relaxed);
+}
+
+LatencyHistogram::Summary LatencyHistogram::summary() const {
+    int64_t second = nowSecond();
+    std::vector<uint64_t> merged(kBucketCount, 0);
+    Summary result;
+    for (const auto& slice : slices) {
+        int64_t sliceSecond = slice.second.load(std::memory_order_acquire);
+        if (sliceSecond < 0 || second - sliceSecond >= kWindowSeconds) continue;
+        for (int i = 0; i < kBucketCount; ++i) merged[i] += slice.counts[i].load(std::memory_order_relaxed);
+        result.max = std::max(result.max, slice.max.load(std::memory_order_relaxed));
+    }
+    for (uint64_t c : merged) result.count += c;
+    if (result.count == 0) return result;
+
+    // 按累计计数找分位数所在的桶；分位数不超过真实最大值
+    auto percentile = [&](double q) {
+        uint64_t rank = (uint64_t)std::ceil(q * result.count);
+        uint64_t seen = 0;
+        for (int i = 0; i < kBucketCount; ++i) {
+            seen += merged[i];
+            if (seen >= rank) return std::min(bucketValue(i), result.max);
+        }
+        return result.max;
+    };
+    result.p50 = percentile(0.50);
+    result.p95 = percentile(0.95);
+    result.p99 = percentile(0.99);
+    return result;
+}
+
+uint64_t LatencyHistogram::lifetimeCountAtMost(double ms) const {
+    uint64_t count = 0;
+    for (int i = 0; i < kBucketCount && bucketUpper(i) <= ms * (1.0 + 1e-9); ++i) {
+        count += lifetime[i].load(std::memory_order_relaxed);
+    }
+    return count;
+}
+
+void LatencyTracker::record(LatencyMetric metric, double ms) {
+    if (ms >= 0.0) histograms[(size_t)metric].record(ms);
+}
+
+void LatencyTracker::recordPublished(const FrameTrace& trace) {
+    record(LatencyMetric::GlassToDepth, trace.spanMs(TracePoint::GrabStart, TracePoint::Publish));
+    record(LatencyMetric::Grab, trace.spanMs(TracePoint::GrabStart, TracePoint::GrabEnd));
+    record(LatencyMetric::CaptureQueue, trace.spanMs(TracePoint::GrabEnd, TracePoint::PreprocessStart));
+    record(LatencyMetric::Preprocess, trace.spanMs(TracePoint::PreprocessStart, TracePoint::PreprocessEnd));
+    record(LatencyMetric::RunQueue, trace.spanMs(TracePoint::PreprocessEnd, TracePoint::RunStart));
+    record(LatencyMetric::Run, trace.spanMs(TracePoint::RunStart, TracePoint::RunEnd));
+    record(LatencyMetric::PostQueue, trace.spanMs(TracePoint::RunEnd, TracePoint::PostprocessStart));
+    record(LatencyMetric::Postprocess, trace.spanMs(TracePoint::PostprocessStart, TracePoint::PostprocessEnd));
+    record(LatencyMetric::PublishQueue, trace.spanMs(TracePoint::PostprocessEnd, TracePoint::Publish));
+}
+
+void LatencyTracker::recordClientSend(const FrameTrace& trace, int64_t sentNs) {
+    int64_t glass = trace.at(TracePoint::GrabStart);
+    if (glass > 0 && sentNs >= glass) record(LatencyMetric::GlassToClient, (sentNs - glass) / 1e6);
+}
+
+void LatencyTracker::recordEncode(const FrameTrace& trace) {
+    record(LatencyMetric::Encode, trace.spanMs(TracePoint::SendStart, TracePoint::SendEnd));
+}
+
+const char* LatencyTracker::id(LatencyMetric metric) {
+    switch (metric) {
+    case LatencyMetric::GlassToDepth: return "glass_to_depth";
+    case LatencyMetric::GlassToClient: return "glass_to_client";
+    case LatencyMetric::Grab: return "grab";
+    case LatencyMetric::CaptureQueue: return "capture_queue";
+    case LatencyMetric::Preprocess: return "preprocess";
+    case LatencyMetric::RunQueue: return "run_queue";
+    case LatencyMetric::Run: return "run";
+    case LatencyMetric::PostQueue: return "post_queue";
+    case LatencyMetric::Postprocess: return "postprocess";
+    case LatencyMetric::PublishQueue: return "publish_queue";
+    case LatencyMetric::Encode: return "encode";
+    case LatencyMetric::CaptureJitter: return "capture_jitter";
+    default: return "";
+    }
+}
+
+const char* LatencyTracker::name(LatencyMetric metric) {
+    switch (metric) {
+    case LatencyMetric::GlassToDepth: return "截图→深度";
+    case LatencyMetric::GlassToClient: return "截图→网页";
+    case LatencyMetric::Grab: return "截图";
+    case LatencyMetric::CaptureQueue: return "  排队";
+    case LatencyMetric::Preprocess: return "预处理";
+    case LatencyMetric::RunQueue: return "  排队";
+    case LatencyMetric::Run: return "推理";
+    case LatencyMetric::PostQueue: return "  排队";
+    case LatencyMetric::Postprocess: return "后处理";
+    case LatencyMetric::PublishQueue: return "  排队";
+    case LatencyMetric::Encode: return "网页编码";
+    case LatencyMetric::CaptureJitter: return "截图抖动";
+    default: return "";
+    }
+}
@@ -0,0 +1,135 @@
+﻿#pragma once
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * @brief 帧在流水线中经过的时间点
+ * @details 相邻两点之差即各段耗时，其中 “上一段结束 → 下一段开始” 是在队列里等待的时间
+ */
+enum class TracePoint : uint8_t {
+    GrabStart,          ///< 开始截图（以此作为“画面上屏”时刻的近似）
+    GrabEnd,            ///< 截图完成，进入 frames 队列
+    PreprocessStart,    ///< 出队，开始预处理
+    PreprocessEnd,
+    RunStart,
+    RunEnd,
+    PostprocessStart,
+    PostprocessEnd,
+    Publish,            ///< 写入深度通道，界面/自动化可见
+    SendStart,          ///< 网页编码开始
+    SendEnd,            ///< 最后一个客户端发送完成
+    Count
+};
+
+/**
+ * @brief 单帧的逐阶段时间戳
+ * @details 单调时钟 (steady_clock) 纳秒，0 表示尚未经过该点。
+ *          原图帧与其深度帧共享同一个实例，各阶段在不同线程写入不同时间点，全部是原子量，无需加锁。
+ */
+struct FrameTrace {
+    std::array<std::atomic<int64_t>, (size_t)TracePoint::Count> stamps{};
+
+    static int64_t nowNs() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+    void mark(TracePoint point) { markAt(point, nowNs()); }
+    void markAt(TracePoint point, int64_t ns) { stamps[(size_t)point].store(ns, std::memory_order_relaxed); }
+    int64_t at(TracePoint point) const { return stamps[(size_t)point].load(std::memory_order_relaxed); }
+    // 两点之间的毫秒数，任一点缺失时返回 -1
+    double spanMs(TracePoint from, TracePoint to) const {
+        int64_t a = at(from), b = at(to);
+        return (a > 0 && b >= a) ? (b - a) / 1e6 : -1.0;
+    }
+};
+
+/**
+ * @brief 延迟直方图
+ * @details 对数分桶（相邻桶宽 5%，覆盖 1 µs ~ 100 s），记录是几次无竞争的原子加，不加锁：
+ *          - 滚动窗口：按秒分片轮转，只统计最近 kWindowSeconds 秒，读取时合并各分片计算分位数（误差不超过桶宽）；
+ *            分片换秒时由第一个写入者清零，与之并发的极少数样本可能丢失
+ *          - 累计：自启动以来的各桶计数、总数与总和，供 Prometheus 导出（计数只增不减）
+ */
+class LatencyHistogram {
+public:
+    static constexpr int kWindowSeconds = 10;
+
+    struct Summary {
+        uint64_t count = 0;
+        double p50 = 0.0, p95 = 0.0, p99 = 0.0, max = 0.0;  ///< 毫秒
+    };
+
+    LatencyHistogram();
+    void record(double ms);
+    Summary summary() const;
+
+    // 累计样本中不超过 ms 的个数（按桶上界判断，跨越 ms 的那个桶不计入，最多少算 5% 宽度内的样本）
+    uint64_t lifetimeCountAtMost(double ms) const;
+    uint64_t lifetimeCount() const { return lifetimeTotal.load(std::memory_order_relaxed); }
+    double lifetimeSumMs() const { return lifetimeSumNs.load(std::memory_order_relaxed) / 1e6; }
+
+private:
+    struct Slice {
+        std::atomic<int64_t> second{ -1 };               ///< 分片对应的秒数（单调时钟）
+        std::unique_ptr<std::atomic<uint32_t>[]> counts;
+        std::atomic<double> max{ 0.0 };
+    };
+    static int bucketOf(double ms);
+    static double bucketValue(int bucket);  ///< 桶的代表值（几何中点）
+    static double bucketUpper(int bucket);  ///< 桶的上界
+    static int64_t nowSecond();
+
+    std::array<Slice, kWindowSeconds> slices;
+    std::unique_ptr<std::atomic<uint64_t>[]> lifetime;
+    std::atomic<uint64_t> lifetimeTotal{ 0 };
+    std::atomic<uint64_t> lifetimeSumNs{ 0 };
+};
+
+/**
+ * @brief 端到端延迟指标
+ * @details GlassToDepth：截图开始 → 深度帧发布；GlassToClient：截图开始 → 深度数据发给某个网页客户端（每个客户端各记一次）；
+ *          其余为各段耗时与段间排队时间
+ */
+enum class LatencyMetric : uint8_t {
+    GlassToDepth,
+    GlassToClient,
+    Grab,
+    CaptureQueue,       ///< GrabEnd → PreprocessStart
+    Preprocess,
+    RunQueue,           ///< PreprocessEnd → RunStart
+    Run,
+    PostQueue,          ///< RunEnd → PostprocessStart
+    Postprocess,
+    PublishQueue,       ///< PostprocessEnd → Publish
+    Encode,             ///< SendStart → SendEnd
+    CaptureJitter,      ///< 截图实际开拍时刻相对节拍截止时间的偏差
+    Count
+};
+
+/**
+ * @brief 各延迟指标的直方图集合
+ */
+class LatencyTracker {
+public:
+    // 深度帧发布时调用，记录 GlassToDepth 及发布之前的各段
+    void recordPublished(const FrameTrace& trace);
+    // 深度数据发给一个客户端后调用
+    void recordClientSend(const FrameTrace& trace, int64_t sentNs);
+    // 网页编码结束（SendEnd 已打点）后调用
+    void recordEncode(const FrameTrace& trace);
+    // 截图节拍器每帧调用
+    void recordCaptureJitter(double ms) { record(LatencyMetric::CaptureJitter, ms); }
+
+    LatencyHistogram::Summary summary(LatencyMetric metric) const { return histograms[(size_t)metric].summary(); }
+    const LatencyHistogram& histogram(LatencyMetric metric) const { return histograms[(size_t)metric]; }
+    static const char* name(LatencyMetric metric);   ///< 界面显示名
+    static const char* id(LatencyMetric metric);     ///< 导出用的英文标识，如 glass_to_depth
+
+private:
+    void record(LatencyMetric metric, double ms);
+    std::array<LatencyHistogram, (size_t)LatencyMetric::Count> histograms;
+};
@@ -0,0 +1,183 @@
+﻿#pragma once
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+
+/**
+ * @brief 单写者 / 多读者的无锁“最新值”通道
+ * @details 固定 Slots 个槽位轮转：写者每次挑一个没有读者的空闲槽写入新值，再原子地切换“最新”指针；
+ *          读者给最新槽位的读者计数加一、校验槽位戳未变后拷贝出值，全程不加锁。
+ *          - publish：无锁；读者数不超过 Slots-2 时一次就能找到空闲槽，无需等待
+ *          - load：无锁；只有写者恰好复用了读者看到的槽位时才重试
+ *          - waitForNewer：阻塞等待更新的版本，只有存在阻塞等待者时写者才会短暂触碰等待锁
+ *          T 建议是 shared_ptr 之类的句柄，读者拷贝的代价只是一次引用计数；
+ *          旧值在下一次发布时（无读者占用的情况下）立即释放，通道只长期持有最新值。
+ *          版本号由写者提供且必须递增（如帧序列号），不递增的写入被忽略。
+ */
+template <typename T, size_t Slots = 8>
+class LatestChannel {
+    static_assert(Slots >= 3 && Slots <= 256, "LatestChannel slot count must be in [3, 256]");
+
+public:
+    explicit LatestChannel(T initial = T(), long long initialVersion = LLONG_MIN) {
+        slots[0].value = std::move(initial);
+        slots[0].version = initialVersion;
+        slots[0].stamp.store(1, std::memory_order_relaxed);
+        slots[0].occupied = true;
+        latest.store((1ULL << 8) | 0, std::memory_order_relaxed);
+        publishedVersion.store(initialVersion, std::memory_order_relaxed);
+        writerVersion = initialVersion;
+    }
+
+    LatestChannel(const LatestChannel&) = delete;
+    LatestChannel& operator=(const LatestChannel&) = delete;
+
+    /**
+     * @brief 发布新值（只允许一个写者线程调用）
+     * @return false 表示版本号未递增被忽略
+     */
+    bool publish(T value, long long version) {
+        if (version <= writerVersion) return false;
+        const size_t current = (size_t)(latest.load(std::memory_order_relaxed) & 0xff);
+        while (true) {
+            for (size_t i = 1; i <= Slots; ++i) {
+                const size_t idx = (writeCursor + i) % Slots;
+                if (idx == current || !tryAcquire(slots[idx])) continue;
+                Slot& slot = slots[idx];
+                slot.value = std::move(value);
+                slot.version = version;
+                slot.occupied = true;
+                const uint64_t stamp = nextStamp++;
+                slot.stamp.store(stamp, std::memory_order_release);
+                latest.store((stamp << 8) | idx, std::memory_order_seq_cst);
+                writeCursor = idx;
+                writerVersion = version;
+                publishedVersion.store(version, std::memory_order_seq_cst);
+                if (waiters.load(std::memory_order_seq_cst) > 0) {
+                    { std::lock_guard<std::mutex> lock(waitMtx); }
+                    waitCv.notify_all();
+                }
+                releaseStale(idx);
+                return true;
+            }
+            // 所有空闲槽都被读者占着（并发读者超过 Slots-2），让出时间片后重试
+            std::this_thread::yield();
+        }
+    }
+
+    /**
+     * @brief 读取最新值
+     * @param version 可选，输出该值的版本号
+     */
+    T load(long long* version = nullptr) const {
+        while (true) {
+            const uint64_t cur = latest.load(std::memory_order_acquire);
+            const Slot& slot = slots[cur & 0xff];
+            slot.readers.fetch_add(1, std::memory_order_seq_cst);
+            if (slot.stamp.load(std::memory_order_seq_cst) == (cur >> 8)) {
+                T value = slot.value;
+                if (version) *version = slot.version;
+                slot.readers.fetch_sub(1, std::memory_order_release);
+                return value;
+            }
+            // 读到一半被写者复用了该槽位，重新读取最新指针
+            slot.readers.fetch_sub(1, std::memory_order_release);
+        }
+    }
+
+    // 最新版本号（不拷贝值）
+    long long latestVersion() const { return publishedVersion.load(std::memory_order_acquire); }
+
+    /**
+     * @brief 有比 lastVersion 更新的值时读出
+     * @return 是否读到了更新的值
+     */
+    bool loadNewer(long long lastVersion, T& out, long long* version = nullptr) const {
+        if (latestVersion() <= lastVersion) return false;
+        long long v = 0;
+        T value = load(&v);
+        if (v <= lastVersion) return false;
+        out = std::move(value);
+        if (version) *version = v;
+        return true;
+    }
+
+    /**
+     * @brief 阻塞等待比 lastVersion 更新的值
+     * @return 是否读到了更新的值；超时或被 wakeAll 唤醒时返回 false
+     */
+    bool waitForNewer(long long lastVersion, T& out, std::chrono::milliseconds timeout, long long* version = nullptr) {
+        if (loadNewer(lastVersion, out, version)) return true;
+        {
+            std::unique_lock<std::mutex> lock(waitMtx);
+            const uint64_t generation = wakeGeneration;
+            waiters.fetch_add(1, std::memory_order_seq_cst);
+            waitCv.wait_for(lock, timeout, [&] {
+                return publishedVersion.load(std::memory_order_seq_cst) > lastVersion || wakeGeneration != generation;
+            });
+            waiters.fetch_sub(1, std::memory_order_seq_cst);
+        }
+        return loadNewer(lastVersion, out, version);
+    }
+
+    // 唤醒所有阻塞等待者（如停止推理时），等待者返回 false 后自行检查退出条件
+    void wakeAll() {
+        {
+            std::lock_guard<std::mutex> lock(waitMtx);
+            wakeGeneration++;
+        }
+        waitCv.notify_all();
+    }
+
+private:
+    struct alignas(64) Slot {
+        mutable std::atomic<uint32_t> readers{ 0 }; ///< 正在拷贝该槽位的读者数
+        std::atomic<uint64_t> stamp{ 0 };           ///< 写入戳，0 表示无效（正在写入或已清空）
+        long long version = LLONG_MIN;
+        bool occupied = false;                      ///< 是否持有值（只由写者访问）
+        T value{};
+    };
+
+    // 写者独占一个槽位：先作废槽位戳，再确认没有读者。
+    // 此后进入的读者校验戳必然失败，不会读到写了一半的值
+    bool tryAcquire(Slot& slot) {
+        if (slot.readers.load(std::memory_order_seq_cst) != 0) return false;
+        const uint64_t oldStamp = slot.stamp.load(std::memory_order_relaxed);
+        slot.stamp.store(0, std::memory_order_seq_cst);
+        if (slot.readers.load(std::memory_order_seq_cst) != 0) {
+            slot.stamp.store(oldStamp, std::memory_order_seq_cst);
+            return false;
+        }
+        return true;
+    }
+
+    // 及时释放旧值：T 持有帧缓冲/推理输出缓冲的引用，留在旧槽位里会让它们迟迟回不到池中
+    void releaseStale(size_t current) {
+        for (size_t idx = 0; idx < Slots; ++idx) {
+            Slot& slot = slots[idx];
+            if (idx == current || !slot.occupied || !tryAcquire(slot)) continue;
+            slot.value = T();
+            slot.occupied = false;
+        }
+    }
+
+    std::array<Slot, Slots> slots;
+    alignas(64) std::atomic<uint64_t> latest{ 0 };  ///< (stamp << 8) | 槽位号
+    std::atomic<long long> publishedVersion{ LLONG_MIN };
+
+    // 以下只由写者访问
+    uint64_t nextStamp = 2;
+    size_t writeCursor = 0;
+    long long writerVersion = LLONG_MIN;
+
+    // 阻塞等待
+    std::atomic<int> waiters{ 0 };
+    std::mutex waitMtx;
+    std::condition_variable waitCv;
+    uint64_t wakeGeneration = 0;
+};
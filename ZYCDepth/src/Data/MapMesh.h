@@ -0,0 +1,32 @@
+﻿#pragma once
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @brief 地图网格的一个分块（对应一个 TSDF 体素块）
+ * @details 发布后不可修改，UI 与网页通过句柄共享；顶点在分块内按所在体素边去重
+ */
+struct MeshChunk {
+    uint64_t id = 0;                 ///< 分块 ID：体素块坐标键（BlockCoord::key），块存在期间不变
+    uint64_t version = 0;            ///< 全局递增的提取序号，同一 ID 的分块重新提取后一定变化
+    std::vector<float> vertices;     ///< 顶点坐标 xyz 交错（世界系，米）
+    std::vector<uint32_t> indices;   ///< 三角形顶点下标，(b−a)×(c−a) 指向自由空间（朝向观测的相机）
+
+    size_t vertexCount() const { return vertices.size() / 3; }
+    size_t triangleCount() const { return indices.size() / 3; }
+};
+using MeshChunkHandle = std::shared_ptr<const MeshChunk>;
+
+/**
+ * @brief 某次提取后的整张地图网格
+ * @details 只是分块句柄的集合，未变化的分块与上一份快照共享同一个 MeshChunk；
+ *          消费者按 (id, version) 与自己持有的分块比较，只更新变化的分块、删除不再出现的分块
+ */
+struct MapMeshSnapshot {
+    uint64_t version = 0;            ///< 每次提取递增
+    std::unordered_map<uint64_t, MeshChunkHandle> chunks;   ///< 非空分块
+    size_t triangles = 0;
+};
+using MapMeshHandle = std::shared_ptr<const MapMeshSnapshot>;
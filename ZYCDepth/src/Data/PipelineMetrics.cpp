@@ -0,0 +1,63 @@
+﻿#include "PipelineMetrics.h"
+#include <chrono>
+
+int64_t RateCounter::nowSecond() {
+    return std::chrono::duration_cast<std::chrono::seconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void RateCounter::add(uint64_t n) {
+    const int64_t second = nowSecond();
+    Slice& slice = slices[(size_t)(second % (int64_t)slices.size())];
+    int64_t sliceSecond = slice.second.load(std::memory_order_acquire);
+    // 分片已过期：抢到换秒权的写入者负责清零，与之并发的极少数计数可能丢失（累计数不受影响）
+    if (sliceSecond != second && slice.second.compare_exchange_strong(sliceSecond, second, std::memory_order_acq_rel)) {
+        slice.count.store(0, std::memory_order_relaxed);
+    }
+    slice.count.fetch_add(n, std::memory_order_relaxed);
+    lifetime.fetch_add(n, std::memory_order_relaxed);
+}
+
+double RateCounter::ratePerSecond() const {
+    const int64_t second = nowSecond();
+    uint64_t sum = 0;
+    for (const auto& slice : slices) {
+        int64_t age = second - slice.second.load(std::memory_order_acquire);
+        // 只统计完整的秒：当前秒还在累加，不计入
+        if (age >= 1 && age <= kWindowSeconds) sum += slice.count.load(std::memory_order_relaxed);
+    }
+    return (double)sum / kWindowSeconds;
+}
+
+const char* PipelineMetrics::id(FrameStream stream) {
+    switch (stream) {
+    case FrameStream::Capture: return "capture";
+    case FrameStream::Unchanged: return "unchanged";
+    case FrameStream::Keyframe: return "keyframe";
+    case FrameStream::Propagated: return "propagated";
+    case FrameStream::Inference: return "inference";
+    case FrameStream::Odometry: return "odometry";
+    case FrameStream::BroadcastRaw: return "broadcast_raw";
+    case FrameStream::BroadcastDepth: return "broadcast_depth";
+    default: return "";
+    }
+}
+
+const char* PipelineMetrics::id(ByteStream stream) {
+    switch (stream) {
+    case ByteStream::Raw: return "raw";
+    case ByteStream::Depth: return "depth";
+    case ByteStream::PointCloud: return "point_cloud";
+    case ByteStream::Mesh: return "mesh";
+    case ByteStream::Text: return "text";
+    default: return "";
+    }
+}
+
+const char* PipelineMetrics::id(SendDrop reason) {
+    switch (reason) {
+    case SendDrop::Stale: return "stale";
+    case SendDrop::Overflow: return "overflow";
+    case SendDrop::Backpressure: return "backpressure";
+    default: return "";
+    }
+}
@@ -0,0 +1,97 @@
+﻿#pragma once
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+/**
+ * @brief 按秒分片的事件计数器
+ * @details add 是一次无竞争的原子加（换秒时由第一个写入者清零分片），读取不加锁：
+ *          ratePerSecond 取最近 kWindowSeconds 个完整秒的平均值，total 为自启动以来的累计数
+ */
+class RateCounter {
+public:
+    static constexpr int kWindowSeconds = 5;
+
+    void add(uint64_t n = 1);
+    uint64_t total() const { return lifetime.load(std::memory_order_relaxed); }
+    double ratePerSecond() const;
+
+private:
+    struct Slice {
+        std::atomic<int64_t> second{ -1 };
+        std::atomic<uint64_t> count{ 0 };
+    };
+    static int64_t nowSecond();
+
+    // 多一个分片存放当前（未完整）的秒
+    std::array<Slice, kWindowSeconds + 1> slices;
+    std::atomic<uint64_t> lifetime{ 0 };
+};
+
+/**
+ * @brief 帧流：各阶段产出的帧数与帧率
+ */
+enum class FrameStream : uint8_t {
+    Capture,            ///< 截图
+    Unchanged,          ///< 截图中画面未变化、跳过推理的帧
+    Keyframe,           ///< 深度传播模式下送去完整推理的关键帧
+    Propagated,         ///< 深度传播模式下由光流得到的深度帧
+    Inference,          ///< 深度帧发布
+    Odometry,           ///< 视觉里程计跟踪成功、输出位姿的帧
+    BroadcastRaw,       ///< 原图发给网页
+    BroadcastDepth,     ///< 深度发给网页
+    Count
+};
+
+/**
+ * @brief 网页发送的字节流（按 消息大小 × 客户端数 计）
+ */
+enum class ByteStream : uint8_t {
+    Raw,                ///< 原图 JPEG (Base64 JSON)
+    Depth,              ///< 深度可视化 JPEG (Base64 JSON)
+    PointCloud,         ///< 二进制点云
+    Mesh,               ///< 二进制地图网格分块
+    Text,               ///< 日志、状态等其他文本消息
+    Count
+};
+
+/**
+ * @brief 网页发送被丢弃的原因
+ */
+enum class SendDrop : uint8_t {
+    Stale,              ///< 帧类消息（原图/深度/点云）还没发出就被更新的一帧替换
+    Overflow,           ///< 有序消息（文本/网格）积压超过上限
+    Backpressure,       ///< 客户端发送缓冲超过上限，本条消息跳过该客户端
+    Count
+};
+
+/**
+ * @brief 流水线运行指标
+ * @details 各阶段在热路径上只做原子加，/metrics 导出与 UI 轮询都是无锁读取，不影响流水线
+ */
+class PipelineMetrics {
+public:
+    void countFrame(FrameStream stream, uint64_t n = 1) { frames[(size_t)stream].add(n); }
+    void countBytes(ByteStream stream, uint64_t bytes) { bytesSent[(size_t)stream].fetch_add(bytes, std::memory_order_relaxed); }
+    void countSendDrop(ByteStream stream, SendDrop reason) { droppedSends[(size_t)stream][(size_t)reason].fetch_add(1, std::memory_order_relaxed); }
+
+    void setCapturePeriodMs(double ms) { capturePeriodMs.store(ms, std::memory_order_relaxed); }
+    void countMissedDeadline() { missedDeadlines.fetch_add(1, std::memory_order_relaxed); }
+
+    const RateCounter& frameCounter(FrameStream stream) const { return frames[(size_t)stream]; }
+    double getCapturePeriodMs() const { return capturePeriodMs.load(std::memory_order_relaxed); }
+    uint64_t getMissedDeadlines() const { return missedDeadlines.load(std::memory_order_relaxed); }
+    uint64_t bytes(ByteStream stream) const { return bytesSent[(size_t)stream].load(std::memory_order_relaxed); }
+    uint64_t sendDrops(ByteStream stream, SendDrop reason) const { return droppedSends[(size_t)stream][(size_t)reason].load(std::memory_order_relaxed); }
+
+    static const char* id(FrameStream stream);  ///< 导出用的英文标识，如 capture
+    static const char* id(ByteStream stream);
+    static const char* id(SendDrop reason);
+
+private:
+    std::array<RateCounter, (size_t)FrameStream::Count> frames;
+    std::array<std::atomic<uint64_t>, (size_t)ByteStream::Count> bytesSent{};
+    std::array<std::array<std::atomic<uint64_t>, (size_t)SendDrop::Count>, (size_t)ByteStream::Count> droppedSends{};
+    std::atomic<double> capturePeriodMs{ 0.0 };   ///< 截图节拍器当前周期
+    std::atomic<uint64_t> missedDeadlines{ 0 };   ///< 截图落后超过一个周期、重新对齐的次数
+};
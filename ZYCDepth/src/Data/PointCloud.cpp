@@ -0,0 +1,264 @@
+﻿#include "PointCloud.h"
+#include "Profiler/TraceProfiler.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include "Data/SimdDispatch.h"
+
+#if defined(ZYC_SIMD_X86)
+#define ZYC_CLOUD_AVX2 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define ZYC_CLOUD_NEON 1
+#endif
+
+namespace {
+    constexpr size_t kSlack = 8;   // 向量化整段写入越过 count 的余量
+
+    float valueAt(const cv::Mat& m, int r, int c) {
+        return m.depth() == CV_64F ? (float)m.at<double>(r, c) : m.at<float>(r, c);
+    }
+
+    // BGRA/BGR 像素 → RGBA（alpha 255）
+    uint32_t packColor(const uchar* p) {
+        return (uint32_t)p[2] | ((uint32_t)p[1] << 8) | ((uint32_t)p[0] << 16) | 0xFF000000u;
+    }
+
+#if defined(ZYC_CLOUD_AVX2)
+    // 8 位掩码 → 把置位的通道按序挪到最前面的置换下标，以及置位数（不依赖 POPCNT 指令）
+    struct CompactEntry {
+        std::array<int32_t, 8> lanes;
+        int32_t count;
+    };
+    const std::array<CompactEntry, 256>& compactTable() {
+        static const auto table = [] {
+            std::array<CompactEntry, 256> t{};
+            for (int mask = 0; mask < 256; ++mask) {
+                int n = 0;
+                for (int lane = 0; lane < 8; ++lane) {
+                    if (mask & (1 << lane)) t[mask].lanes[n++] = lane;
+                }
+                t[mask].count = n;
+                for (; n < 8; ++n) t[mask].lanes[n] = 0;
+            }
+            return t;
+        }();
+        return table;
+    }
+#endif
+
+#if defined(ZYC_CLOUD_AVX2)
+    // 回投一行的 AVX2 部分：有效点按序写到 outs[c] + n / outC + n，返回处理到的采样列号
+    ZYC_TARGET_AVX2 int backprojectRowAvx2(const float* zrow, int stride, const float* rayX, const int32_t* colorCol, int sampledCols,
+        const uchar* crow, int cn, const float a[3], const float b[3], const float t[3], float minDepth, float maxDepth,
+        float* const outs[3], uint32_t* outC, size_t& n) {
+        int i = 0;
+        const auto& compact = compactTable();
+        const __m256 vMin = _mm256_set1_ps(minDepth), vMax = _mm256_set1_ps(maxDepth);
+        const __m256 va[3] = { _mm256_set1_ps(a[0]), _mm256_set1_ps(a[1]), _mm256_set1_ps(a[2]) };
+        const __m256 vb[3] = { _mm256_set1_ps(b[0]), _mm256_set1_ps(b[1]), _mm256_set1_ps(b[2]) };
+        const __m256 vt[3] = { _mm256_set1_ps(t[0]), _mm256_set1_ps(t[1]), _mm256_set1_ps(t[2]) };
+        const __m256i laneStride = _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), _mm256_set1_epi32(stride));
+        // BGRA → RGBA：每个 32 位内交换第 0、2 字节，alpha 置 255
+        const __m256i swapRB = _mm256_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15,
+            2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+        const __m256i alpha = _mm256_set1_epi32((int)0xFF000000u);
+        for (; i + 8 <= sampledCols; i += 8) {
+            const __m256 z = stride == 1 ? _mm256_loadu_ps(zrow + i)
+                : _mm256_i32gather_ps(zrow, _mm256_add_epi32(_mm256_set1_epi32(i * stride), laneStride), 4);
+            // 有序比较：NaN 两项都为假
+            const __m256 valid = _mm256_and_ps(_mm256_cmp_ps(z, vMin, _CMP_GT_OQ), _mm256_cmp_ps(z, vMax, _CMP_LE_OQ));
+            const int mask = _mm256_movemask_ps(valid);
+            const __m256i perm = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(compact[mask].lanes.data()));
+            const __m256 rx = _mm256_loadu_ps(rayX + i);
+            for (int c = 0; c < 3; ++c) {
+                const __m256 p = _mm256_add_ps(_mm256_mul_ps(z, _mm256_add_ps(va[c], _mm256_mul_ps(rx, vb[c]))), vt[c]);
+                _mm256_storeu_ps(outs[c] + n, _mm256_permutevar8x32_ps(p, perm));
+            }
+            if (outC) {
+                __m256i rgba;
+                if (cn == 4) {
+                    const __m256i col = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(colorCol + i));
+                    rgba = _mm256_i32gather_epi32(reinterpret_cast<const int*>(crow), col, 4);
+                    rgba = _mm256_or_si256(_mm256_shuffle_epi8(rgba, swapRB), alpha);
+                }
+                else {
+                    // BGR 每像素 24 位，32 位 gather 会越过行尾：逐点取色，变换与重排仍向量化
+                    alignas(32) uint32_t colors[8];
+                    for (int k = 0; k < 8; ++k) colors[k] = packColor(crow + colorCol[i + k] * cn);
+                    rgba = _mm256_load_si256(reinterpret_cast<const __m256i*>(colors));
+                }
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(outC + n), _mm256_permutevar8x32_epi32(rgba, perm));
+            }
+            n += (size_t)compact[mask].count;
+        }
+        return i;
+    }
+#endif
+}
+
+void PointCloudBuilder::updateTable(const cv::Mat& depth, const cv::Rect& roi, float fx, float fy, float cx, float cy,
+    const cv::Mat& color, cv::Size frameSize, int stride) {
+    const cv::Size colorSize = color.empty() ? cv::Size() : color.size();
+    if (table.cols == depth.cols && table.rows == depth.rows && table.stride == stride && table.roi == roi
+        && table.fx == fx && table.fy == fy && table.cx == cx && table.cy == cy
+        && table.colorSize == colorSize && table.frameSize == frameSize) return;
+
+    table.cols = depth.cols;
+    table.rows = depth.rows;
+    table.stride = stride;
+    table.roi = roi;
+    table.fx = fx; table.fy = fy; table.cx = cx; table.cy = cy;
+    table.colorSize = colorSize;
+    table.frameSize = frameSize;
+
+    // 深度像素 → 原图像素（像素中心对齐，与 FrameData::depthToFrame 一致）→ 取色图像素
+    const float sx = (float)roi.width / depth.cols, sy = (float)roi.height / depth.rows;
+    const float colorScaleX = colorSize.width > 0 && frameSize.width > 0 ? (float)colorSize.width / frameSize.width : 1.0f;
+    const float colorScaleY = colorSize.height > 0 && frameSize.height > 0 ? (float)colorSize.height / frameSize.height : 1.0f;
+    const int sampledCols = (depth.cols + stride - 1) / stride, sampledRows = (depth.rows + stride - 1) / stride;
+    table.rayX.resize(sampledCols);
+    table.colorCol.resize(sampledCols);
+    for (int i = 0; i < sampledCols; ++i) {
+        const float frameU = roi.x + (i * stride + 0.5f) * sx - 0.5f;
+        table.rayX[i] = (frameU - cx) / fx;
+        table.colorCol[i] = std::clamp((int)std::floor(frameU * colorScaleX), 0, std::max(0, colorSize.width - 1));
+    }
+    table.rayY.resize(sampledRows);
+    table.colorRow.resize(sampledRows);
+    for (int j = 0; j < sampledRows; ++j) {
+        const float frameV = roi.y + (j * stride + 0.5f) * sy - 0.5f;
+        table.rayY[j] = (frameV - cy) / fy;
+        table.colorRow[j] = std::clamp((int)std::floor(frameV * colorScaleY), 0, std::max(0, colorSize.height - 1));
+    }
+}
+
+void PointCloudBuilder::build(const FrameData& depthFrame, const cv::Mat& color, const Options& options, PointCloud& out) {
+    out.count = 0;
+    if (!depthFrame.rawDepth || depthFrame.rawDepth->empty()) return;
+    build(*depthFrame.rawDepth, depthFrame.roi, depthFrame.intrinsics, depthFrame.extrinsics, color, depthFrame.frameSize, options, out);
+}
+
+void PointCloudBuilder::build(const cv::Mat& depth, const cv::Rect& roiIn, const cv::Mat& K, const cv::Mat& Rt,
+    const cv::Mat& color, cv::Size frameSize, const Options& options, PointCloud& out) {
+    ZYC_PROFILE_SCOPE("PointCloudBuilder::build");
+    out.count = 0;
+    if (depth.empty() || depth.type() != CV_32FC1 || K.rows != 3 || K.cols != 3) return;
+    if (options.world && (Rt.rows != 3 || Rt.cols != 4)) return;
+    const cv::Rect roi = roiIn.empty() ? cv::Rect(0, 0, depth.cols, depth.rows) : roiIn;
+    const int stride = std::max(1, options.stride);
+    const bool withColor = !color.empty() && (color.channels() == 3 || color.channels() == 4) && color.depth() == CV_8U;
+    updateTable(depth, roi, valueAt(K, 0, 0), valueAt(K, 1, 1), valueAt(K, 0, 2), valueAt(K, 1, 2),
+        withColor ? color : cv::Mat(), frameSize.width > 0 ? frameSize : roi.size(), stride);
+
+    // 相机系输出即 R = I、t = 0
+    float R[9] = { 1, 0, 0, 0, 1, 0, 0, 0, 1 }, t[3] = { 0, 0, 0 };
+    if (options.world) {
+        for (int r = 0; r < 3; ++r) {
+            for (int c = 0; c < 3; ++c) R[r * 3 + c] = valueAt(Rt, r, c);
+            t[r] = valueAt(Rt, r, 3);
+        }
+    }
+
+    const int sampledCols = (int)table.rayX.size(), sampledRows = (int)table.rayY.size();
+    const size_t capacity = (size_t)sampledCols * sampledRows + kSlack;
+    if (out.x.size() < capacity) {
+        out.x.resize(capacity);
+        out.y.resize(capacity);
+        out.z.resize(capacity);
+    }
+    if (withColor && out.rgba.size() < capacity) out.rgba.resize(capacity);
+    if (!withColor) out.rgba.clear();
+    float* outX = out.x.data();
+    float* outY = out.y.data();
+    float* outZ = out.z.data();
+    uint32_t* outC = withColor ? out.rgba.data() : nullptr;
+    const float minDepth = options.minDepth, maxDepth = options.maxDepth;
+    const int cn = withColor ? color.channels() : 0;
+    size_t n = 0;
+#if defined(ZYC_CLOUD_AVX2)
+    const bool avx2 = cpuHasAvx2();
+#endif
+
+    for (int j = 0; j < sampledRows; ++j) {
+        const float* zrow = depth.ptr<float>(j * stride);
+        const uchar* crow = withColor ? color.ptr<uchar>(table.colorRow[j]) : nullptr;
+        // 每行常量：a = R·(0, ry, 1)，b = R 的第 0 列；xw = z·(a + rx·b) + t
+        const float ry = table.rayY[j];
+        const float a[3] = { R[1] * ry + R[2], R[4] * ry + R[5], R[7] * ry + R[8] };
+        const float b[3] = { R[0], R[3], R[6] };
+        int i = 0;
+
+#if defined(ZYC_CLOUD_AVX2)
+        if (avx2) {
+            float* outs[3] = { outX, outY, outZ };
+            i = backprojectRowAvx2(zrow, stride, table.rayX.data(), table.colorCol.data(), sampledCols, crow, cn, a, b, t,
+                minDepth, maxDepth, outs, outC, n);
+        }
+#elif defined(ZYC_CLOUD_NEON)
+        {
+            // NEON 没有按掩码重排：变换向量化，写出时按有效位标量前移
+            const float32x4_t vMin = vdupq_n_f32(minDepth), vMax = vdupq_n_f32(maxDepth);
+            for (; i + 4 <= sampledCols; i += 4) {
+                float zs[4];
+                for (int k = 0; k < 4; ++k) zs[k] = zrow[(i + k) * stride];
+                const float32x4_t z = vld1q_f32(zs);
+                const float32x4_t rx = vld1q_f32(&table.rayX[i]);
+                uint32_t valid[4];
+                vst1q_u32(valid, vandq_u32(vcgtq_f32(z, vMin), vcleq_f32(z, vMax)));
+                float p[3][4];
+                for (int c = 0; c < 3; ++c) {
+                    vst1q_f32(p[c], vaddq_f32(vmulq_f32(z, vmlaq_f32(vdupq_n_f32(a[c]), rx, vdupq_n_f32(b[c]))), vdupq_n_f32(t[c])));
+                }
+                for (int k = 0; k < 4; ++k) {
+                    outX[n] = p[0][k];
+                    outY[n] = p[1][k];
+                    outZ[n] = p[2][k];
+                    if (outC) outC[n] = packColor(crow + table.colorCol[i + k] * cn);
+                    n += valid[k] & 1u;
+                }
+            }
+        }
+#endif
+
+        // 标量路径：向量化剩余的尾部；无效点照写，只是写指针不前移
+        for (; i < sampledCols; ++i) {
+            const float z = zrow[i * stride];
+            const float rx = table.rayX[i];
+            outX[n] = z * (a[0] + rx * b[0]) + t[0];
+            outY[n] = z * (a[1] + rx * b[1]) + t[1];
+            outZ[n] = z * (a[2] + rx * b[2]) + t[2];
+            if (outC) outC[n] = packColor(crow + table.colorCol[i] * cn);
+            n += (size_t)(z > minDepth && z <= maxDepth);
+        }
+    }
+    out.count = n;
+}
+
+bool PointCloudBuilder::writePly(const std::string& path, const PointCloud& cloud) {
+    std::ofstream file(path, std::ios::binary);
+    if (!file) return false;
+    const bool withColor = !cloud.rgba.empty();
+    file << "ply\nformat binary_little_endian 1.0\nelement vertex " << cloud.count << "\n"
+        << "property float x\nproperty float y\nproperty float z\n";
+    if (withColor) file << "property uchar red\nproperty uchar green\nproperty uchar blue\n";
+    file << "end_header\n";
+    // PLY 按点交错存放，SoA 在这里转一次
+    std::vector<char> buffer;
+    const size_t pointSize = 12 + (withColor ? 3 : 0);
+    buffer.resize(pointSize * std::min<size_t>(cloud.count, 65536));
+    for (size_t begin = 0; begin < cloud.count; begin += 65536) {
+        const size_t end = std::min(cloud.count, begin + 65536);
+        char* p = buffer.data();
+        for (size_t k = begin; k < end; ++k, p += pointSize) {
+            std::memcpy(p, &cloud.x[k], 4);
+            std::memcpy(p + 4, &cloud.y[k], 4);
+            std::memcpy(p + 8, &cloud.z[k], 4);
+            if (withColor) std::memcpy(p + 12, &cloud.rgba[k], 3);
+        }
+        file.write(buffer.data(), (std::streamsize)((end - begin) * pointSize));
+    }
+    return (bool)file;
+}
@@ -0,0 +1,75 @@
+﻿#pragma once
+#include <opencv2/opencv.hpp>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "Data/CommonTypes.h"
+
+/**
+ * @brief 深度图回投得到的点云（SoA：各分量连续存放，SIMD 整段写入，网页/导出按分量直接拷贝）
+ * @details 数组长度可能大于 count（末尾留有向量化写入的余量），只有前 count 个有效
+ */
+struct PointCloud {
+    std::vector<float> x, y, z;
+    std::vector<uint32_t> rgba;      ///< R | G << 8 | B << 16 | A << 24（内存顺序 RGBA，与 IM_COL32 相同）；不取色时为空
+    size_t count = 0;
+};
+
+/**
+ * @brief 深度 → 点云回投（UI 点云、网页点云、建图分配、导出共用；每个使用者持有一个实例，非线程安全）
+ * @details 1. 射线表：针孔模型下单位深度的射线 ((u' − cx)/fx, (v' − cy)/fy, 1) 可按列、按行分离，
+ *             其中 (u', v') 是深度像素经 roi 映射回的原图像素；取色的原图像素坐标同样按列、按行预先算好。
+ *             表以 内参 + 分辨率 + roi + 采样步长 + 原图/取色图尺寸 为键缓存，不变时每帧零开销；
+ *          2. 变换：xw = R·(rx·z, ry·z, z) + t = z·(R·(0, ry, 1) + rx·R₀) + t，每行常量提出后每点每分量两次乘加，
+ *             AVX2（x86，运行时检测 CPU）一次 8 点、NEON 一次 4 点；
+ *          3. 过滤与输出：有效性（minDepth < z <= maxDepth，同时排除 NaN 与排除区域的 0）算成掩码，
+ *             按掩码查表重排后整段写入 SoA，写指针按表中的有效点数前移，全程无分支；BGRA 取色用 gather，BGR 逐点取色。
+ */
+class PointCloudBuilder {
+public:
+    struct Options {
+        int stride = 1;              ///< 深度图采样步长（像素）
+        float minDepth = 0.1f;
+        float maxDepth = 50.0f;
+        bool world = true;           ///< true 用外参变换到世界系，false 输出相机系
+    };
+
+    /**
+     * @brief 回投一个深度帧
+     * @param depthFrame 深度帧（rawDepth + 内外参 + roi + frameSize）
+     * @param color 取色的原图（BGRA 或 BGR，可以是缩小的预览），为空时不取色
+     */
+    void build(const FrameData& depthFrame, const cv::Mat& color, const Options& options, PointCloud& out);
+
+    /**
+     * @brief 回投一张深度图
+     * @param depth CV_32F 深度图（米）
+     * @param roi 深度图覆盖的原图区域，为空时认为深度图就是整幅原图
+     * @param K 3x3 内参（原图像素坐标），CV_32F 或 CV_64F
+     * @param Rt 3x4 相机到世界外参（options.world 为 false 时不使用）
+     * @param color 取色图，为空时不取色
+     * @param frameSize 原图尺寸，用于把原图像素换算到取色图像素；为空时认为取色图就是原图
+     */
+    void build(const cv::Mat& depth, const cv::Rect& roi, const cv::Mat& K, const cv::Mat& Rt,
+        const cv::Mat& color, cv::Size frameSize, const Options& options, PointCloud& out);
+
+    // 写二进制 PLY（x y z float + red green blue uchar），返回是否成功
+    static bool writePly(const std::string& path, const PointCloud& cloud);
+
+private:
+    struct RayTable {
+        // 键
+        int cols = 0, rows = 0, stride = 0;
+        cv::Rect roi;
+        float fx = 0, fy = 0, cx = 0, cy = 0;
+        cv::Size colorSize, frameSize;
+        // 按采样列/行
+        std::vector<float> rayX, rayY;
+        std::vector<int32_t> colorCol, colorRow;   ///< 取色图像素坐标（已夹到图内）
+    };
+
+    void updateTable(const cv::Mat& depth, const cv::Rect& roi, float fx, float fy, float cx, float cy,
+        const cv::Mat& color, cv::Size frameSize, int stride);
+
+    RayTable table;
+};
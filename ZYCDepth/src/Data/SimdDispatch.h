@@ -0,0 +1,28 @@
+﻿#pragma once
+#include <opencv2/opencv.hpp>
+
+/**
+ * @brief x86 SIMD 运行时分派
+ * @details 工程按基线指令集编译（不开 /arch:AVX2），AVX2 内核写成单独的函数并标上 ZYC_TARGET_AVX2，
+ *          调用前用 cpuHasAvx2() 检查 CPU，不支持 AVX2 的机器走标量路径，不会因非法指令崩溃。
+ *          - MSVC 不需要 /arch 就能编译 AVX2 内建函数，宏为空
+ *          - GCC/Clang 用 target 属性只对内核函数打开 AVX2；属性不会传给 lambda，内核里不要写 lambda
+ *          ARM 上 NEON 属于基线指令集，仍按编译期宏选择。
+ *          设置环境变量 OPENCV_CPU_DISABLE=AVX2 可在支持 AVX2 的机器上强制走标量路径（对比、排查用）。
+ */
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define ZYC_SIMD_X86 1
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#define ZYC_TARGET_AVX2
+#else
+#define ZYC_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+// CPU 与操作系统是否支持 AVX2（OpenCV 启动时已检测，含 YMM 状态保存），结果缓存
+inline bool cpuHasAvx2() {
+    static const bool supported = cv::checkHardwareSupport(CV_CPU_AVX2);
+    return supported;
+}
+#endif
@@ -1,43 +1,79 @@
 ﻿#include "DepthInference.h"
+#include <algorithm>
 #include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
 #include"Log/Logger.h"
+#include "Profiler/TraceProfiler.h"
 ONNXDepthInference::ONNXDepthInference() : env(ORT_LOGGING_LEVEL_ERROR, "DepthAnythingV3") {}
 
 bool ONNXDepthInference::init(const std::string& modelPath) {
     bool cudaEnabled = false; // 增加一个标志位
+    startupMetrics = StartupMetrics();
+    auto loadStart = std::chrono::high_resolution_clock::now();
     try {
-        // 1. 尝试配置 CUDA
-        try {
-            OrtCUDAProviderOptions cuda_options;
-            // 设置一些常用的 CUDA 优化参数（可选）
-            cuda_options.device_id = 0;
-            cuda_options.cudnn_conv_algo_search = OrtCudnnConvAlgoSearchExhaustive;
-
-            sessionOptions.AppendExecutionProvider_CUDA(cuda_options);
-            cudaEnabled = true; // 如果运行到这里没报错，说明 Provider 加载成功
+        // 1. 选择执行后端与线程配置：自动调优（命中缓存时无需测速），否则优先 CUDA 失败回退 CPU
+        tuning = SessionTuning();
+        if (config.autoTune) {
+            SessionTuner tuner(env, config);
+            tuning = tuner.resolve(modelPath);
         }
-        catch (...) {
-            LOG_WARN("CUDA 硬件环境检查失败，系统将自动回退到 CPU 模式", true);
-            cudaEnabled = false;
+        // INT8 (QDQ) 模型只在 CPU 后端上走整数内核，CUDA 会退化为反量化后的浮点计算
+        if (config.precision == InferencePrecision::INT8) tuning.provider = "CPU";
+        cudaEnabled = SessionTuner::apply(sessionOptions, tuning);
+        std::string provider = cudaEnabled ? "CUDA" : "CPU";
+
+        // 2. 加载主模型与附加尺寸模型（优先使用优化模型缓存），每个尺寸预分配自己的轮转输出缓冲
+        memoryInfo = Ort::MemoryInfo::CreateCpu(OrtArenaAllocator, OrtMemTypeDefault);
+        defaultContext.reset();
+        selectedVariant = nullptr;
+        variants.clear();
+        variants.push_back(loadVariant(modelPath, provider));
+        for (std::string path : config.modelVariants) {
+            if (config.precision == InferencePrecision::INT8) {
+                path = std::filesystem::path(path).replace_extension(".int8.onnx").string();
+            }
+            if (path == modelPath || !std::filesystem::exists(path)) continue;
+            try {
+                variants.push_back(loadVariant(path, provider));
+            }
+            catch (const Ort::Exception& e) {
+                // 附加尺寸加载失败不影响主模型
+                LOG_WARN("附加尺寸模型加载失败 [" + path + "]: " + std::string(e.what()));
+            }
         }
 
-        sessionOptions.SetGraphOptimizationLevel(GraphOptimizationLevel::ORT_ENABLE_ALL);
+        // 3. 默认上下文（常驻输入张量 + IoBinding）
+        defaultContext = createContext();
+        startupMetrics.modelLoadMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - loadStart).count();
 
-        // 2. 加载模型
-#ifdef _WIN32
-        std::wstring wModelPath = std::wstring(modelPath.begin(), modelPath.end());
-        session = std::make_unique<Ort::Session>(env, wModelPath.c_str(), sessionOptions);
-#else
-        session = std::make_unique<Ort::Session>(env, modelPath.c_str(), sessionOptions);
-#endif
+        // 预热：首几次 Run 会触发内核选择、内存规划等惰性初始化，放在就绪之前完成
+        // 设置了延迟预算时至少跑一次，用于测得各尺寸的单次耗时
+        auto warmupStart = std::chrono::high_resolution_clock::now();
+        int warmupRuns = config.latencyBudgetMs > 0.0 ? std::max(1, config.warmupRuns) : config.warmupRuns;
+        for (auto& variant : variants) warmup(*variant, warmupRuns);
+        startupMetrics.warmupMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - warmupStart).count();
 
-        // 3. 根据标志位输出成功日志
+        // 4. 根据标志位输出成功日志
         if (cudaEnabled) {
             LOG_INFO("深度估计模型已成功加载 [推理引擎: CUDA/GPU]", true);
         }
         else {
-            LOG_INFO("深度估计模型已成功加载 [推理引擎: CPU]", true);
+            LOG_INFO(std::string("深度估计模型已成功加载 [推理引擎: CPU") +
+                (config.precision == InferencePrecision::INT8 ? " INT8] " : "] ") + tuning.describe(), true);
+        }
+        std::string shapes;
+        for (auto& variant : variants) {
+            char item[64];
+            snprintf(item, sizeof(item), " %dx%d(%.0fms)", variant->netHeight, variant->netWidth, variant->warmupRunMs);
+            shapes += item;
         }
+        LOG_INFO("可用输入尺寸 (HxW):" + shapes, true);
+        char timing[128];
+        snprintf(timing, sizeof(timing), "模型加载 %.0f ms%s，预热 %.0f ms", startupMetrics.modelLoadMs,
+            startupMetrics.optimizedCacheHit ? "（优化模型缓存）" : "", startupMetrics.warmupMs);
+        LOG_INFO(std::string(timing), true);
 
         return true;
     }
@@ -47,70 +83,261 @@ bool ONNXDepthInference::init(const std::string& modelPath) {
     }
 }
 
-DepthResult ONNXDepthInference::predict(const cv::Mat& input) {
-    if (input.empty()) return DepthResult();
+std::unique_ptr<ONNXDepthInference::ModelVariant> ONNXDepthInference::loadVariant(const std::string& path, const std::string& provider) {
+    auto variant = std::make_unique<ModelVariant>();
+    variant->path = path;
+    if (config.cacheOptimizedModel) {
+        openSessionCached(*variant, provider);
+    }
+    else {
+        variant->session = SessionTuner::openSession(env, path, sessionOptions);
+    }
+    // 输入尺寸以模型为准（导出时固定），动态尺寸的模型按 504x504 使用
+    std::vector<int64_t> shape = SessionTuner::inputShapeOf(*variant->session);
+    variant->netHeight = (int)shape[2];
+    variant->netWidth = (int)shape[3];
+    variant->outputSlots.resize(kOutputSlotCount);
+    for (auto& slot : variant->outputSlots) allocateOutputSlot(*variant, slot);
+    return variant;
+}
+
+void ONNXDepthInference::openSessionCached(ModelVariant& variant, const std::string& provider) {
+    const std::string& modelPath = variant.path;
+    std::string cachePath = ModelCache::optimizedPath(modelPath, provider);
+    if (ModelCache::isFresh(cachePath, modelPath) && variant.mappedModel.open(cachePath)) {
+        try {
+            // ORT 格式已是优化后的图，直接引用映射内存中的模型与权重，不再拷贝
+            Ort::SessionOptions options = sessionOptions.Clone();
+            options.AddConfigEntry("session.load_model_format", "ORT");
+            options.AddConfigEntry("session.use_ort_model_bytes_directly", "1");
+            options.AddConfigEntry("session.use_ort_model_bytes_for_initializers", "1");
+            variant.session = std::make_unique<Ort::Session>(env, variant.mappedModel.data(), variant.mappedModel.size(), options);
+            startupMetrics.optimizedCacheHit = true;
+            return;
+        }
+        catch (const Ort::Exception& e) {
+            // 缓存损坏或 ORT 版本不兼容，回退到源模型并重新生成
+            LOG_WARN("优化模型缓存加载失败，将重新生成: " + std::string(e.what()));
+            variant.mappedModel.close();
+        }
+    }
+
+    try {
+        Ort::SessionOptions options = sessionOptions.Clone();
+        options.AddConfigEntry("session.save_model_format", "ORT");
+#ifdef _WIN32
+        std::wstring wCachePath = std::wstring(cachePath.begin(), cachePath.end());
+        options.SetOptimizedModelFilePath(wCachePath.c_str());
+#else
+        options.SetOptimizedModelFilePath(cachePath.c_str());
+#endif
+        variant.session = SessionTuner::openSession(env, modelPath, options);
+        LOG_INFO("已生成优化模型缓存: " + cachePath);
+    }
+    catch (const Ort::Exception& e) {
+        // 某些后端不支持序列化优化结果，不影响正常加载
+        LOG_WARN("优化模型缓存生成失败: " + std::string(e.what()));
+        variant.session = SessionTuner::openSession(env, modelPath, sessionOptions);
+    }
+}
+
+void ONNXDepthInference::warmup(ModelVariant& variant, int runs) {
+    if (runs <= 0) return;
+    OnnxInferenceContext ctx;
+    bindContext(ctx, variant);
+    double totalMs = 0.0;
+    int measured = 0;
+    for (int i = 0; i < runs; ++i) {
+        if (!run(ctx)) break;
+        // 首次 Run 含惰性初始化，不计入单次耗时（只跑一次时只能用它）
+        if (i > 0 || runs == 1) {
+            totalMs += ctx.runMs;
+            measured++;
+        }
+        // 不经过后处理，直接释放对输出缓冲组的引用
+        ctx.depth.release();
+        ctx.intrinsics.release();
+        ctx.extrinsics.release();
+    }
+    if (measured > 0) variant.warmupRunMs = totalMs / measured;
+}
+
+ONNXDepthInference::ModelVariant& ONNXDepthInference::selectVariant(cv::Size sourceSize) {
+    std::lock_guard<std::mutex> lock(selectMtx);
+    if (selectedVariant && sourceSize == selectedForSize) return *selectedVariant;
 
+    // 1. 延迟预算内的候选；都超预算时只保留最快的一个
+    std::vector<ModelVariant*> candidates;
+    for (auto& variant : variants) {
+        if (config.latencyBudgetMs <= 0.0 || variant->warmupRunMs <= config.latencyBudgetMs) candidates.push_back(variant.get());
+    }
+    if (candidates.empty()) {
+        candidates.push_back(std::min_element(variants.begin(), variants.end(),
+            [](const auto& a, const auto& b) { return a->warmupRunMs < b->warmupRunMs; })->get());
+    }
+
+    // 2. 宽高比误差（对数域，横竖对称）最小者；误差相近（5% 以内）时取像素最多的
+    double sourceAspect = (double)sourceSize.width / std::max(1, sourceSize.height);
+    auto aspectError = [&](const ModelVariant* v) {
+        return std::abs(std::log((double)v->netWidth / v->netHeight / sourceAspect));
+    };
+    double bestError = aspectError(*std::min_element(candidates.begin(), candidates.end(),
+        [&](const ModelVariant* a, const ModelVariant* b) { return aspectError(a) < aspectError(b); }));
+    ModelVariant* best = nullptr;
+    for (ModelVariant* v : candidates) {
+        if (aspectError(v) > bestError + 0.05) continue;
+        if (!best || v->netWidth * v->netHeight > best->netWidth * best->netHeight) best = v;
+    }
+
+    if (best != selectedVariant) {
+        LOG_INFO("推理输入尺寸: " + std::to_string(best->netHeight) + "x" + std::to_string(best->netWidth) +
+            " (原图 " + std::to_string(sourceSize.width) + "x" + std::to_string(sourceSize.height) + ")");
+    }
+    selectedForSize = sourceSize;
+    selectedVariant = best;
+    return *best;
+}
+
+void ONNXDepthInference::bindContext(OnnxInferenceContext& ctx, ModelVariant& variant) {
+    ctx.variant = &variant;
+    ctx.inputTensorValues.assign((size_t)3 * variant.netHeight * variant.netWidth, 0.0f);
+    std::vector<int64_t> inputShape = { 1, 3, variant.netHeight, variant.netWidth };
+    ctx.inputTensor = Ort::Value::CreateTensor<float>(
+        memoryInfo, ctx.inputTensorValues.data(), ctx.inputTensorValues.size(), inputShape.data(), inputShape.size());
+    ctx.ioBinding = std::make_unique<Ort::IoBinding>(*variant.session);
+    ctx.ioBinding->BindInput(inputNames[0], ctx.inputTensor);
+}
+
+bool ONNXDepthInference::OutputSlot::inUse() const {
+    // 下游线程用 CV_XADD 增减引用计数，这里同样用原子操作读取（加 0），与帧池归还时的判断一致
+    auto referenced = [](const cv::Mat& m) { return m.u && CV_XADD(&m.u->refcount, 0) > 1; };
+    return referenced(depth) || referenced(intrinsics) || referenced(extrinsics);
+}
+
+void ONNXDepthInference::allocateOutputSlot(ModelVariant& variant, OutputSlot& slot) {
+    // 新分配内存，旧内存（若仍被下游引用）由 cv::Mat 引用计数负责释放
+    slot.depth = cv::Mat(variant.netHeight, variant.netWidth, CV_32FC1);
+    slot.intrinsics = cv::Mat(3, 3, CV_32FC1);
+    slot.extrinsics = cv::Mat(3, 4, CV_32FC1);
+    // 形状与导出脚本一致: depth [1, H, W], intrinsics [3, 3], extrinsics [3, 4]
+    const int64_t depthShape[] = { 1, variant.netHeight, variant.netWidth };
+    const int64_t kShape[] = { 3, 3 };
+    const int64_t rtShape[] = { 3, 4 };
+    slot.depthValue = Ort::Value::CreateTensor<float>(memoryInfo, slot.depth.ptr<float>(), slot.depth.total(), depthShape, 3);
+    slot.intrinsicsValue = Ort::Value::CreateTensor<float>(memoryInfo, slot.intrinsics.ptr<float>(), slot.intrinsics.total(), kShape, 2);
+    slot.extrinsicsValue = Ort::Value::CreateTensor<float>(memoryInfo, slot.extrinsics.ptr<float>(), slot.extrinsics.total(), rtShape, 2);
+}
+
+ONNXDepthInference::OutputSlot& ONNXDepthInference::acquireOutputSlot(ModelVariant& variant) {
+    auto& outputSlots = variant.outputSlots;
+    size_t& nextOutputSlot = variant.nextOutputSlot;
+    // 从上次位置开始找第一组已被下游全部释放的缓冲
+    for (size_t i = 0; i < outputSlots.size(); ++i) {
+        OutputSlot& slot = outputSlots[(nextOutputSlot + i) % outputSlots.size()];
+        if (!slot.inUse()) {
+            nextOutputSlot = (nextOutputSlot + i + 1) % outputSlots.size();
+            return slot;
+        }
+    }
+    // 全部被占用（下游持有过久），给最旧的一组换新内存，旧内存随最后一个持有者释放
+    OutputSlot& slot = outputSlots[nextOutputSlot];
+    nextOutputSlot = (nextOutputSlot + 1) % outputSlots.size();
+    allocateOutputSlot(variant, slot);
+    return slot;
+}
+
+std::unique_ptr<InferenceContext> ONNXDepthInference::createContext() {
+    auto ctx = std::make_unique<OnnxInferenceContext>();
+    // 先绑定主模型，首帧预处理时再按原图尺寸切换
+    bindContext(*ctx, *variants.front());
+    return ctx;
+}
+
+bool ONNXDepthInference::preprocess(const cv::Mat& input, InferenceContext& baseCtx) {
+    ZYC_PROFILE_SCOPE("ONNXDepthInference::preprocess");
+    if (input.empty()) return false;
+    auto& ctx = static_cast<OnnxInferenceContext&>(baseCtx);
     auto start = std::chrono::high_resolution_clock::now();
-    DepthResult result;
-    int origW = input.cols;
-    int origH = input.rows;
-    // --- 1. 预处理 ---
-    cv::Mat resized, floatImg;
-    cv::resize(input, resized, cv::Size(netWidth, netHeight));
-    cv::cvtColor(resized, resized, cv::COLOR_BGR2RGB); // 必须转 RGB
-    resized.convertTo(floatImg, CV_32FC3, 1.0 / 255.0);
-    // 标准化
-    cv::Scalar mean(0.485, 0.456, 0.406);
-    cv::Scalar std(0.229, 0.224, 0.225);
-    // 注意：这里由于是矩阵运算，可以直接 subtract/divide
-    cv::subtract(floatImg, mean, floatImg);
-    cv::divide(floatImg, std, floatImg);
-    // HWC -> CHW
-    std::vector<float> inputTensorValues(1 * 3 * netHeight * netWidth);
-    std::vector<cv::Mat> channels(3);
-    for (int i = 0; i < 3; ++i) {
-        channels[i] = cv::Mat(netHeight, netWidth, CV_32FC1, &inputTensorValues[i * netHeight * netWidth]);
+    ctx.sourceSize = input.size();
+    // 按原图宽高比选择模型尺寸，与上下文当前绑定的尺寸不同时重新绑定（仅在窗口尺寸变化时发生）
+    ModelVariant& variant = selectVariant(input.size());
+    if (ctx.variant != &variant) bindContext(ctx, variant);
+    // 单趟完成 缩放 + BGR(A)→RGB + 归一化 + CHW，直接写入该上下文的常驻输入张量
+    ctx.preprocessor.run(input, ctx.inputTensorValues.data(), variant.netWidth, variant.netHeight);
+    ctx.preprocessMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    return true;
+}
+
+bool ONNXDepthInference::run(InferenceContext& baseCtx) {
+    ZYC_PROFILE_SCOPE("ONNXDepthInference::run");
+    auto& ctx = static_cast<OnnxInferenceContext&>(baseCtx);
+    auto start = std::chrono::high_resolution_clock::now();
+    try {
+        // 输出直接写入空闲的缓冲组，ORT 不再为输出分配内存
+        {
+            ZYC_PROFILE_SCOPE("acquireOutputSlot");
+            std::lock_guard<std::mutex> lock(slotMtx);
+            OutputSlot& slot = acquireOutputSlot(*ctx.variant);
+            ctx.ioBinding->BindOutput(outputNames[0], slot.depthValue);
+            ctx.ioBinding->BindOutput(outputNames[1], slot.intrinsicsValue);
+            ctx.ioBinding->BindOutput(outputNames[2], slot.extrinsicsValue);
+            // 上下文持有视图期间该缓冲组处于占用状态，Run 之前就占住，并发的推理线程不会挑中同一组
+            ctx.depth = slot.depth;
+            ctx.intrinsics = slot.intrinsics;
+            ctx.extrinsics = slot.extrinsics;
+        }
+        ZYC_PROFILE_SCOPE("Ort::Session::Run");
+        ctx.variant->session->Run(Ort::RunOptions{ nullptr }, *ctx.ioBinding);
+    }
+    catch (const Ort::Exception& e) {
+        LOG_ERR("推理失败: " + std::string(e.what()));
+        ctx.depth.release();
+        ctx.intrinsics.release();
+        ctx.extrinsics.release();
+        return false;
     }
-    cv::split(floatImg, channels);
-    // --- 2. 运行推理 ---
-    auto memory_info = Ort::MemoryInfo::CreateCpu(OrtArenaAllocator, OrtMemTypeDefault);
-    std::vector<int64_t> inputShape = { 1, 3, netHeight, netWidth };
-    Ort::Value inputTensor = Ort::Value::CreateTensor<float>(
-        memory_info, inputTensorValues.data(), inputTensorValues.size(), inputShape.data(), inputShape.size());
-    // 运行模型，获取 3 个输出 Tensor
-    auto outputTensors = session->Run(
-        Ort::RunOptions{ nullptr },
-        inputNames.data(), &inputTensor, 1,
-        outputNames.data(), outputNames.size()
-    );
-    // --- 3. 后处理 ---
-
-    // A. 提取深度图 (Output 0: [1, 504, 504])
-    float* depthData = outputTensors[0].GetTensorMutableData<float>();
-    cv::Mat rawDepth(netHeight, netWidth, CV_32FC1, depthData);
-    result.depthMap = rawDepth.clone(); // 建议 resize 回原图大小或保持 504
-    // B. 提取内参并还原缩放 (Output 1: [3, 3])
-    float* kData = outputTensors[1].GetTensorMutableData<float>();
-    cv::Mat K = cv::Mat(3, 3, CV_32FC1, kData).clone();
-
-    // 关键：将 504 空间的内参映射回原图尺寸
-    float scaleX = (float)origW / netWidth;
-    float scaleY = (float)origH / netHeight;
+    ctx.runMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    return true;
+}
+
+DepthResult ONNXDepthInference::postprocess(InferenceContext& baseCtx) {
+    ZYC_PROFILE_SCOPE("ONNXDepthInference::postprocess");
+    auto& ctx = static_cast<OnnxInferenceContext&>(baseCtx);
+    if (ctx.depth.empty()) return DepthResult();
+    auto start = std::chrono::high_resolution_clock::now();
+    DepthResult result;
+
+    // A. 深度图 (Output 0: [1, H, W])，与缓冲组共享内存，无拷贝
+    result.depthMap = ctx.depth;
+    // B. 内参并还原缩放 (Output 1: [3, 3])
+    cv::Mat& K = ctx.intrinsics;
+
+    // 关键：将网络输入空间的内参映射回原图尺寸（宽高各自缩放，非正方形输入同样成立）
+    float scaleX = (float)ctx.sourceSize.width / ctx.variant->netWidth;
+    float scaleY = (float)ctx.sourceSize.height / ctx.variant->netHeight;
     K.at<float>(0, 0) *= scaleX; // fx
     K.at<float>(0, 2) *= scaleX; // cx
     K.at<float>(1, 1) *= scaleY; // fy
     K.at<float>(1, 2) *= scaleY; // cy
     result.intrinsics = K;
-    // C. 提取外参 (Output 2: [3, 4])
-    float* rtData = outputTensors[2].GetTensorMutableData<float>();
-    result.extrinsics = cv::Mat(3, 4, CV_32FC1, rtData).clone();
-    // D. 生成可视化图
-    double minV, maxV;
-    cv::minMaxLoc(result.depthMap, &minV, &maxV);
-    result.depthMap.convertTo(result.visualDepth, CV_8UC1, 255.0 / (maxV - minV), -minV * 255.0 / (maxV - minV));
-    cv::applyColorMap(result.visualDepth, result.visualDepth, cv::COLORMAP_INFERNO);
-    auto end = std::chrono::high_resolution_clock::now();
-    result.inferTimeMs = std::chrono::duration<double, std::milli>(end - start).count();
+    // C. 外参 (Output 2: [3, 4])
+    result.extrinsics = ctx.extrinsics;
+
+    // 释放上下文对输出缓冲组的引用，之后只由 result 及其下游持有
+    ctx.depth.release();
+    ctx.intrinsics.release();
+    ctx.extrinsics.release();
+
+    double postMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    result.inferTimeMs = ctx.preprocessMs + ctx.runMs + postMs;
     result.isValid = true;
     return result;
-}
\ No newline at end of file
+}
+
+DepthResult ONNXDepthInference::predict(const cv::Mat& input) {
+    ZYC_PROFILE_SCOPE("ONNXDepthInference::predict");
+    if (input.empty() || !defaultContext) return DepthResult();
+    if (!preprocess(input, *defaultContext)) return DepthResult();
+    if (!run(*defaultContext)) return DepthResult();
+    return postprocess(*defaultContext);
+}
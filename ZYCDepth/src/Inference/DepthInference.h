@@ -1,11 +1,15 @@
 ﻿#pragma once
 #include <opencv2/opencv.hpp>
 #include <memory>
+#include <mutex>
 #include <onnxruntime_cxx_api.h>
+#include "Inference/Preprocess.h"
+#include "Inference/SessionTuner.h"
+#include "Inference/ModelCache.h"
 
 struct DepthResult {
-    cv::Mat depthMap;      // 原始深度数据 (CV_32F)
-    cv::Mat visualDepth;   // 可视化深度图 (CV_8U)
+    cv::Mat depthMap;      // 原始深度数据 (CV_32F)，与推理引擎的输出缓冲共享内存，只读
+                           // 可视化图不在推理路径上生成，见 FrameData::displayImage()
 
     // V3 新增输出
     cv::Mat intrinsics;    // 3x3 相机内参 (fx, fy, cx, cy)
@@ -15,29 +19,126 @@ struct DepthResult {
     bool isValid = false;
 };
 
+// 单帧在途推理的上下文：持有该帧的输入张量与输出视图
+// 流水线中每个在途帧占用一个上下文，预处理/推理/后处理三段可以在不同线程对不同上下文并行执行
+struct InferenceContext {
+    virtual ~InferenceContext() = default;
+    cv::Size sourceSize;      // 输入原图尺寸，后处理还原内参用
+    double preprocessMs = 0.0;
+    double runMs = 0.0;
+};
+
 // 抽象接口 准备ONNX Runtime和TensorRT两种实现方法，TensorRT性能比ONNX高，但是配置麻烦，待议
 class IDepthInference {
 public:
     virtual ~IDepthInference() = default;
     virtual bool init(const std::string& modelPath) = 0;
+    // 当前加载的模型精度（INT8 为静态量化模型）
+    virtual InferencePrecision getPrecision() const { return InferencePrecision::FP32; }
+    // 单帧同步推理 = preprocess + run + postprocess
     virtual DepthResult predict(const cv::Mat& input) = 0;
+
+    // ========== 分段接口（流水线使用） ==========
+    // 同一上下文的三个阶段必须按顺序调用；不同上下文的不同阶段可以并行
+    virtual std::unique_ptr<InferenceContext> createContext() = 0;
+    virtual bool preprocess(const cv::Mat& input, InferenceContext& ctx) = 0;
+    virtual bool run(InferenceContext& ctx) = 0;
+    virtual DepthResult postprocess(InferenceContext& ctx) = 0;
 };
 
 // ONNX Runtime 实现
+// 支持同时加载多个固定输入尺寸的模型（如 504x504、336x588、504x896），
+// 每帧按原图宽高比与延迟预算选择最合适的一个，避免把 16:9 画面硬拉成正方形
 class ONNXDepthInference : public IDepthInference {
 public:
     ONNXDepthInference();
+    // 在 init 之前调用，设置自动调优等选项
+    void configure(const InferenceConfig& config) { this->config = config; }
+    // modelPath 为主模型，config.modelVariants 中存在的文件作为附加尺寸一并加载
     bool init(const std::string& modelPath) override;
+    InferencePrecision getPrecision() const override { return config.precision; }
+    const SessionTuning& getTuning() const { return tuning; }
+    // init 中各阶段耗时（模型加载/预热/是否命中优化模型缓存）
+    const StartupMetrics& getStartupMetrics() const { return startupMetrics; }
     DepthResult predict(const cv::Mat& input) override;
+
+    std::unique_ptr<InferenceContext> createContext() override;
+    bool preprocess(const cv::Mat& input, InferenceContext& ctx) override;
+    bool run(InferenceContext& ctx) override;
+    DepthResult postprocess(InferenceContext& ctx) override;
 private:
+    // 一组输出缓冲：内存由 cv::Mat 持有并引用计数，Ort::Value 只是包在同一块内存上的视图。
+    // DepthResult / FrameData 拿到的是这些 Mat 的浅拷贝，下游全部释放后该组缓冲才会被复用。
+    struct OutputSlot {
+        cv::Mat depth;          // [H, W] CV_32F
+        cv::Mat intrinsics;     // [3, 3] CV_32F
+        cv::Mat extrinsics;     // [3, 4] CV_32F
+        Ort::Value depthValue{ nullptr };
+        Ort::Value intrinsicsValue{ nullptr };
+        Ort::Value extrinsicsValue{ nullptr };
+        bool inUse() const;     // 任一缓冲仍被下游引用
+    };
+
+    // 一个固定输入尺寸的模型：会话 + 该尺寸的轮转输出缓冲
+    struct ModelVariant {
+        std::string path;
+        MappedFile mappedModel;    // 优化模型缓存的内存映射，会话直接引用其中的权重，必须比 session 活得久
+        std::unique_ptr<Ort::Session> session;
+        int netWidth = 504;
+        int netHeight = 504;
+        double warmupRunMs = 0.0;  // 预热测得的单次 Run 耗时，按延迟预算选型用
+        std::vector<OutputSlot> outputSlots;   // 轮转使用的输出缓冲组（run 阶段在 slotMtx 下挑选）
+        size_t nextOutputSlot = 0;
+    };
+
+    // ImageNet 均值/方差，RGB 顺序
+    static constexpr float kMean[3] = { 0.485f, 0.456f, 0.406f };
+    static constexpr float kStd[3] = { 0.229f, 0.224f, 0.225f };
+
+    // ONNX 上下文：常驻输入张量 + 各自的 IoBinding，每个在途帧一份
+    // 绑定到某个模型尺寸，原图宽高比变化导致选中其他尺寸时重新绑定
+    struct OnnxInferenceContext : InferenceContext {
+        ModelVariant* variant = nullptr;
+        std::vector<float> inputTensorValues;
+        Ort::Value inputTensor{ nullptr };
+        std::unique_ptr<Ort::IoBinding> ioBinding; // 输入常驻绑定，输出每帧绑定到空闲的缓冲组
+        cv::Mat depth, intrinsics, extrinsics;      // 本帧输出（指向输出缓冲组的视图）
+        // 融合预处理内核，采样表按上下文缓存，多个预处理工作线程互不干扰
+        FusedPreprocessor preprocessor{ kMean, kStd };
+    };
+
     Ort::Env env;
     Ort::SessionOptions sessionOptions;
-    std::unique_ptr<Ort::Session> session;
-    // V3 默认分辨率通常为 504 (根据你的导出脚本)
-    int netWidth = 504;
-    int netHeight = 504;
+    InferenceConfig config;
+    SessionTuning tuning;      // 实际使用的后端/线程配置
+    StartupMetrics startupMetrics;
+    std::vector<std::unique_ptr<ModelVariant>> variants;  // [0] 为主模型
+    Ort::MemoryInfo memoryInfo{ nullptr };
+    // predict() 使用的默认上下文：init 时分配一次，每帧不再分配
+    std::unique_ptr<InferenceContext> defaultContext;
+
+    // 选型结果按原图尺寸缓存（预处理阶段可能有多个工作线程，由 selectMtx 保护）
+    std::mutex selectMtx;
+    cv::Size selectedForSize;
+    ModelVariant* selectedVariant = nullptr;
+
+    std::mutex slotMtx;        // 多个推理工作线程并发挑选输出缓冲组
+    static constexpr int kOutputSlotCount = 6;  // 流水线在途帧 + 下游持有的帧
+
+    // 加载一个模型尺寸，失败抛出 Ort::Exception
+    std::unique_ptr<ModelVariant> loadVariant(const std::string& path, const std::string& provider);
+    // 优先映射加载优化模型缓存，未命中时加载源模型并顺带生成缓存
+    void openSessionCached(ModelVariant& variant, const std::string& provider);
+    // 用该尺寸的临时上下文跑若干次空输入，让 ORT 完成惰性内核选择与内存规划，顺带测得单次耗时
+    void warmup(ModelVariant& variant, int runs);
+    // 按原图宽高比与延迟预算选择模型尺寸
+    ModelVariant& selectVariant(cv::Size sourceSize);
+    void bindContext(OnnxInferenceContext& ctx, ModelVariant& variant);
+
+    void allocateOutputSlot(ModelVariant& variant, OutputSlot& slot);
+    OutputSlot& acquireOutputSlot(ModelVariant& variant);
     // 修改输入输出节点名，对应onnx Python 导出脚本
     std::vector<const char*> inputNames = { "image" };
     // 顺序必须与导出时的 output_names 一致: ["depth", "intrinsics", "extrinsics"]
     std::vector<const char*> outputNames = { "depth", "intrinsics", "extrinsics" };
-};
\ No newline at end of file
+};
@@ -0,0 +1,123 @@
+﻿#include "DepthPropagator.h"
+#include "Profiler/TraceProfiler.h"
+#include <algorithm>
+#include <cmath>
+
+DepthPropagator::DepthPropagator(const InferenceConfig& config)
+    : flowWidth(std::max(64, config.propagationFlowWidth)),
+      maxGap(std::max(1, config.keyframeMaxGap)),
+      maxWarpError(config.keyframeMaxWarpError),
+      maxInvalid(config.keyframeMaxInvalid),
+      flow(cv::DISOpticalFlow::create(cv::DISOpticalFlow::PRESET_ULTRAFAST)) {}
+
+void DepthPropagator::toFlowGray(const cv::Mat& image, cv::Mat& out) const {
+    // 先缩小再转灰度：颜色转换只处理小图
+    int height = std::max(1, (int)std::lround((double)image.rows * flowWidth / image.cols));
+    cv::Mat small;
+    cv::resize(image, small, cv::Size(flowWidth, height), 0, 0, cv::INTER_AREA);
+    switch (small.channels()) {
+    case 4: cv::cvtColor(small, out, cv::COLOR_BGRA2GRAY); break;
+    case 3: cv::cvtColor(small, out, cv::COLOR_BGR2GRAY); break;
+    default: out = small; break;
+    }
+}
+
+DepthPropagator::Result DepthPropagator::onFrame(const FrameHandle& frame) {
+    ZYC_PROFILE_SCOPE("DepthPropagator::onFrame");
+    Result result;
+    if (!frame || !frame->image || frame->image->empty()) return result;
+    // 光流只在推理区域内计算，与关键帧深度图覆盖的区域一致
+    const cv::Rect region = frame->region();
+    toFlowGray((*frame->image)(region), gray);
+
+    auto now = std::chrono::steady_clock::now();
+    const bool waiting = !pending.empty() && now - lastRequest < kKeyframeTimeout;
+    const bool comparable = keyDepth && gray.size() == keyGray.size() && region == keyDepth->roi;
+    bool wantKey = !comparable || ++framesSinceKey >= maxGap;
+
+    if (comparable) {
+        result.depth = warpDepth(*frame);
+        result.warpError = lastWarpError;
+        result.invalidRatio = lastInvalidRatio;
+        if (result.warpError > maxWarpError || result.invalidRatio > maxInvalid) wantKey = true;
+    }
+
+    // 已有关键帧在推理中时不重复请求，超时（被下游丢弃）后重新请求
+    if (wantKey && !waiting) {
+        result.needKeyframe = true;
+        pending.push_back({ frame->sequenceID, gray.clone() });
+        while (pending.size() > 4) pending.pop_front();
+        lastRequest = now;
+    }
+    return result;
+}
+
+bool DepthPropagator::onKeyframeDepth(const FrameHandle& depth) {
+    if (!depth || !depth->rawDepth || depth->rawDepth->empty()) return false;
+    auto it = std::find_if(pending.begin(), pending.end(), [&](const PendingKey& key) { return key.sequenceID == depth->sequenceID; });
+    if (it == pending.end()) return false;
+    keyDepth = depth;
+    keyGray = std::move(it->gray);
+    framesSinceKey = 0;
+    // 比它早请求的关键帧已经没有意义
+    pending.erase(pending.begin(), it + 1);
+    return true;
+}
+
+FrameHandle DepthPropagator::warpDepth(const FrameData& frame) {
+    ZYC_PROFILE_SCOPE("DepthPropagator::warpDepth");
+    auto start = std::chrono::steady_clock::now();
+    const cv::Size size = gray.size();
+    if (gridX.size() != size) {
+        gridX.create(size, CV_32F);
+        gridY.create(size, CV_32F);
+        for (int y = 0; y < size.height; ++y) {
+            float* gx = gridX.ptr<float>(y);
+            float* gy = gridY.ptr<float>(y);
+            for (int x = 0; x < size.width; ++x) { gx[x] = (float)x; gy[x] = (float)y; }
+        }
+        ones = cv::Mat(size, CV_8U, cv::Scalar(255));
+    }
+
+    // 1. 当前帧 → 关键帧的稠密光流：当前帧像素 (x, y) 在关键帧中的位置 = (x, y) + flow
+    flow->calc(gray, keyGray, flowField);
+    cv::split(flowField, flowChannels);
+    cv::add(gridX, flowChannels[0], mapX);
+    cv::add(gridY, flowChannels[1], mapY);
+
+    // 2. 回投关键帧灰度，只在落在关键帧内的像素上计算光度误差
+    cv::remap(keyGray, warped, mapX, mapY, cv::INTER_LINEAR, cv::BORDER_CONSTANT, cv::Scalar(0));
+    cv::remap(ones, valid, mapX, mapY, cv::INTER_NEAREST, cv::BORDER_CONSTANT, cv::Scalar(0));
+    cv::absdiff(gray, warped, diff);
+    int validCount = cv::countNonZero(valid);
+    lastInvalidRatio = 1.0 - (double)validCount / size.area();
+    lastWarpError = validCount > 0 ? cv::mean(diff, valid)[0] : 255.0;
+
+    // 3. 映射换算到深度图网格（像素中心对齐）后最近邻采样关键帧深度
+    const cv::Mat& source = *keyDepth->rawDepth;
+    double sx = (double)source.cols / size.width;
+    double sy = (double)source.rows / size.height;
+    cv::resize(mapX, depthMapX, source.size(), 0, 0, cv::INTER_LINEAR);
+    cv::resize(mapY, depthMapY, source.size(), 0, 0, cv::INTER_LINEAR);
+    depthMapX.convertTo(depthMapX, CV_32F, sx, 0.5 * sx - 0.5);
+    depthMapY.convertTo(depthMapY, CV_32F, sy, 0.5 * sy - 0.5);
+    auto depthMap = std::make_shared<cv::Mat>();
+    cv::remap(source, *depthMap, depthMapX, depthMapY, cv::INTER_NEAREST, cv::BORDER_REPLICATE);
+
+    auto out = std::make_shared<FrameData>();
+    // 排除区域是屏幕固定的 HUD，按当前帧重新置 0，不跟随光流移动
+    applyExclusionMasks(*depthMap, keyDepth->roi, frame.masks);
+    out->rawDepth = std::move(depthMap);
+    out->roi = keyDepth->roi;
+    out->frameSize = keyDepth->frameSize;
+    out->masks = frame.masks;
+    out->depthVisual = std::make_shared<LazyDepthVisual>();
+    out->intrinsics = keyDepth->intrinsics;
+    // 外参留空：关键帧的外参是关键帧时刻的相机位姿，深度已按光流搬到当前视角，沿用它会让建图按过期位姿融合
+    out->sequenceID = frame.sequenceID;
+    out->timestamp = frame.timestamp;
+    out->trace = frame.trace;
+    out->propagated = true;
+    out->captureDurationMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return out;
+}
@@ -0,0 +1,59 @@
+﻿#pragma once
+#include <opencv2/opencv.hpp>
+#include <chrono>
+#include <deque>
+#include "Data/CommonTypes.h"
+
+/**
+ * @brief 关键帧之间的深度传播（流水线 propagate 阶段独占，非线程安全）
+ * @details 完整网络只跑关键帧，中间帧用稠密光流把最近关键帧的深度图搬到当前视角：
+ *          1. 当前帧与关键帧都缩成 flowWidth 宽的灰度图，DIS 光流 (ULTRAFAST) 求当前帧每个像素在关键帧中的位置
+ *          2. 按该映射对关键帧灰度回投，与当前帧比较得到平均光度误差，并统计映射落到关键帧外的像素比例
+ *          3. 映射放大到深度图分辨率，最近邻采样关键帧深度（不插值，避免前后景边缘出现悬空深度）
+ *          误差或越界比例超过阈值、或距关键帧超过 keyframeMaxGap 帧时请求新的关键帧；
+ *          关键帧推理期间中间帧继续从旧关键帧传播，深度输出不断档。
+ *          与关键帧比较而不是逐帧串联，误差不会随帧数累积。
+ */
+class DepthPropagator {
+public:
+    explicit DepthPropagator(const InferenceConfig& config);
+
+    struct Result {
+        bool needKeyframe = false;   ///< 该帧应送去完整推理
+        FrameHandle depth;           ///< 传播得到的深度帧，还没有关键帧深度时为空
+        double warpError = 0.0;      ///< 平均光度误差 (0~255 灰度)
+        double invalidRatio = 0.0;   ///< 映射落在关键帧外的像素比例
+    };
+
+    // 新的截图帧
+    Result onFrame(const FrameHandle& frame);
+    // 关键帧的推理结果到达；返回 false 表示不是本对象请求的关键帧（已过期被替换），忽略
+    bool onKeyframeDepth(const FrameHandle& depth);
+
+private:
+    void toFlowGray(const cv::Mat& image, cv::Mat& gray) const;
+    FrameHandle warpDepth(const FrameData& frame);
+
+    struct PendingKey {
+        long long sequenceID;
+        cv::Mat gray;
+    };
+
+    int flowWidth;
+    int maxGap;
+    double maxWarpError;
+    double maxInvalid;
+    static constexpr std::chrono::milliseconds kKeyframeTimeout{ 1000 };  ///< 请求的关键帧迟迟不回（被丢弃）时重新请求
+
+    cv::Ptr<cv::DISOpticalFlow> flow;
+    FrameHandle keyDepth;            ///< 当前关键帧的深度帧
+    cv::Mat keyGray;                 ///< 当前关键帧的缩小灰度图
+    int framesSinceKey = 0;
+    double lastWarpError = 0.0;
+    double lastInvalidRatio = 0.0;
+    std::deque<PendingKey> pending;  ///< 已请求、结果未到的关键帧（只保留最近几个）
+    std::chrono::steady_clock::time_point lastRequest{};
+
+    // 复用的中间缓冲
+    cv::Mat gray, colorSmall, flowField, flowChannels[2], gridX, gridY, mapX, mapY, warped, diff, valid, ones, depthMapX, depthMapY;
+};
@@ -0,0 +1,131 @@
+﻿#include "InferencePipeline.h"
+#include "Log/Logger.h"
+#include <algorithm>
+
+InferencePipeline::InferencePipeline(IDepthInference& engine, int depth)
+    : engine(engine), depth(std::clamp(depth, 1, 4)) {}
+
+InferencePipeline::~InferencePipeline() = default;
+
+std::shared_ptr<InferenceContext> InferencePipeline::acquireContext() {
+    std::unique_ptr<InferenceContext> ctx;
+    {
+        std::lock_guard<std::mutex> lock(poolMtx);
+        if (freeContexts.empty()) return nullptr;
+        ctx = std::move(freeContexts.back());
+        freeContexts.pop_back();
+    }
+    // 包被下游丢弃或处理完后上下文回到空闲池，并唤醒等待上下文的预处理阶段
+    return std::shared_ptr<InferenceContext>(ctx.release(), [this](InferenceContext* released) {
+        {
+            std::lock_guard<std::mutex> lock(poolMtx);
+            freeContexts.emplace_back(released);
+        }
+        if (graph) graph->notify();
+        });
+}
+
+bool InferencePipeline::hasFreeContext() {
+    std::lock_guard<std::mutex> lock(poolMtx);
+    return !freeContexts.empty();
+}
+
+void InferencePipeline::attach(PipelineGraph& target, const PipelineConfig& config, const std::string& inputPort, const std::string& outputPort) {
+    graph = &target;
+    StageTuning pre = config.stage("preprocess");
+    StageTuning infer = config.stage("infer");
+    StageTuning post = config.stage("postprocess");
+    // 每个并发实例都要有上下文可用，否则多出来的实例永远拿不到活
+    int contexts = std::max(depth, pre.concurrency + infer.concurrency + post.concurrency);
+    {
+        std::lock_guard<std::mutex> lock(poolMtx);
+        for (int i = 0; i < contexts; ++i) freeContexts.push_back(engine.createContext());
+    }
+    LOG_INFO("推理流水线: 在途帧数 " + std::to_string(contexts));
+
+    // 预处理：没有开启推理或没有空闲上下文时不调度，输入边只保留最新一帧
+    StageSpec preprocess;
+    preprocess.name = "preprocess";
+    preprocess.inputs = { { inputPort, EdgePolicy::LatestOnly } };
+    preprocess.outputs = { "preprocessed" };
+    preprocess.concurrency = pre.concurrency;
+    preprocess.cpuBudget = pre.cpuBudget;
+    preprocess.gate = [this] { return SharedContext::getInstance().getIsInferencing() && hasFreeContext(); };
+    preprocess.fn = [this](StageRun& run) {
+        const FrameHandle& frame = run.packet.frame;
+        if (!frame || frame->empty()) return;
+        auto ctx = acquireContext();
+        if (!ctx) return;  // 并发实例抢走了最后一个上下文，这一帧让给下一帧
+        if (frame->trace) frame->trace->mark(TracePoint::PreprocessStart);
+        // 只把 ROI 送进模型：视图不拷贝，缩放直接从 ROI 采样
+        if (!engine.preprocess((*frame->image)(frame->region()), *ctx)) return;
+        if (frame->trace) frame->trace->mark(TracePoint::PreprocessEnd);
+        run.emit("preprocessed", { frame, ctx });
+    };
+    target.addStage(std::move(preprocess));
+
+    StageSpec inference;
+    inference.name = "infer";
+    inference.inputs = { { "preprocessed", EdgePolicy::LatestOnly } };
+    inference.outputs = { "inferred" };
+    inference.concurrency = infer.concurrency;
+    inference.cpuBudget = infer.cpuBudget;
+    inference.fn = [this](StageRun& run) {
+        auto ctx = std::any_cast<std::shared_ptr<InferenceContext>>(run.packet.payload);
+        FrameTrace* trace = run.packet.frame->trace.get();
+        if (trace) trace->mark(TracePoint::RunStart);
+        if (!engine.run(*ctx)) return;
+        if (trace) trace->mark(TracePoint::RunEnd);
+        run.emit("inferred", std::move(run.packet));
+    };
+    target.addStage(std::move(inference));
+
+    StageSpec postprocess;
+    postprocess.name = "postprocess";
+    postprocess.inputs = { { "inferred", EdgePolicy::LatestOnly } };
+    postprocess.outputs = { outputPort };
+    postprocess.concurrency = post.concurrency;
+    postprocess.cpuBudget = post.cpuBudget;
+    postprocess.fn = [this, outputPort](StageRun& run) {
+        auto ctx = std::any_cast<std::shared_ptr<InferenceContext>>(run.packet.payload);
+        const FrameData& source = *run.packet.frame;
+        if (source.trace) source.trace->mark(TracePoint::PostprocessStart);
+        DepthResult result = engine.postprocess(*ctx);
+        if (!result.isValid) return;
+
+        auto depthFrame = std::make_shared<FrameData>();
+        // 可视化图由界面/网页端按需生成（displayImage），无人查看时不产生开销
+        depthFrame->depthVisual = std::make_shared<LazyDepthVisual>();
+        // 保存原始 float 深度图和矩阵用于 3D 还原
+        // 这里只拷贝 Mat 头，和推理引擎的输出缓冲共享内存；所有持有者释放后该缓冲才会被引擎复用
+        depthFrame->rawDepth = std::make_shared<cv::Mat>(result.depthMap);
+        depthFrame->roi = source.region();
+        depthFrame->frameSize = source.image->size();
+        depthFrame->masks = source.masks;
+        // 排除区域置 0：输出缓冲只读，有排除区域时才拷贝一份
+        if (!source.masks.empty()) {
+            depthFrame->rawDepth = std::make_shared<cv::Mat>(result.depthMap.clone());
+            applyExclusionMasks(*depthFrame->rawDepth, depthFrame->roi, depthFrame->masks);
+        }
+        // 内参换算回整幅原图的像素坐标：模型把裁剪图的中心当作主点，实际主点在整幅画面中心，
+        // 保留模型估计的主点偏移，整体平移到原图中心；焦距（像素）与裁剪无关
+        const cv::Rect& roi = depthFrame->roi;
+        if (roi.size() != depthFrame->frameSize && !result.intrinsics.empty()) {
+            result.intrinsics.at<float>(0, 2) += depthFrame->frameSize.width * 0.5f - roi.width * 0.5f;
+            result.intrinsics.at<float>(1, 2) += depthFrame->frameSize.height * 0.5f - roi.height * 0.5f;
+        }
+        depthFrame->intrinsics = result.intrinsics;
+        depthFrame->extrinsics = result.extrinsics;
+        depthFrame->sequenceID = source.sequenceID;
+        depthFrame->timestamp = source.timestamp;
+        depthFrame->captureDurationMs = result.inferTimeMs;
+        depthFrame->trace = source.trace;
+        if (depthFrame->trace) depthFrame->trace->mark(TracePoint::PostprocessEnd);
+
+        // 尽早释放输入包：上下文回到空闲池，截图帧缓冲回到帧池
+        ctx.reset();
+        run.packet = PipelinePacket();
+        run.emit(outputPort, { std::move(depthFrame) });
+    };
+    target.addStage(std::move(postprocess));
+}
@@ -0,0 +1,49 @@
+﻿#pragma once
+#include "Inference/DepthInference.h"
+#include "Data/CommonTypes.h"
+#include "Thread/PipelineGraph.h"
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * @brief 分段推理流水线
+ * @details 把 预处理 → 推理(Run) → 后处理 注册为流水线图中的三个阶段，每个在途帧占用一个 InferenceContext：
+ *          推理第 N 帧的同时预处理第 N+1 帧、后处理第 N-1 帧，CPU 推理时不再有核心在串行段空转。
+ *          阶段之间是 LatestOnly 边：下游忙时上游产出的新帧会顶替还没被取走的旧帧（旧帧直接丢弃并计数），
+ *          保证延迟优先，不会积压过期帧。各阶段的并发数取自 PipelineConfig（如 "infer" 设为 2 即两个推理工作者）。
+ *
+ *          端口：frames（原图帧）→ preprocess → infer → postprocess → depth（深度帧，FrameHandle）
+ *          （深度传播模式下改为 keyframes → … → keydepth，由 propagate 阶段决定哪些帧跑完整网络）
+ */
+class InferencePipeline {
+public:
+    /**
+     * @param engine 已初始化的推理引擎，生命周期需长于流水线
+     * @param depth 在途帧数（上下文数量），1 为串行，2 为双缓冲，3 为三缓冲；不足各阶段并发数之和时自动补足
+     */
+    InferencePipeline(IDepthInference& engine, int depth);
+    ~InferencePipeline();
+
+    /**
+     * @brief 把三个阶段接入流水线图
+     * @details 图必须先于本对象 stop：在途包持有的推理上下文在包析构时归还到本对象的空闲池
+     * @param inputPort 输入帧端口（深度传播模式下只订阅关键帧端口）
+     * @param outputPort 深度帧输出端口
+     */
+    void attach(PipelineGraph& graph, const PipelineConfig& config,
+        const std::string& inputPort = "frames", const std::string& outputPort = "depth");
+
+private:
+    // 取一个空闲上下文，包被丢弃或处理完时自动归还
+    std::shared_ptr<InferenceContext> acquireContext();
+    bool hasFreeContext();
+
+    IDepthInference& engine;
+    int depth;
+    PipelineGraph* graph = nullptr;
+
+    std::mutex poolMtx;
+    std::vector<std::unique_ptr<InferenceContext>> freeContexts;  ///< 空闲上下文
+};
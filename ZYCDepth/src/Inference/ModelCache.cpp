@@ -0,0 +1,100 @@
+﻿#include "ModelCache.h"
+#include "Inference/SessionTuner.h"
+#include <cstdio>
+#include <filesystem>
+#include <system_error>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+bool MappedFile::open(const std::string& path) {
+    close();
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) return false;
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+        CloseHandle(file);
+        return false;
+    }
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (!mapping) {
+        CloseHandle(file);
+        return false;
+    }
+    const void* ptr = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!ptr) {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        return false;
+    }
+    fileHandle = file;
+    mappingHandle = mapping;
+    view = ptr;
+    length = (size_t)fileSize.QuadPart;
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        ::close(fd);
+        return false;
+    }
+    void* ptr = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd); // 映射建立后即可关闭描述符
+    if (ptr == MAP_FAILED) return false;
+    view = ptr;
+    length = (size_t)st.st_size;
+#endif
+    return true;
+}
+
+void MappedFile::close() {
+    if (!view) return;
+#ifdef _WIN32
+    UnmapViewOfFile(view);
+    CloseHandle((HANDLE)mappingHandle);
+    CloseHandle((HANDLE)fileHandle);
+    mappingHandle = nullptr;
+    fileHandle = nullptr;
+#else
+    munmap(const_cast<void*>(view), length);
+#endif
+    view = nullptr;
+    length = 0;
+}
+
+std::string ModelCache::optimizedPath(const std::string& modelPath, const std::string& provider) {
+    // CPU 签名做 FNV-1a 取低 32 位，换机器（指令集不同）时自动使用新的缓存文件
+    uint64_t hash = 1469598103934665603ULL;
+    for (unsigned char c : SessionTuner::cpuSignature()) {
+        hash ^= c;
+        hash *= 1099511628211ULL;
+    }
+    char suffix[16];
+    snprintf(suffix, sizeof(suffix), "%08x", (unsigned int)(hash & 0xffffffffULL));
+    fs::path path(modelPath);
+    path.replace_extension("." + provider + "." + suffix + ".ort");
+    return path.string();
+}
+
+bool ModelCache::isFresh(const std::string& cachePath, const std::string& modelPath) {
+    std::error_code ec;
+    if (!fs::exists(cachePath, ec) || fs::file_size(cachePath, ec) == 0) return false;
+    auto cacheTime = fs::last_write_time(cachePath, ec);
+    if (ec) return false;
+    auto modelTime = fs::last_write_time(modelPath, ec);
+    if (ec) return false;
+    return cacheTime >= modelTime;
+}
@@ -0,0 +1,51 @@
+﻿#pragma once
+#include <cstddef>
+#include <string>
+
+/**
+ * @brief 只读内存映射文件
+ * @details 用于直接从映射内存创建 ORT 会话：模型权重不再整体读入堆内存，
+ *          由系统按需换页，同一模型多进程/频繁重启时可直接命中页缓存。
+ *          会话使用期间映射必须保持有效。
+ */
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool open(const std::string& path);
+    void close();
+
+    const void* data() const { return view; }
+    size_t size() const { return length; }
+    bool isOpen() const { return view != nullptr; }
+
+private:
+    const void* view = nullptr;
+    size_t length = 0;
+#ifdef _WIN32
+    void* fileHandle = nullptr;
+    void* mappingHandle = nullptr;
+#endif
+};
+
+/**
+ * @brief 优化后模型（ORT 格式）缓存
+ * @details 首次加载时让 ORT 把图优化后的模型序列化到源模型旁边，之后直接映射该文件加载，
+ *          跳过 ONNX 解析与 ORT_ENABLE_ALL 图优化。
+ *          优化结果与执行后端、CPU 指令集相关，文件名中带上后端名与 CPU 签名哈希；
+ *          源模型比缓存新时视为过期并重新生成。
+ */
+class ModelCache {
+public:
+    /**
+     * @brief 缓存文件路径，如 models/DA3-SMALL-504.CPU.1a2b3c4d.ort
+     * @param provider 实际生效的执行后端 ("CUDA" / "CPU")
+     */
+    static std::string optimizedPath(const std::string& modelPath, const std::string& provider);
+
+    // 缓存存在且不早于源模型
+    static bool isFresh(const std::string& cachePath, const std::string& modelPath);
+};
@@ -0,0 +1,168 @@
+﻿#include "Preprocess.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include "Data/SimdDispatch.h"
+
+#if defined(ZYC_SIMD_X86)
+#define ZYC_PREPROCESS_AVX2 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define ZYC_PREPROCESS_NEON 1
+#endif
+
+FusedPreprocessor::FusedPreprocessor(const float mean[3], const float std[3]) {
+    for (int c = 0; c < 3; ++c) {
+        scale[c] = 1.0f / (255.0f * std[c]);
+        bias[c] = -mean[c] / std[c];
+    }
+}
+
+// 计算一维双线性采样表（与 cv::resize INTER_LINEAR 相同的像素中心对齐方式）
+static void buildAxisTable(int srcLen, int dstLen, std::vector<int>& ofs0, std::vector<int>& ofs1, std::vector<float>& weight) {
+    ofs0.resize(dstLen);
+    ofs1.resize(dstLen);
+    weight.resize(dstLen);
+    double ratio = (double)srcLen / dstLen;
+    for (int d = 0; d < dstLen; ++d) {
+        double f = (d + 0.5) * ratio - 0.5;
+        int i0 = (int)std::floor(f);
+        float w = (float)(f - i0);
+        if (i0 < 0) {
+            i0 = 0;
+            w = 0.0f;
+        }
+        if (i0 >= srcLen - 1) {
+            i0 = srcLen - 1;
+            w = 0.0f;
+        }
+        ofs0[d] = i0;
+        ofs1[d] = std::min(i0 + 1, srcLen - 1);
+        weight[d] = w;
+    }
+}
+
+void FusedPreprocessor::updateTables(int srcW, int srcH, int dstW, int dstH) {
+    if (srcW != tableSrcW || dstW != tableDstW) {
+        buildAxisTable(srcW, dstW, xOfs0, xOfs1, xWeight);
+        tableSrcW = srcW;
+        tableDstW = dstW;
+    }
+    if (srcH != tableSrcH || dstH != tableDstH) {
+        buildAxisTable(srcH, dstH, yOfs0, yOfs1, yWeight);
+        tableSrcH = srcH;
+        tableDstH = dstH;
+    }
+}
+
+#if defined(ZYC_PREPROCESS_AVX2)
+// 一次处理 8 个输出像素：BGRA 每像素正好 32 位，直接用 gather 取四个邻域像素；返回处理到的列号
+static ZYC_TARGET_AVX2 int processRowAvx2(const uint8_t* row0, const uint8_t* row1, float wy, const int* xOfs0, const int* xOfs1,
+    const float* xWeight, const float scale[3], const float bias[3], float* const outs[3], int dstW) {
+    const int* p0 = reinterpret_cast<const int*>(row0);
+    const int* p1 = reinterpret_cast<const int*>(row1);
+    const __m256i byteMask = _mm256_set1_epi32(0xFF);
+    const __m256 vwy = _mm256_set1_ps(wy);
+    const __m256 vScale[3] = { _mm256_set1_ps(scale[0]), _mm256_set1_ps(scale[1]), _mm256_set1_ps(scale[2]) };
+    const __m256 vBias[3] = { _mm256_set1_ps(bias[0]), _mm256_set1_ps(bias[1]), _mm256_set1_ps(bias[2]) };
+    int dx = 0;
+    for (; dx + 8 <= dstW; dx += 8) {
+        __m256i ix0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(xOfs0 + dx));
+        __m256i ix1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(xOfs1 + dx));
+        __m256 vwx = _mm256_loadu_ps(xWeight + dx);
+        __m256i q00 = _mm256_i32gather_epi32(p0, ix0, 4);
+        __m256i q01 = _mm256_i32gather_epi32(p0, ix1, 4);
+        __m256i q10 = _mm256_i32gather_epi32(p1, ix0, 4);
+        __m256i q11 = _mm256_i32gather_epi32(p1, ix1, 4);
+        for (int c = 0; c < 3; ++c) {
+            // 输出 R/G/B 分别对应 BGRA 的第 2/1/0 字节
+            const __m128i shift = _mm_cvtsi32_si128(8 * (2 - c));
+            __m256 a = _mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srl_epi32(q00, shift), byteMask));
+            __m256 b = _mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srl_epi32(q01, shift), byteMask));
+            __m256 d = _mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srl_epi32(q10, shift), byteMask));
+            __m256 e = _mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srl_epi32(q11, shift), byteMask));
+            __m256 top = _mm256_add_ps(a, _mm256_mul_ps(_mm256_sub_ps(b, a), vwx));
+            __m256 bot = _mm256_add_ps(d, _mm256_mul_ps(_mm256_sub_ps(e, d), vwx));
+            __m256 v = _mm256_add_ps(top, _mm256_mul_ps(_mm256_sub_ps(bot, top), vwy));
+            _mm256_storeu_ps(outs[c] + dx, _mm256_add_ps(_mm256_mul_ps(v, vScale[c]), vBias[c]));
+        }
+    }
+    return dx;
+}
+#endif
+
+void FusedPreprocessor::processRow(const cv::Mat& src, float* dst, int dstW, int dstH, int dy) const {
+    const int cn = src.channels();
+    const uint8_t* row0 = src.ptr<uint8_t>(yOfs0[dy]);
+    const uint8_t* row1 = src.ptr<uint8_t>(yOfs1[dy]);
+    const float wy = yWeight[dy];
+    const size_t plane = (size_t)dstW * dstH;
+    float* outR = dst + (size_t)dy * dstW;
+    float* outG = outR + plane;
+    float* outB = outG + plane;
+
+    int dx = 0;
+#if defined(ZYC_PREPROCESS_AVX2)
+    if (cn == 4 && cpuHasAvx2()) {
+        float* outs[3] = { outR, outG, outB };
+        dx = processRowAvx2(row0, row1, wy, xOfs0.data(), xOfs1.data(), xWeight.data(), scale, bias, outs, dstW);
+    }
+#elif defined(ZYC_PREPROCESS_NEON)
+    if (cn == 4) {
+        // NEON 没有 gather：逐个装载 4 个 BGRA 像素，其余计算向量化
+        const uint32x4_t byteMask = vdupq_n_u32(0xFF);
+        const float32x4_t vwy = vdupq_n_f32(wy);
+        float* outs[3] = { outR, outG, outB };
+        for (; dx + 4 <= dstW; dx += 4) {
+            uint32_t t00[4], t01[4], t10[4], t11[4];
+            for (int k = 0; k < 4; ++k) {
+                std::memcpy(&t00[k], row0 + 4 * xOfs0[dx + k], 4);
+                std::memcpy(&t01[k], row0 + 4 * xOfs1[dx + k], 4);
+                std::memcpy(&t10[k], row1 + 4 * xOfs0[dx + k], 4);
+                std::memcpy(&t11[k], row1 + 4 * xOfs1[dx + k], 4);
+            }
+            uint32x4_t q00 = vld1q_u32(t00), q01 = vld1q_u32(t01), q10 = vld1q_u32(t10), q11 = vld1q_u32(t11);
+            float32x4_t vwx = vld1q_f32(&xWeight[dx]);
+            for (int c = 0; c < 3; ++c) {
+                const int32x4_t shift = vdupq_n_s32(-8 * (2 - c)); // 负数即右移
+                float32x4_t a = vcvtq_f32_u32(vandq_u32(vshlq_u32(q00, shift), byteMask));
+                float32x4_t b = vcvtq_f32_u32(vandq_u32(vshlq_u32(q01, shift), byteMask));
+                float32x4_t d = vcvtq_f32_u32(vandq_u32(vshlq_u32(q10, shift), byteMask));
+                float32x4_t e = vcvtq_f32_u32(vandq_u32(vshlq_u32(q11, shift), byteMask));
+                float32x4_t top = vmlaq_f32(a, vsubq_f32(b, a), vwx);
+                float32x4_t bot = vmlaq_f32(d, vsubq_f32(e, d), vwx);
+                float32x4_t v = vmlaq_f32(top, vsubq_f32(bot, top), vwy);
+                vst1q_f32(outs[c] + dx, vmlaq_f32(vdupq_n_f32(bias[c]), v, vdupq_n_f32(scale[c])));
+            }
+        }
+    }
+#endif
+
+    // 标量路径：处理向量化剩余的尾部，以及 BGR 三通道输入
+    for (; dx < dstW; ++dx) {
+        const uint8_t* a = row0 + xOfs0[dx] * cn;
+        const uint8_t* b = row0 + xOfs1[dx] * cn;
+        const uint8_t* d = row1 + xOfs0[dx] * cn;
+        const uint8_t* e = row1 + xOfs1[dx] * cn;
+        const float wx = xWeight[dx];
+        float* outs[3] = { outR, outG, outB };
+        for (int c = 0; c < 3; ++c) {
+            const int sc = 2 - c;
+            float top = a[sc] + (b[sc] - a[sc]) * wx;
+            float bot = d[sc] + (e[sc] - d[sc]) * wx;
+            float v = top + (bot - top) * wy;
+            outs[c][dx] = v * scale[c] + bias[c];
+        }
+    }
+}
+
+void FusedPreprocessor::run(const cv::Mat& src, float* dst, int dstW, int dstH) {
+    CV_Assert(src.depth() == CV_8U && (src.channels() == 3 || src.channels() == 4));
+    updateTables(src.cols, src.rows, dstW, dstH);
+    // 行间互不依赖，按行条带并行；nstripes 控制调度粒度，避免任务过碎
+    cv::parallel_for_(cv::Range(0, dstH), [&](const cv::Range& range) {
+        for (int dy = range.start; dy < range.end; ++dy) {
+            processRow(src, dst, dstW, dstH, dy);
+        }
+        }, std::max(1.0, dstH / 32.0));
+}
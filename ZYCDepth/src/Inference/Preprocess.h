@@ -0,0 +1,41 @@
+﻿#pragma once
+#include <opencv2/opencv.hpp>
+#include <vector>
+
+/**
+ * @brief 单趟融合预处理内核
+ * @details 一次遍历完成：双线性缩放 + BGR(A)→RGB + (x/255 - mean)/std 归一化 + HWC→CHW 平面化，
+ *          结果直接写入调用方提供的输入张量缓冲，不产生任何中间 Mat。
+ *          输入支持 CV_8UC4 (BGRA，截图原生格式) 与 CV_8UC3 (BGR)，可以是 ROI 子图。
+ *          BGRA 输入走 AVX2 (x86，运行时检测 CPU) / NEON (ARM) 向量路径，其余情况走标量路径。
+ *          坐标映射与 cv::resize(INTER_LINEAR) 一致（像素中心对齐）。
+ */
+class FusedPreprocessor {
+public:
+    /**
+     * @param mean RGB 顺序的均值
+     * @param std  RGB 顺序的标准差
+     */
+    FusedPreprocessor(const float mean[3], const float std[3]);
+
+    /**
+     * @brief 执行预处理
+     * @param src 输入图像 (CV_8UC3 / CV_8UC4)
+     * @param dst 输出缓冲，大小至少为 3 * dstW * dstH，依次为 R、G、B 三个平面
+     */
+    void run(const cv::Mat& src, float* dst, int dstW, int dstH);
+
+private:
+    // 输入/输出尺寸变化时重建采样表，尺寸不变时跨帧复用
+    void updateTables(int srcW, int srcH, int dstW, int dstH);
+    void processRow(const cv::Mat& src, float* dst, int dstW, int dstH, int dy) const;
+
+    float scale[3];   ///< 1 / (255 * std)，RGB 顺序
+    float bias[3];    ///< -mean / std，RGB 顺序
+
+    int tableSrcW = 0, tableSrcH = 0, tableDstW = 0, tableDstH = 0;
+    std::vector<int> xOfs0, xOfs1;    ///< 每个输出列对应的左右源像素列号
+    std::vector<float> xWeight;       ///< 右侧源像素的权重
+    std::vector<int> yOfs0, yOfs1;    ///< 每个输出行对应的上下源像素行号
+    std::vector<float> yWeight;       ///< 下方源像素的权重
+};
@@ -0,0 +1,263 @@
+﻿#include "SessionTuner.h"
+#include "Log/Logger.h"
+#include <nlohmann/json.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <thread>
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+
+std::string SessionTuning::describe() const {
+    std::ostringstream oss;
+    oss << provider << " intra=" << intraOpThreads << " inter=" << interOpThreads
+        << (parallelExecution ? " parallel" : " sequential") << (cpuArena ? " arena" : " no-arena");
+    if (p95Ms > 0.0) oss << " p95=" << p95Ms << "ms";
+    return oss.str();
+}
+
+SessionTuner::SessionTuner(Ort::Env& env, const InferenceConfig& config) : env(env), config(config) {}
+
+bool SessionTuner::apply(Ort::SessionOptions& options, const SessionTuning& tuning) {
+    bool cudaEnabled = false;
+    if (tuning.provider == "auto" || tuning.provider == "CUDA") {
+        try {
+            OrtCUDAProviderOptions cuda_options;
+            // 设置一些常用的 CUDA 优化参数（可选）
+            cuda_options.device_id = 0;
+            cuda_options.cudnn_conv_algo_search = OrtCudnnConvAlgoSearchExhaustive;
+            options.AppendExecutionProvider_CUDA(cuda_options);
+            cudaEnabled = true; // 如果运行到这里没报错，说明 Provider 加载成功
+        }
+        catch (...) {
+            if (tuning.provider == "CUDA") throw;
+            LOG_WARN("CUDA 硬件环境检查失败，系统将自动回退到 CPU 模式", true);
+        }
+    }
+    if (tuning.intraOpThreads > 0) options.SetIntraOpNumThreads(tuning.intraOpThreads);
+    if (tuning.interOpThreads > 0) options.SetInterOpNumThreads(tuning.interOpThreads);
+    options.SetExecutionMode(tuning.parallelExecution ? ExecutionMode::ORT_PARALLEL : ExecutionMode::ORT_SEQUENTIAL);
+    if (tuning.cpuArena) {
+        options.EnableCpuMemArena();
+        options.EnableMemPattern();
+    }
+    else {
+        options.DisableCpuMemArena();
+        options.DisableMemPattern();
+    }
+    options.SetGraphOptimizationLevel(GraphOptimizationLevel::ORT_ENABLE_ALL);
+    return cudaEnabled;
+}
+
+std::unique_ptr<Ort::Session> SessionTuner::openSession(Ort::Env& env, const std::string& modelPath, const Ort::SessionOptions& options) {
+#ifdef _WIN32
+    std::wstring wModelPath = std::wstring(modelPath.begin(), modelPath.end());
+    return std::make_unique<Ort::Session>(env, wModelPath.c_str(), options);
+#else
+    return std::make_unique<Ort::Session>(env, modelPath.c_str(), options);
+#endif
+}
+
+std::vector<int64_t> SessionTuner::inputShapeOf(const Ort::Session& session, int64_t fallbackH, int64_t fallbackW) {
+    std::vector<int64_t> shape = session.GetInputTypeInfo(0).GetTensorTypeAndShapeInfo().GetShape();
+    if (shape.size() != 4) return { 1, 3, fallbackH, fallbackW };
+    if (shape[0] <= 0) shape[0] = 1;
+    if (shape[1] <= 0) shape[1] = 3;
+    if (shape[2] <= 0) shape[2] = fallbackH;
+    if (shape[3] <= 0) shape[3] = fallbackW;
+    return shape;
+}
+
+std::string SessionTuner::hashFile(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) return "";
+    uint64_t hash = 1469598103934665603ULL;
+    std::vector<char> buffer(1 << 20);
+    while (file) {
+        file.read(buffer.data(), buffer.size());
+        std::streamsize n = file.gcount();
+        for (std::streamsize i = 0; i < n; ++i) {
+            hash ^= (uint8_t)buffer[(size_t)i];
+            hash *= 1099511628211ULL;
+        }
+    }
+    std::ostringstream oss;
+    oss << std::hex << hash;
+    return oss.str();
+}
+
+std::string SessionTuner::cpuSignature() {
+    // CPUID 0x80000002~0x80000004 返回 48 字节的品牌字符串
+    char brand[49] = {};
+    unsigned int regs[4] = {};
+    for (unsigned int i = 0; i < 3; ++i) {
+#ifdef _MSC_VER
+        __cpuid(reinterpret_cast<int*>(regs), (int)(0x80000002 + i));
+#else
+        __get_cpuid(0x80000002 + i, &regs[0], &regs[1], &regs[2], &regs[3]);
+#endif
+        std::memcpy(brand + i * 16, regs, 16);
+    }
+    std::string sig(brand);
+    sig.erase(0, sig.find_first_not_of(' '));
+    return sig + " x" + std::to_string(std::thread::hardware_concurrency());
+}
+
+std::vector<SessionTuning> SessionTuner::candidates() const {
+    std::vector<SessionTuning> list;
+    auto providers = Ort::GetAvailableProviders();
+    bool hasCuda = std::find(providers.begin(), providers.end(), "CUDAExecutionProvider") != providers.end();
+    // INT8 模型固定走 CPU 整数内核，不参与 GPU 候选
+    if (hasCuda && config.precision != InferencePrecision::INT8) {
+        // GPU 上算子都在设备端执行，CPU 线程配置影响很小，只测默认配置
+        SessionTuning cuda;
+        cuda.provider = "CUDA";
+        list.push_back(cuda);
+    }
+
+    int cores = (int)std::max(1u, std::thread::hardware_concurrency());
+    std::vector<int> threadCounts = { cores, std::max(1, cores / 2), std::max(1, cores / 4) };
+    threadCounts.erase(std::unique(threadCounts.begin(), threadCounts.end()), threadCounts.end());
+    for (int threads : threadCounts) {
+        for (bool parallel : { false, true }) {
+            for (bool arena : { true, false }) {
+                SessionTuning cpu;
+                cpu.provider = "CPU";
+                cpu.intraOpThreads = threads;
+                cpu.interOpThreads = parallel ? 2 : 1;
+                cpu.parallelExecution = parallel;
+                cpu.cpuArena = arena;
+                list.push_back(cpu);
+            }
+        }
+    }
+    return list;
+}
+
+double SessionTuner::benchmark(const std::string& modelPath, const SessionTuning& tuning) {
+    try {
+        Ort::SessionOptions options;
+        apply(options, tuning);
+        auto session = openSession(env, modelPath, options);
+
+        Ort::AllocatorWithDefaultOptions allocator;
+        auto inputName = session->GetInputNameAllocated(0, allocator);
+        std::vector<Ort::AllocatedStringPtr> outputNameHolders;
+        std::vector<const char*> outputNames;
+        for (size_t i = 0; i < session->GetOutputCount(); ++i) {
+            outputNameHolders.push_back(session->GetOutputNameAllocated(i, allocator));
+            outputNames.push_back(outputNameHolders.back().get());
+        }
+        const char* inputNames[] = { inputName.get() };
+        std::vector<int64_t> inputShape = inputShapeOf(*session);
+
+        // 合成输入：固定种子的归一化噪声，延迟与像素内容无关
+        size_t count = 1;
+        for (int64_t d : inputShape) count *= (size_t)d;
+        std::vector<float> input(count);
+        std::mt19937 rng(42);
+        std::normal_distribution<float> dist(0.0f, 1.0f);
+        for (auto& v : input) v = dist(rng);
+        auto memoryInfo = Ort::MemoryInfo::CreateCpu(OrtArenaAllocator, OrtMemTypeDefault);
+        Ort::Value tensor = Ort::Value::CreateTensor<float>(memoryInfo, input.data(), input.size(), inputShape.data(), inputShape.size());
+
+        for (int i = 0; i < config.autoTuneWarmupRuns; ++i) {
+            session->Run(Ort::RunOptions{ nullptr }, inputNames, &tensor, 1, outputNames.data(), outputNames.size());
+        }
+        std::vector<double> samples;
+        for (int i = 0; i < std::max(1, config.autoTuneMeasureRuns); ++i) {
+            auto start = std::chrono::high_resolution_clock::now();
+            session->Run(Ort::RunOptions{ nullptr }, inputNames, &tensor, 1, outputNames.data(), outputNames.size());
+            samples.push_back(std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count());
+        }
+        std::sort(samples.begin(), samples.end());
+        size_t idx = (size_t)std::ceil(0.95 * samples.size()) - 1;
+        return samples[std::min(idx, samples.size() - 1)];
+    }
+    catch (const std::exception& e) {
+        LOG_WARN("调优: 候选配置不可用 [" + tuning.describe() + "] " + e.what());
+        return -1.0;
+    }
+}
+
+bool SessionTuner::loadCache(const std::string& key, SessionTuning& tuning) const {
+    std::ifstream file(config.tuningCachePath);
+    if (!file) return false;
+    try {
+        nlohmann::json cache = nlohmann::json::parse(file);
+        if (!cache.contains(key)) return false;
+        const auto& j = cache[key];
+        tuning.provider = j.value("provider", "CPU");
+        tuning.intraOpThreads = j.value("intra_op_threads", 0);
+        tuning.interOpThreads = j.value("inter_op_threads", 0);
+        tuning.parallelExecution = j.value("parallel", false);
+        tuning.cpuArena = j.value("cpu_arena", true);
+        tuning.p95Ms = j.value("p95_ms", 0.0);
+        return true;
+    }
+    catch (const std::exception& e) {
+        LOG_WARN("调优缓存解析失败: " + std::string(e.what()));
+        return false;
+    }
+}
+
+void SessionTuner::saveCache(const std::string& key, const SessionTuning& tuning) const {
+    nlohmann::json cache = nlohmann::json::object();
+    {
+        std::ifstream file(config.tuningCachePath);
+        if (file) {
+            try { cache = nlohmann::json::parse(file); }
+            catch (...) { cache = nlohmann::json::object(); }
+        }
+    }
+    cache[key] = {
+        { "provider", tuning.provider },
+        { "intra_op_threads", tuning.intraOpThreads },
+        { "inter_op_threads", tuning.interOpThreads },
+        { "parallel", tuning.parallelExecution },
+        { "cpu_arena", tuning.cpuArena },
+        { "p95_ms", tuning.p95Ms },
+    };
+    std::ofstream out(config.tuningCachePath);
+    out << cache.dump(2);
+}
+
+SessionTuning SessionTuner::resolve(const std::string& modelPath) {
+    std::string modelHash = hashFile(modelPath);
+    std::string key = modelHash + "|" + cpuSignature();
+    SessionTuning best;
+    if (modelHash.empty()) return best; // 模型不存在，交给 init 报错
+
+    if (loadCache(key, best)) {
+        LOG_INFO("调优: 使用缓存配置 [" + best.describe() + "]", true);
+        return best;
+    }
+
+    auto list = candidates();
+    LOG_INFO("调优: 首次在本机运行该模型，开始测试 " + std::to_string(list.size()) + " 组配置...", true);
+    double bestP95 = -1.0;
+    for (auto& candidate : list) {
+        double p95 = benchmark(modelPath, candidate);
+        if (p95 < 0.0) continue;
+        candidate.p95Ms = p95;
+        LOG_INFO("调优: [" + candidate.describe() + "]");
+        if (bestP95 < 0.0 || p95 < bestP95) {
+            bestP95 = p95;
+            best = candidate;
+        }
+    }
+    if (bestP95 < 0.0) {
+        LOG_WARN("调优: 没有可用的候选配置，使用默认配置", true);
+        return SessionTuning();
+    }
+    saveCache(key, best);
+    LOG_INFO("调优完成: [" + best.describe() + "]", true);
+    return best;
+}
@@ -0,0 +1,62 @@
+﻿#pragma once
+#include "Data/CommonTypes.h"
+#include <onnxruntime_cxx_api.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * @brief 一组 ORT 会话配置（执行后端 + 线程 + 执行模式 + 内存策略）
+ */
+struct SessionTuning {
+    std::string provider = "auto";  ///< "auto"-优先 CUDA 失败回退 CPU，"CUDA"，"CPU"
+    int intraOpThreads = 0;         ///< 算子内线程数，0 表示 ORT 默认
+    int interOpThreads = 0;         ///< 算子间线程数，仅并行执行模式有效
+    bool parallelExecution = false; ///< ORT_PARALLEL / ORT_SEQUENTIAL
+    bool cpuArena = true;           ///< CPU 内存池 + 内存模式规划（两者同开同关）
+    double p95Ms = 0.0;             ///< 自动调优测得的 p95 延迟
+
+    std::string describe() const;
+};
+
+/**
+ * @brief 执行后端与线程配置自动调优器
+ * @details 启动时在若干合成输入上对候选配置（可用后端 × 线程数 × 执行模式 × 内存池开关）逐个测速，
+ *          取 p95 延迟最低者。结果以 “模型文件哈希 + CPU 签名” 为键写入缓存文件，
+ *          同一模型在同一类机器上再次启动时直接读取缓存，跳过测速。
+ */
+class SessionTuner {
+public:
+    SessionTuner(Ort::Env& env, const InferenceConfig& config);
+
+    /**
+     * @brief 读取缓存，未命中时执行测速并写回缓存
+     * @param modelPath 模型路径（输入形状从模型中读取）
+     */
+    SessionTuning resolve(const std::string& modelPath);
+
+    /**
+     * @brief 把配置应用到 SessionOptions
+     * @return 是否成功挂载了 CUDA 执行后端
+     */
+    static bool apply(Ort::SessionOptions& options, const SessionTuning& tuning);
+
+    static std::unique_ptr<Ort::Session> openSession(Ort::Env& env, const std::string& modelPath, const Ort::SessionOptions& options);
+
+    // 读取会话第一个输入的固定形状 (NCHW)，动态维度用 fallbackH/fallbackW 代替
+    static std::vector<int64_t> inputShapeOf(const Ort::Session& session, int64_t fallbackH = 504, int64_t fallbackW = 504);
+
+    static std::string hashFile(const std::string& path);   ///< FNV-1a 64 位文件哈希（十六进制）
+    static std::string cpuSignature();                      ///< CPU 品牌字符串 + 逻辑核数
+
+private:
+    std::vector<SessionTuning> candidates() const;
+    // 测一个候选配置的 p95 延迟，失败（如后端不可用）返回负数
+    double benchmark(const std::string& modelPath, const SessionTuning& tuning);
+
+    bool loadCache(const std::string& key, SessionTuning& tuning) const;
+    void saveCache(const std::string& key, const SessionTuning& tuning) const;
+
+    Ort::Env& env;
+    InferenceConfig config;
+};
@@ -0,0 +1,349 @@
+﻿#include "FeatureOdometry.h"
+#include "Profiler/TraceProfiler.h"
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cmath>
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    constexpr int kCell = 32;             // 分桶网格边长（该层像素）
+    constexpr int kFastThreshold = 12;
+    constexpr int kPatchSize = 31;        // ORB 描述子的采样块，离边界不足半块的点会被 compute 丢掉
+    constexpr int kDescriptorBytes = 32;
+    constexpr float kSearchRadius = 12.0f;   // 投影匹配的搜索半径（工作图像素，按层放大）
+    constexpr int kMaxHamming = 50;
+    constexpr float kRatio = 0.8f;           // 最近 / 次近距离之比的上限，排除重复纹理上的歧义匹配
+    constexpr int kMinMatches = 30;          // 少于该数时放大搜索半径重找
+    constexpr int kMinInliers = 20;
+    constexpr float kReprojError = 2.0f;     // RANSAC 重投影误差阈值（工作图像素）
+
+    double valueAt(const cv::Mat& m, int r, int c) {
+        return m.depth() == CV_64F ? m.at<double>(r, c) : (double)m.at<float>(r, c);
+    }
+}
+
+FeatureOdometry::FeatureOdometry(const MappingConfig& config) : workWidth(0), targetFeatures(0), minDepth(0), maxDepth(0) {
+    orbs.resize(kLevels);
+    for (auto& orb : orbs) orb = cv::ORB::create(500, kLevelScale, 1, kPatchSize, 0, 2, cv::ORB::HARRIS_SCORE, kPatchSize, kFastThreshold);
+    configure(config);
+}
+
+bool FeatureOdometry::configure(const MappingConfig& config) {
+    const int width = std::max(160, config.odometryWidth);
+    const int features = std::max(100, config.odometryFeatures);
+    if (width == workWidth && features == targetFeatures && config.minDepth == minDepth && config.maxDepth == maxDepth) return false;
+    workWidth = width;
+    targetFeatures = features;
+    minDepth = config.minDepth;
+    maxDepth = config.maxDepth;
+    reset();
+    return true;
+}
+
+void FeatureOdometry::reset() {
+    history.clear();
+    reference = Reference();
+    lastDepthFeatures.reset();
+    lastTracked = false;
+    velocity = RigidTransform();
+}
+
+void FeatureOdometry::extract(const cv::Mat& image, const cv::Rect& roi, Features& out) {
+    ZYC_PROFILE_SCOPE("FeatureOdometry::extract");
+    // 先缩小再转灰度：颜色转换只处理小图
+    const int height = std::max(1, (int)std::lround((double)roi.height * workWidth / roi.width));
+    cv::resize(image(roi), small, cv::Size(workWidth, height), 0, 0, cv::INTER_AREA);
+    switch (small.channels()) {
+    case 4: cv::cvtColor(small, gray, cv::COLOR_BGRA2GRAY); break;
+    case 3: cv::cvtColor(small, gray, cv::COLOR_BGR2GRAY); break;
+    default: gray = small; break;
+    }
+    workScale = (float)roi.width / workWidth;
+
+    pyramid.resize(kLevels);
+    pyramid[0] = gray;
+    for (int l = 1; l < kLevels; ++l) {
+        const cv::Size size((int)std::lround(pyramid[l - 1].cols / kLevelScale), (int)std::lround(pyramid[l - 1].rows / kLevelScale));
+        cv::resize(pyramid[l - 1], pyramid[l], size, 0, 0, cv::INTER_LINEAR);
+    }
+
+    // 各层目标点数按面积分配
+    float weights[kLevels], weightSum = 0.0f;
+    for (int l = 0; l < kLevels; ++l) weightSum += weights[l] = std::pow(kLevelScale, -2.0f * l);
+
+    std::vector<cv::KeyPoint> levelKeys[kLevels];
+    cv::Mat levelDescriptors[kLevels];
+    cv::parallel_for_(cv::Range(0, kLevels), [&](const cv::Range& range) {
+        for (int l = range.start; l < range.end; ++l) {
+            const cv::Mat& level = pyramid[l];
+            const int target = std::max(1, (int)std::lround(targetFeatures * weights[l] / weightSum));
+            std::vector<cv::KeyPoint> raw;
+            cv::FAST(level, raw, kFastThreshold, true);
+
+            // 网格分桶：全层按响应排序后每格最多留 perCell 个（给弱纹理格子留出名额），总数再截到 target
+            const int gridCols = std::max(1, level.cols / kCell), gridRows = std::max(1, level.rows / kCell);
+            const int perCell = std::max(1, (2 * target + gridCols * gridRows - 1) / (gridCols * gridRows));
+            std::sort(raw.begin(), raw.end(), [](const cv::KeyPoint& a, const cv::KeyPoint& b) { return a.response > b.response; });
+            std::vector<int> counts(gridCols * gridRows, 0);
+            std::vector<cv::KeyPoint>& keys = levelKeys[l];
+            keys.reserve(target);
+            for (const cv::KeyPoint& kp : raw) {
+                const int cx = std::min(gridCols - 1, (int)kp.pt.x / kCell), cy = std::min(gridRows - 1, (int)kp.pt.y / kCell);
+                int& count = counts[cy * gridCols + cx];
+                if (count >= perCell) continue;
+                count++;
+                keys.push_back(kp);
+                keys.back().angle = 0.0f;
+                keys.back().size = (float)kPatchSize;
+                keys.back().octave = 0;
+                if ((int)keys.size() >= target) break;
+            }
+            orbs[l]->compute(level, keys, levelDescriptors[l]);
+
+            // 层像素 → 工作图像素 → 原图像素（像素中心对齐）
+            const float levelScale = (float)pyramid[0].cols / level.cols;
+            for (cv::KeyPoint& kp : keys) {
+                const float wx = (kp.pt.x + 0.5f) * levelScale - 0.5f, wy = (kp.pt.y + 0.5f) * levelScale - 0.5f;
+                kp.pt.x = roi.x + (wx + 0.5f) * workScale - 0.5f;
+                kp.pt.y = roi.y + (wy + 0.5f) * workScale - 0.5f;
+                kp.size *= levelScale * workScale;
+                kp.octave = l;
+            }
+        }
+    });
+
+    out.keypoints.clear();
+    std::vector<cv::Mat> descriptors;
+    for (int l = 0; l < kLevels; ++l) {
+        if (levelKeys[l].empty()) continue;
+        out.keypoints.insert(out.keypoints.end(), levelKeys[l].begin(), levelKeys[l].end());
+        descriptors.push_back(levelDescriptors[l]);
+    }
+    if (!descriptors.empty()) cv::vconcat(descriptors, out.descriptors);
+}
+
+int FeatureOdometry::matchByProjection(const Features& current, const RigidTransform& predicted, float radius,
+    std::vector<cv::Point3f>& objectPoints, std::vector<cv::Point2f>& imagePoints) const {
+    objectPoints.clear();
+    imagePoints.clear();
+    const int n = (int)current.keypoints.size();
+    if (n == 0) return 0;
+
+    // 当前帧特征按原图坐标分桶（CSR：cellStart[c]..cellStart[c+1] 为第 c 格的点）
+    const float cell = kCell * workScale;
+    const int gridCols = std::max(1, (int)std::ceil(workRoi.width / cell)), gridRows = std::max(1, (int)std::ceil(workRoi.height / cell));
+    auto cellOf = [&](float x, float y) {
+        const int cx = std::clamp((int)((x - workRoi.x) / cell), 0, gridCols - 1);
+        const int cy = std::clamp((int)((y - workRoi.y) / cell), 0, gridRows - 1);
+        return cy * gridCols + cx;
+    };
+    std::vector<int> cellStart(gridCols * gridRows + 1, 0), order(n);
+    for (const cv::KeyPoint& kp : current.keypoints) cellStart[cellOf(kp.pt.x, kp.pt.y) + 1]++;
+    for (size_t c = 1; c < cellStart.size(); ++c) cellStart[c] += cellStart[c - 1];
+    {
+        std::vector<int> fill(cellStart.begin(), cellStart.end() - 1);
+        for (int i = 0; i < n; ++i) order[fill[cellOf(current.keypoints[i].pt.x, current.keypoints[i].pt.y)]++] = i;
+    }
+
+    const double fx = valueAt(reference.K, 0, 0), fy = valueAt(reference.K, 1, 1), cx = valueAt(reference.K, 0, 2), cy = valueAt(reference.K, 1, 2);
+    const RigidTransform toCamera = predicted.inverse();
+    // 每个当前特征只能被一个参考点占用，冲突时留距离更小的
+    std::vector<int> owner(n, -1), ownerDistance(n, INT_MAX);
+    for (int i = 0; i < (int)reference.points.size(); ++i) {
+        const cv::Point3f& p = reference.points[i];
+        const double* R = toCamera.R;
+        const double z = R[6] * p.x + R[7] * p.y + R[8] * p.z + toCamera.t[2];
+        if (z <= minDepth) continue;
+        const double x = R[0] * p.x + R[1] * p.y + R[2] * p.z + toCamera.t[0];
+        const double y = R[3] * p.x + R[4] * p.y + R[5] * p.z + toCamera.t[1];
+        const float u = (float)(fx * x / z + cx), v = (float)(fy * y / z + cy);
+        if (u < workRoi.x || v < workRoi.y || u >= workRoi.x + workRoi.width || v >= workRoi.y + workRoi.height) continue;
+
+        const int octave = reference.octaves[i];
+        const float r = radius * workScale * std::pow(kLevelScale, (float)octave);
+        const int c0 = std::max(0, (int)((u - r - workRoi.x) / cell)), c1 = std::min(gridCols - 1, (int)((u + r - workRoi.x) / cell));
+        const int r0 = std::max(0, (int)((v - r - workRoi.y) / cell)), r1 = std::min(gridRows - 1, (int)((v + r - workRoi.y) / cell));
+        const uchar* descriptor = reference.descriptors.ptr<uchar>(i);
+        int best = INT_MAX, second = INT_MAX, bestIndex = -1;
+        for (int gy = r0; gy <= r1; ++gy) {
+            for (int gx = c0; gx <= c1; ++gx) {
+                const int c = gy * gridCols + gx;
+                for (int k = cellStart[c]; k < cellStart[c + 1]; ++k) {
+                    const int j = order[k];
+                    const cv::KeyPoint& kp = current.keypoints[j];
+                    if (std::abs(kp.octave - octave) > 1) continue;
+                    const float du = kp.pt.x - u, dv = kp.pt.y - v;
+                    if (du * du + dv * dv > r * r) continue;
+                    const int distance = cv::hal::normHamming(descriptor, current.descriptors.ptr<uchar>(j), kDescriptorBytes);
+                    if (distance < best) {
+                        second = best;
+                        best = distance;
+                        bestIndex = j;
+                    }
+                    else if (distance < second) {
+                        second = distance;
+                    }
+                }
+            }
+        }
+        if (bestIndex < 0 || best > kMaxHamming || (second != INT_MAX && best > kRatio * second)) continue;
+        if (best < ownerDistance[bestIndex]) {
+            owner[bestIndex] = i;
+            ownerDistance[bestIndex] = best;
+        }
+    }
+
+    for (int j = 0; j < n; ++j) {
+        if (owner[j] < 0) continue;
+        objectPoints.push_back(reference.points[owner[j]]);
+        imagePoints.push_back(current.keypoints[j].pt);
+    }
+    return (int)objectPoints.size();
+}
+
+FeatureOdometry::Result FeatureOdometry::onFrame(const FrameData& frame) {
+    ZYC_PROFILE_SCOPE("FeatureOdometry::onFrame");
+    Result result;
+    if (!frame.image || frame.image->empty()) return result;
+    const cv::Rect roi = frame.region();
+    if (roi != workRoi) {
+        // 推理区域变了：缓存的特征与参考点的像素坐标系不再一致
+        reset();
+        workRoi = roi;
+    }
+
+    auto start = Clock::now();
+    auto features = std::make_shared<Features>();
+    features->sequenceID = frame.sequenceID;
+    extract(*frame.image, roi, *features);
+    history.push_back(features);
+    while ((int)history.size() > kHistory) history.pop_front();
+    result.features = (int)features->keypoints.size();
+    auto extracted = Clock::now();
+    result.extractMs = std::chrono::duration<double, std::milli>(extracted - start).count();
+    if (reference.points.empty()) return result;
+
+    // 匀速模型预测；上一帧没跟上时从参考关键帧位姿出发并放大搜索范围
+    const RigidTransform predicted = lastTracked ? lastPose * velocity : reference.pose;
+    std::vector<cv::Point3f> objectPoints;
+    std::vector<cv::Point2f> imagePoints;
+    result.matches = matchByProjection(*features, predicted, lastTracked ? kSearchRadius : kSearchRadius * 4.0f, objectPoints, imagePoints);
+    if (result.matches < kMinMatches && lastTracked) {
+        result.matches = matchByProjection(*features, predicted, kSearchRadius * 4.0f, objectPoints, imagePoints);
+    }
+
+    bool tracked = false;
+    RigidTransform pose;
+    int inlierCount = 0;
+    if (result.matches >= kMinInliers) {
+        // PnP 求世界 → 相机，以预测位姿为初值
+        const RigidTransform guess = predicted.inverse();
+        cv::Mat rotation(3, 3, CV_64F), rvec, tvec(3, 1, CV_64F), inliers;
+        for (int i = 0; i < 9; ++i) rotation.at<double>(i / 3, i % 3) = guess.R[i];
+        for (int i = 0; i < 3; ++i) tvec.at<double>(i, 0) = guess.t[i];
+        cv::Rodrigues(rotation, rvec);
+        if (cv::solvePnPRansac(objectPoints, imagePoints, reference.K, cv::Mat(), rvec, tvec, true, 100,
+            kReprojError * workScale, 0.99, inliers, cv::SOLVEPNP_ITERATIVE)) {
+            inlierCount = inliers.rows;
+            if (inlierCount >= kMinInliers) {
+                // Rodrigues 旋转向量与 fromTwist 的 ω 定义一致
+                const double xi[6] = { rvec.at<double>(0, 0), rvec.at<double>(1, 0), rvec.at<double>(2, 0),
+                    tvec.at<double>(0, 0), tvec.at<double>(1, 0), tvec.at<double>(2, 0) };
+                pose = RigidTransform::fromTwist(xi).inverse();
+                tracked = true;
+            }
+        }
+    }
+
+    if (tracked) {
+        velocity = lastTracked ? lastPose.inverse() * pose : RigidTransform();
+        velocity.orthonormalize();
+        lastPose = pose;
+        result.tracked = true;
+        result.pose = { frame.sequenceID, epoch, pose, inlierCount };
+        features->hasPose = true;
+        features->pose = result.pose;
+    }
+    lastTracked = tracked;
+    result.trackMs = std::chrono::duration<double, std::milli>(Clock::now() - extracted).count();
+    return result;
+}
+
+bool FeatureOdometry::onDepth(const FrameData& depth) {
+    if (!depth.rawDepth || depth.rawDepth->empty() || depth.intrinsics.rows != 3 || depth.intrinsics.cols != 3) return false;
+    if (depth.roi != workRoi) return false;
+    auto it = std::find_if(history.begin(), history.end(), [&](const auto& f) { return f->sequenceID == depth.sequenceID; });
+    if (it == history.end()) return false;
+    const Features& features = **it;
+
+    // 参考位姿：在里程计链上就沿用，否则以网络外参重新锚定（开始一条新链）
+    RigidTransform pose;
+    bool newChain = false;
+    if (features.hasPose) {
+        pose = features.pose.pose;
+    }
+    else {
+        if (depth.propagated || depth.extrinsics.rows != 3 || depth.extrinsics.cols != 4) return false;
+        pose = RigidTransform::fromMat(depth.extrinsics);
+        newChain = true;
+    }
+
+    Reference next;
+    next.sequenceID = depth.sequenceID;
+    next.pose = pose;
+    depth.intrinsics.convertTo(next.K, CV_64F);
+    const double fx = next.K.at<double>(0, 0), fy = next.K.at<double>(1, 1), cx = next.K.at<double>(0, 2), cy = next.K.at<double>(1, 2);
+    const cv::Mat& D = *depth.rawDepth;
+    const float sx = (float)D.cols / workRoi.width, sy = (float)D.rows / workRoi.height;
+    auto frameFeatures = std::make_shared<FrameFeatures>();
+    frameFeatures->sequenceID = depth.sequenceID;
+    frameFeatures->K = next.K;
+    std::vector<int> kept;
+    kept.reserve(features.keypoints.size());
+    for (int i = 0; i < (int)features.keypoints.size(); ++i) {
+        const cv::KeyPoint& kp = features.keypoints[i];
+        // 原图像素 → 深度图像素（FrameData::depthToFrame 的逆）
+        const int u = (int)std::lround((kp.pt.x - workRoi.x + 0.5f) * sx - 0.5f);
+        const int v = (int)std::lround((kp.pt.y - workRoi.y + 0.5f) * sy - 0.5f);
+        if (u < 1 || v < 1 || u >= D.cols - 1 || v >= D.rows - 1) continue;
+        // 3×3 邻域深度一致才用：前后景边缘上的特征点深度不可靠
+        const float z = D.at<float>(v, u);
+        if (!(z > minDepth && z <= maxDepth)) continue;
+        float lo = z, hi = z;
+        for (int dv = -1; dv <= 1; ++dv) {
+            for (int du = -1; du <= 1; ++du) {
+                const float d = D.at<float>(v + dv, u + du);
+                lo = std::min(lo, d > 0.0f ? d : 0.0f);   // NaN 与 0 都压成 0，下面一并排除
+                hi = std::max(hi, d);
+            }
+        }
+        if (lo <= 0.0f || hi - lo > 0.05f * z) continue;
+        const double xc = (kp.pt.x - cx) / fx * z, yc = (kp.pt.y - cy) / fy * z;
+        next.points.emplace_back((float)(pose.R[0] * xc + pose.R[1] * yc + pose.R[2] * z + pose.t[0]),
+            (float)(pose.R[3] * xc + pose.R[4] * yc + pose.R[5] * z + pose.t[1]),
+            (float)(pose.R[6] * xc + pose.R[7] * yc + pose.R[8] * z + pose.t[2]));
+        next.octaves.push_back(kp.octave);
+        frameFeatures->keypoints.push_back(kp.pt);
+        frameFeatures->points.emplace_back((float)xc, (float)yc, z);
+        kept.push_back(i);
+    }
+    if ((int)kept.size() < kMinMatches) return false;
+    next.descriptors.create((int)kept.size(), kDescriptorBytes, CV_8U);
+    for (int k = 0; k < (int)kept.size(); ++k) {
+        std::copy_n(features.descriptors.ptr<uchar>(kept[k]), kDescriptorBytes, next.descriptors.ptr<uchar>(k));
+    }
+
+    frameFeatures->descriptors = next.descriptors;
+    lastDepthFeatures = std::move(frameFeatures);
+    reference = std::move(next);
+    if (newChain) {
+        // 新链上的位姿与旧链不可比：匀速模型作废，从参考位姿重新开始
+        epoch++;
+        lastTracked = false;
+    }
+    // 比参考更早的帧不会再被用到
+    history.erase(history.begin(), it + 1);
+    return true;
+}
@@ -0,0 +1,125 @@
+﻿#pragma once
+#include <opencv2/opencv.hpp>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <vector>
+#include "Data/CommonTypes.h"
+#include "Mapping/RigidTransform.h"
+
+/**
+ * @brief 视觉里程计输出的一帧位姿（流水线 poses 端口的 payload）
+ * @details epoch 相同的位姿在同一条里程计链上，两者之差才是可信的帧间运动；
+ *          里程计跟丢后重新以网络外参锚定时 epoch 递增
+ */
+struct OdometryPose {
+    long long sequenceID = -1;
+    uint64_t epoch = 0;
+    RigidTransform pose;     ///< 相机到世界
+    int inliers = 0;         ///< PnP 内点数
+};
+
+/**
+ * @brief 一个深度帧上有深度的特征点（流水线 features 端口的 payload，供关键帧库做地点识别与回环验证）
+ */
+struct FrameFeatures {
+    long long sequenceID = -1;
+    std::vector<cv::Point2f> keypoints;      ///< 原图像素
+    std::vector<cv::Point3f> points;         ///< 相机系 3D 点，与 keypoints 一一对应
+    cv::Mat descriptors;                     ///< CV_8U，每行 32 字节
+    cv::Mat K;                               ///< CV_64F 3x3（原图像素）
+};
+using FrameFeaturesHandle = std::shared_ptr<const FrameFeatures>;
+
+/**
+ * @brief 特征点视觉里程计前端（流水线 odometry 阶段独占，非线程安全）
+ * @details 与深度推理并行地跑在截图帧上，不依赖网络：
+ *          1. 提取：ROI 缩到 odometryWidth 宽的灰度图，建 kLevels 层（比例 kLevelScale）金字塔，
+ *             各层并行（cv::parallel_for_）做 FAST，按网格分桶保留每格响应最强的点（特征铺满画面，
+ *             不挤在高纹理的 HUD/植被上），再算不带方向的 ORB 描述子（游戏相机几乎没有滚转）；
+ *          2. 参考关键帧：深度帧到达时取同序列号帧缓存的特征，查深度回投成世界系 3D 点；
+ *          3. 跟踪：按匀速模型预测位姿，把参考 3D 点投影到当前帧，只在投影点附近的网格里找汉明距离最近的描述子
+ *             （匹配量与特征数成线性，不做全量暴力匹配），再以预测位姿为初值 PnP RANSAC。
+ *          深度比截图晚若干帧到达，参考关键帧总是落后于当前帧，所以每帧都提取并缓存特征。
+ *          平坦、纹理少的几何上深度 ICP 退化，而特征点仍能约束沿墙面的运动；输出给建图阶段作为 ICP 的帧间运动初值。
+ */
+class FeatureOdometry {
+public:
+    struct Result {
+        bool tracked = false;
+        OdometryPose pose;
+        int features = 0;            ///< 本帧提取的特征点数
+        int matches = 0;             ///< 与参考关键帧的匹配数
+        double extractMs = 0.0;
+        double trackMs = 0.0;        ///< 匹配 + PnP
+    };
+
+    explicit FeatureOdometry(const MappingConfig& config);
+
+    // 参数变化时清空缓存与参考关键帧，返回是否发生了变化
+    bool configure(const MappingConfig& config);
+
+    // 新的截图帧：提取特征并缓存；已有参考关键帧时求位姿
+    Result onFrame(const FrameData& frame);
+
+    /**
+     * @brief 深度帧到达：作为新的参考关键帧
+     * @details 需要同序列号的截图帧已经提取过特征；参考位姿优先用该帧的里程计位姿，
+     *          没有时用网络外参（传播得到的深度帧外参是旧关键帧的，此时不采用）。返回是否更新了参考
+     */
+    bool onDepth(const FrameData& depth);
+
+    // 最近一次 onDepth 成功时该帧有深度的特征点（相机系），供关键帧库使用
+    const FrameFeaturesHandle& depthFeatures() const { return lastDepthFeatures; }
+
+    void reset();
+
+    int referencePoints() const { return (int)reference.points.size(); }
+    long long referenceID() const { return reference.sequenceID; }
+
+private:
+    struct Features {
+        long long sequenceID = -1;
+        std::vector<cv::KeyPoint> keypoints;   ///< 原图像素坐标，octave 为金字塔层
+        cv::Mat descriptors;                   ///< CV_8U，每行 32 字节
+        bool hasPose = false;
+        OdometryPose pose;
+    };
+
+    struct Reference {
+        long long sequenceID = -1;
+        std::vector<cv::Point3f> points;       ///< 世界系
+        cv::Mat descriptors;
+        std::vector<int> octaves;
+        RigidTransform pose;
+        cv::Mat K;                             ///< CV_64F 3x3（原图像素）
+    };
+
+    void extract(const cv::Mat& image, const cv::Rect& roi, Features& out);
+    // 把参考点投影到 predicted 位姿下，在投影点 radius（工作图像素）内找匹配；返回匹配数
+    int matchByProjection(const Features& current, const RigidTransform& predicted, float radius,
+        std::vector<cv::Point3f>& objectPoints, std::vector<cv::Point2f>& imagePoints) const;
+
+    int workWidth;
+    int targetFeatures;
+    float minDepth, maxDepth;
+
+    static constexpr int kLevels = 4;
+    static constexpr float kLevelScale = 1.2f;
+    static constexpr int kHistory = 32;        ///< 缓存最近多少帧的特征等待深度（约 1 秒）
+
+    std::vector<cv::Ptr<cv::ORB>> orbs;        ///< 每层一个（各层并行计算描述子）
+    std::deque<std::shared_ptr<Features>> history;
+    Reference reference;
+    FrameFeaturesHandle lastDepthFeatures;
+    float workScale = 1.0f;                    ///< 原图像素 / 工作图像素
+    cv::Rect workRoi;                          ///< 特征对应的原图 ROI，变化时特征与参考作废
+    uint64_t epoch = 0;
+    bool lastTracked = false;
+    RigidTransform lastPose;
+    RigidTransform velocity;                   ///< 上一帧到当前帧的相对运动（相机系）
+
+    // 复用的中间缓冲
+    cv::Mat small, gray;
+    std::vector<cv::Mat> pyramid;
+};
@@ -0,0 +1,739 @@
+﻿#include "IcpTracker.h"
+#include "Profiler/TraceProfiler.h"
+#include <algorithm>
+#include <array>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <mutex>
+#include "Data/SimdDispatch.h"
+
+#if defined(ZYC_SIMD_X86)
+#define ZYC_ICP_AVX2 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define ZYC_ICP_NEON 1
+#endif
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    constexpr int kMinInliers = 64;   // 少于该数的对应点不足以约束 6 个自由度
+
+    float valueAt(const cv::Mat& m, int r, int c) {
+        return m.depth() == CV_64F ? (float)m.at<double>(r, c) : m.at<float>(r, c);
+    }
+
+#if defined(ZYC_ICP_AVX2)
+    // 点积的 AVX2 部分：处理前 n & ~7 项，i 返回处理到的下标
+    ZYC_TARGET_AVX2 float dotAvx2(const float* a, const float* b, int n, int& i) {
+        __m256 acc0 = _mm256_setzero_ps(), acc1 = _mm256_setzero_ps();
+        for (; i + 16 <= n; i += 16) {
+            acc0 = _mm256_add_ps(acc0, _mm256_mul_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)));
+            acc1 = _mm256_add_ps(acc1, _mm256_mul_ps(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8)));
+        }
+        for (; i + 8 <= n; i += 8) {
+            acc0 = _mm256_add_ps(acc0, _mm256_mul_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)));
+        }
+        const __m256 acc = _mm256_add_ps(acc0, acc1);
+        __m128 half = _mm_add_ps(_mm256_castps256_ps128(acc), _mm256_extractf128_ps(acc, 1));
+        half = _mm_add_ps(half, _mm_movehl_ps(half, half));
+        half = _mm_add_ss(half, _mm_shuffle_ps(half, half, 1));
+        return _mm_cvtss_f32(half);
+    }
+#endif
+
+    // 两个 float 数组的点积：法方程 JᵀJ、Jᵀr 的每一项都是雅可比两列的点积
+    float dot(const float* a, const float* b, int n) {
+        int i = 0;
+        float sum = 0.0f;
+#if defined(ZYC_ICP_AVX2)
+        if (cpuHasAvx2()) sum = dotAvx2(a, b, n, i);
+#elif defined(ZYC_ICP_NEON)
+        float32x4_t acc = vdupq_n_f32(0.0f);
+        for (; i + 4 <= n; i += 4) acc = vmlaq_f32(acc, vld1q_f32(a + i), vld1q_f32(b + i));
+        const float32x2_t pair = vadd_f32(vget_low_f32(acc), vget_high_f32(acc));
+        sum = vget_lane_f32(vpadd_f32(pair, pair), 0);
+#endif
+        // 标量路径：处理向量化剩余的尾部
+        for (; i < n; ++i) sum += a[i] * b[i];
+        return sum;
+    }
+
+#if defined(ZYC_ICP_AVX2)
+    // 8 位掩码 → 把置位的通道按序挪到最前面的置换下标，以及置位数（不依赖 POPCNT 指令）
+    struct CompactEntry {
+        std::array<int32_t, 8> lanes;
+        int32_t count;
+    };
+    const std::array<CompactEntry, 256>& compactTable() {
+        static const auto table = [] {
+            std::array<CompactEntry, 256> t{};
+            for (int mask = 0; mask < 256; ++mask) {
+                int n = 0;
+                for (int lane = 0; lane < 8; ++lane) {
+                    if (mask & (1 << lane)) t[mask].lanes[n++] = lane;
+                }
+                t[mask].count = n;
+                for (; n < 8; ++n) t[mask].lanes[n] = 0;
+            }
+            return t;
+        }();
+        return table;
+    }
+#endif
+
+    // 6×6 对称正定方程 A x = b（Cholesky），A 非正定时返回 false
+    bool solveCholesky6(const double A[36], const double b[6], double x[6]) {
+        double L[36] = {};
+        for (int i = 0; i < 6; ++i) {
+            for (int j = 0; j <= i; ++j) {
+                double s = A[i * 6 + j];
+                for (int k = 0; k < j; ++k) s -= L[i * 6 + k] * L[j * 6 + k];
+                if (i == j) {
+                    if (!(s > 1e-12)) return false;
+                    L[i * 6 + i] = std::sqrt(s);
+                }
+                else {
+                    L[i * 6 + j] = s / L[j * 6 + j];
+                }
+            }
+        }
+        double y[6];
+        for (int i = 0; i < 6; ++i) {
+            double s = b[i];
+            for (int k = 0; k < i; ++k) s -= L[i * 6 + k] * y[k];
+            y[i] = s / L[i * 6 + i];
+        }
+        for (int i = 5; i >= 0; --i) {
+            double s = y[i];
+            for (int k = i + 1; k < 6; ++k) s -= L[k * 6 + i] * x[k];
+            x[i] = s / L[i * 6 + i];
+        }
+        return true;
+    }
+
+#if defined(ZYC_ICP_AVX2)
+    // 降采样一行的 AVX2 部分，返回处理到的输出列号
+    ZYC_TARGET_AVX2 int downsampleRowAvx2(const float* r0, const float* r1, float* out, int cols) {
+        int u = 0;
+        // 一次 8 个输出：两行各读 16 个深度，拆成偶数列/奇数列，规则与下面的标量路径逐位相同
+        const __m256 zero = _mm256_setzero_ps(), one = _mm256_set1_ps(1.0f);
+        const __m256 none = _mm256_set1_ps(FLT_MAX), margin = _mm256_set1_ps(1.05f);
+        for (; u + 8 <= cols; u += 8) {
+            __m256 s[4];
+            const float* rows[2] = { r0 + 2 * u, r1 + 2 * u };
+            for (int k = 0; k < 2; ++k) {
+                const __m256 a = _mm256_loadu_ps(rows[k]), b = _mm256_loadu_ps(rows[k] + 8);
+                // shuffle 在 128 位内取偶/奇，再按 64 位交换中间两段恢复顺序
+                s[2 * k] = _mm256_castpd_ps(_mm256_permute4x64_pd(
+                    _mm256_castps_pd(_mm256_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0))), _MM_SHUFFLE(3, 1, 2, 0)));
+                s[2 * k + 1] = _mm256_castpd_ps(_mm256_permute4x64_pd(
+                    _mm256_castps_pd(_mm256_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1))), _MM_SHUFFLE(3, 1, 2, 0)));
+            }
+            __m256 valid[4], lo = none;
+            for (int k = 0; k < 4; ++k) {
+                valid[k] = _mm256_cmp_ps(s[k], zero, _CMP_GT_OQ);   // 有序比较，NaN 为假
+                lo = _mm256_min_ps(lo, _mm256_blendv_ps(none, s[k], valid[k]));
+            }
+            const __m256 limit = _mm256_mul_ps(lo, margin);
+            __m256 sum = zero, count = zero;
+            for (int k = 0; k < 4; ++k) {
+                const __m256 keep = _mm256_and_ps(valid[k], _mm256_cmp_ps(s[k], limit, _CMP_LE_OQ));
+                sum = _mm256_add_ps(sum, _mm256_and_ps(keep, s[k]));
+                count = _mm256_add_ps(count, _mm256_and_ps(keep, one));
+            }
+            _mm256_storeu_ps(out + u, _mm256_and_ps(_mm256_cmp_ps(count, zero, _CMP_GT_OQ), _mm256_div_ps(sum, count)));
+        }
+        return u;
+    }
+#endif
+
+    // 深度 2×2 降采样：只平均与块内最近深度相差 5% 以内的有效值，不把前景和背景混成悬空的点
+    void downsampleDepth(const cv::Mat& src, cv::Mat& dst) {
+        dst.create(src.rows / 2, src.cols / 2, CV_32F);
+#if defined(ZYC_ICP_AVX2)
+        const bool avx2 = cpuHasAvx2();
+#endif
+        for (int v = 0; v < dst.rows; ++v) {
+            const float* r0 = src.ptr<float>(2 * v);
+            const float* r1 = src.ptr<float>(2 * v + 1);
+            float* out = dst.ptr<float>(v);
+            int u = 0;
+#if defined(ZYC_ICP_AVX2)
+            if (avx2) u = downsampleRowAvx2(r0, r1, out, dst.cols);
+#endif
+            // 标量路径：处理向量化剩余的尾部
+            for (; u < dst.cols; ++u) {
+                const float s[4] = { r0[2 * u], r0[2 * u + 1], r1[2 * u], r1[2 * u + 1] };
+                float lo = FLT_MAX;
+                for (float d : s) if (d > 0.0f) lo = std::min(lo, d);   // NaN 比较为 false，同时被排除
+                float sum = 0.0f;
+                int count = 0;
+                for (float d : s) {
+                    if (d > 0.0f && d <= lo * 1.05f) { sum += d; count++; }
+                }
+                out[u] = count ? sum / count : 0.0f;
+            }
+        }
+    }
+
+    // 按世界坐标取 TSDF 值
+    class VoxelSampler {
+    public:
+        explicit VoxelSampler(const TsdfVolume& volume) : volume(volume), invVoxel(1.0f / volume.config().voxelSize) {}
+
+        // 所在体素的值；未分配或未观测时返回 false
+        bool nearest(float x, float y, float z, float& tsdf) {
+            const TsdfVoxel* v = voxel((int)std::floor(x * invVoxel), (int)std::floor(y * invVoxel), (int)std::floor(z * invVoxel));
+            if (!v) return false;
+            tsdf = v->tsdf;
+            return true;
+        }
+
+        // 三线性插值（体素中心在 (i + 0.5)·voxel）；任一角点未观测时返回 false
+        bool trilinear(float x, float y, float z, float& tsdf) {
+            constexpr int S = TsdfBlock::kSide;
+            const float gx = x * invVoxel - 0.5f, gy = y * invVoxel - 0.5f, gz = z * invVoxel - 0.5f;
+            const int ix = (int)std::floor(gx), iy = (int)std::floor(gy), iz = (int)std::floor(gz);
+            const BlockCoord base{ floorDiv(ix), floorDiv(iy), floorDiv(iz) };
+            const int lx = ix - base.x * S, ly = iy - base.y * S, lz = iz - base.z * S;
+            float c[8];
+            if (lx < S - 1 && ly < S - 1 && lz < S - 1) {
+                // 常见情况：8 个角点都在同一块内
+                const TsdfBlock* b = block(base);
+                if (!b) return false;
+                for (int k = 0; k < 8; ++k) {
+                    const TsdfVoxel& v = b->voxels[TsdfBlock::index(lx + (k & 1), ly + ((k >> 1) & 1), lz + (k >> 2))];
+                    if (!(v.weight > 0.0f)) return false;
+                    c[k] = v.tsdf;
+                }
+                return interpolate(c, gx - ix, gy - iy, gz - iz, tsdf);
+            }
+            // 跨块：8 个角点最多落在 8 个块里，按“各轴是否进入下一个块”分组，每组只查一次
+            const TsdfBlock* corners[8];
+            bool looked[8] = {};
+            for (int k = 0; k < 8; ++k) {
+                const int vx = ix + (k & 1), vy = iy + ((k >> 1) & 1), vz = iz + (k >> 2);
+                const BlockCoord coord{ floorDiv(vx), floorDiv(vy), floorDiv(vz) };
+                const int slot = (coord.x != base.x) | (coord.y != base.y) << 1 | (coord.z != base.z) << 2;
+                if (!looked[slot]) {
+                    corners[slot] = block(coord);
+                    looked[slot] = true;
+                }
+                if (!corners[slot]) return false;
+                const TsdfVoxel& v = corners[slot]->voxels[TsdfBlock::index(vx - coord.x * S, vy - coord.y * S, vz - coord.z * S)];
+                if (!(v.weight > 0.0f)) return false;
+                c[k] = v.tsdf;
+            }
+            return interpolate(c, gx - ix, gy - iy, gz - iz, tsdf);
+        }
+
+    private:
+        static bool interpolate(const float c[8], float fx, float fy, float fz, float& tsdf) {
+            const float x00 = c[0] + (c[1] - c[0]) * fx, x10 = c[2] + (c[3] - c[2]) * fx;
+            const float x01 = c[4] + (c[5] - c[4]) * fx, x11 = c[6] + (c[7] - c[6]) * fx;
+            const float y0 = x00 + (x10 - x00) * fy, y1 = x01 + (x11 - x01) * fy;
+            tsdf = y0 + (y1 - y0) * fz;
+            return true;
+        }
+
+        static int floorDiv(int v) {
+            constexpr int S = TsdfBlock::kSide;
+            return v >= 0 ? v / S : -((-v + S - 1) / S);
+        }
+
+        // 直接映射的小缓存：相邻光线反复访问同一批块，绝大多数查找不必进哈希表
+        const TsdfBlock* block(const BlockCoord& coord) {
+            const uint64_t key = coord.key();
+            CacheEntry& entry = cache[(key * 0x9E3779B97F4A7C15ull) >> (64 - kCacheBits)];
+            if (entry.key != key) {
+                entry.key = key;
+                entry.block = volume.findBlock(coord);
+            }
+            return entry.block;
+        }
+
+        const TsdfVoxel* voxel(int x, int y, int z) {
+            constexpr int S = TsdfBlock::kSide;
+            const BlockCoord coord{ floorDiv(x), floorDiv(y), floorDiv(z) };
+            const TsdfBlock* b = block(coord);
+            if (!b) return nullptr;
+            const TsdfVoxel& v = b->voxels[TsdfBlock::index(x - coord.x * S, y - coord.y * S, z - coord.z * S)];
+            return v.weight > 0.0f ? &v : nullptr;
+        }
+
+        static constexpr int kCacheBits = 8;
+        struct CacheEntry {
+            uint64_t key = ~0ull;   // 合法块键只用低 63 位，不会与初值冲突
+            const TsdfBlock* block = nullptr;
+        };
+
+        const TsdfVolume& volume;
+        const float invVoxel;
+        std::array<CacheEntry, 1 << kCacheBits> cache;
+    };
+
+#if defined(ZYC_ICP_AVX2)
+    // 对应点关联在一帧内不变的参数（AVX2 内核是独立函数，不能直接捕获 accumulate 的局部变量）
+    struct AssociationParams {
+        float R[9], t[3];                       ///< 当前相机 → 模型相机
+        float cx, invFx;                        ///< 当前层相机
+        float refFx, refFy, refCx, refCy;       ///< 模型同层相机
+        int refCols, refRows;
+        const float* vertex;                    ///< 模型顶点图首行
+        const float* normal;                    ///< 模型法线图首行
+        int vertexStride, normalStride;         ///< 行跨度（float 个数）
+        float maxDepth, maxDist2, huber;
+    };
+
+    // 关联一行的 AVX2 部分：有效对应点的加权雅可比写入 J[c] + n，返回处理到的列号
+    ZYC_TARGET_AVX2 int associateRowAvx2(const AssociationParams& p, const float* row, int cols, const float rowBase[3],
+        float* const J[7], int& n, int& candidates) {
+        int u = 0;
+        // 一次 8 个像素：关联、残差、雅可比全部向量化，模型顶点/法线用带掩码的 gather 取，
+        // 有效对应点按掩码查表重排后整段写入 SoA；逐项运算顺序与 accumulate 里的标量路径相同
+        const auto& compact = compactTable();
+        const __m256 zero = _mm256_setzero_ps(), one = _mm256_set1_ps(1.0f), half = _mm256_set1_ps(0.5f);
+        const __m256 absMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7FFFFFFF));
+        const __m256 vMaxDepth = _mm256_set1_ps(p.maxDepth), vMaxDist2 = _mm256_set1_ps(p.maxDist2), vHuber = _mm256_set1_ps(p.huber);
+        const __m256 vBase[3] = { _mm256_set1_ps(rowBase[0]), _mm256_set1_ps(rowBase[1]), _mm256_set1_ps(rowBase[2]) };
+        const __m256 vCol[3] = { _mm256_set1_ps(p.R[0]), _mm256_set1_ps(p.R[3]), _mm256_set1_ps(p.R[6]) };
+        const __m256 vt[3] = { _mm256_set1_ps(p.t[0]), _mm256_set1_ps(p.t[1]), _mm256_set1_ps(p.t[2]) };
+        const __m256 lane = _mm256_setr_ps(0, 1, 2, 3, 4, 5, 6, 7);
+        const __m256 vCx = _mm256_set1_ps(p.cx), vInvFx = _mm256_set1_ps(p.invFx);
+        const __m256 refFx = _mm256_set1_ps(p.refFx), refFy = _mm256_set1_ps(p.refFy);
+        const __m256 refCx = _mm256_set1_ps(p.refCx), refCy = _mm256_set1_ps(p.refCy);
+        const __m256 refCols = _mm256_set1_ps((float)p.refCols), refRows = _mm256_set1_ps((float)p.refRows);
+        const __m256i vertexStride = _mm256_set1_epi32(p.vertexStride);
+        const __m256i normalStride = _mm256_set1_epi32(p.normalStride);
+        const __m256i three = _mm256_set1_epi32(3);
+        const float* vertexBase = p.vertex;
+        const float* normalBase = p.normal;
+        for (; u + 8 <= cols; u += 8) {
+            const __m256 d = _mm256_loadu_ps(row + u);
+            const __m256 hasDepth = _mm256_and_ps(_mm256_cmp_ps(d, zero, _CMP_GT_OQ), _mm256_cmp_ps(d, vMaxDepth, _CMP_LE_OQ));
+            const int depthMask = _mm256_movemask_ps(hasDepth);
+            if (depthMask == 0) continue;
+            candidates += compact[depthMask].count;
+            const __m256 rx = _mm256_mul_ps(_mm256_sub_ps(_mm256_add_ps(_mm256_set1_ps((float)u), lane), vCx), vInvFx);
+            const __m256 x = _mm256_add_ps(_mm256_mul_ps(_mm256_add_ps(vBase[0], _mm256_mul_ps(vCol[0], rx)), d), vt[0]);
+            const __m256 y = _mm256_add_ps(_mm256_mul_ps(_mm256_add_ps(vBase[1], _mm256_mul_ps(vCol[1], rx)), d), vt[1]);
+            const __m256 z = _mm256_add_ps(_mm256_mul_ps(_mm256_add_ps(vBase[2], _mm256_mul_ps(vCol[2], rx)), d), vt[2]);
+            __m256 ok = _mm256_and_ps(hasDepth, _mm256_cmp_ps(z, zero, _CMP_GT_OQ));
+            const __m256 invZ = _mm256_div_ps(one, z);
+            const __m256 mu = _mm256_floor_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_mul_ps(refFx, x), invZ), refCx), half));
+            const __m256 mv = _mm256_floor_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_mul_ps(refFy, y), invZ), refCy), half));
+            ok = _mm256_and_ps(ok, _mm256_and_ps(_mm256_cmp_ps(mu, zero, _CMP_GE_OQ), _mm256_cmp_ps(mv, zero, _CMP_GE_OQ)));
+            ok = _mm256_and_ps(ok, _mm256_and_ps(_mm256_cmp_ps(mu, refCols, _CMP_LT_OQ), _mm256_cmp_ps(mv, refRows, _CMP_LT_OQ)));
+            if (_mm256_movemask_ps(ok) == 0) continue;
+            // 无效通道的下标置 0，gather 也只取有效通道
+            const __m256i iu = _mm256_cvttps_epi32(_mm256_and_ps(ok, mu)), iv = _mm256_cvttps_epi32(_mm256_and_ps(ok, mv));
+            const __m256i vertexIndex = _mm256_add_epi32(_mm256_mullo_epi32(iv, vertexStride), _mm256_mullo_epi32(iu, three));
+            const __m256i normalIndex = _mm256_add_epi32(_mm256_mullo_epi32(iv, normalStride), _mm256_mullo_epi32(iu, three));
+            __m256 q[3], nrm[3];
+            for (int c = 0; c < 3; ++c) {
+                q[c] = _mm256_mask_i32gather_ps(zero, vertexBase + c, vertexIndex, ok, 4);
+                nrm[c] = _mm256_mask_i32gather_ps(zero, normalBase + c, normalIndex, ok, 4);
+            }
+            const __m256 hasNormal = _mm256_or_ps(_mm256_or_ps(_mm256_cmp_ps(nrm[0], zero, _CMP_NEQ_UQ),
+                _mm256_cmp_ps(nrm[1], zero, _CMP_NEQ_UQ)), _mm256_cmp_ps(nrm[2], zero, _CMP_NEQ_UQ));
+            ok = _mm256_and_ps(ok, _mm256_and_ps(_mm256_cmp_ps(q[2], zero, _CMP_GT_OQ), hasNormal));
+            const __m256 dx = _mm256_sub_ps(x, q[0]), dy = _mm256_sub_ps(y, q[1]), dz = _mm256_sub_ps(z, q[2]);
+            const __m256 dist2 = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)), _mm256_mul_ps(dz, dz));
+            ok = _mm256_and_ps(ok, _mm256_cmp_ps(dist2, vMaxDist2, _CMP_LE_OQ));
+            const int mask = _mm256_movemask_ps(ok);
+            if (mask == 0) continue;
+
+            const __m256 r = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(nrm[0], dx), _mm256_mul_ps(nrm[1], dy)), _mm256_mul_ps(nrm[2], dz));
+            const __m256 absR = _mm256_and_ps(r, absMask);
+            const __m256 w = _mm256_blendv_ps(_mm256_sqrt_ps(_mm256_div_ps(vHuber, absR)), one, _mm256_cmp_ps(absR, vHuber, _CMP_LE_OQ));
+            const __m256 jac[7] = {
+                _mm256_mul_ps(_mm256_sub_ps(_mm256_mul_ps(y, nrm[2]), _mm256_mul_ps(z, nrm[1])), w),
+                _mm256_mul_ps(_mm256_sub_ps(_mm256_mul_ps(z, nrm[0]), _mm256_mul_ps(x, nrm[2])), w),
+                _mm256_mul_ps(_mm256_sub_ps(_mm256_mul_ps(x, nrm[1]), _mm256_mul_ps(y, nrm[0])), w),
+                _mm256_mul_ps(nrm[0], w), _mm256_mul_ps(nrm[1], w), _mm256_mul_ps(nrm[2], w), _mm256_mul_ps(r, w) };
+            const __m256i perm = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(compact[mask].lanes.data()));
+            for (int c = 0; c < 7; ++c) _mm256_storeu_ps(J[c] + n, _mm256_permutevar8x32_ps(jac[c], perm));
+            n += compact[mask].count;
+        }
+        return u;
+    }
+#endif
+}
+
+IcpTracker::IcpTracker(const Params& params) : params(params) {
+    if (this->params.iterations.empty()) this->params.iterations = { 1 };
+}
+
+void IcpTracker::correct(const RigidTransform& correction) {
+    // 模型顶点在模型相机系下，随相机位姿一起变换后仍与搬动后的地图一致
+    lastPose = correction * lastPose;
+    lastPose.orthonormalize();
+    networkPose = correction * networkPose;
+    networkPose.orthonormalize();
+    modelPose = correction * modelPose;
+    modelPose.orthonormalize();
+}
+
+void IcpTracker::reset() {
+    frame.clear();
+    model.clear();
+    hasHistory = false;
+    hasOdometry = false;
+}
+
+void IcpTracker::buildPyramid(const cv::Mat& depth, const cv::Rect& roiIn, const cv::Mat& K) {
+    const cv::Rect roi = roiIn.empty() ? cv::Rect(0, 0, depth.cols, depth.rows) : roiIn;
+    const float fx = valueAt(K, 0, 0), fy = valueAt(K, 1, 1), cx = valueAt(K, 0, 2), cy = valueAt(K, 1, 2);
+    frame.resize(params.iterations.size());
+    const cv::Mat* src = &depth;
+    for (size_t l = 0; l < frame.size(); ++l) {
+        downsampleDepth(*src, frame[l].depth);
+        // 该层像素 u 的中心对应原图像素 ax·u + bx（先映射到深度图像素，再经 roi 映射回原图）
+        const float scale = (float)(2 << l);
+        const float ax = scale * roi.width / depth.cols, ay = scale * roi.height / depth.rows;
+        const float bx = roi.x + 0.5f * ax - 0.5f, by = roi.y + 0.5f * ay - 0.5f;
+        frame[l].cam = { fx / ax, fy / ay, (cx - bx) / ax, (cy - by) / ay };
+        src = &frame[l].depth;
+    }
+}
+
+IcpTracker::NormalEquations IcpTracker::accumulate(int level, const RigidTransform& currentToModel) const {
+    const DepthLevel& cur = frame[level];
+    const ModelLevel& ref = model[level];
+    const float maxDistance = params.maxDistance * (float)(1 << level);
+    const float maxDist2 = maxDistance * maxDistance;
+    const float huber = params.huber, maxDepth = params.maxDepth;
+    float R[9], t[3];
+    for (int i = 0; i < 9; ++i) R[i] = (float)currentToModel.R[i];
+    for (int i = 0; i < 3; ++i) t[i] = (float)currentToModel.t[i];
+    const float invFx = 1.0f / cur.cam.fx, invFy = 1.0f / cur.cam.fy;
+#if defined(ZYC_ICP_AVX2)
+    const bool avx2 = cpuHasAvx2();
+    AssociationParams assoc;
+    std::copy(R, R + 9, assoc.R);
+    std::copy(t, t + 3, assoc.t);
+    assoc.cx = cur.cam.cx;
+    assoc.invFx = invFx;
+    assoc.refFx = ref.cam.fx;
+    assoc.refFy = ref.cam.fy;
+    assoc.refCx = ref.cam.cx;
+    assoc.refCy = ref.cam.cy;
+    assoc.refCols = ref.vertex.cols;
+    assoc.refRows = ref.vertex.rows;
+    assoc.vertex = ref.vertex.ptr<float>(0);
+    assoc.normal = ref.normal.ptr<float>(0);
+    assoc.vertexStride = (int)(ref.vertex.step / sizeof(float));
+    assoc.normalStride = (int)(ref.normal.step / sizeof(float));
+    assoc.maxDepth = maxDepth;
+    assoc.maxDist2 = maxDist2;
+    assoc.huber = huber;
+#endif
+
+    NormalEquations total;
+    std::mutex mergeMtx;
+    cv::parallel_for_(cv::Range(0, cur.depth.rows), [&](const cv::Range& range) {
+        // 有效对应点的雅可比 [p×n, n] 与残差按列紧凑存放（SoA），最后用点积一次归约
+        thread_local std::vector<float> buffer;
+        const size_t capacity = (size_t)(range.end - range.start) * cur.depth.cols;
+        buffer.resize(capacity * 7);
+        float* J[7];
+        for (int c = 0; c < 7; ++c) J[c] = buffer.data() + c * capacity;
+        int n = 0, candidates = 0;
+
+        for (int v = range.start; v < range.end; ++v) {
+            const float* row = cur.depth.ptr<float>(v);
+            const float ry = (v - cur.cam.cy) * invFy;
+            // 每行常量：单位深度的点 (rx, ry, 1) 变换到模型相机系 = rowBase + rx·R 第 0 列
+            const float rowBase[3] = { R[1] * ry + R[2], R[4] * ry + R[5], R[7] * ry + R[8] };
+            int u = 0;
+#if defined(ZYC_ICP_AVX2)
+            if (avx2) u = associateRowAvx2(assoc, row, cur.depth.cols, rowBase, J, n, candidates);
+#endif
+            // 标量路径：处理向量化剩余的尾部
+            for (; u < cur.depth.cols; ++u) {
+                const float d = row[u];
+                if (!(d > 0.0f && d <= maxDepth)) continue;
+                candidates++;
+                // 当前相机系 → 模型相机系，投影到模型金字塔同层找对应点
+                const float rx = (u - cur.cam.cx) * invFx;
+                const float x = (rowBase[0] + R[0] * rx) * d + t[0];
+                const float y = (rowBase[1] + R[3] * rx) * d + t[1];
+                const float z = (rowBase[2] + R[6] * rx) * d + t[2];
+                if (z <= 0.0f) continue;
+                const float invZ = 1.0f / z;
+                const int mu = (int)std::floor(ref.cam.fx * x * invZ + ref.cam.cx + 0.5f);
+                const int mv = (int)std::floor(ref.cam.fy * y * invZ + ref.cam.cy + 0.5f);
+                if (mu < 0 || mv < 0 || mu >= ref.vertex.cols || mv >= ref.vertex.rows) continue;
+                const float* q = ref.vertex.ptr<float>(mv) + mu * 3;
+                const float* nrm = ref.normal.ptr<float>(mv) + mu * 3;
+                if (q[2] <= 0.0f || (nrm[0] == 0.0f && nrm[1] == 0.0f && nrm[2] == 0.0f)) continue;
+                const float dx = x - q[0], dy = y - q[1], dz = z - q[2];
+                if (dx * dx + dy * dy + dz * dz > maxDist2) continue;
+
+                // 点到平面残差，Huber 权重（IRLS）以 √w 乘到雅可比与残差上
+                const float r = nrm[0] * dx + nrm[1] * dy + nrm[2] * dz;
+                const float w = std::abs(r) <= huber ? 1.0f : std::sqrt(huber / std::abs(r));
+                J[0][n] = (y * nrm[2] - z * nrm[1]) * w;
+                J[1][n] = (z * nrm[0] - x * nrm[2]) * w;
+                J[2][n] = (x * nrm[1] - y * nrm[0]) * w;
+                J[3][n] = nrm[0] * w;
+                J[4][n] = nrm[1] * w;
+                J[5][n] = nrm[2] * w;
+                J[6][n] = r * w;
+                n++;
+            }
+        }
+
+        NormalEquations local;
+        for (int i = 0; i < 6; ++i) {
+            for (int j = i; j < 6; ++j) local.JtJ[i * 6 + j] = dot(J[i], J[j], n);
+            local.Jtr[i] = dot(J[i], J[6], n);
+        }
+        local.squaredError = dot(J[6], J[6], n);
+
+        std::lock_guard<std::mutex> lock(mergeMtx);
+        for (int i = 0; i < 6; ++i) {
+            for (int j = i; j < 6; ++j) total.JtJ[i * 6 + j] += local.JtJ[i * 6 + j];
+            total.Jtr[i] += local.Jtr[i];
+        }
+        total.squaredError += local.squaredError;
+        total.inliers += n;
+        total.candidates += candidates;
+    });
+    for (int i = 0; i < 6; ++i) {
+        for (int j = 0; j < i; ++j) total.JtJ[i * 6 + j] = total.JtJ[j * 6 + i];
+    }
+    return total;
+}
+
+IcpTracker::Result IcpTracker::track(const cv::Mat& depth, const cv::Rect& roi, const cv::Mat& K, const cv::Mat& networkRt, const Odometry* odometry) {
+    ZYC_PROFILE_SCOPE("IcpTracker::track");
+    auto start = Clock::now();
+    Result result;
+
+    // 初值：上一帧位姿 × 帧间相对运动（里程计优先，其次网络外参）；第一帧直接用网络外参
+    // 网络外参为空（传播帧）时没有网络运动：有里程计用里程计，否则按静止处理；网络链的基准留在上一个有网络外参的帧上，
+    // 下一帧的网络相对运动从那一帧的位姿算起，传播帧期间 ICP 跟出的运动不会被重复计入
+    const bool hasNetwork = !networkRt.empty();
+    if (!hasNetwork && !hasHistory) {
+        result.ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        return result;
+    }
+    const RigidTransform network = RigidTransform::fromMat(networkRt);
+    RigidTransform prior = network;
+    if (hasHistory) {
+        const bool sameChain = odometry && hasOdometry && odometry->epoch == lastOdometry.epoch;
+        if (sameChain) prior = lastPose * (lastOdometry.pose.inverse() * odometry->pose);
+        else prior = hasNetwork ? networkPose * (lastNetwork.inverse() * network) : lastPose;
+        result.odometryPrior = sameChain;
+    }
+    prior.orthonormalize();
+    hasOdometry = odometry != nullptr;
+    if (odometry) lastOdometry = *odometry;
+    hasHistory = true;
+    result.pose = prior;
+    lastPose = prior;
+    if (hasNetwork) {
+        lastNetwork = network;
+        networkPose = prior;
+    }
+
+    if (depth.empty() || depth.type() != CV_32FC1 || K.rows != 3 || K.cols != 3) {
+        frame.clear();
+        return result;
+    }
+    buildPyramid(depth, roi, K);
+    if (model.size() != frame.size()) {
+        result.ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        return result;
+    }
+
+    // 在模型相机系里求解：估计量是当前相机 → 模型相机的变换，增量左乘
+    RigidTransform toModel = modelPose.inverse() * prior;
+    NormalEquations finest;
+    for (int level = (int)frame.size() - 1; level >= 0; --level) {
+        for (int it = 0; it < params.iterations[level]; ++it) {
+            NormalEquations eq = accumulate(level, toModel);
+            if (level == 0) finest = eq;
+            if (eq.inliers < kMinInliers) break;
+
+            // 轻微阻尼：退化方向（如走廊沿墙方向）保持初值，而不是被噪声推着走
+            double A[36], b[6], xi[6];
+            const double trace = eq.JtJ[0] + eq.JtJ[7] + eq.JtJ[14] + eq.JtJ[21] + eq.JtJ[28] + eq.JtJ[35];
+            std::copy(eq.JtJ, eq.JtJ + 36, A);
+            for (int i = 0; i < 6; ++i) {
+                A[i * 6 + i] += 1e-4 * trace / 6.0;
+                b[i] = -eq.Jtr[i];
+            }
+            if (!solveCholesky6(A, b, xi)) break;
+            toModel = RigidTransform::fromTwist(xi) * toModel;
+            result.iterations++;
+            const double rotation = std::sqrt(xi[0] * xi[0] + xi[1] * xi[1] + xi[2] * xi[2]);
+            const double translation = std::sqrt(xi[3] * xi[3] + xi[4] * xi[4] + xi[5] * xi[5]);
+            if (rotation < 1e-4 && translation < 1e-4) break;
+        }
+    }
+
+    result.inliers = finest.inliers;
+    result.inlierRatio = finest.candidates > 0 ? (float)finest.inliers / finest.candidates : 0.0f;
+    result.rms = finest.inliers > 0 ? (float)std::sqrt(finest.squaredError / finest.inliers) : 0.0f;
+    RigidTransform tracked = modelPose * toModel;
+    tracked.orthonormalize();
+    const RigidTransform correction = prior.inverse() * tracked;
+    result.tracked = finest.inliers >= kMinInliers && result.inlierRatio >= params.minInlierRatio && result.rms <= params.maxRms &&
+        correction.translationNorm() <= params.maxCorrection && correction.rotationAngle() <= params.maxCorrectionDeg * CV_PI / 180.0;
+    if (result.tracked) {
+        result.pose = tracked;
+        lastPose = tracked;
+        if (hasNetwork) networkPose = tracked;
+    }
+    result.ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    return result;
+}
+
+double IcpTracker::updateModel(const TsdfVolume& volume) {
+    if (frame.empty()) {
+        model.clear();
+        return 0.0;
+    }
+    ZYC_PROFILE_SCOPE("IcpTracker::updateModel");
+    auto start = Clock::now();
+    modelPose = lastPose;
+    model.resize(frame.size());
+
+    // 投射层：沿每个像素的视线在本帧深度前后各一个截断距离内找 TSDF 由正到负的过零点
+    // （本帧刚以该位姿融合，表面必在附近；下一帧对齐的是融合了历史观测后的表面，而不是本帧的噪声）
+    const MappingConfig& config = volume.config();
+    const float trunc = config.truncation();
+    const int cast = std::clamp(params.modelLevel, 0, (int)frame.size() - 1);
+    const DepthLevel& seed = frame[cast];
+    ModelLevel& base = model[cast];
+    base.cam = seed.cam;
+    base.vertex.create(seed.depth.rows, seed.depth.cols, CV_32FC3);
+    float R[9], t[3];
+    for (int i = 0; i < 9; ++i) R[i] = (float)modelPose.R[i];
+    for (int i = 0; i < 3; ++i) t[i] = (float)modelPose.t[i];
+    cv::parallel_for_(cv::Range(0, seed.depth.rows), [&](const cv::Range& range) {
+        VoxelSampler sampler(volume);
+        for (int v = range.start; v < range.end; ++v) {
+            const float* depthRow = seed.depth.ptr<float>(v);
+            float* out = base.vertex.ptr<float>(v);
+            const float ry = (v - seed.cam.cy) / seed.cam.fy;
+            for (int u = 0; u < seed.depth.cols; ++u) {
+                float* vertex = out + u * 3;
+                vertex[0] = vertex[1] = vertex[2] = 0.0f;
+                const float d = depthRow[u];
+                if (!(d > config.minDepth && d <= config.maxDepth)) continue;
+                const float rx = (u - seed.cam.cx) / seed.cam.fx;
+                // 单位深度的世界系视线方向；s 为相机系 z 深度，最小步长对应沿视线走一个体素
+                const float dx = R[0] * rx + R[1] * ry + R[2], dy = R[3] * rx + R[4] * ry + R[5], dz = R[6] * rx + R[7] * ry + R[8];
+                const float invLength = 1.0f / std::sqrt(rx * rx + ry * ry + 1.0f);
+                const float step = config.voxelSize * invLength;
+                const float end = d + trunc;
+                float prevS = 0.0f, prevF = 0.0f;
+                bool prevValid = false, fine = false;
+                for (float s = std::max(config.minDepth, d - trunc); s <= end;) {
+                    float f;
+                    if (!sampler.nearest(t[0] + dx * s, t[1] + dy * s, t[2] + dz * s, f)) {
+                        prevValid = false;
+                        s += step;
+                        continue;
+                    }
+                    if (prevValid && prevF > 0.0f && f <= 0.0f) {
+                        if (s - prevS > step * 1.01f) {
+                            // 跳步越过了过零点：退回上一个正值处逐体素细走，保证求根区间两端都在截断带内
+                            fine = true;
+                            s = prevS + step;
+                            continue;
+                        }
+                        // 过零区间两端改用三线性插值再线性求根，避免最近体素的台阶
+                        float fa, fb;
+                        if (!(sampler.trilinear(t[0] + dx * prevS, t[1] + dy * prevS, t[2] + dz * prevS, fa) &&
+                            sampler.trilinear(t[0] + dx * s, t[1] + dy * s, t[2] + dz * s, fb) && fa > 0.0f && fb <= 0.0f)) {
+                            fa = prevF;
+                            fb = f;
+                        }
+                        const float hit = prevS + (s - prevS) * fa / (fa - fb);
+                        vertex[0] = rx * hit;
+                        vertex[1] = ry * hit;
+                        vertex[2] = hit;
+                        break;
+                    }
+                    prevS = s;
+                    prevF = f;
+                    prevValid = true;
+                    // 离表面还远时按 TSDF 值跳着走（留两成余量），越过过零点也能由前后异号检测到
+                    s += fine ? step : std::max(step, f * trunc * 0.8f * invLength);
+                }
+            }
+        }
+    });
+    computeNormals(base);
+    // 更细的层共用投射层：关联只按各层自己的针孔参数投影，模型分辨率低于当前帧不影响关联
+    for (int l = 0; l < cast; ++l) model[l] = base;
+
+    // 粗层：顶点 2×2 降采样（与深度金字塔同样的前景优先规则），再算法线
+    for (size_t l = cast + 1; l < model.size(); ++l) {
+        const cv::Mat& src = model[l - 1].vertex;
+        ModelLevel& dst = model[l];
+        dst.cam = frame[l].cam;
+        dst.vertex.create(src.rows / 2, src.cols / 2, CV_32FC3);
+        for (int v = 0; v < dst.vertex.rows; ++v) {
+            const float* r0 = src.ptr<float>(2 * v);
+            const float* r1 = src.ptr<float>(2 * v + 1);
+            float* out = dst.vertex.ptr<float>(v);
+            for (int u = 0; u < dst.vertex.cols; ++u) {
+                const float* s[4] = { r0 + 6 * u, r0 + 6 * u + 3, r1 + 6 * u, r1 + 6 * u + 3 };
+                float lo = FLT_MAX;
+                for (const float* p : s) if (p[2] > 0.0f) lo = std::min(lo, p[2]);
+                float sum[3] = {};
+                int count = 0;
+                for (const float* p : s) {
+                    if (p[2] > 0.0f && p[2] <= lo * 1.05f) {
+                        for (int k = 0; k < 3; ++k) sum[k] += p[k];
+                        count++;
+                    }
+                }
+                for (int k = 0; k < 3; ++k) out[u * 3 + k] = count ? sum[k] / count : 0.0f;
+            }
+        }
+        computeNormals(dst);
+    }
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+void IcpTracker::computeNormals(ModelLevel& level) {
+    const cv::Mat& V = level.vertex;
+    level.normal.create(V.rows, V.cols, CV_32FC3);
+    cv::parallel_for_(cv::Range(0, V.rows), [&](const cv::Range& range) {
+        for (int v = range.start; v < range.end; ++v) {
+            float* out = level.normal.ptr<float>(v);
+            for (int u = 0; u < V.cols; ++u) {
+                float* n = out + u * 3;
+                n[0] = n[1] = n[2] = 0.0f;
+                if (u == 0 || v == 0 || u == V.cols - 1 || v == V.rows - 1) continue;
+                const float* c = V.ptr<float>(v) + u * 3;
+                const float* l = c - 3;
+                const float* r = c + 3;
+                const float* up = V.ptr<float>(v - 1) + u * 3;
+                const float* dn = V.ptr<float>(v + 1) + u * 3;
+                if (c[2] <= 0.0f || l[2] <= 0.0f || r[2] <= 0.0f || up[2] <= 0.0f || dn[2] <= 0.0f) continue;
+                // 邻点深度跳变（遮挡边缘）处法线不可靠
+                const float jump = 0.1f * c[2];
+                if (std::abs(r[2] - l[2]) > jump || std::abs(dn[2] - up[2]) > jump) continue;
+                const float ax = r[0] - l[0], ay = r[1] - l[1], az = r[2] - l[2];
+                const float bx = dn[0] - up[0], by = dn[1] - up[1], bz = dn[2] - up[2];
+                float nx = ay * bz - az * by, ny = az * bx - ax * bz, nz = ax * by - ay * bx;
+                const float len = std::sqrt(nx * nx + ny * ny + nz * nz);
+                if (len <= 0.0f) continue;
+                // 统一朝向相机
+                const float sign = (nx * c[0] + ny * c[1] + nz * c[2]) > 0.0f ? -1.0f / len : 1.0f / len;
+                n[0] = nx * sign;
+                n[1] = ny * sign;
+                n[2] = nz * sign;
+            }
+        }
+    });
+}
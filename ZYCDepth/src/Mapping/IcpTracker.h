@@ -0,0 +1,110 @@
+﻿#pragma once
+#include <opencv2/opencv.hpp>
+#include <vector>
+#include "Data/CommonTypes.h"
+#include "Mapping/RigidTransform.h"
+#include "Mapping/TsdfVolume.h"
+
+/**
+ * @brief 帧到模型的点到平面 ICP 位姿跟踪（建图阶段独占，非线程安全）
+ * @details 网络逐帧独立输出的外参前后不一致，直接融合会把地图抹花。跟踪器把每个新深度帧对齐到地图：
+ *          1. 模型：上一帧融合之后，在上一帧位姿下对 TSDF 光线投射出顶点/法线图（搜索区间以上一帧深度为中心，
+ *             每条光线只走几个截断距离）。投射在 1/4 分辨率上做，1/2 层直接与它关联，更粗的层逐层 2×2 降采样；
+ *          2. 跟踪：当前深度图建 1/2、1/4、1/8 金字塔，从粗到细做投影关联的点到平面 ICP。
+ *             关联按行并行（cv::parallel_for_），有效对应点的雅可比先紧凑存成 SoA，
+ *             再用 SIMD 点积归约出 6×6 法方程，Cholesky 求解；
+ *          3. 初值：上一帧跟踪位姿 × 帧间相对运动；相对运动优先取视觉里程计（前后两帧在同一条里程计链上时），否则取网络外参。
+ *             内点比例过低、残差过大或修正量离初值太远时视为跟丢，返回该初值（即退回网络外参的运动）。
+ *          504×280 深度下单线程 跟踪 + 光线投射 约 4 ms（运行时检测到 AVX2）；不支持 AVX2 的 CPU 走标量路径约 8 ms，
+ *          达不到每帧 5 ms 的目标。见 --bench-tsdf --bench-track。
+ */
+class IcpTracker {
+public:
+    struct Params {
+        std::vector<int> iterations = { 4, 5, 6 };   ///< 每层迭代次数（细 → 粗），层数即其长度；最细层为深度图的 1/2
+        int modelLevel = 1;              ///< 光线投射所在的金字塔层，更细的层直接与它关联（每粗一层光线数减为 1/4）
+        float maxDepth = 20.0f;          ///< 参与对齐的最大深度（米），远处的网络深度噪声大
+        float maxDistance = 0.15f;       ///< 最细层对应点最大距离（米），每粗一层放大一倍
+        float huber = 0.02f;             ///< 点到平面残差的 Huber 阈值（米）
+        float minInlierRatio = 0.2f;     ///< 最细层有效对应点 / 有效深度点，低于此视为跟丢
+        float maxRms = 0.05f;            ///< 最细层加权残差均方根（米），高于此视为跟丢
+        float maxCorrection = 0.5f;      ///< 相对初值的平移修正（米），超过视为跟丢
+        float maxCorrectionDeg = 15.0f;  ///< 相对初值的旋转修正（度），超过视为跟丢
+    };
+
+    struct Result {
+        RigidTransform pose;         ///< 相机到世界；未跟踪或跟丢时为初值
+        bool tracked = false;        ///< ICP 成功收敛
+        bool odometryPrior = false;  ///< 初值的帧间运动来自视觉里程计
+        int iterations = 0;
+        int inliers = 0;             ///< 最细层有效对应点数
+        float inlierRatio = 0.0f;
+        float rms = 0.0f;            ///< 最细层加权点到平面残差均方根（米）
+        double ms = 0.0;
+    };
+
+    // 视觉里程计位姿：epoch 相同的两帧之差才作为帧间运动
+    struct Odometry {
+        RigidTransform pose;         ///< 相机到世界
+        uint64_t epoch = 0;
+    };
+
+    IcpTracker() : IcpTracker(Params()) {}
+    explicit IcpTracker(const Params& params);
+
+    /**
+     * @brief 跟踪一帧
+     * @param depth CV_32F 深度图（米），<= 0 或 NaN 为无效
+     * @param roi 深度图覆盖的原图区域，为空时认为深度图就是整幅原图
+     * @param K 3x3 内参（原图像素坐标）
+     * @param networkRt 网络输出的 3x4 相机到世界外参，只用它的帧间相对运动做初值；传播帧没有网络外参时传空，
+     *        此时没有历史位姿则直接返回未跟踪
+     * @param odometry 该帧的视觉里程计位姿（可为空），与上一帧的在同一条链上时代替网络外参给出帧间运动
+     */
+    Result track(const cv::Mat& depth, const cv::Rect& roi, const cv::Mat& K, const cv::Mat& networkRt, const Odometry* odometry = nullptr);
+
+    /**
+     * @brief 更新模型：在最近一次 track 返回的位姿下对地图光线投射，供下一帧对齐
+     * @details 必须在该帧融合进地图之后调用；返回耗时（毫秒）
+     */
+    double updateModel(const TsdfVolume& volume);
+
+    // 是否已有可对齐的模型（首帧、reset 之后没有，此时 track 直接返回初值）
+    bool hasModel() const { return !model.empty(); }
+
+    // 回环校正：地图整体按 correction（世界系，x' = C·x）搬动后，把位姿历史与模型位姿一起搬过去；帧间运动不受影响
+    void correct(const RigidTransform& correction);
+
+    // 丢弃模型与位姿历史（地图清空、跟踪关闭时），下一帧从网络外参重新开始
+    void reset();
+
+private:
+    struct Pinhole { float fx = 0, fy = 0, cx = 0, cy = 0; };   ///< 某层像素坐标系下的针孔参数
+    struct DepthLevel { cv::Mat depth; Pinhole cam; };
+    struct ModelLevel { cv::Mat vertex, normal; Pinhole cam; };  ///< 模型相机系，CV_32FC3，z <= 0 为无效
+
+    // 法方程 JᵀJ ξ = −Jᵀr 的累加结果
+    struct NormalEquations {
+        double JtJ[36] = {};
+        double Jtr[6] = {};
+        double squaredError = 0.0;
+        int inliers = 0;
+        int candidates = 0;          ///< 有效深度点数
+    };
+
+    void buildPyramid(const cv::Mat& depth, const cv::Rect& roi, const cv::Mat& K);
+    NormalEquations accumulate(int level, const RigidTransform& currentToModel) const;
+    // 由顶点图的左右、上下邻点叉乘求法线，朝向相机；边缘与深度跳变处为 0
+    static void computeNormals(ModelLevel& level);
+
+    Params params;
+    std::vector<DepthLevel> frame;   ///< 当前帧深度金字塔（0 为最细层）
+    std::vector<ModelLevel> model;   ///< 模型金字塔，空表示尚无模型
+    RigidTransform modelPose;        ///< 模型相机到世界
+    RigidTransform lastPose;         ///< 最近一次 track 返回的位姿
+    RigidTransform lastNetwork;      ///< 最近一次带网络外参的 track 的网络外参
+    RigidTransform networkPose;      ///< 该帧 track 返回的位姿，网络相对运动从这里算起
+    Odometry lastOdometry;           ///< 最近一次 track 的里程计位姿（hasOdometry 为 false 时无效）
+    bool hasOdometry = false;
+    bool hasHistory = false;
+};
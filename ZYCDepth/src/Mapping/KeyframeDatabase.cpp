@@ -0,0 +1,227 @@
+﻿#include "KeyframeDatabase.h"
+#include "Log/Logger.h"
+#include "Profiler/TraceProfiler.h"
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <random>
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    constexpr int kDescriptorBytes = 32;
+    constexpr int kExcludeRecent = 30;       // 最近这么多个关键帧不作为回环候选
+    constexpr int kLoopCooldown = 10;        // 闭合一次回环后，这么多个关键帧内不再检测
+    constexpr int kCandidates = 3;           // 逐个验证的最高票候选数
+    constexpr float kMinScore = 0.05f;       // 归一化票数下限
+    constexpr int kMaxHamming = 64;
+    constexpr float kRatio = 0.8f;
+    constexpr int kMinInliers = 40;
+    constexpr float kReprojError = 3.0f;     // 原图像素
+    // 位姿图边的信息量：旋转 0.01 rad、平移 0.05 m 的标准差
+    constexpr double kRotationInfo = 1.0 / (0.01 * 0.01);
+    constexpr double kTranslationInfo = 1.0 / (0.05 * 0.05);
+    // 优化后回环边残差超过该值视为误匹配（与里程计矛盾）
+    constexpr double kMaxLoopTranslation = 0.5;
+    constexpr double kMaxLoopAngleDeg = 5.0;
+    constexpr double kDegToRad = 3.14159265358979323846 / 180.0;
+}
+
+KeyframeDatabase::KeyframeDatabase() {
+    // 固定种子：单词定义与运行无关
+    std::mt19937 rng(20240601u);
+    std::vector<int> bits(kDescriptorBytes * 8);
+    for (int i = 0; i < (int)bits.size(); ++i) bits[i] = i;
+    bitPositions.resize(kTables);
+    for (auto& table : bitPositions) {
+        std::shuffle(bits.begin(), bits.end(), rng);
+        table.assign(bits.begin(), bits.begin() + kBits);
+    }
+}
+
+void KeyframeDatabase::clear() {
+    keyframes.clear();
+    graph.clear();
+    postings.clear();
+    lastLoop = 0;
+    loops = 0;
+}
+
+bool KeyframeDatabase::shouldAdmit(const RigidTransform& pose, float overlap, const MappingConfig& config) const {
+    if (keyframes.empty()) return true;
+    const RigidTransform motion = graph.pose(graph.nodeCount() - 1).inverse() * pose;
+    return motion.translationNorm() > config.keyframeDistance
+        || motion.rotationAngle() > config.keyframeAngleDeg * kDegToRad
+        || overlap < config.keyframeMinOverlap;
+}
+
+void KeyframeDatabase::computeWords(const cv::Mat& descriptors, std::vector<uint32_t>& words) const {
+    words.clear();
+    words.reserve((size_t)descriptors.rows * kTables);
+    for (int r = 0; r < descriptors.rows; ++r) {
+        const uchar* d = descriptors.ptr<uchar>(r);
+        for (int table = 0; table < kTables; ++table) {
+            uint32_t word = 0;
+            for (int b = 0; b < kBits; ++b) {
+                const int bit = bitPositions[table][b];
+                word |= (uint32_t)((d[bit >> 3] >> (bit & 7)) & 1) << b;
+            }
+            words.push_back(((uint32_t)table << kBits) | word);
+        }
+    }
+    std::sort(words.begin(), words.end());
+    words.erase(std::unique(words.begin(), words.end()), words.end());
+}
+
+uint32_t KeyframeDatabase::admit(long long sequenceID, const RigidTransform& pose, const FrameFeaturesHandle& features) {
+    Keyframe keyframe;
+    keyframe.sequenceID = sequenceID;
+    keyframe.features = features;
+    if (features && !features->descriptors.empty()) computeWords(features->descriptors, keyframe.words);
+
+    const int node = graph.addNode(pose);
+    if (node > 0) {
+        PoseGraph::Edge edge;
+        edge.from = node - 1;
+        edge.to = node;
+        edge.measurement = graph.pose(node - 1).inverse() * pose;
+        edge.measurement.orthonormalize();
+        edge.rotationInfo = kRotationInfo;
+        edge.translationInfo = kTranslationInfo;
+        graph.addEdge(edge);
+    }
+
+    const uint32_t index = (uint32_t)keyframes.size();
+    for (uint32_t word : keyframe.words) postings[word].push_back(index);
+    keyframes.push_back(std::move(keyframe));
+    return index + 1;
+}
+
+uint32_t KeyframeDatabase::attach(long long sequenceID, const FrameFeaturesHandle& features) {
+    if (!features || features->descriptors.empty()) return 0;
+    constexpr int kWindow = 8;   // 特征最多晚到几个关键帧
+    for (int i = (int)keyframes.size() - 1; i >= 0 && i >= (int)keyframes.size() - kWindow; --i) {
+        Keyframe& keyframe = keyframes[i];
+        if (keyframe.sequenceID != sequenceID) continue;
+        if (keyframe.features) return 0;
+        keyframe.features = features;
+        computeWords(features->descriptors, keyframe.words);
+        for (uint32_t word : keyframe.words) postings[word].push_back((uint32_t)i);
+        return (uint32_t)i + 1;
+    }
+    return 0;
+}
+
+int KeyframeDatabase::verify(const Keyframe& candidate, const Keyframe& query, RigidTransform& relative) const {
+    const FrameFeatures& from = *candidate.features;
+    const FrameFeatures& to = *query.features;
+
+    // 暴力汉明匹配：每个查询描述子在候选帧中找最近与次近
+    std::vector<cv::Point3f> objectPoints;
+    std::vector<cv::Point2f> imagePoints;
+    for (int q = 0; q < to.descriptors.rows; ++q) {
+        const uchar* descriptor = to.descriptors.ptr<uchar>(q);
+        int best = INT_MAX, second = INT_MAX, bestIndex = -1;
+        for (int c = 0; c < from.descriptors.rows; ++c) {
+            const int distance = cv::hal::normHamming(descriptor, from.descriptors.ptr<uchar>(c), kDescriptorBytes);
+            if (distance < best) {
+                second = best;
+                best = distance;
+                bestIndex = c;
+            }
+            else if (distance < second) {
+                second = distance;
+            }
+        }
+        if (bestIndex < 0 || best > kMaxHamming || (second != INT_MAX && best > kRatio * second)) continue;
+        objectPoints.push_back(from.points[bestIndex]);
+        imagePoints.push_back(to.keypoints[q]);
+    }
+    if ((int)objectPoints.size() < kMinInliers) return 0;
+
+    // 候选相机系 3D 点 → 查询帧像素：解出 x_query = R·x_cand + t
+    cv::Mat rvec, tvec, inliers;
+    if (!cv::solvePnPRansac(objectPoints, imagePoints, to.K, cv::Mat(), rvec, tvec, false, 200,
+        kReprojError, 0.99, inliers, cv::SOLVEPNP_ITERATIVE)) return 0;
+    if (inliers.rows < kMinInliers) return inliers.rows;
+
+    const double xi[6] = { rvec.at<double>(0, 0), rvec.at<double>(1, 0), rvec.at<double>(2, 0),
+        tvec.at<double>(0, 0), tvec.at<double>(1, 0), tvec.at<double>(2, 0) };
+    relative = RigidTransform::fromTwist(xi).inverse();   // 查询相机系 → 候选相机系
+    return inliers.rows;
+}
+
+KeyframeDatabase::LoopResult KeyframeDatabase::closeLoop(uint32_t id) {
+    ZYC_PROFILE_SCOPE("KeyframeDatabase::closeLoop");
+    LoopResult result;
+    const auto start = Clock::now();
+    const int current = (int)id - 1;
+    if (current < 0 || current >= (int)keyframes.size()) return result;
+    const Keyframe& query = keyframes[current];
+    if (query.words.empty() || current <= kExcludeRecent) return result;
+    if (lastLoop != 0 && current - ((int)lastLoop - 1) < kLoopCooldown) return result;
+
+    // 倒排索引投票：只有与查询共享单词的关键帧会被访问
+    const int searchable = current - kExcludeRecent;
+    std::vector<int> votes(searchable, 0);
+    for (uint32_t word : query.words) {
+        auto it = postings.find(word);
+        if (it == postings.end()) continue;
+        for (uint32_t index : it->second) {
+            if ((int)index >= searchable) continue;   // 最近的关键帧
+            votes[index]++;
+        }
+    }
+    std::vector<std::pair<float, int>> ranked;
+    for (int i = 0; i < searchable; ++i) {
+        if (votes[i] == 0) continue;
+        const float score = votes[i] / std::sqrt((float)query.words.size() * (float)keyframes[i].words.size());
+        if (score >= kMinScore) ranked.emplace_back(score, i);
+    }
+    const int count = std::min((int)ranked.size(), kCandidates);
+    std::partial_sort(ranked.begin(), ranked.begin() + count, ranked.end(), [](const auto& a, const auto& b) { return a.first > b.first; });
+
+    for (int k = 0; k < count && !result.closed; ++k) {
+        const int candidate = ranked[k].second;
+        RigidTransform relative;
+        result.matched = (uint32_t)candidate + 1;
+        result.inliers = verify(keyframes[candidate], query, relative);
+        if (result.inliers < kMinInliers) continue;
+
+        PoseGraph::Edge edge;
+        edge.from = candidate;
+        edge.to = current;
+        edge.measurement = relative;
+        edge.rotationInfo = kRotationInfo;
+        edge.translationInfo = kTranslationInfo;
+        const std::vector<RigidTransform> before = graph.allPoses();
+        graph.addEdge(edge);
+        graph.optimize();
+
+        // 优化后仍与里程计严重矛盾的回环是误匹配（重复纹理、相似房间）：撤销
+        double e[6];
+        graph.residual(edge, e);
+        const double angle = std::sqrt(e[0] * e[0] + e[1] * e[1] + e[2] * e[2]);
+        const double distance = std::sqrt(e[3] * e[3] + e[4] * e[4] + e[5] * e[5]);
+        if (distance > kMaxLoopTranslation || angle > kMaxLoopAngleDeg * kDegToRad) {
+            graph.removeLastEdge();
+            for (int i = 0; i < (int)before.size(); ++i) graph.setPose(i, before[i]);
+            LOG_WARN("回环 " + std::to_string(candidate + 1) + " → " + std::to_string(id) + " 优化后残差过大，视为误匹配");
+            continue;
+        }
+
+        for (int i = 0; i < (int)before.size(); ++i) {
+            RigidTransform correction = graph.pose(i) * before[i].inverse();
+            correction.orthonormalize();
+            if (correction.translationNorm() > 1e-4 || correction.rotationAngle() > 1e-5) {
+                result.corrections.emplace_back((uint32_t)i + 1, correction);
+            }
+        }
+        result.closed = true;
+        lastLoop = id;
+        loops++;
+    }
+    result.ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    return result;
+}
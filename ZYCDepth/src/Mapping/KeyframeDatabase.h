@@ -0,0 +1,75 @@
+﻿#pragma once
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "Data/CommonTypes.h"
+#include "Mapping/FeatureOdometry.h"
+#include "Mapping/PoseGraph.h"
+#include "Mapping/RigidTransform.h"
+
+/**
+ * @brief 关键帧库：关键帧筛选、地点识别与回环校正（建图阶段独占，非线程安全）
+ * @details 1. 筛选：只有相对上一关键帧移动/转动足够大，或与地图的重叠（ICP 内点比例）明显下降的帧才成为关键帧，
+ *             只有关键帧融合进 TSDF，其余帧只做跟踪；
+ *          2. 地点识别：关键帧的 ORB 描述子按位采样哈希（kTables 张表，每张取 kBits 个固定比特位）成“视觉单词”，
+ *             倒排索引 单词 → 关键帧；查询时按共享单词数投票，排除最近的关键帧（它们本来就相似）；
+ *          3. 验证：票数最高的几个候选与当前关键帧暴力汉明匹配（比率测试），候选帧的相机系 3D 点对当前帧的 2D 点 PnP RANSAC，
+ *             内点足够才作为回环边加入位姿图；
+ *          4. 校正：位姿图（相邻关键帧之间的里程计边 + 回环边）稀疏优化，回环边优化后残差仍过大则视为误匹配撤销。
+ *             返回每个关键帧的校正量 C = T_new·T_old⁻¹，地图据此把各关键帧融合的体素块刚性搬到新位置（TsdfVolume::reanchor）。
+ *          关键帧 id 从 1 开始（0 表示“无关键帧”），即位姿图节点号 + 1。
+ */
+class KeyframeDatabase {
+public:
+    struct LoopResult {
+        bool closed = false;
+        uint32_t matched = 0;        ///< 回环匹配到的历史关键帧 id（未闭合时为最后验证的候选）
+        int inliers = 0;             ///< 回环验证的 PnP 内点数
+        double ms = 0.0;             ///< 查询 + 验证 + 优化耗时
+        std::vector<std::pair<uint32_t, RigidTransform>> corrections;   ///< 关键帧 id → 校正量（只含有变化的）
+    };
+
+    KeyframeDatabase();
+
+    // 是否应把该帧作为新关键帧：尚无关键帧、相对上一关键帧的平移/旋转超过阈值，或 ICP 内点比例低于 keyframeMinOverlap
+    bool shouldAdmit(const RigidTransform& pose, float overlap, const MappingConfig& config) const;
+
+    // 加入关键帧（features 可为空，此时不参与地点识别），与上一关键帧之间加里程计边；返回关键帧 id
+    uint32_t admit(long long sequenceID, const RigidTransform& pose, const FrameFeaturesHandle& features);
+
+    /**
+     * @brief 给最近加入、还没有特征的关键帧补上特征
+     * @details 特征由 odometry 阶段与建图并行算出，可能晚于该深度帧到达建图阶段；返回补上的关键帧 id，没有对应关键帧时返回 0
+     */
+    uint32_t attach(long long sequenceID, const FrameFeaturesHandle& features);
+
+    // 以关键帧 id 为查询做回环检测，成功时优化位姿图
+    LoopResult closeLoop(uint32_t id);
+
+    void clear();
+    size_t size() const { return keyframes.size(); }
+    uint64_t loopCount() const { return loops; }
+    const RigidTransform& pose(uint32_t id) const { return graph.pose((int)id - 1); }
+
+private:
+    struct Keyframe {
+        long long sequenceID = -1;
+        FrameFeaturesHandle features;
+        std::vector<uint32_t> words;     ///< 去重后的 (表号 << kBits) | 单词
+    };
+
+    void computeWords(const cv::Mat& descriptors, std::vector<uint32_t>& words) const;
+    // 候选关键帧（下标）与查询关键帧验证，成功时给出相对位姿 Z = T_cand⁻¹·T_query
+    int verify(const Keyframe& candidate, const Keyframe& query, RigidTransform& relative) const;
+
+    static constexpr int kTables = 8;
+    static constexpr int kBits = 16;
+
+    std::vector<Keyframe> keyframes;
+    PoseGraph graph;
+    std::unordered_map<uint32_t, std::vector<uint32_t>> postings;   ///< 单词 → 关键帧下标
+    std::vector<std::vector<int>> bitPositions;                      ///< 每张表采样的描述子比特位
+    uint32_t lastLoop = 0;
+    uint64_t loops = 0;
+};
@@ -0,0 +1,289 @@
+﻿#pragma once
+#include <cstdint>
+
+/**
+ * @brief 行进立方体查找表
+ * @details 角点与边的编号沿用 Paul Bourke 的约定：
+ *          角点 0 (0,0,0) 1 (1,0,0) 2 (1,1,0) 3 (0,1,0) 4 (0,0,1) 5 (1,0,1) 6 (1,1,1) 7 (0,1,1)，
+ *          边 0..11 见 kEdgeCorners；格子配置的第 i 位为 1 表示角点 i 在表面内侧（tsdf < 0）。
+ *
+ *          三角形表不是 Bourke 的原表：按“每个面上把内侧角点彼此分开”的统一规则解决面歧义后逐面连线、
+ *          沿立方体表面追踪等值线环再扇形三角化（扇形顶点选在对角线不贴面的位置），
+ *          因此相邻格子在公共面上的边界完全一致，网格没有原表在歧义配置下的裂缝；
+ *          三角形绕向统一为 (b−a)×(c−a) 指向外侧（tsdf 增大方向）。每行最多 5 个三角形，以 -1 结束。
+ */
+namespace MarchingCubes {
+
+// 角点相对格子最小角的偏移
+constexpr int kCornerOffset[8][3] = {
+    { 0, 0, 0 }, { 1, 0, 0 }, { 1, 1, 0 }, { 0, 1, 0 },
+    { 0, 0, 1 }, { 1, 0, 1 }, { 1, 1, 1 }, { 0, 1, 1 },
+};
+
+// 每条边的两个端点角
+constexpr int kEdgeCorners[12][2] = {
+    { 0, 1 }, { 1, 2 }, { 2, 3 }, { 3, 0 },
+    { 4, 5 }, { 5, 6 }, { 6, 7 }, { 7, 4 },
+    { 0, 4 }, { 1, 5 }, { 2, 6 }, { 3, 7 },
+};
+
+constexpr int8_t kTriangles[256][16] = {
+    { -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+    {  0,  3,  8, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+    {  0,  9,  1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+    {  9,  1,  3,  9,  3,  8, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+    {  2,  1, 10, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+    {  0,  3,  8,  2,  1, 10, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+    {  2,  0,  9,  2,  9, 10, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+    {  9, 10,  2,  9,  2,  3,  9,  3,  8, -1, -1, -1, -1, -1, -1, -1 },
+    {  2, 11,  3, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+    {  0,  2, 11,  0, 11,  8, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+    {  2, 11,  3,  0,  9,  1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+    {  9,  1,  2,  9,  2, 11,  9, 11,  8, -1, -1, -1, -1, -1, -1, -1 },
+    {  1, 10, 11,  1, 11,  3, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+    {  0,  1, 10,  0, 10, 11,  0, 11,  8, -1, -1, -1, -1, -1, -1, -1 },
+    {  0,  9, 10,  0, 10, 11,  0, 11,  3, -1, -1, -1, -1, -1, -1, -1 },
+    {  9, 10, 11,  9, 11,  8, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+    {  4,  8,  7, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+    {  4,  0,  3,  4,  3,  7, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+    {  4,  8,  7,  0,  9,  1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+    {  4,  9,  1,  4,  1,  3,  4,  3,  7, -1, -1, -1, -1, -1, -1, -1 },
+    {  4,  8,  7,  2,  1, 10, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+    {  4,  0,  3,  4,  3,  7,  2,  1, 10, -1, -1, -1, -1, -1, -1, -1 },
+    {  4,  8,  7,  2,  0,  9,  2,  9, 10, -1, -1, -1, -1, -1, -1, -1 },
+    {  4,  9, 10,  4, 10,  2,  4,  2,  3,  4,  3,  7, -1, -1, -1, -1 },
+    {  2, 11,  3,  4,  8,  7, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+    {  4,  0,  2,  4,  2, 11,  4, 11,  7, -1, -1, -1, -1, -1, -1, -1 },
+    {  2, 11,  3,  4,  8,  7,  0,  9,  1, -1, -1, -1, -1, -1, -1, -1 },
+    {  4,  9,  1,  4,  1,  2,  4,  2, 11,  4, 11,  7, -1, -1, -1, -1 },
+    {  1, 10, 11,  1, 11,  3,  4,  8,  7, -1, -1, -1, -1, -1, -1, -1 },
+    {  4,  0,  1,  4,  1, 10,  4, 10, 11,  4, 11,  7, -1, -1, -1, -1 },
+    {  0,  9, 10,  0, 10, 11,  0, 11,  3,  4,  8,  7, -1, -1, -1, -1 },
+    {  4,  9, 10,  4, 10, 11,  4, 11,  7, -1, -1, -1, -1, -1, -1, -1 },
+    {  4,  5,  9, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+    {  0,  3,  8,  4,  5,  9, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+    {  0,  4,  5,  0,  5,  1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+    {  4,  5,  1,  4,  1,  3,  4,  3,  8, -1, -1, -1, -1, -1, -1, -1 },
+    {  2,  1, 10,  4,  5,  9, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+    {  0,  3,  8,  2,  1, 10,  4,  5,  9, -1, -1, -1, -1, -1, -1, -1 },
+    {  2,  0,  4,  2,  4,  5,  2,  5, 10, -1, -1, -1, -1, -1, -1, -1 },
+    {  4,  5, 10,  4, 10,  2,  4,  2,  3,  4,  3,  8, -1, -1, -1, -1 },
+    {  2, 11,  3,  4,  5,  9, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+    {  0,  2, 11,  0, 11,  8,  4,  5,  9, -1, -1, -1, -1, -1, -1, -1 },
+    {  2, 11,  3,  0,  4,  5,  0,  5,  1, -1, -1, -1, -1, -1, -1, -1 },
+    {  4,  5,  1,  4,  1,  2,  4,  2, 11,  4, 11,  8, -1, -1, -1, -1 },
+    {  1, 10, 11,  1, 11,  3,  4,  5,  9, -1, -1, -1, -1, -1, -1, -1 },
+    {  0,  1, 10,  0, 10, 11,  0, 11,  8,  4,  5,  9, -1, -1, -1, -1 },
+    {  0,  4,  5,  0,  5, 10,  0, 10, 11,  0, 11,  3, -1, -1, -1, -1 },
+    {  4,  5, 10,  4, 10, 11,  4, 11,  8, -1, -1, -1, -1, -1, -1, -1 },
+    {  5,  9,  8,  5,  8,  7, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+    {  5,  9,  0,  5,  0,  3,  5,  3,  7, -1, -1, -1, -1, -1, -1, -1 },
+    {  5,  1,  0,  5,  0,  8,  5,  8,  7, -1, -1, -1, -1, -1, -1, -1 },
+    {  5,  1,  3,  5,  3,  7, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+    {  5,  9,  8,  5,  8,  7,  2,  1, 10, -1, -1, -1, -1, -1, -1, -1 },
+    {  5,  9,  0,  5,  0,  3,  5,  3,  7,  2,  1, 10, -1, -1, -1, -1 },
+    {  5, 10,  2,  5,  2,  0,  5,  0,  8,  5,  8,  7, -1, -1, -1, -1 },
+    {  5, 10,  2,  5,  2,  3,  5,  3,  7, -1, -1, -1, -1, -1, -1, -1 },
+    {  2, 11,  3,  5,  9,  8,  5,  8,  7, -1, -1, -1, -1, -1, -1, -1 },
+    {  5,  9,  0,  5,  0,  2,  5,  2, 11,  5, 11,  7, -1, -1, -1, -1 },
+    {  2, 11,  3,  5,  1,  0,  5,  0,  8,  5,  8,  7, -1, -1, -1, -1 },
+    {  5,  1,  2,  5,  2, 11,  5, 11,  7, -1, -1, -1, -1, -1, -1, -1 },
+    {  1, 10, 11,  1, 11,  3,  5,  9,  8,  5,  8,  7, -1, -1, -1, -1 },
+    {  0,  1, 10,  0, 10, 11,  0, 11,  7,  0,  7,  5,  0,  5,  9, -1 },
+    {  0,  8,  7,  0,  7,  5,  0,  5, 10,  0, 10, 11,  0, 11,  3, -1 },
+    {  5, 10, 11,  5, 11,  7, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+    {  6, 10,  5, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+    {  0,  3,  8,  6, 10,  5, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+    {  6, 10,  5,  0,  9,  1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+    {  9,  1,  3,  9,  3,  8,  6, 10,  5, -1, -1, -1, -1, -1, -1, -1 },
+    {  6,  2,  1,  6,  1,  5, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+    {  0,  3,  8,  6,  2,  1,  6,  1,  5, -1, -1, -1, -1, -1, -1, -1 },
+    {  6,  2,  0,  6,  0,  9,  6,  9,  5, -1, -1, -1, -1, -1, -1, -1 },
+    {  9,  5,  6,  9,  6,  2,  9,  2,  3,  9,  3,  8, -1, -1, -1, -1 },
+    {  2, 11,  3,  6, 10,  5, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+    {  0,  2, 11,  0, 11,  8,  6, 10,  5, -1, -1, -1, -1, -1, -1, -1 },
+    {  2, 11,  3,  6, 10,  5,  0,  9,  1, -1, -1, -1, -1, -1, -1, -1 },
+    {  9,  1,  2,  9,  2, 11,  9, 11,  8,  6, 10,  5, -1, -1, -1, -1 },
+    {  1,  5,  6,  1,  6, 11,  1, 11,  3, -1, -1, -1, -1, -1, -1, -1 },
+    {  0,  1,  5,  0,  5,  6,  0,  6, 11,  0, 11,  8, -1, -1, -1, -1 },
+    {  0,  9,  5,  0,  5,  6,  0,  6, 11,  0, 11,  3, -1, -1, -1, -1 },
+    {  9,  5,  6,  9,  6, 11,  9, 11,  8, -1, -1, -1, -1, -1, -1, -1 },
+    {  4,  8,  7,  6, 10,  5, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+    {  4,  0,  3,  4,  3,  7,  6, 10,  5, -1, -1, -1, -1, -1, -1, -1 },
+    {  4,  8,  7,  6, 10,  5,  0,  9,  1, -1, -1, -1, -1, -1, -1, -1 },
+    {  4,  9,  1,  4,  1,  3,  4,  3,  7,  6, 10,  5, -1, -1, -1, -1 },
+    {  4,  8,  7,  6,  2,  1,  6,  1,  5, -1, -1, -1, -1, -1, -1, -1 },
+    {  4,  0,  3,  4,  3,  7,  6,  2,  1,  6,  1,  5, -1, -1, -1, -1 },
+    {  4,  8,  7,  6,  2,  0,  6,  0,  9,  6,  9,  5, -1, -1, -1, -1 },
+    {  9,  5,  6,  9,  6,  2,  9,  2,  3,  9,  3,  7,  9,  7,  4, -1 },
+    {  2, 11,  3,  4,  8,  7,  6, 10,  5, -1, -1, -1, -1, -1, -1, -1 },
+    {  4,  0,  2,  4,  2, 11,  4, 11,  7,  6, 10,  5, -1, -1, -1, -1 },
+    {  2, 11,  3,  4,  8,  7,  6, 10,  5,  0,  9,  1, -1, -1, -1, -1 },
+    {  4,  9,  1,  4,  1,  2,  4,  2, 11,  4, 11,  7,  6, 10,  5, -1 },
+    {  1,  5,  6,  1,  6, 11,  1, 11,  3,  4,  8,  7, -1, -1, -1, -1 },
+    {  0,  1,  5,  0,  5,  6,  0,  6, 11,  0, 11,  7,  0,  7,  4, -1 },
+    {  0,  9,  5,  0,  5,  6,  0,  6, 11,  0, 11,  3,  4,  8,  7, -1 },
+    {  9,  5,  6,  9,  6, 11,  9, 11,  7,  9,  7,  4, -1, -1, -1, -1 },
+    {  4,  6, 10,  4, 10,  9, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+    {  0,  3,  8,  4,  6, 10,  4, 10,  9, -1, -1, -1, -1, -1, -1, -1 },
+    {  0,  4,  6,  0,  6, 10,  0, 10,  1, -1, -1, -1, -1, -1, -1, -1 },
+    {  4,  6, 10,  4, 10,  1,  4,  1,  3,  4,  3,  8, -1, -1, -1, -1 },
+    {  4,  6,  2,  4,  2,  1,  4,  1,  9, -1, -1, -1, -1, -1, -1, -1 },
+    {  0,  3,  8,  4,  6,  2,  4,  2,  1,  4,  1,  9, -1, -1, -1, -1 },
+    {  6,  2,  0,  6,  0,  4, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+    {  4,  6,  2,  4,  2,  3,  4,  3,  8, -1, -1, -1, -1, -1, -1, -1 },
+    {  2, 11,  3,  4,  6, 10,  4, 10,  9, -1, -1, -1, -1, -1, -1, -1 },
+    {  0,  2, 11,  0, 11,  8,  4,  6, 10,  4, 10,  9, -1, -1, -1, -1 },
+    {  2, 11,  3,  0,  4,  6,  0,  6, 10,  0, 10,  1, -1, -1, -1, -1 },
+    {  4,  6, 10,  4, 10,  1,  4,  1,  2,  4,  2, 11,  4, 11,  8, -1 },
+    {  1,  9,  4,  1,  4,  6,  1,  6, 11,  1, 11,  3, -1, -1, -1, -1 },
+    {  1,  9,  4,  1,  4,  6,  1,  6, 11,  1, 11,  8,  1,  8,  0, -1 },
+    {  0,  4,  6,  0,  6, 11,  0, 11,  3, -1, -1, -1, -1, -1, -1, -1 },
+    {  4,  6, 11,  4, 11,  8, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+    {  6, 10,  9,  6,  9,  8,  6,  8,  7, -1, -1, -1, -1, -1, -1, -1 },
+    {  6, 10,  9,  6,  9,  0,  6,  0,  3,  6,  3,  7, -1, -1, -1, -1 },
+    {  6, 10,  1,  6,  1,  0,  6,  0,  8,  6,  8,  7, -1, -1, -1, -1 },
+    {  6, 10,  1,  6,  1,  3,  6,  3,  7, -1, -1, -1, -1, -1, -1, -1 },
+    {  6,  2,  1,  6,  1,  9,  6,  9,  8,  6,  8,  7, -1, -1, -1, -1 },
+    {  6,  2,  1,  6,  1,  9,  6,  9,  0,  6,  0,  3,  6,  3,  7, -1 },
+    {  6,  2,  0,  6,  0,  8,  6,  8,  7, -1, -1, -1, -1, -1, -1, -1 },
+    {  6,  2,  3,  6,  3,  7, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+    {  2, 11,  3,  6, 10,  9,  6,  9,  8,  6,  8,  7, -1, -1, -1, -1 },
+    {  9,  0,  2,  9,  2, 11,  9, 11,  7,  9,  7,  6,  9,  6, 10, -1 },
+    {  2, 11,  3,  6, 10,  1,  6,  1,  0,  6,  0,  8,  6,  8,  7, -1 },
+    {  1,  2, 11,  1, 11,  7,  1,  7,  6,  1,  6, 10, -1, -1, -1, -1 },
+    {  1,  9,  8,  1,  8,  7,  1,  7,  6,  1,  6, 11,  1, 11,  3, -1 },
+    {  6, 11,  7,  0,  1,  9, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+    {  0,  8,  7,  0,  7,  6,  0,  6, 11,  0, 11,  3, -1, -1, -1, -1 },
+    {  6, 11,  7, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+    {  6,  7, 11, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+    {  6,  7, 11,  0,  3,  8, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+    {  6,  7, 11,  0,  9,  1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+    {  6,  7, 11,  9,  1,  3,  9,  3,  8, -1, -1, -1, -1, -1, -1, -1 },
+    {  6,  7, 11,  2,  1, 10, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+    {  6,  7, 11,  0,  3,  8,  2,  1, 10, -1, -1, -1, -1, -1, -1, -1 },
+    {  6,  7, 11,  2,  0,  9,  2,  9, 10, -1, -1, -1, -1, -1, -1, -1 },
+    {  6,  7, 11,  9, 10,  2,  9,  2,  3,  9,  3,  8, -1, -1, -1, -1 },
+    {  2,  6,  7,  2,  7,  3, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+    {  0,  2,  6,  0,  6,  7,  0,  7,  8, -1, -1, -1, -1, -1, -1, -1 },
+    {  2,  6,  7,  2,  7,  3,  0,  9,  1, -1, -1, -1, -1, -1, -1, -1 },
+    {  9,  1,  2,  9,  2,  6,  9,  6,  7,  9,  7,  8, -1, -1, -1, -1 },
+    {  1, 10,  6,  1,  6,  7,  1,  7,  3, -1, -1, -1, -1, -1, -1, -1 },
+    {  0,  1, 10,  0, 10,  6,  0,  6,  7,  0,  7,  8, -1, -1, -1, -1 },
+    {  0,  9, 10,  0, 10,  6,  0,  6,  7,  0,  7,  3, -1, -1, -1, -1 },
+    {  9, 10,  6,  9,  6,  7,  9,  7,  8, -1, -1, -1, -1, -1, -1, -1 },
+    {  6,  4,  8,  6,  8, 11, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+    {  6,  4,  0,  6,  0,  3,  6,  3, 11, -1, -1, -1, -1, -1, -1, -1 },
+    {  6,  4,  8,  6,  8, 11,  0,  9,  1, -1, -1, -1, -1, -1, -1, -1 },
+    {  6,  4,  9,  6,  9,  1,  6,  1,  3,  6,  3, 11, -1, -1, -1, -1 },
+    {  6,  4,  8,  6,  8, 11,  2,  1, 10, -1, -1, -1, -1, -1, -1, -1 },
+    {  6,  4,  0,  6,  0,  3,  6,  3, 11,  2,  1, 10, -1, -1, -1, -1 },
+    {  6,  4,  8,  6,  8, 11,  2,  0,  9,  2,  9, 10, -1, -1, -1, -1 },
+    {  4,  9, 10,  4, 10,  2,  4,  2,  3,  4,  3, 11,  4, 11,  6, -1 },
+    {  2,  6,  4,  2,  4,  8,  2,  8,  3, -1, -1, -1, -1, -1, -1, -1 },
+    {  2,  6,  4,  2,  4,  0, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+    {  2,  6,  4,  2,  4,  8,  2,  8,  3,  0,  9,  1, -1, -1, -1, -1 },
+    {  2,  6,  4,  2,  4,  9,  2,  9,  1, -1, -1, -1, -1, -1, -1, -1 },
+    {  1, 10,  6,  1,  6,  4,  1,  4,  8,  1,  8,  3, -1, -1, -1, -1 },
+    {  6,  4,  0,  6,  0,  1,  6,  1, 10, -1, -1, -1, -1, -1, -1, -1 },
+    { 10,  6,  4, 10,  4,  8, 10,  8,  3, 10,  3,  0, 10,  0,  9, -1 },
+    {  6,  4,  9,  6,  9, 10, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+    {  6,  7, 11,  4,  5,  9, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+    {  6,  7, 11,  0,  3,  8,  4,  5,  9, -1, -1, -1, -1, -1, -1, -1 },
+    {  6,  7, 11,  0,  4,  5,  0,  5,  1, -1, -1, -1, -1, -1, -1, -1 },
+    {  6,  7, 11,  4,  5,  1,  4,  1,  3,  4,  3,  8, -1, -1, -1, -1 },
+    {  6,  7, 11,  2,  1, 10,  4,  5,  9, -1, -1, -1, -1, -1, -1, -1 },
+    {  6,  7, 11,  0,  3,  8,  2,  1, 10,  4,  5,  9, -1, -1, -1, -1 },
+    {  6,  7, 11,  2,  0,  4,  2,  4,  5,  2,  5, 10, -1, -1, -1, -1 },
+    {  6,  7, 11,  4,  5, 10,  4, 10,  2,  4,  2,  3,  4,  3,  8, -1 },
+    {  2,  6,  7,  2,  7,  3,  4,  5,  9, -1, -1, -1, -1, -1, -1, -1 },
+    {  0,  2,  6,  0,  6,  7,  0,  7,  8,  4,  5,  9, -1, -1, -1, -1 },
+    {  2,  6,  7,  2,  7,  3,  0,  4,  5,  0,  5,  1, -1, -1, -1, -1 },
+    {  1,  2,  6,  1,  6,  7,  1,  7,  8,  1,  8,  4,  1,  4,  5, -1 },
+    {  1, 10,  6,  1,  6,  7,  1,  7,  3,  4,  5,  9, -1, -1, -1, -1 },
+    {  0,  1, 10,  0, 10,  6,  0,  6,  7,  0,  7,  8,  4,  5,  9, -1 },
+    {  0,  4,  5,  0,  5, 10,  0, 10,  6,  0,  6,  7,  0,  7,  3, -1 },
+    { 10,  6,  7, 10,  7,  8, 10,  8,  4, 10,  4,  5, -1, -1, -1, -1 },
+    {  6,  5,  9,  6,  9,  8,  6,  8, 11, -1, -1, -1, -1, -1, -1, -1 },
+    {  6,  5,  9,  6,  9,  0,  6,  0,  3,  6,  3, 11, -1, -1, -1, -1 },
+    {  6,  5,  1,  6,  1,  0,  6,  0,  8,  6,  8, 11, -1, -1, -1, -1 },
+    {  6,  5,  1,  6,  1,  3,  6,  3, 11, -1, -1, -1, -1, -1, -1, -1 },
+    {  6,  5,  9,  6,  9,  8,  6,  8, 11,  2,  1, 10, -1, -1, -1, -1 },
+    {  6,  5,  9,  6,  9,  0,  6,  0,  3,  6,  3, 11,  2,  1, 10, -1 },
+    {  5, 10,  2,  5,  2,  0,  5,  0,  8,  5,  8, 11,  5, 11,  6, -1 },
+    {  5, 10,  2,  5,  2,  3,  5,  3, 11,  5, 11,  6, -1, -1, -1, -1 },
+    {  2,  6,  5,  2,  5,  9,  2,  9,  8,  2,  8,  3, -1, -1, -1, -1 },
+    {  0,  2,  6,  0,  6,  5,  0,  5,  9, -1, -1, -1, -1, -1, -1, -1 },
+    {  6,  5,  1,  6,  1,  0,  6,  0,  8,  6,  8,  3,  6,  3,  2, -1 },
+    {  2,  6,  5,  2,  5,  1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+    {  6,  5,  9,  6,  9,  8,  6,  8,  3,  6,  3,  1,  6,  1, 10, -1 },
+    {  6,  5,  9,  6,  9,  0,  6,  0,  1,  6,  1, 10, -1, -1, -1, -1 },
+    {  0,  8,  3,  6,  5, 10, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+    {  6,  5, 10, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+    { 10,  5,  7, 10,  7, 11, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+    { 10,  5,  7, 10,  7, 11,  0,  3,  8, -1, -1, -1, -1, -1, -1, -1 },
+    { 10,  5,  7, 10,  7, 11,  0,  9,  1, -1, -1, -1, -1, -1, -1, -1 },
+    { 10,  5,  7, 10,  7, 11,  9,  1,  3,  9,  3,  8, -1, -1, -1, -1 },
+    {  2,  1,  5,  2,  5,  7,  2,  7, 11, -1, -1, -1, -1, -1, -1, -1 },
+    {  2,  1,  5,  2,  5,  7,  2,  7, 11,  0,  3,  8, -1, -1, -1, -1 },
+    {  2,  0,  9,  2,  9,  5,  2,  5,  7,  2,  7, 11, -1, -1, -1, -1 },
+    {  2,  3,  8,  2,  8,  9,  2,  9,  5,  2,  5,  7,  2,  7, 11, -1 },
+    {  2, 10,  5,  2,  5,  7,  2,  7,  3, -1, -1, -1, -1, -1, -1, -1 },
+    {  0,  2, 10,  0, 10,  5,  0,  5,  7,  0,  7,  8, -1, -1, -1, -1 },
+    {  2, 10,  5,  2,  5,  7,  2,  7,  3,  0,  9,  1, -1, -1, -1, -1 },
+    {  2, 10,  5,  2,  5,  7,  2,  7,  8,  2,  8,  9,  2,  9,  1, -1 },
+    {  1,  5,  7,  1,  7,  3, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+    {  0,  1,  5,  0,  5,  7,  0,  7,  8, -1, -1, -1, -1, -1, -1, -1 },
+    {  0,  9,  5,  0,  5,  7,  0,  7,  3, -1, -1, -1, -1, -1, -1, -1 },
+    {  9,  5,  7,  9,  7,  8, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+    { 10,  5,  4, 10,  4,  8, 10,  8, 11, -1, -1, -1, -1, -1, -1, -1 },
+    { 10,  5,  4, 10,  4,  0, 10,  0,  3, 10,  3, 11, -1, -1, -1, -1 },
+    { 10,  5,  4, 10,  4,  8, 10,  8, 11,  0,  9,  1, -1, -1, -1, -1 },
+    {  4,  9,  1,  4,  1,  3,  4,  3, 11,  4, 11, 10,  4, 10,  5, -1 },
+    {  2,  1,  5,  2,  5,  4,  2,  4,  8,  2,  8, 11, -1, -1, -1, -1 },
+    {  5,  4,  0,  5,  0,  3,  5,  3, 11,  5, 11,  2,  5,  2,  1, -1 },
+    {  2,  0,  9,  2,  9,  5,  2,  5,  4,  2,  4,  8,  2,  8, 11, -1 },
+    {  2,  3, 11,  4,  9,  5, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+    {  2, 10,  5,  2,  5,  4,  2,  4,  8,  2,  8,  3, -1, -1, -1, -1 },
+    {  4,  0,  2,  4,  2, 10,  4, 10,  5, -1, -1, -1, -1, -1, -1, -1 },
+    {  2, 10,  5,  2,  5,  4,  2,  4,  8,  2,  8,  3,  0,  9,  1, -1 },
+    {  4,  9,  1,  4,  1,  2,  4,  2, 10,  4, 10,  5, -1, -1, -1, -1 },
+    {  1,  5,  4,  1,  4,  8,  1,  8,  3, -1, -1, -1, -1, -1, -1, -1 },
+    {  4,  0,  1,  4,  1,  5, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+    {  5,  4,  8,  5,  8,  3,  5,  3,  0,  5,  0,  9, -1, -1, -1, -1 },
+    {  4,  9,  5, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+    { 10,  9,  4, 10,  4,  7, 10,  7, 11, -1, -1, -1, -1, -1, -1, -1 },
+    { 10,  9,  4, 10,  4,  7, 10,  7, 11,  0,  3,  8, -1, -1, -1, -1 },
+    { 10,  1,  0, 10,  0,  4, 10,  4,  7, 10,  7, 11, -1, -1, -1, -1 },
+    { 10,  1,  3, 10,  3,  8, 10,  8,  4, 10,  4,  7, 10,  7, 11, -1 },
+    {  2,  1,  9,  2,  9,  4,  2,  4,  7,  2,  7, 11, -1, -1, -1, -1 },
+    {  2,  1,  9,  2,  9,  4,  2,  4,  7,  2,  7, 11,  0,  3,  8, -1 },
+    {  2,  0,  4,  2,  4,  7,  2,  7, 11, -1, -1, -1, -1, -1, -1, -1 },
+    {  2,  3,  8,  2,  8,  4,  2,  4,  7,  2,  7, 11, -1, -1, -1, -1 },
+    {  2, 10,  9,  2,  9,  4,  2,  4,  7,  2,  7,  3, -1, -1, -1, -1 },
+    {  2, 10,  9,  2,  9,  4,  2,  4,  7,  2,  7,  8,  2,  8,  0, -1 },
+    { 10,  1,  0, 10,  0,  4, 10,  4,  7, 10,  7,  3, 10,  3,  2, -1 },
+    {  4,  7,  8,  2, 10,  1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+    {  1,  9,  4,  1,  4,  7,  1,  7,  3, -1, -1, -1, -1, -1, -1, -1 },
+    {  1,  9,  4,  1,  4,  7,  1,  7,  8,  1,  8,  0, -1, -1, -1, -1 },
+    {  0,  4,  7,  0,  7,  3, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+    {  4,  7,  8, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+    { 10,  9,  8, 10,  8, 11, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+    { 10,  9,  0, 10,  0,  3, 10,  3, 11, -1, -1, -1, -1, -1, -1, -1 },
+    { 10,  1,  0, 10,  0,  8, 10,  8, 11, -1, -1, -1, -1, -1, -1, -1 },
+    { 10,  1,  3, 10,  3, 11, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+    {  2,  1,  9,  2,  9,  8,  2,  8, 11, -1, -1, -1, -1, -1, -1, -1 },
+    {  9,  0,  3,  9,  3, 11,  9, 11,  2,  9,  2,  1, -1, -1, -1, -1 },
+    {  2,  0,  8,  2,  8, 11, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+    {  2,  3, 11, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+    {  2, 10,  9,  2,  9,  8,  2,  8,  3, -1, -1, -1, -1, -1, -1, -1 },
+    {  0,  2, 10,  0, 10,  9, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+    { 10,  1,  0, 10,  0,  8, 10,  8,  3, 10,  3,  2, -1, -1, -1, -1 },
+    {  2, 10,  1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+    {  1,  9,  8,  1,  8,  3, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+    {  0,  1,  9, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+    {  0,  8,  3, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+    { -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+};
+
+}  // namespace MarchingCubes
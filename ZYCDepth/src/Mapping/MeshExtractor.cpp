@@ -0,0 +1,165 @@
+﻿#include "MeshExtractor.h"
+#include "Mapping/MarchingCubesTables.h"
+#include "Profiler/TraceProfiler.h"
+#include <algorithm>
+#include <chrono>
+
+namespace {
+    constexpr int kSide = TsdfBlock::kSide;
+    constexpr int kGrid = kSide + 1;   // 块内格子的角点会用到 +1 层（邻块的第 0 层体素）
+
+    // 边 → (最小端点相对格子的偏移, 方向轴)，用于在块内唯一标识一条体素边
+    struct EdgeSlot { int dx, dy, dz, axis; };
+    constexpr EdgeSlot kEdgeSlots[12] = {
+        { 0, 0, 0, 0 }, { 1, 0, 0, 1 }, { 0, 1, 0, 0 }, { 0, 0, 0, 1 },
+        { 0, 0, 1, 0 }, { 1, 0, 1, 1 }, { 0, 1, 1, 0 }, { 0, 0, 1, 1 },
+        { 0, 0, 0, 2 }, { 1, 0, 0, 2 }, { 1, 1, 0, 2 }, { 0, 1, 0, 2 },
+    };
+}
+
+void MeshExtractor::meshBlock(const TsdfVolume& volume, const TsdfBlock& block, MeshChunk& out) {
+    // 格子角点可能落在 +x/+y/+z 方向的 7 个邻块里，先一次查好
+    const TsdfBlock* neighbors[2][2][2];
+    for (int dz = 0; dz < 2; ++dz)
+        for (int dy = 0; dy < 2; ++dy)
+            for (int dx = 0; dx < 2; ++dx)
+                neighbors[dz][dy][dx] = (dx | dy | dz) ? volume.findBlock({ block.coord.x + dx, block.coord.y + dy, block.coord.z + dz }) : &block;
+    auto voxelAt = [&](int x, int y, int z) -> const TsdfVoxel* {
+        const TsdfBlock* b = neighbors[z / kSide][y / kSide][x / kSide];
+        return b ? &b->voxels[TsdfBlock::index(x % kSide, y % kSide, z % kSide)] : nullptr;
+    };
+
+    // 体素边 → 分块内顶点下标（-1 表示尚未生成），每个线程复用一份
+    thread_local std::vector<int32_t> edgeVertex;
+    edgeVertex.assign(kGrid * kGrid * kGrid * 3, -1);
+
+    const float voxel = volume.config().voxelSize;
+    const float baseX = (block.coord.x * kSide + 0.5f) * voxel;
+    const float baseY = (block.coord.y * kSide + 0.5f) * voxel;
+    const float baseZ = (block.coord.z * kSide + 0.5f) * voxel;
+
+    for (int z = 0; z < kSide; ++z) {
+        for (int y = 0; y < kSide; ++y) {
+            for (int x = 0; x < kSide; ++x) {
+                float values[8];
+                int config = 0;
+                bool observed = true;
+                for (int c = 0; c < 8 && observed; ++c) {
+                    const int* o = MarchingCubes::kCornerOffset[c];
+                    const TsdfVoxel* v = voxelAt(x + o[0], y + o[1], z + o[2]);
+                    if (!v || v->weight <= 0.0f) { observed = false; break; }
+                    values[c] = v->tsdf;
+                    if (v->tsdf < 0.0f) config |= 1 << c;
+                }
+                if (!observed || config == 0 || config == 0xFF) continue;
+
+                const int8_t* tri = MarchingCubes::kTriangles[config];
+                for (int t = 0; tri[t] >= 0; t += 3) {
+                    uint32_t ids[3];
+                    for (int k = 0; k < 3; ++k) {
+                        const int edge = tri[t + k];
+                        const EdgeSlot& slot = kEdgeSlots[edge];
+                        int32_t& id = edgeVertex[(((z + slot.dz) * kGrid + (y + slot.dy)) * kGrid + (x + slot.dx)) * 3 + slot.axis];
+                        if (id < 0) {
+                            // 在边上按符号距离线性插值零点
+                            const int a = MarchingCubes::kEdgeCorners[edge][0], b = MarchingCubes::kEdgeCorners[edge][1];
+                            const float s = values[a] / (values[a] - values[b]);
+                            const int* oa = MarchingCubes::kCornerOffset[a];
+                            const int* ob = MarchingCubes::kCornerOffset[b];
+                            id = (int32_t)out.vertexCount();
+                            out.vertices.push_back(baseX + (x + oa[0] + s * (ob[0] - oa[0])) * voxel);
+                            out.vertices.push_back(baseY + (y + oa[1] + s * (ob[1] - oa[1])) * voxel);
+                            out.vertices.push_back(baseZ + (z + oa[2] + s * (ob[2] - oa[2])) * voxel);
+                        }
+                        ids[k] = (uint32_t)id;
+                    }
+                    if (ids[0] == ids[1] || ids[1] == ids[2] || ids[0] == ids[2]) continue;
+                    out.indices.insert(out.indices.end(), ids, ids + 3);
+                }
+            }
+        }
+    }
+}
+
+MeshExtractor::Update MeshExtractor::extract(TsdfVolume& volume) {
+    ZYC_PROFILE_SCOPE("MeshExtractor::extract");
+    auto start = std::chrono::steady_clock::now();
+    Update update;
+
+    // 地图清空过：旧分块全部删除，之后的脏块列表只包含清空后融合的块
+    if (volume.generation() != generation) {
+        generation = volume.generation();
+        for (const auto& [id, mesh] : meshes) update.removed.push_back(id);
+        meshes.clear();
+        triangles = 0;
+    }
+
+    // 脏块本身，以及格子会读到脏块体素的 -x/-y/-z 方向邻块
+    std::vector<uint64_t> dirty = volume.takeDirtyBlocks();
+    std::vector<uint64_t> keys;
+    keys.reserve(dirty.size() * 8);
+    for (uint64_t key : dirty) {
+        const BlockCoord c = BlockCoord::fromKey(key);
+        for (int dz = 0; dz < 2; ++dz)
+            for (int dy = 0; dy < 2; ++dy)
+                for (int dx = 0; dx < 2; ++dx)
+                    keys.push_back(BlockCoord{ c.x - dx, c.y - dy, c.z - dz }.key());
+    }
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+
+    std::vector<const TsdfBlock*> work;
+    work.reserve(keys.size());
+    for (uint64_t key : keys) {
+        if (const TsdfBlock* block = volume.findBlock(BlockCoord::fromKey(key))) {
+            work.push_back(block);
+        }
+        else if (auto it = meshes.find(key); it != meshes.end()) {
+            // 块已不存在（回环校正时被搬走）：删除它的分块
+            triangles -= it->second->triangleCount();
+            update.removed.push_back(key);
+            meshes.erase(it);
+        }
+    }
+    update.remeshedBlocks = work.size();
+
+    std::vector<std::shared_ptr<MeshChunk>> results(work.size());
+    cv::parallel_for_(cv::Range(0, (int)work.size()), [&](const cv::Range& range) {
+        for (int i = range.start; i < range.end; ++i) {
+            auto mesh = std::make_shared<MeshChunk>();
+            mesh->id = work[i]->coord.key();
+            meshBlock(volume, *work[i], *mesh);
+            results[i] = std::move(mesh);
+        }
+    });
+
+    for (auto& mesh : results) {
+        auto it = meshes.find(mesh->id);
+        if (it != meshes.end()) {
+            triangles -= it->second->triangleCount();
+            if (mesh->indices.empty()) {
+                update.removed.push_back(mesh->id);
+                meshes.erase(it);
+                continue;
+            }
+        }
+        else if (mesh->indices.empty()) {
+            continue;
+        }
+        mesh->version = ++nextVersion;
+        triangles += mesh->triangleCount();
+        MeshChunkHandle handle = std::move(mesh);
+        meshes[handle->id] = handle;
+        update.changed.push_back(std::move(handle));
+    }
+    update.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return update;
+}
+
+MapMeshHandle MeshExtractor::snapshot() {
+    auto snapshot = std::make_shared<MapMeshSnapshot>();
+    snapshot->version = ++nextVersion;
+    snapshot->chunks = meshes;
+    snapshot->triangles = triangles;
+    return snapshot;
+}
@@ -0,0 +1,44 @@
+﻿#pragma once
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include "Data/MapMesh.h"
+#include "Mapping/TsdfVolume.h"
+
+/**
+ * @brief 增量网格提取（建图阶段独占，非线程安全）
+ * @details 每个 TSDF 体素块对应一个网格分块，分块 ID 就是块坐标键，块存在期间不变。
+ *          每次提取只重新三角化上次之后被融合更新过的块，以及格子会读到这些块体素的邻块
+ *          （块负责最小角落在块内的 8³ 个格子，最后一层格子读取 +x/+y/+z 方向的邻块），
+ *          其余分块原样沿用，单次开销与本次变化的块数成正比，而不是与地图大小成正比。
+ *          需要重新三角化的块按块并行（cv::parallel_for_）做行进立方体，
+ *          顶点在分块内按所在的体素边去重，输出带索引的三角形。
+ *          地图被清空（体素参数变化）时所有分块作为删除输出；单个块被移除（回环校正搬动）时其分块同样作为删除输出。
+ */
+class MeshExtractor {
+public:
+    struct Update {
+        std::vector<MeshChunkHandle> changed;   ///< 新增或重新三角化后非空的分块
+        std::vector<uint64_t> removed;          ///< 变空或随地图清空而删除的分块 ID
+        size_t remeshedBlocks = 0;              ///< 本次重新三角化的块数（含结果为空的）
+        double ms = 0.0;
+    };
+
+    // 增量提取：消费体素地图的脏块列表
+    Update extract(TsdfVolume& volume);
+
+    // 当前全部非空分块组成的快照（未变化的分块与上一份快照共享），快照版本号每次递增
+    MapMeshHandle snapshot();
+
+    size_t chunkCount() const { return meshes.size(); }
+    size_t triangleCount() const { return triangles; }
+
+private:
+    // 对一个块内的 8³ 个格子做行进立方体；缺少邻块或有未观测角点的格子跳过
+    static void meshBlock(const TsdfVolume& volume, const TsdfBlock& block, MeshChunk& out);
+
+    uint64_t generation = 0;       ///< 上次提取时地图的清空次数
+    uint64_t nextVersion = 0;      ///< 分块与快照共用的递增序号（跨清空也不回退）
+    std::unordered_map<uint64_t, MeshChunkHandle> meshes;
+    size_t triangles = 0;
+};
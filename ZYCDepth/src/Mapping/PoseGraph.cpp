@@ -0,0 +1,271 @@
+﻿#include "Mapping/PoseGraph.h"
+#include <array>
+#include <cmath>
+#include <map>
+
+namespace {
+
+using Block = std::array<double, 36>;   ///< 6×6 行主序
+using Vec6 = std::array<double, 6>;
+
+// C −= A·Bᵀ
+void subtractABt(Block& C, const Block& A, const Block& B) {
+    for (int r = 0; r < 6; ++r) {
+        for (int c = 0; c < 6; ++c) {
+            double s = 0.0;
+            for (int k = 0; k < 6; ++k) s += A[r * 6 + k] * B[c * 6 + k];
+            C[r * 6 + c] -= s;
+        }
+    }
+}
+
+// 原地 Cholesky：A = L·Lᵀ，只使用并写回下三角；主元非正时返回 false
+bool cholesky(Block& A) {
+    for (int c = 0; c < 6; ++c) {
+        double d = A[c * 6 + c];
+        for (int k = 0; k < c; ++k) d -= A[c * 6 + k] * A[c * 6 + k];
+        if (!(d > 1e-12)) return false;
+        d = std::sqrt(d);
+        A[c * 6 + c] = d;
+        for (int r = c + 1; r < 6; ++r) {
+            double s = A[r * 6 + c];
+            for (int k = 0; k < c; ++k) s -= A[r * 6 + k] * A[c * 6 + k];
+            A[r * 6 + c] = s / d;
+        }
+        for (int r = 0; r < c; ++r) A[r * 6 + c] = 0.0;
+    }
+    return true;
+}
+
+// x ← L⁻¹·x
+void forwardSolve(const Block& L, double* x) {
+    for (int r = 0; r < 6; ++r) {
+        double s = x[r];
+        for (int k = 0; k < r; ++k) s -= L[r * 6 + k] * x[k];
+        x[r] = s / L[r * 6 + r];
+    }
+}
+
+// x ← L⁻ᵀ·x
+void backwardSolve(const Block& L, double* x) {
+    for (int r = 5; r >= 0; --r) {
+        double s = x[r];
+        for (int k = r + 1; k < 6; ++k) s -= L[k * 6 + r] * x[k];
+        x[r] = s / L[r * 6 + r];
+    }
+}
+
+/**
+ * @brief 6×6 块稀疏对称正定矩阵的右视（right-looking）块 Cholesky
+ * @details 只存下三角：每列一个对角块和若干 行号 > 列号 的非对角块（std::map 按行有序）。
+ *          消去第 k 列时对该列的每对非对角块 (i, j) 更新 H_ij −= L_ik·L_jkᵀ，不存在的块即填充，按需新建
+ */
+class BlockCholesky {
+public:
+    explicit BlockCholesky(int n) : diagonal(n, Block{}), columns(n), rhs(n, Vec6{}) {}
+
+    Block& diag(int i) { return diagonal[i]; }
+    // 下三角块 (row, col)，row > col
+    Block& lower(int row, int col) {
+        auto it = columns[col].find(row);
+        if (it == columns[col].end()) it = columns[col].emplace(row, Block{}).first;
+        return it->second;
+    }
+    Vec6& b(int i) { return rhs[i]; }
+
+    bool factorize() {
+        const int n = (int)diagonal.size();
+        for (int k = 0; k < n; ++k) {
+            Block& Lkk = diagonal[k];
+            if (!cholesky(Lkk)) return false;
+            // L_ik = H_ik·L_kk⁻ᵀ：逐行解 L_kk·xᵀ = rowᵀ
+            for (auto& [i, Hik] : columns[k]) {
+                for (int r = 0; r < 6; ++r) forwardSolve(Lkk, &Hik[r * 6]);
+            }
+            for (auto it = columns[k].begin(); it != columns[k].end(); ++it) {
+                const int i = it->first;
+                subtractABt(diagonal[i], it->second, it->second);
+                for (auto jt = columns[k].begin(); jt != it; ++jt) {
+                    subtractABt(lower(i, jt->first), it->second, jt->second);
+                }
+            }
+        }
+        return true;
+    }
+
+    // 在 factorize 之后解 H·x = rhs，结果写回 rhs
+    void solve() {
+        const int n = (int)diagonal.size();
+        for (int k = 0; k < n; ++k) {
+            forwardSolve(diagonal[k], rhs[k].data());
+            for (const auto& [i, Lik] : columns[k]) {
+                for (int r = 0; r < 6; ++r) {
+                    double s = 0.0;
+                    for (int c = 0; c < 6; ++c) s += Lik[r * 6 + c] * rhs[k][c];
+                    rhs[i][r] -= s;
+                }
+            }
+        }
+        for (int k = n - 1; k >= 0; --k) {
+            for (const auto& [i, Lik] : columns[k]) {
+                for (int c = 0; c < 6; ++c) {
+                    double s = 0.0;
+                    for (int r = 0; r < 6; ++r) s += Lik[r * 6 + c] * rhs[i][r];
+                    rhs[k][c] -= s;
+                }
+            }
+            backwardSolve(diagonal[k], rhs[k].data());
+        }
+    }
+
+private:
+    std::vector<Block> diagonal;
+    std::vector<std::map<int, Block>> columns;
+    std::vector<Vec6> rhs;
+};
+
+// [v]×
+void skew(const double v[3], double S[9]) {
+    S[0] = 0;     S[1] = -v[2]; S[2] = v[1];
+    S[3] = v[2];  S[4] = 0;     S[5] = -v[0];
+    S[6] = -v[1]; S[7] = v[0];  S[8] = 0;
+}
+
+// 3×3 乘法，Aᵀ 由 transposeA 选择
+void mul33(const double* A, const double* B, double* C, bool transposeA) {
+    for (int r = 0; r < 3; ++r) {
+        for (int c = 0; c < 3; ++c) {
+            double s = 0.0;
+            for (int k = 0; k < 3; ++k) s += (transposeA ? A[k * 3 + r] : A[r * 3 + k]) * B[k * 3 + c];
+            C[r * 3 + c] = s;
+        }
+    }
+}
+
+void setBlock(Block& J, int row, int col, const double* M, double sign = 1.0) {
+    for (int r = 0; r < 3; ++r) {
+        for (int c = 0; c < 3; ++c) J[(row + r) * 6 + col + c] = sign * M[r * 3 + c];
+    }
+}
+
+} // namespace
+
+int PoseGraph::addNode(const RigidTransform& pose) {
+    poses.push_back(pose);
+    return (int)poses.size() - 1;
+}
+
+void PoseGraph::addEdge(const Edge& edge) {
+    if (edge.from < 0 || edge.to < 0 || edge.from >= nodeCount() || edge.to >= nodeCount() || edge.from == edge.to) return;
+    edges.push_back(edge);
+}
+
+void PoseGraph::residual(const Edge& edge, double e[6]) const {
+    const RigidTransform E = edge.measurement.inverse() * (poses[edge.from].inverse() * poses[edge.to]);
+    E.toTwist(e);
+}
+
+double PoseGraph::totalError() const {
+    double sum = 0.0;
+    for (const Edge& edge : edges) {
+        double e[6];
+        residual(edge, e);
+        sum += edge.rotationInfo * (e[0] * e[0] + e[1] * e[1] + e[2] * e[2])
+            + edge.translationInfo * (e[3] * e[3] + e[4] * e[4] + e[5] * e[5]);
+    }
+    return sum;
+}
+
+PoseGraph::Result PoseGraph::optimize(int maxIterations) {
+    Result result;
+    result.initialError = result.finalError = totalError();
+    const int n = nodeCount() - 1;   // 节点 0 固定，变量下标 = 节点号 − 1
+    if (n <= 0 || edges.empty()) return result;
+
+    for (int iter = 0; iter < maxIterations; ++iter) {
+        BlockCholesky H(n);
+        for (int i = 0; i < n; ++i) {
+            for (int d = 0; d < 6; ++d) H.diag(i)[d * 6 + d] = 1e-6;   // 微小阻尼：只连到固定节点的方向也可解
+        }
+
+        for (const Edge& edge : edges) {
+            // 右扰动 T ← T·exp(δ)（旋转右乘，平移 t ← t + R·τ）下，e = log(Z⁻¹·Ti⁻¹·Tj) 的雅可比：
+            //   ∂e/∂δi = [[−R_Aᵀ, 0], [R_Zᵀ[t_A]×, −R_Zᵀ]]，∂e/∂δj = [[I, 0], [0, R_Zᵀ·R_A]]，A = Ti⁻¹·Tj
+            const RigidTransform A = poses[edge.from].inverse() * poses[edge.to];
+            const double* RZ = edge.measurement.R;
+            double e[6];
+            (edge.measurement.inverse() * A).toTwist(e);
+
+            double tA[9], RZtA[9], RZRA[9];
+            skew(A.t, tA);
+            mul33(RZ, tA, RZtA, true);
+            mul33(RZ, A.R, RZRA, true);
+            double RAt[9], RZt[9];
+            for (int r = 0; r < 3; ++r) {
+                for (int c = 0; c < 3; ++c) { RAt[r * 3 + c] = A.R[c * 3 + r]; RZt[r * 3 + c] = RZ[c * 3 + r]; }
+            }
+            static const double I3[9] = { 1, 0, 0, 0, 1, 0, 0, 0, 1 };
+
+            Block Ji{}, Jj{};
+            setBlock(Ji, 0, 0, RAt, -1.0);
+            setBlock(Ji, 3, 0, RZtA);
+            setBlock(Ji, 3, 3, RZt, -1.0);
+            setBlock(Jj, 0, 0, I3);
+            setBlock(Jj, 3, 3, RZRA);
+
+            const double info[6] = { edge.rotationInfo, edge.rotationInfo, edge.rotationInfo,
+                edge.translationInfo, edge.translationInfo, edge.translationInfo };
+            const int vi = edge.from - 1, vj = edge.to - 1;
+            const int var[2] = { vi, vj };
+            const Block* J[2] = { &Ji, &Jj };
+
+            for (int a = 0; a < 2; ++a) {
+                if (var[a] < 0) continue;
+                // b_a += J_aᵀ·Λ·e
+                Vec6& b = H.b(var[a]);
+                for (int r = 0; r < 6; ++r) {
+                    double s = 0.0;
+                    for (int k = 0; k < 6; ++k) s += (*J[a])[k * 6 + r] * info[k] * e[k];
+                    b[r] += s;
+                }
+                for (int c = 0; c < 2; ++c) {
+                    if (var[c] < 0 || var[c] > var[a]) continue;
+                    // H_ac += J_aᵀ·Λ·J_c（只累加下三角块）
+                    Block& Hac = var[c] == var[a] ? H.diag(var[a]) : H.lower(var[a], var[c]);
+                    for (int r = 0; r < 6; ++r) {
+                        for (int q = 0; q < 6; ++q) {
+                            double s = 0.0;
+                            for (int k = 0; k < 6; ++k) s += (*J[a])[k * 6 + r] * info[k] * (*J[c])[k * 6 + q];
+                            Hac[r * 6 + q] += s;
+                        }
+                    }
+                }
+            }
+        }
+
+        if (!H.factorize()) break;
+        H.solve();   // 解出 H·x = b，增量 δ = −x
+
+        const std::vector<RigidTransform> previous = poses;
+        double step = 0.0;
+        for (int i = 0; i < n; ++i) {
+            double delta[6];
+            for (int d = 0; d < 6; ++d) {
+                delta[d] = -H.b(i)[d];
+                step = std::max(step, std::abs(delta[d]));
+            }
+            poses[i + 1] = poses[i + 1] * RigidTransform::fromTwist(delta);
+            poses[i + 1].orthonormalize();
+        }
+
+        const double error = totalError();
+        if (error > result.finalError) {
+            poses = previous;   // 发散（线性化失效）时保留上一步
+            break;
+        }
+        result.finalError = error;
+        result.iterations = iter + 1;
+        if (step < 1e-6) break;
+    }
+    return result;
+}
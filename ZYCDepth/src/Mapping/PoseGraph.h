@@ -0,0 +1,51 @@
+﻿#pragma once
+#include <cstdint>
+#include <vector>
+#include "Mapping/RigidTransform.h"
+
+/**
+ * @brief 关键帧位姿图（建图阶段独占，非线程安全）
+ * @details 节点是关键帧的相机到世界位姿，边是两帧之间的相对位姿观测 Z ≈ Ti⁻¹·Tj：
+ *          相邻关键帧之间的里程计边，以及回环检测验证过的回环边。
+ *          优化用高斯-牛顿，增量右乘 Ti ← Ti·exp(δi)，残差 e = log(Z⁻¹·Ti⁻¹·Tj)；第 0 个节点固定（规范自由度）。
+ *          法方程按 6×6 块稀疏存储，按关键帧顺序做块 Cholesky：里程计边只连相邻节点，
+ *          回环边 (a, b) 只在 a..b 之间的列上各产生一个填充块，分解代价与节点数成线性，而不是稠密的立方。
+ */
+class PoseGraph {
+public:
+    struct Edge {
+        int from = 0, to = 0;
+        RigidTransform measurement;      ///< Z：to 相机系 → from 相机系
+        double rotationInfo = 1.0;       ///< 旋转残差（弧度²）的信息量
+        double translationInfo = 1.0;    ///< 平移残差（米²）的信息量
+    };
+
+    struct Result {
+        int iterations = 0;
+        double initialError = 0.0;       ///< 加权残差平方和
+        double finalError = 0.0;
+    };
+
+    int addNode(const RigidTransform& pose);
+    void addEdge(const Edge& edge);
+    // 删除最后加入的边（回环边优化后残差仍过大时撤销）
+    void removeLastEdge() { if (!edges.empty()) edges.pop_back(); }
+
+    Result optimize(int maxIterations = 10);
+
+    // 单条边的残差 [ω, t]
+    void residual(const Edge& edge, double e[6]) const;
+
+    int nodeCount() const { return (int)poses.size(); }
+    const RigidTransform& pose(int node) const { return poses[node]; }
+    void setPose(int node, const RigidTransform& pose) { poses[node] = pose; }
+    const std::vector<RigidTransform>& allPoses() const { return poses; }
+    const std::vector<Edge>& allEdges() const { return edges; }
+    void clear() { poses.clear(); edges.clear(); }
+
+private:
+    double totalError() const;
+
+    std::vector<RigidTransform> poses;
+    std::vector<Edge> edges;
+};
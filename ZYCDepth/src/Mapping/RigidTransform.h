@@ -0,0 +1,114 @@
+﻿#pragma once
+#include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <cmath>
+
+/**
+ * @brief 刚体变换 x' = R·x + t（双精度，R 行主序）
+ * @details 用作外参时与 FrameData::extrinsics 约定一致：相机系 → 世界系（xw = R·xc + t）
+ */
+struct RigidTransform {
+    double R[9] = { 1, 0, 0, 0, 1, 0, 0, 0, 1 };
+    double t[3] = { 0, 0, 0 };
+
+    // 从 3x4 [R|t]（CV_32F 或 CV_64F）构造，R 重新正交化；形状不对时返回单位变换
+    static RigidTransform fromMat(const cv::Mat& Rt) {
+        RigidTransform T;
+        if (Rt.rows != 3 || Rt.cols != 4) return T;
+        const bool isDouble = Rt.depth() == CV_64F;
+        for (int r = 0; r < 3; ++r) {
+            for (int c = 0; c < 3; ++c) T.R[r * 3 + c] = isDouble ? Rt.at<double>(r, c) : Rt.at<float>(r, c);
+            T.t[r] = isDouble ? Rt.at<double>(r, 3) : Rt.at<float>(r, 3);
+        }
+        T.orthonormalize();
+        return T;
+    }
+
+    /**
+     * @brief 把 R 拉回正交矩阵（Gram-Schmidt：先单位化第 0 列，第 1 列去掉其分量，第 2 列取叉乘）
+     * @details 单精度外参的 R 本身就不严格正交，反复复合时 inverse()（转置）的误差会逐帧放大成尺度漂移，
+     *          链式复合得到的位姿在保存为下一帧的基准前都要调用
+     */
+    void orthonormalize() {
+        double c0[3] = { R[0], R[3], R[6] }, c1[3] = { R[1], R[4], R[7] };
+        const double n0 = std::sqrt(c0[0] * c0[0] + c0[1] * c0[1] + c0[2] * c0[2]);
+        if (n0 <= 1e-12) return;
+        for (double& v : c0) v /= n0;
+        const double proj = c0[0] * c1[0] + c0[1] * c1[1] + c0[2] * c1[2];
+        for (int i = 0; i < 3; ++i) c1[i] -= proj * c0[i];
+        const double n1 = std::sqrt(c1[0] * c1[0] + c1[1] * c1[1] + c1[2] * c1[2]);
+        if (n1 <= 1e-12) return;
+        for (double& v : c1) v /= n1;
+        const double c2[3] = { c0[1] * c1[2] - c0[2] * c1[1], c0[2] * c1[0] - c0[0] * c1[2], c0[0] * c1[1] - c0[1] * c1[0] };
+        for (int r = 0; r < 3; ++r) {
+            R[r * 3] = c0[r];
+            R[r * 3 + 1] = c1[r];
+            R[r * 3 + 2] = c2[r];
+        }
+    }
+
+    // 3x4 CV_32F [R|t]
+    cv::Mat toMat() const {
+        cv::Mat Rt(3, 4, CV_32F);
+        for (int r = 0; r < 3; ++r) {
+            for (int c = 0; c < 3; ++c) Rt.at<float>(r, c) = (float)R[r * 3 + c];
+            Rt.at<float>(r, 3) = (float)t[r];
+        }
+        return Rt;
+    }
+
+    /**
+     * @brief 小增量 [ω, τ]：R = exp(ω^)（Rodrigues，ω 为旋转向量，弧度），t = τ
+     * @details 与点到平面 ICP 的线性化 x' ≈ x + ω × x + τ 一致，增量左乘到当前估计上
+     */
+    static RigidTransform fromTwist(const double xi[6]) {
+        RigidTransform T;
+        const double theta = std::sqrt(xi[0] * xi[0] + xi[1] * xi[1] + xi[2] * xi[2]);
+        if (theta > 1e-12) {
+            const double kx = xi[0] / theta, ky = xi[1] / theta, kz = xi[2] / theta;
+            const double c = std::cos(theta), s = std::sin(theta), v = 1.0 - c;
+            T.R[0] = c + kx * kx * v;      T.R[1] = kx * ky * v - kz * s; T.R[2] = kx * kz * v + ky * s;
+            T.R[3] = ky * kx * v + kz * s; T.R[4] = c + ky * ky * v;      T.R[5] = ky * kz * v - kx * s;
+            T.R[6] = kz * kx * v - ky * s; T.R[7] = kz * ky * v + kx * s; T.R[8] = c + kz * kz * v;
+        }
+        T.t[0] = xi[3]; T.t[1] = xi[4]; T.t[2] = xi[5];
+        return T;
+    }
+
+    // fromTwist 的逆：xi = [ω, t]，ω 为旋转向量（转角接近 180° 时不准，只用于小残差）
+    void toTwist(double xi[6]) const {
+        const double angle = rotationAngle();
+        const double vx = (R[7] - R[5]) * 0.5, vy = (R[2] - R[6]) * 0.5, vz = (R[3] - R[1]) * 0.5;   // sin(θ)·k
+        const double s = std::sin(angle);
+        const double scale = s > 1e-9 ? angle / s : 1.0;
+        xi[0] = vx * scale; xi[1] = vy * scale; xi[2] = vz * scale;
+        xi[3] = t[0]; xi[4] = t[1]; xi[5] = t[2];
+    }
+
+    // 复合：(this * o)(x) = this(o(x))
+    RigidTransform operator*(const RigidTransform& o) const {
+        RigidTransform T;
+        for (int r = 0; r < 3; ++r) {
+            for (int c = 0; c < 3; ++c) {
+                T.R[r * 3 + c] = R[r * 3] * o.R[c] + R[r * 3 + 1] * o.R[3 + c] + R[r * 3 + 2] * o.R[6 + c];
+            }
+            T.t[r] = R[r * 3] * o.t[0] + R[r * 3 + 1] * o.t[1] + R[r * 3 + 2] * o.t[2] + t[r];
+        }
+        return T;
+    }
+
+    RigidTransform inverse() const {
+        RigidTransform T;
+        for (int r = 0; r < 3; ++r) {
+            for (int c = 0; c < 3; ++c) T.R[r * 3 + c] = R[c * 3 + r];
+        }
+        for (int r = 0; r < 3; ++r) T.t[r] = -(T.R[r * 3] * t[0] + T.R[r * 3 + 1] * t[1] + T.R[r * 3 + 2] * t[2]);
+        return T;
+    }
+
+    // 旋转角（弧度）与平移长度，用于衡量两个位姿的差异
+    double rotationAngle() const {
+        return std::acos(std::clamp((R[0] + R[4] + R[8] - 1.0) * 0.5, -1.0, 1.0));
+    }
+    double translationNorm() const { return std::sqrt(t[0] * t[0] + t[1] * t[1] + t[2] * t[2]); }
+};
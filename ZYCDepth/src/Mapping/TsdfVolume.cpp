@@ -0,0 +1,380 @@
+﻿#include "TsdfVolume.h"
+#include "Profiler/TraceProfiler.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <mutex>
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    double elapsedMs(Clock::time_point start) {
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+
+    // 内外参可能是 float 或 double（网络输出为 float，标定/基准可能给 double）
+    float valueAt(const cv::Mat& m, int r, int c) {
+        return m.depth() == CV_64F ? (float)m.at<double>(r, c) : m.at<float>(r, c);
+    }
+}
+
+TsdfVolume::TsdfVolume(const MappingConfig& config) {
+    configure(config);
+}
+
+bool TsdfVolume::configure(const MappingConfig& config) {
+    MappingConfig next = config;
+    next.voxelSize = std::max(0.005f, next.voxelSize);
+    next.truncationVoxels = std::max(1.0f, next.truncationVoxels);
+    next.maxWeight = std::max(1.0f, next.maxWeight);
+    next.allocationStride = std::max(1, next.allocationStride);
+    const bool reset = !blocks.empty() && (next.voxelSize != params.voxelSize || next.truncationVoxels != params.truncationVoxels);
+    params = next;
+    if (reset) clear();
+    return reset;
+}
+
+void TsdfVolume::clear() {
+    index.clear();
+    blocks.clear();
+    dirtyKeys.clear();
+    frames = 0;
+    currentAnchor = 0;
+    clearCount++;
+}
+
+std::vector<uint64_t> TsdfVolume::takeDirtyBlocks() {
+    compactDirtyBlocks();
+    std::vector<uint64_t> keys;
+    keys.swap(dirtyKeys);
+    return keys;
+}
+
+void TsdfVolume::compactDirtyBlocks() {
+    std::sort(dirtyKeys.begin(), dirtyKeys.end());
+    dirtyKeys.erase(std::unique(dirtyKeys.begin(), dirtyKeys.end()), dirtyKeys.end());
+}
+
+const TsdfBlock* TsdfVolume::findBlock(const BlockCoord& coord) const {
+    auto it = index.find(coord.key());
+    return it != index.end() ? blocks[it->second].get() : nullptr;
+}
+
+TsdfVolume::IntegrateStats TsdfVolume::integrate(const FrameData& depthFrame) {
+    if (!depthFrame.rawDepth || depthFrame.rawDepth->empty()) return {};
+    return integrate(*depthFrame.rawDepth, depthFrame.roi, depthFrame.intrinsics, depthFrame.extrinsics);
+}
+
+void TsdfVolume::collectTouchedBlocks(const cv::Mat& depth, const cv::Rect& roi, const cv::Mat& K,
+    const cv::Matx33f& R, const cv::Vec3f& t, std::vector<uint64_t>& keys) {
+    PointCloudBuilder::Options options;
+    options.stride = params.allocationStride;
+    options.minDepth = params.minDepth;
+    options.maxDepth = params.maxDepth;
+    options.world = false;
+    cloudBuilder.build(depth, roi, K, cv::Mat(), cv::Mat(), cv::Size(), options, cloud);
+
+    const float invBlock = 1.0f / blockSize();
+    const float step = blockSize() * 0.5f;   // 半个块长采样一次线段，最多漏掉线段擦过的块角
+    const float trunc = params.truncation();
+    constexpr int kPointsPerTask = 4096;
+    const int tasks = (int)((cloud.count + kPointsPerTask - 1) / kPointsPerTask);
+
+    std::mutex mergeMtx;
+    cv::parallel_for_(cv::Range(0, tasks), [&](const cv::Range& range) {
+        const size_t first = (size_t)range.start * kPointsPerTask;
+        const size_t end = std::min(cloud.count, (size_t)range.end * kPointsPerTask);
+        std::vector<uint64_t> local;
+        local.reserve((end - first) * 2);
+        for (size_t p = first; p < end; ++p) {
+            const float z = cloud.z[p];
+            const float rayX = cloud.x[p] / z, rayY = cloud.y[p] / z;
+            // 单位深度对应的世界系方向：相机系点 = ray * z
+            const float dx = R(0, 0) * rayX + R(0, 1) * rayY + R(0, 2);
+            const float dy = R(1, 0) * rayX + R(1, 1) * rayY + R(1, 2);
+            const float dz = R(2, 0) * rayX + R(2, 1) * rayY + R(2, 2);
+            const float nearZ = std::max(params.minDepth, z - trunc), farZ = z + trunc;
+            const float length = (farZ - nearZ) * std::sqrt(dx * dx + dy * dy + dz * dz);
+            const int samples = (int)std::ceil(length / step) + 1;
+            const float dStep = (farZ - nearZ) / (samples - 1);
+            uint64_t last = ~0ull;
+            for (int i = 0; i < samples; ++i) {
+                const float s = nearZ + i * dStep;
+                BlockCoord coord{ (int)std::floor((t[0] + dx * s) * invBlock), (int)std::floor((t[1] + dy * s) * invBlock),
+                    (int)std::floor((t[2] + dz * s) * invBlock) };
+                uint64_t key = coord.key();
+                if (key != last) local.push_back(key);
+                last = key;
+            }
+        }
+        // 相邻像素大多落在同一批块里，先在本地去重再合并，锁内只做一次追加
+        std::sort(local.begin(), local.end());
+        local.erase(std::unique(local.begin(), local.end()), local.end());
+        std::lock_guard<std::mutex> lock(mergeMtx);
+        keys.insert(keys.end(), local.begin(), local.end());
+    });
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+}
+
+TsdfVolume::IntegrateStats TsdfVolume::integrate(const cv::Mat& depth, const cv::Rect& roiIn, const cv::Mat& Kmat, const cv::Mat& Rt) {
+    ZYC_PROFILE_SCOPE("TsdfVolume::integrate");
+    IntegrateStats stats;
+    if (depth.empty() || depth.type() != CV_32FC1 || Kmat.rows != 3 || Kmat.cols != 3 || Rt.rows != 3 || Rt.cols != 4) return stats;
+    const cv::Rect roi = roiIn.empty() ? cv::Rect(0, 0, depth.cols, depth.rows) : roiIn;
+
+    cv::Matx33f K, R;
+    cv::Vec3f t;
+    for (int r = 0; r < 3; ++r) {
+        for (int c = 0; c < 3; ++c) {
+            K(r, c) = valueAt(Kmat, r, c);
+            R(r, c) = valueAt(Rt, r, c);
+        }
+        t[r] = valueAt(Rt, r, 3);
+    }
+    frames++;
+
+    // 1. 分配：找出截断带经过的体素块，新块在这里串行插入哈希（之后的并行融合不再改动索引）
+    auto start = Clock::now();
+    touchedKeys.clear();
+    collectTouchedBlocks(depth, roi, Kmat, R, t, touchedKeys);
+    touched.clear();
+    touched.reserve(touchedKeys.size());
+    for (uint64_t key : touchedKeys) {
+        auto [it, inserted] = index.try_emplace(key, (uint32_t)blocks.size());
+        if (inserted) {
+            auto block = std::make_unique<TsdfBlock>();
+            block->coord = BlockCoord::fromKey(key);
+            block->anchor = currentAnchor;
+            blocks.push_back(std::move(block));
+            stats.newBlocks++;
+        }
+        touched.push_back(blocks[it->second].get());
+    }
+    stats.touchedBlocks = touched.size();
+    stats.allocateMs = elapsedMs(start);
+
+    // 2. 融合：按块并行，块之间没有共享写入
+    start = Clock::now();
+    const float fx = K(0, 0), fy = K(1, 1), cx = K(0, 2), cy = K(1, 2);
+    const float invSx = (float)depth.cols / roi.width, invSy = (float)depth.rows / roi.height;
+    const float voxel = params.voxelSize;
+    const float trunc = params.truncation(), invTrunc = 1.0f / trunc;
+    const uint64_t frame = frames;
+    cv::parallel_for_(cv::Range(0, (int)touched.size()), [&](const cv::Range& range) {
+        for (int b = range.start; b < range.end; ++b) {
+            TsdfBlock& block = *touched[b];
+            // 第一个体素中心变换到相机系：xc = Rᵀ(xw − t)；沿世界系三个轴每走一个体素，相机系坐标增加 Rᵀ 的一列
+            const cv::Vec3f world((block.coord.x * TsdfBlock::kSide + 0.5f) * voxel - t[0],
+                (block.coord.y * TsdfBlock::kSide + 0.5f) * voxel - t[1], (block.coord.z * TsdfBlock::kSide + 0.5f) * voxel - t[2]);
+            cv::Vec3f origin, axis[3];
+            for (int r = 0; r < 3; ++r) {
+                origin[r] = R(0, r) * world[0] + R(1, r) * world[1] + R(2, r) * world[2];
+                for (int a = 0; a < 3; ++a) axis[a][r] = R(a, r) * voxel;
+            }
+            bool updated = false;
+            int i = 0;
+            for (int z = 0; z < TsdfBlock::kSide; ++z) {
+                for (int y = 0; y < TsdfBlock::kSide; ++y) {
+                    const float rowX = origin[0] + axis[2][0] * z + axis[1][0] * y;
+                    const float rowY = origin[1] + axis[2][1] * z + axis[1][1] * y;
+                    const float rowZ = origin[2] + axis[2][2] * z + axis[1][2] * y;
+                    for (int x = 0; x < TsdfBlock::kSide; ++x, ++i) {
+                        const float pz = rowZ + axis[0][2] * x;
+                        if (pz <= params.minDepth) continue;
+                        const float invZ = 1.0f / pz;
+                        // 投影到原图像素，再映射到深度图像素（最近邻）
+                        const float du = ((rowX + axis[0][0] * x) * fx * invZ + cx + 0.5f - roi.x) * invSx;
+                        const float dv = ((rowY + axis[0][1] * x) * fy * invZ + cy + 0.5f - roi.y) * invSy;
+                        if (!(du >= 0.0f && dv >= 0.0f && du < depth.cols && dv < depth.rows)) continue;
+                        const float d = depth.ptr<float>((int)dv)[(int)du];
+                        if (!(d > params.minDepth && d <= params.maxDepth)) continue;
+                        const float sdf = d - pz;
+                        if (sdf < -trunc) continue;   // 表面后方被遮挡，不更新
+                        const float value = std::min(1.0f, sdf * invTrunc);
+                        TsdfVoxel& v = block.voxels[i];
+                        v.tsdf = (v.tsdf * v.weight + value) / (v.weight + 1.0f);
+                        v.weight = std::min(v.weight + 1.0f, params.maxWeight);
+                        updated = true;
+                    }
+                }
+            }
+            if (updated) block.integratedFrame = frame;
+        }
+    });
+    for (const TsdfBlock* block : touched) {
+        if (block->integratedFrame == frame) dirtyKeys.push_back(block->coord.key());
+    }
+    // 长时间没人取（未开启网格提取）时去重，列表不超过块数
+    if (dirtyKeys.size() > 2 * blocks.size() + 4096) compactDirtyBlocks();
+    stats.integrateMs = elapsedMs(start);
+    return stats;
+}
+
+TsdfVolume::ReanchorStats TsdfVolume::reanchor(const std::vector<std::pair<uint32_t, RigidTransform>>& corrections) {
+    ZYC_PROFILE_SCOPE("TsdfVolume::reanchor");
+    ReanchorStats stats;
+    const auto start = Clock::now();
+    const double voxel = params.voxelSize;
+    const double half = blockSize() * 0.5;
+
+    // 只搬动块中心位移超过 0.25 个体素的关键帧：小校正留给后续融合慢慢修
+    std::unordered_map<uint32_t, size_t> groupOf;
+    for (size_t g = 0; g < corrections.size(); ++g) {
+        if (corrections[g].first == 0) continue;
+        groupOf[corrections[g].first] = g;
+    }
+    std::vector<std::vector<std::unique_ptr<TsdfBlock>>> groups(corrections.size());
+    std::vector<std::unique_ptr<TsdfBlock>> kept;
+    kept.reserve(blocks.size());
+    for (auto& block : blocks) {
+        auto it = groupOf.find(block->anchor);
+        bool move = false;
+        if (it != groupOf.end()) {
+            const RigidTransform& C = corrections[it->second].second;
+            const double c[3] = { block->coord.x * 2.0 * half + half, block->coord.y * 2.0 * half + half, block->coord.z * 2.0 * half + half };
+            double moved = 0.0;
+            for (int r = 0; r < 3; ++r) {
+                const double d = C.R[r * 3] * c[0] + C.R[r * 3 + 1] * c[1] + C.R[r * 3 + 2] * c[2] + C.t[r] - c[r];
+                moved += d * d;
+            }
+            move = moved > 0.0625 * voxel * voxel;
+        }
+        if (move) {
+            dirtyKeys.push_back(block->coord.key());
+            groups[it->second].push_back(std::move(block));
+        }
+        else {
+            kept.push_back(std::move(block));
+        }
+    }
+    blocks.swap(kept);
+    index.clear();
+    for (uint32_t i = 0; i < (uint32_t)blocks.size(); ++i) index.emplace(blocks[i]->coord.key(), i);
+
+    const float maxWeight = params.maxWeight;
+    for (size_t g = 0; g < groups.size(); ++g) {
+        auto& group = groups[g];
+        if (group.empty()) continue;
+        stats.movedBlocks += group.size();
+        const RigidTransform& C = corrections[g].second;
+        const RigidTransform inverse = C.inverse();
+
+        std::unordered_map<uint64_t, const TsdfBlock*, BlockKeyHash> source;
+        source.reserve(group.size() * 2);
+        for (const auto& block : group) source.emplace(block->coord.key(), block.get());
+
+        // 目标块：每个旧块 8 个角点变换后的包围盒覆盖的块
+        std::vector<uint64_t> targets;
+        const double side = 2.0 * half;
+        for (const auto& block : group) {
+            double lo[3] = { 1e30, 1e30, 1e30 }, hi[3] = { -1e30, -1e30, -1e30 };
+            for (int corner = 0; corner < 8; ++corner) {
+                const double p[3] = { (block->coord.x + (corner & 1)) * side, (block->coord.y + ((corner >> 1) & 1)) * side,
+                    (block->coord.z + (corner >> 2)) * side };
+                for (int r = 0; r < 3; ++r) {
+                    const double q = C.R[r * 3] * p[0] + C.R[r * 3 + 1] * p[1] + C.R[r * 3 + 2] * p[2] + C.t[r];
+                    lo[r] = std::min(lo[r], q);
+                    hi[r] = std::max(hi[r], q);
+                }
+            }
+            const int x0 = (int)std::floor(lo[0] / side), x1 = (int)std::floor(hi[0] / side);
+            const int y0 = (int)std::floor(lo[1] / side), y1 = (int)std::floor(hi[1] / side);
+            const int z0 = (int)std::floor(lo[2] / side), z1 = (int)std::floor(hi[2] / side);
+            for (int z = z0; z <= z1; ++z) {
+                for (int y = y0; y <= y1; ++y) {
+                    for (int x = x0; x <= x1; ++x) targets.push_back(BlockCoord{ x, y, z }.key());
+                }
+            }
+        }
+        std::sort(targets.begin(), targets.end());
+        targets.erase(std::unique(targets.begin(), targets.end()), targets.end());
+
+        // 逐目标块并行重采样：体素中心经 C⁻¹ 回到旧位置，在旧块上三线性插值（只用观测过的邻点，系数重新归一化）
+        std::vector<std::unique_ptr<TsdfBlock>> resampled(targets.size());
+        cv::parallel_for_(cv::Range(0, (int)targets.size()), [&](const cv::Range& range) {
+            uint64_t cachedKey = ~0ull;
+            const TsdfBlock* cached = nullptr;
+            auto voxelAt = [&](int gx, int gy, int gz) -> const TsdfVoxel* {
+                const BlockCoord coord{ (int)std::floor(gx / (double)TsdfBlock::kSide), (int)std::floor(gy / (double)TsdfBlock::kSide),
+                    (int)std::floor(gz / (double)TsdfBlock::kSide) };
+                const uint64_t key = coord.key();
+                if (key != cachedKey) {   // 相邻体素大多落在同一个旧块里
+                    auto it = source.find(key);
+                    cached = it != source.end() ? it->second : nullptr;
+                    cachedKey = key;
+                }
+                if (!cached) return nullptr;
+                const TsdfVoxel& v = cached->voxels[TsdfBlock::index(gx - coord.x * TsdfBlock::kSide,
+                    gy - coord.y * TsdfBlock::kSide, gz - coord.z * TsdfBlock::kSide)];
+                return v.weight > 0.0f ? &v : nullptr;
+            };
+
+            for (int b = range.start; b < range.end; ++b) {
+                auto block = std::make_unique<TsdfBlock>();
+                block->coord = BlockCoord::fromKey(targets[b]);
+                bool observed = false;
+                int i = 0;
+                for (int z = 0; z < TsdfBlock::kSide; ++z) {
+                    for (int y = 0; y < TsdfBlock::kSide; ++y) {
+                        for (int x = 0; x < TsdfBlock::kSide; ++x, ++i) {
+                            const double p[3] = { (block->coord.x * TsdfBlock::kSide + x + 0.5) * voxel,
+                                (block->coord.y * TsdfBlock::kSide + y + 0.5) * voxel, (block->coord.z * TsdfBlock::kSide + z + 0.5) * voxel };
+                            // 旧位置的体素网格坐标（以体素中心为整数点）
+                            double g[3];
+                            for (int r = 0; r < 3; ++r) {
+                                g[r] = (inverse.R[r * 3] * p[0] + inverse.R[r * 3 + 1] * p[1] + inverse.R[r * 3 + 2] * p[2] + inverse.t[r]) / voxel - 0.5;
+                            }
+                            const int gx = (int)std::floor(g[0]), gy = (int)std::floor(g[1]), gz = (int)std::floor(g[2]);
+                            const double fx = g[0] - gx, fy = g[1] - gy, fz = g[2] - gz;
+                            double sum = 0.0, tsdf = 0.0, weight = 0.0;
+                            for (int n = 0; n < 8; ++n) {
+                                const int dx = n & 1, dy = (n >> 1) & 1, dz = n >> 2;
+                                const TsdfVoxel* v = voxelAt(gx + dx, gy + dy, gz + dz);
+                                if (!v) continue;
+                                const double a = (dx ? fx : 1.0 - fx) * (dy ? fy : 1.0 - fy) * (dz ? fz : 1.0 - fz);
+                                sum += a;
+                                tsdf += a * v->tsdf;
+                                weight += a * v->weight;
+                            }
+                            if (sum < 0.5) continue;   // 大半邻点未观测：留空，避免把表面边缘外推出去
+                            TsdfVoxel& out = block->voxels[i];
+                            out.tsdf = (float)(tsdf / sum);
+                            out.weight = (float)(weight / sum);
+                            observed = true;
+                        }
+                    }
+                }
+                if (observed) resampled[b] = std::move(block);
+            }
+        });
+
+        // 串行写回：已有块按权重合并，否则插入
+        for (auto& block : resampled) {
+            if (!block) continue;
+            block->anchor = corrections[g].first;
+            block->integratedFrame = frames;
+            const uint64_t key = block->coord.key();
+            auto [it, inserted] = index.try_emplace(key, (uint32_t)blocks.size());
+            if (inserted) {
+                blocks.push_back(std::move(block));
+            }
+            else {
+                TsdfBlock& existing = *blocks[it->second];
+                for (int i = 0; i < TsdfBlock::kVoxels; ++i) {
+                    const TsdfVoxel& in = block->voxels[i];
+                    TsdfVoxel& out = existing.voxels[i];
+                    if (in.weight <= 0.0f) continue;
+                    out.tsdf = (out.tsdf * out.weight + in.tsdf * in.weight) / (out.weight + in.weight);
+                    out.weight = std::min(out.weight + in.weight, maxWeight);
+                }
+                existing.integratedFrame = frames;
+            }
+            dirtyKeys.push_back(key);
+            stats.writtenBlocks++;
+        }
+    }
+    compactDirtyBlocks();
+    stats.ms = elapsedMs(start);
+    return stats;
+}
@@ -0,0 +1,160 @@
+﻿#pragma once
+#include <opencv2/opencv.hpp>
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "Data/CommonTypes.h"
+#include "Data/PointCloud.h"
+#include "Mapping/RigidTransform.h"
+
+/**
+ * @brief 体素块坐标（以块为单位的整数网格坐标）
+ * @details 打包成 64 位键：每轴 21 位有符号，体素 0.1 m 时覆盖 ±83 km
+ */
+struct BlockCoord {
+    int x = 0, y = 0, z = 0;
+
+    bool operator==(const BlockCoord& other) const { return x == other.x && y == other.y && z == other.z; }
+    bool operator!=(const BlockCoord& other) const { return !(*this == other); }
+
+    uint64_t key() const {
+        return ((uint64_t)(x & 0x1FFFFF) << 42) | ((uint64_t)(y & 0x1FFFFF) << 21) | (uint64_t)(z & 0x1FFFFF);
+    }
+    static BlockCoord fromKey(uint64_t key) {
+        // 21 位补码还原成 int：左移到最高位再算术右移
+        auto axis = [](uint64_t bits) { return (int)((int64_t)(bits << 43) >> 43); };
+        return { axis(key >> 42), axis(key >> 21), axis(key) };
+    }
+};
+
+/**
+ * @brief 空间哈希：经典的三素数异或（Teschner 2003），相邻块分散到不同桶
+ */
+struct BlockKeyHash {
+    size_t operator()(uint64_t key) const {
+        BlockCoord c = BlockCoord::fromKey(key);
+        return (size_t)((uint64_t)c.x * 73856093u ^ (uint64_t)c.y * 19349663u ^ (uint64_t)c.z * 83492791u);
+    }
+};
+
+/**
+ * @brief 截断符号距离体素
+ */
+struct TsdfVoxel {
+    float tsdf = 1.0f;     ///< 归一化到 [-1, 1] 的截断符号距离，正值在表面前方（自由空间）
+    float weight = 0.0f;   ///< 融合权重，0 表示从未观测
+};
+
+/**
+ * @brief 8³ 体素块，体素按 x 最快、z 最慢排列
+ */
+struct TsdfBlock {
+    static constexpr int kSide = 8;
+    static constexpr int kVoxels = kSide * kSide * kSide;
+
+    BlockCoord coord;
+    uint64_t integratedFrame = 0;    ///< 最近一次有体素被更新的帧号（增量提取网格时据此判断是否变脏）
+    uint32_t anchor = 0;             ///< 首次分配该块的关键帧 id（0 为未启用关键帧），回环校正时随该关键帧移动
+    std::array<TsdfVoxel, kVoxels> voxels;
+
+    static int index(int x, int y, int z) { return (z * kSide + y) * kSide + x; }
+};
+
+/**
+ * @brief 体素哈希 TSDF 融合（建图阶段独占，非线程安全）
+ * @details 地图只在观测到的表面附近稀疏存储：8³ 体素块按块坐标哈希索引到连续的块数组，
+ *          内存与计算量随表面面积增长，而不是随包围盒体积增长。每帧分两步：
+ *          1. 分配：深度图按步长采样，每个像素沿视线取深度前后各一个截断距离的线段，
+ *             线段经过的体素块即本帧“触及”的块（必然在视锥内），不存在的新建；
+ *          2. 融合：只遍历触及的块，按块并行（cv::parallel_for_），块内每个体素投影回深度图，
+ *             用 (观测深度 − 体素深度) 更新加权平均的截断符号距离。
+ *          单帧耗时只取决于视野内的表面，与地图总大小无关（哈希查找 O(1)），见 --bench-tsdf。
+ *
+ *          坐标约定与点云回投一致：外参 [R|t] 把相机系变换到世界系（xw = R·xc + t），
+ *          内参在原图像素坐标系下，深度像素经 FrameData::roi 映射回原图像素；深度 z <= 0（排除区域）跳过。
+ */
+class TsdfVolume {
+public:
+    explicit TsdfVolume(const MappingConfig& config);
+
+    struct IntegrateStats {
+        size_t touchedBlocks = 0;    ///< 本帧融合的体素块数
+        size_t newBlocks = 0;        ///< 本帧新分配的体素块数
+        double allocateMs = 0.0;
+        double integrateMs = 0.0;
+    };
+
+    // 融合一个深度帧（rawDepth + 内外参 + roi），缺少任一项时什么都不做
+    IntegrateStats integrate(const FrameData& depthFrame);
+
+    /**
+     * @brief 融合一张深度图
+     * @param depth CV_32F 深度图（米）
+     * @param roi 深度图覆盖的原图区域（像素），为空时认为深度图就是整幅原图
+     * @param K 3x3 内参（原图像素坐标），CV_32F 或 CV_64F
+     * @param Rt 3x4 相机到世界的外参，CV_32F 或 CV_64F
+     */
+    IntegrateStats integrate(const cv::Mat& depth, const cv::Rect& roi, const cv::Mat& K, const cv::Mat& Rt);
+
+    struct ReanchorStats {
+        size_t movedBlocks = 0;      ///< 被搬走的旧块数
+        size_t writtenBlocks = 0;    ///< 重采样后写入（新建或合并）的块数
+        double ms = 0.0;
+    };
+
+    // 之后 integrate 新分配的块归属该关键帧
+    void setAnchor(uint32_t keyframe) { currentAnchor = keyframe; }
+
+    /**
+     * @brief 回环校正后把各关键帧的块刚性搬到新位置，不重新融合深度
+     * @param corrections 关键帧 id → 校正量 C（世界系，x' = C·x）
+     * @details 块中心位移不足 0.25 个体素的关键帧不动。要动的块先从哈希中取出（旧位置标脏，网格随之删除），
+     *          按关键帧分组：变换后包围盒覆盖的目标块逐体素用 C⁻¹ 映射回旧位置三线性插值（按目标块并行），
+     *          再串行写回——目标位置已有块（别的关键帧的、或本次搬来的）时按权重加权平均合并
+     */
+    ReanchorStats reanchor(const std::vector<std::pair<uint32_t, RigidTransform>>& corrections);
+
+    /**
+     * @brief 更新参数
+     * @details 体素尺寸或截断距离变化时已有体素失去意义，清空地图并返回 true；其余参数直接生效
+     */
+    bool configure(const MappingConfig& config);
+    void clear();
+
+    const MappingConfig& config() const { return params; }
+    float blockSize() const { return params.voxelSize * TsdfBlock::kSide; }
+    size_t blockCount() const { return blocks.size(); }
+    size_t memoryBytes() const { return blocks.size() * sizeof(TsdfBlock); }
+    uint64_t frameCount() const { return frames; }
+    uint64_t generation() const { return clearCount; }   ///< 每次清空地图递增，块坐标与网格分块随之失效
+
+    // 取走上次调用以来有体素被更新的块（已去重），供增量提取网格
+    std::vector<uint64_t> takeDirtyBlocks();
+
+    // 按块坐标查找，不存在时返回 nullptr
+    const TsdfBlock* findBlock(const BlockCoord& coord) const;
+    const std::vector<std::unique_ptr<TsdfBlock>>& allBlocks() const { return blocks; }
+
+private:
+    // 分配步骤：返回本帧触及的块（已去重）；按 allocationStride 回投成相机系点云后沿每点视线的截断带采样
+    void collectTouchedBlocks(const cv::Mat& depth, const cv::Rect& roi, const cv::Mat& K,
+        const cv::Matx33f& R, const cv::Vec3f& t, std::vector<uint64_t>& keys);
+    void compactDirtyBlocks();
+
+    MappingConfig params;
+    uint64_t frames = 0;
+    uint64_t clearCount = 0;
+    uint32_t currentAnchor = 0;
+    std::vector<uint64_t> dirtyKeys;                               ///< 各帧融合更新过的块，可能重复
+    std::unordered_map<uint64_t, uint32_t, BlockKeyHash> index;   ///< 块键 → blocks 下标
+    std::vector<std::unique_ptr<TsdfBlock>> blocks;                ///< 块数组（指针稳定，扩容不搬动体素）
+
+    // 复用的中间缓冲
+    std::vector<uint64_t> touchedKeys;
+    std::vector<TsdfBlock*> touched;
+    PointCloudBuilder cloudBuilder;
+    PointCloud cloud;
+};
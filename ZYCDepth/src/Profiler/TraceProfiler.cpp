@@ -0,0 +1,119 @@
+﻿#include "TraceProfiler.h"
+#include "Log/Logger.h"
+#include <algorithm>
+#include <cstdio>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <nlohmann/json.hpp>
+
+std::atomic<bool> TraceProfiler::enabled{ true };
+
+TraceProfiler& TraceProfiler::getInstance() {
+    static TraceProfiler instance;
+    return instance;
+}
+
+namespace {
+    int64_t steadyNs() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+}
+
+TraceProfiler::TraceProfiler() : epochTicks(ticks()), epochNs(steadyNs()) {}
+
+TraceProfiler::ThreadBuffer* TraceProfiler::registerThread() {
+    TraceProfiler& profiler = getInstance();
+    auto buffer = std::make_unique<ThreadBuffer>();
+    std::lock_guard<std::mutex> lock(profiler.mtx);
+    buffer->tid = (uint32_t)profiler.buffers.size() + 1;
+    buffer->name = "thread-" + std::to_string(buffer->tid);
+    localBuffer = buffer.get();
+    profiler.buffers.push_back(std::move(buffer));
+    return localBuffer;
+}
+
+double TraceProfiler::nsPerTick() const {
+#if defined(_M_X64) || defined(__x86_64__)
+    int64_t elapsedTicks = ticks() - epochTicks;
+    int64_t elapsedNs = steadyNs() - epochNs;
+    return elapsedTicks > 0 ? (double)elapsedNs / elapsedTicks : 1.0;
+#else
+    return 1.0;
+#endif
+}
+
+void TraceProfiler::setThreadName(const std::string& name) {
+    ThreadBuffer* buffer = localBuffer ? localBuffer : registerThread();
+    std::lock_guard<std::mutex> lock(getInstance().mtx);
+    buffer->name = name;
+}
+
+const char* TraceProfiler::intern(const std::string& name) {
+    TraceProfiler& profiler = getInstance();
+    std::lock_guard<std::mutex> lock(profiler.mtx);
+    for (const auto& s : profiler.interned) {
+        if (*s == name) return s->c_str();
+    }
+    profiler.interned.push_back(std::make_unique<std::string>(name));
+    return profiler.interned.back()->c_str();
+}
+
+std::string TraceProfiler::dump(const std::string& path) {
+    struct Span { const char* name; int64_t start; int64_t duration; };
+    nlohmann::json events = nlohmann::json::array();
+    const double scale = nsPerTick();
+    size_t spanCount = 0;
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        for (const auto& buffer : buffers) {
+            events.push_back({ {"name", "thread_name"}, {"ph", "M"}, {"pid", 1}, {"tid", buffer->tid},
+                {"args", { {"name", buffer->name} }} });
+
+            // 边读边写：先取写指针拷贝，再用新的写指针剔除拷贝期间可能被覆盖的槽位
+            uint64_t head = buffer->head.load(std::memory_order_acquire);
+            uint64_t begin = head > kEventsPerThread ? head - kEventsPerThread : 0;
+            std::vector<Span> spans;
+            spans.reserve((size_t)(head - begin));
+            for (uint64_t i = begin; i < head; ++i) {
+                const Event& e = buffer->events[i % kEventsPerThread];
+                spans.push_back({ e.name.load(std::memory_order_relaxed), e.start.load(std::memory_order_relaxed),
+                    e.duration.load(std::memory_order_relaxed) });
+            }
+            // 写者此刻可能正在写第 newHead 个事件（槽位与第 newHead - kEventsPerThread 个相同），它之前的都已被覆盖
+            uint64_t newHead = buffer->head.load(std::memory_order_acquire);
+            uint64_t validFrom = newHead >= kEventsPerThread ? newHead - kEventsPerThread + 1 : 0;
+            for (uint64_t i = std::max(begin, validFrom); i < head; ++i) {
+                const Span& s = spans[(size_t)(i - begin)];
+                if (!s.name) continue;
+                events.push_back({ {"name", s.name}, {"ph", "X"}, {"pid", 1}, {"tid", buffer->tid},
+                    {"ts", (s.start - epochTicks) * scale / 1000.0}, {"dur", s.duration * scale / 1000.0} });
+                spanCount++;
+            }
+        }
+    }
+
+    std::string outPath = path;
+    if (outPath.empty()) {
+        std::time_t now = std::time(nullptr);
+        char stamp[32];
+        std::strftime(stamp, sizeof(stamp), "%Y%m%d_%H%M%S", std::localtime(&now));
+        outPath = std::string("traces/trace_") + stamp + ".json";
+    }
+    try {
+        std::filesystem::path p(outPath);
+        if (p.has_parent_path()) std::filesystem::create_directories(p.parent_path());
+        std::ofstream out(p, std::ios::binary);
+        if (!out) {
+            LOG_ERR("时间线导出失败，无法写入: " + outPath);
+            return "";
+        }
+        out << nlohmann::json{ {"traceEvents", std::move(events)}, {"displayTimeUnit", "ms"} }.dump();
+    }
+    catch (const std::exception& e) {
+        LOG_ERR("时间线导出失败: " + std::string(e.what()));
+        return "";
+    }
+    LOG_INFO("时间线已导出: " + outPath + " (" + std::to_string(spanCount) + " 个区间)", true);
+    return outPath;
+}
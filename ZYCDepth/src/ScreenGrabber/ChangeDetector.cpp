@@ -0,0 +1,41 @@
+﻿#include "ChangeDetector.h"
+#include "Profiler/TraceProfiler.h"
+#include <cmath>
+
+bool ChangeDetector::update(const cv::Mat& frame, double threshold, int refreshMs, const std::vector<cv::Rect>& ignore) {
+    ZYC_PROFILE_SCOPE("ChangeDetector::update");
+    if (threshold < 0.0 || frame.empty()) return true;
+
+    // 先缩小再转灰度：颜色转换只处理缩略图
+    cv::resize(frame, thumbColor, cv::Size(kThumbWidth, kThumbHeight), 0, 0, cv::INTER_AREA);
+    switch (thumbColor.channels()) {
+    case 4: cv::cvtColor(thumbColor, thumb, cv::COLOR_BGRA2GRAY); break;
+    case 3: cv::cvtColor(thumbColor, thumb, cv::COLOR_BGR2GRAY); break;
+    default: thumbColor.copyTo(thumb); break;
+    }
+
+    auto now = std::chrono::steady_clock::now();
+    bool changed = keyThumb.empty() || keyThumb.size() != thumb.size();
+    if (!changed) {
+        // INTER_AREA 缩到网格尺寸即各格的平均差
+        cv::absdiff(thumb, keyThumb, diff);
+        // 忽略区域按缩略图比例向外取整后清零
+        const double sx = (double)kThumbWidth / frame.cols, sy = (double)kThumbHeight / frame.rows;
+        for (const auto& rect : ignore) {
+            int x0 = (int)(rect.x * sx), y0 = (int)(rect.y * sy);
+            int x1 = (int)std::ceil((rect.x + rect.width) * sx), y1 = (int)std::ceil((rect.y + rect.height) * sy);
+            cv::Rect cell = cv::Rect(x0, y0, x1 - x0, y1 - y0) & cv::Rect(0, 0, diff.cols, diff.rows);
+            if (!cell.empty()) diff(cell).setTo(0);
+        }
+        cv::resize(diff, tiles, cv::Size(kTilesX, kTilesY), 0, 0, cv::INTER_AREA);
+        double minDiff = 0.0;
+        cv::minMaxLoc(tiles, &minDiff, &lastDifference);
+        changed = lastDifference > threshold;
+        if (!changed && refreshMs > 0 && now - keyTime >= std::chrono::milliseconds(refreshMs)) changed = true;
+    }
+    if (changed) {
+        thumb.copyTo(keyThumb);
+        keyTime = now;
+    }
+    return changed;
+}
@@ -0,0 +1,41 @@
+﻿#pragma once
+#include <opencv2/opencv.hpp>
+#include <chrono>
+#include <vector>
+
+/**
+ * @brief 画面变化检测（截图线程使用，非线程安全）
+ * @details 把帧缩成 128x72 灰度缩略图，与“上一个关键帧”（上一次判定为变化、送去推理的帧）逐像素求绝对差，
+ *          再按 16x9 的网格取每格平均差，任一格超过阈值即视为变化。
+ *          - 按格判定：菜单里一个小图标动了也能检测到，整屏的编码噪声/抖动又不会触发
+ *          - 与关键帧而不是上一帧比较：缓慢的渐变会累积到超过阈值，不会一直被判为静止
+ *          缩放、求差、按格平均都是 OpenCV 的 SIMD 实现，1080p 每帧开销在 0.2 ms 量级，远小于一次推理。
+ */
+class ChangeDetector {
+public:
+    /**
+     * @brief 判断当前帧相对上一个关键帧是否变化，变化时当前帧成为新的关键帧
+     * @param frame 原图 (BGRA / BGR / 灰度)，一般是 ROI 视图
+     * @param threshold 每格平均灰度差阈值 (0~255)，小于 0 时关闭检测（总是返回 true）
+     * @param refreshMs 静止时至少每隔多久强制判为变化一次（让模型加载、开关推理后也能拿到最新深度），<=0 不强制
+     * @param ignore 忽略的区域（frame 内的像素坐标，如 HUD 排除区域），其中的变化不计
+     */
+    bool update(const cv::Mat& frame, double threshold, int refreshMs, const std::vector<cv::Rect>& ignore = {});
+
+    // 最近一次计算的最大格差（调参用）
+    double getLastDifference() const { return lastDifference; }
+
+    // 丢弃关键帧，下一帧必定判为变化（截图配置变更时调用）
+    void reset() { keyThumb.release(); }
+
+private:
+    static constexpr int kThumbWidth = 128;
+    static constexpr int kThumbHeight = 72;
+    static constexpr int kTilesX = 16;
+    static constexpr int kTilesY = 9;
+
+    cv::Mat keyThumb;   ///< 关键帧缩略图 (CV_8UC1)
+    cv::Mat thumbColor, thumb, diff, tiles;  ///< 复用的中间缓冲
+    std::chrono::steady_clock::time_point keyTime{};
+    double lastDifference = 0.0;
+};
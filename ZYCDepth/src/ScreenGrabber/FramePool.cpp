@@ -0,0 +1,90 @@
+﻿#include "FramePool.h"
+
+std::shared_ptr<FramePool> FramePool::create(size_t capacity) {
+    return std::shared_ptr<FramePool>(new FramePool(capacity));
+}
+
+FramePool::FramePool(size_t capacity) : capacity(capacity) {
+    freeList.reserve(capacity);
+}
+
+FramePool::~FramePool() {
+    for (cv::Mat* mat : freeList) delete mat;
+    freeList.clear();
+}
+
+std::shared_ptr<cv::Mat> FramePool::acquire(cv::Size size, int type) {
+    cv::Mat* mat = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        while (!freeList.empty()) {
+            cv::Mat* candidate = freeList.back();
+            freeList.pop_back();
+            if (candidate->size() == size && candidate->type() == type) {
+                mat = candidate;
+                break;
+            }
+            // 窗口尺寸变了，旧尺寸的缓冲直接丢弃
+            delete candidate;
+            allocated--;
+        }
+        if (!mat) {
+            // 所有缓冲都被下游持有：丢帧而不是继续分配，避免消费者卡住时内存无限增长
+            if (allocated >= capacity) {
+                exhausted++;
+                return nullptr;
+            }
+            allocated++;
+        }
+    }
+
+    if (mat) {
+        hits++;
+    }
+    else {
+        misses++;
+        mat = new cv::Mat();
+        if (size.area() > 0) mat->create(size, type);
+    }
+    inFlight++;
+
+    std::weak_ptr<FramePool> weakPool = weak_from_this();
+    return std::shared_ptr<cv::Mat>(mat, [weakPool](cv::Mat* m) {
+        if (auto pool = weakPool.lock()) {
+            pool->release(m);
+        }
+        else {
+            delete m;
+        }
+        });
+}
+
+void FramePool::release(cv::Mat* mat) {
+    inFlight--;
+    // 有人通过 cv::Mat 头拷贝仍引用着这块像素（引用计数 > 1），不能复用，否则会被下一帧覆盖。
+    // 其他线程用 CV_XADD 增减引用计数，这里同样用原子操作读取（加 0）
+    bool reusable = !mat->empty() && mat->u && CV_XADD(&mat->u->refcount, 0) == 1;
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        if (reusable) {
+            freeList.push_back(mat);
+            return;
+        }
+        // 不可复用的缓冲交给仍持有像素的 Mat 头释放，不再计入池的容量
+        allocated--;
+    }
+    delete mat;
+}
+
+FramePoolStats FramePool::getStats() const {
+    FramePoolStats stats;
+    stats.hits = hits.load();
+    stats.misses = misses.load();
+    stats.exhausted = exhausted.load();
+    stats.inFlight = inFlight.load();
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        stats.pooled = freeList.size();
+    }
+    return stats;
+}
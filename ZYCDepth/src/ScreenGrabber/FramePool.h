@@ -0,0 +1,52 @@
+﻿#pragma once
+#include "Data/CommonTypes.h"
+#include <opencv2/opencv.hpp>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+/**
+ * @brief 固定容量的帧缓冲池
+ * @details 截图线程每帧从池中取出一块 cv::Mat 直接写入像素，返回的 shared_ptr 带自定义删除器：
+ *          推理线程、Web 广播、UI 等所有持有者都释放后，缓冲自动归还到池中复用，
+ *          避免高分辨率下每帧数十 MB 的分配/释放抖动。
+ *          池管理的缓冲总数（借出 + 空闲）不超过 capacity，下游积压时 acquire 失败、截图丢帧，内存不会无限增长。
+ *          池本身由 shared_ptr 管理，删除器只持有 weak_ptr，池先于帧销毁也是安全的。
+ */
+class FramePool : public std::enable_shared_from_this<FramePool> {
+public:
+    /**
+     * @brief 创建帧池
+     * @param capacity 池管理的缓冲总数上限（借出 + 空闲）
+     */
+    static std::shared_ptr<FramePool> create(size_t capacity = 16);
+    ~FramePool();
+
+    /**
+     * @brief 取出一块缓冲
+     * @param size 期望尺寸（通常为上一帧尺寸，未知时传空尺寸）
+     * @param type 期望像素类型
+     * @return 尺寸/类型匹配的空闲缓冲（命中），或新分配的缓冲（未命中）；
+     *         已借出 capacity 块时返回 nullptr，调用方应丢弃本帧
+     * @details 返回的 Mat 内容未定义，调用方应通过 create()/copyTo() 写入；
+     *          尺寸不符时 create() 会重新分配，归还时按新尺寸入池。
+     */
+    std::shared_ptr<cv::Mat> acquire(cv::Size size, int type);
+
+    FramePoolStats getStats() const;
+
+private:
+    explicit FramePool(size_t capacity);
+    void release(cv::Mat* mat);
+
+    const size_t capacity;
+    mutable std::mutex mtx;
+    std::vector<cv::Mat*> freeList;          ///< 空闲缓冲（仅保存尺寸一致的缓冲）
+    size_t allocated = 0;                    ///< 池管理的缓冲总数（借出 + 空闲），由 mtx 保护
+
+    std::atomic<uint64_t> hits{ 0 };
+    std::atomic<uint64_t> misses{ 0 };
+    std::atomic<uint64_t> exhausted{ 0 };
+    std::atomic<int64_t> inFlight{ 0 };
+};
@@ -0,0 +1,91 @@
+﻿#include "FrameRecorder.h"
+#include "Log/Logger.h"
+#include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+
+namespace fs = std::filesystem;
+
+FrameRecorder::FrameRecorder() {
+    writer = std::thread(&FrameRecorder::writerWorker, this);
+}
+
+FrameRecorder::~FrameRecorder() {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        running = false;
+    }
+    cv.notify_all();
+    if (writer.joinable()) writer.join();
+}
+
+void FrameRecorder::start(const std::string& dir, int interval, int maxFrames) {
+    std::lock_guard<std::mutex> lock(mtx);
+    if (!recording) {
+        std::error_code ec;
+        fs::create_directories(SharedContext::Utf8ToGbk(dir), ec);
+        if (ec) {
+            LOG_ERR("无法创建录制目录: " + dir, true);
+            return;
+        }
+        savedCount = 0;
+        submitted = 0;
+        LOG_INFO("开始录制校准帧: " + dir, true);
+    }
+    outputDir = dir;
+    this->interval = std::max(1, interval);
+    this->maxFrames = maxFrames;
+    recording = true;
+}
+
+void FrameRecorder::stop() {
+    std::lock_guard<std::mutex> lock(mtx);
+    if (!recording) return;
+    recording = false;
+    LOG_INFO("校准帧录制结束，共 " + std::to_string(savedCount.load()) + " 帧", true);
+}
+
+void FrameRecorder::submit(const FrameData& frame) {
+    if (!recording || frame.empty()) return;
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        if (submitted++ % interval != 0) return;
+        if (pending.image) return; // 上一帧还没写完，跳过
+        pending = frame;           // 只拷贝智能指针，写完即释放，缓冲回到帧池
+    }
+    cv.notify_one();
+}
+
+void FrameRecorder::writerWorker() {
+    while (true) {
+        FrameData frame;
+        std::string dir;
+        int limit = 0;
+        {
+            std::unique_lock<std::mutex> lock(mtx);
+            cv.wait(lock, [&] { return pending.image != nullptr || !running; });
+            if (!running) return;
+            frame = std::move(pending);
+            pending = FrameData();
+            dir = outputDir;
+            limit = maxFrames;
+        }
+
+        char name[64];
+        snprintf(name, sizeof(name), "frame_%06lld.png", frame.sequenceID);
+        fs::path path = fs::path(SharedContext::Utf8ToGbk(dir)) / name;
+        // 截图为 BGRA，校准/回放只需要 BGR
+        cv::Mat bgr;
+        if (frame.image->channels() == 4) cv::cvtColor(*frame.image, bgr, cv::COLOR_BGRA2BGR);
+        else bgr = *frame.image;
+        frame = FrameData();
+
+        if (!cv::imwrite(path.string(), bgr)) {
+            LOG_WARN("校准帧写入失败: " + path.string());
+            continue;
+        }
+        int saved = ++savedCount;
+        if (limit > 0 && saved >= limit) stop();
+    }
+}
@@ -0,0 +1,51 @@
+﻿#pragma once
+#include "Data/CommonTypes.h"
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+
+/**
+ * @brief 截图帧录制器（量化校准集）
+ * @details 截图线程每隔 interval 帧提交一帧，由后台线程编码为 PNG 写入目录，
+ *          写盘不占用截图线程。后台线程忙时新提交的帧直接跳过，不排队。
+ *          录制的目录可直接作为 models/quantize_onnx.py 的 --frames 输入，
+ *          也可以作为 Replay 截图方式的回放源。
+ */
+class FrameRecorder {
+public:
+    FrameRecorder();
+    ~FrameRecorder();
+
+    /**
+     * @brief 开始录制（已在录制时仅更新参数）
+     * @param dir 输出目录，不存在时自动创建
+     * @param interval 每隔多少帧保存一帧
+     * @param maxFrames 最多保存的帧数，达到后自动停止
+     */
+    void start(const std::string& dir, int interval, int maxFrames);
+    void stop();
+
+    // 截图线程调用：按间隔挑选帧交给后台线程
+    void submit(const FrameData& frame);
+
+    bool isRecording() const { return recording.load(); }
+    int getSavedCount() const { return savedCount.load(); }
+
+private:
+    void writerWorker();
+
+    std::string outputDir;
+    int interval = 1;
+    int maxFrames = 0;
+    long long submitted = 0;
+
+    std::mutex mtx;
+    std::condition_variable cv;
+    FrameData pending;              ///< 等待写盘的帧（仅一帧）
+    std::atomic<bool> recording{ false };
+    std::atomic<bool> running{ true };
+    std::atomic<int> savedCount{ 0 };
+    std::thread writer;
+};
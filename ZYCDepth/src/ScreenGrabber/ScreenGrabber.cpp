@@ -1,6 +1,9 @@
 ﻿#include "ScreenGrabber.h"
 #include <iostream>
+#include <algorithm>
+#include <filesystem>
 #include"Log/Logger.h"
+#include "Profiler/TraceProfiler.h"
 #include <unknwn.h>
 // WinRT 核心
 #include <winrt/Windows.Graphics.Capture.h>
@@ -78,18 +81,13 @@ bool GDICaptureStrategy::capture(HWND hwnd, cv::Mat& result) {
     bi.biBitCount = 32;    // GDI通常是32位 BGRA
     bi.biCompression = BI_RGB;
 
-    // 准备 OpenCV Mat (预分配内存)
-    // CV_8UC4 对应 BGRA
+    // 准备 OpenCV Mat (帧池缓冲尺寸不变时不会重新分配)
+    // CV_8UC4 对应 BGRA，保持原生格式，由推理预处理直接消费
     result.create(height, width, CV_8UC4);
 
     // 获取位图数据到 Mat 的 data 指针中
     // 注意：GetDIBits 可能会比较耗时，这里是内存拷贝
     if (GetDIBits(hMemoryDC, hBitmap, 0, height, result.data, (BITMAPINFO*)&bi, DIB_RGB_COLORS)) {
-
-        cv::Mat bgr;
-        cv::cvtColor(result, bgr, cv::COLOR_BGRA2BGR);
-        result = bgr;
-
         return true;
     }
 
@@ -179,14 +177,13 @@ bool WinGCCaptureStrategy::capture(HWND hwnd, cv::Mat& result) {
 
         Microsoft::WRL::ComPtr<ID3D11Texture2D> texture;
         winrt::check_hresult(surfaceInterface->GetInterface(IID_PPV_ARGS(&texture)));
-        copyTextureToMat(texture, result);
-        return true;
+        return copyTextureToMat(texture, result);
     }
     catch (...) {
         return false;
     }
 }
-void WinGCCaptureStrategy::copyTextureToMat(const Microsoft::WRL::ComPtr<ID3D11Texture2D>& texture, cv::Mat& mat) {
+bool WinGCCaptureStrategy::copyTextureToMat(const Microsoft::WRL::ComPtr<ID3D11Texture2D>& texture, cv::Mat& mat) {
     D3D11_TEXTURE2D_DESC desc;
     texture->GetDesc(&desc);
     // 创建一个 staging 纹理用于将数据从显存拷到内存
@@ -202,12 +199,232 @@ void WinGCCaptureStrategy::copyTextureToMat(const Microsoft::WRL::ComPtr<ID3D11T
     }
     d3d11Context->CopyResource(stagingTexture.Get(), texture.Get());
     D3D11_MAPPED_SUBRESOURCE mapped;
-    if (SUCCEEDED(d3d11Context->Map(stagingTexture.Get(), 0, D3D11_MAP_READ, 0, &mapped))) {
-        // WinGC 默认是 BGRA
-        cv::Mat bgra(height, width, CV_8UC4, mapped.pData, mapped.RowPitch);
-        cv::cvtColor(bgra, mat, cv::COLOR_BGRA2BGR); // 转换为 BGR
-        d3d11Context->Unmap(stagingTexture.Get(), 0);
+    // Map 失败时 mat 仍是帧池缓冲里上一帧的像素，不能当作新帧发布
+    if (FAILED(d3d11Context->Map(stagingTexture.Get(), 0, D3D11_MAP_READ, 0, &mapped))) return false;
+    // WinGC 默认是 BGRA
+    cv::Mat bgra(height, width, CV_8UC4, mapped.pData, mapped.RowPitch);
+    bgra.copyTo(mat); // 保持 BGRA，直接拷入帧池缓冲（Map 的内存在 Unmap 后失效）
+    d3d11Context->Unmap(stagingTexture.Get(), 0);
+    return true;
+}
+
+
+// ==========================================
+// Replay 回放策略实现
+// ==========================================
+
+ReplayCaptureStrategy::ReplayCaptureStrategy(const CaptureConfig& config) : config(config) {}
+
+ReplayCaptureStrategy::~ReplayCaptureStrategy() {
+    cleanup();
+}
+
+void ReplayCaptureStrategy::cleanup() {
+    stopDecoder();
+    if (video.isOpened()) video.release();
+    sequence.clear();
+    opened = false;
+    finished = false;
+    frameCount = 0;
+    lastIndex = -1;
+    videoPos = 0;
+}
+
+bool ReplayCaptureStrategy::open() {
+    cleanup();
+    namespace fs = std::filesystem;
+    std::error_code ec;
+    // 配置中的路径是 UTF-8，OpenCV 的文件接口使用 ANSI 路径
+    fs::path source = SharedContext::Utf8ToGbk(config.replaySource);
+    if (config.replaySource.empty() || !fs::exists(source, ec)) {
+        LOG_ERR("Replay: 回放源不存在 [" + config.replaySource + "]", true);
+        finished = true; // 避免每帧重复报错，修改配置后会重建策略
+        return false;
+    }
+
+    if (fs::is_directory(source, ec)) {
+        // 图片序列：按文件名排序，后台线程边播边解码，只在内存中保留前方 kDecodeAhead 帧
+        for (const auto& entry : fs::directory_iterator(source, ec)) {
+            if (!entry.is_regular_file()) continue;
+            std::string ext = entry.path().extension().string();
+            std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+            if (ext == ".png" || ext == ".jpg" || ext == ".jpeg" || ext == ".bmp" || ext == ".tif" || ext == ".tiff") {
+                sequence.push_back(entry.path());
+            }
+        }
+        std::sort(sequence.begin(), sequence.end());
+        if (sequence.empty()) {
+            LOG_ERR("Replay: 目录中没有可用的图片 [" + config.replaySource + "]", true);
+            finished = true;
+            return false;
+        }
+        frameCount = (long long)sequence.size();
+        sourceFps = 30.0;
+        {
+            std::lock_guard<std::mutex> lock(decodeMtx);
+            decodeNext = 0;
+            decoding = true;
+        }
+        decoder = std::thread(&ReplayCaptureStrategy::decodeWorker, this);
     }
+    else {
+        if (!video.open(source.string())) {
+            LOG_ERR("Replay: 无法打开视频 [" + config.replaySource + "]", true);
+            finished = true;
+            return false;
+        }
+        frameCount = (long long)video.get(cv::CAP_PROP_FRAME_COUNT);
+        double fps = video.get(cv::CAP_PROP_FPS);
+        sourceFps = (fps > 0.0) ? fps : 30.0;
+    }
+    if (config.replayFps > 0.0) sourceFps = config.replayFps;
+
+    opened = true;
+    startTime = std::chrono::steady_clock::now();
+    LOG_INFO("Replay: 回放源已加载 [" + config.replaySource + "] 帧数: " + std::to_string(frameCount) +
+        " 帧率: " + std::to_string(sourceFps) + (config.replayRealtime ? " (实时)" : " (全速)"), true);
+    return true;
+}
+
+void ReplayCaptureStrategy::rewind() {
+    startTime = std::chrono::steady_clock::now();
+    lastIndex = -1;
+    if (video.isOpened()) {
+        video.set(cv::CAP_PROP_POS_FRAMES, 0);
+        videoPos = 0;
+    }
+}
+
+bool ReplayCaptureStrategy::readVideoFrame(long long index, cv::Mat& result) {
+    // 回退（循环）时从头解码
+    if (index < videoPos) {
+        video.set(cv::CAP_PROP_POS_FRAMES, 0);
+        videoPos = 0;
+    }
+    // 实时模式下落后的帧只 grab 不 retrieve，跳过颜色转换
+    while (videoPos < index) {
+        if (!video.grab()) return false;
+        videoPos++;
+    }
+    if (!video.read(decodeBuffer)) return false;
+    videoPos++;
+    cv::cvtColor(decodeBuffer, result, cv::COLOR_BGR2BGRA);
+    return true;
+}
+
+void ReplayCaptureStrategy::decodeWorker() {
+    ZYC_PROFILE_THREAD("replay-decode");
+    std::unique_lock<std::mutex> lock(decodeMtx);
+    while (true) {
+        decodeCv.wait(lock, [&] { return !decoding || (decoded.size() < kDecodeAhead && decodeNext < frameCount); });
+        if (!decoding) return;
+        const long long index = decodeNext;
+        const uint64_t generation = decodeGeneration;
+        lock.unlock();
+        cv::Mat img;
+        {
+            ZYC_PROFILE_SCOPE("Replay::decode");
+            img = cv::imread(sequence[(size_t)index].string(), cv::IMREAD_COLOR);
+        }
+        lock.lock();
+        // 解码期间读取方跳转了，这一帧作废
+        if (generation != decodeGeneration) continue;
+        decoded.emplace_back(index, std::move(img));
+        // 循环回放时解码到结尾后接着从头解码
+        decodeNext = (index + 1 >= frameCount && config.replayLoop) ? 0 : index + 1;
+        decodeCv.notify_all();
+    }
+}
+
+void ReplayCaptureStrategy::stopDecoder() {
+    {
+        std::lock_guard<std::mutex> lock(decodeMtx);
+        decoding = false;
+    }
+    decodeCv.notify_all();
+    if (decoder.joinable()) decoder.join();
+    decoded.clear();
+    decodeGeneration = 0;
+}
+
+bool ReplayCaptureStrategy::readSequenceFrame(long long index, cv::Mat& result) {
+    cv::Mat img;
+    {
+        std::unique_lock<std::mutex> lock(decodeMtx);
+        while (true) {
+            // 按解码顺序丢弃目标之前的帧（实时模式落后时跳过的帧）
+            while (!decoded.empty() && decoded.front().first != index) decoded.pop_front();
+            if (!decoded.empty()) {
+                img = std::move(decoded.front().second);
+                decoded.pop_front();
+                break;
+            }
+            // 环里没有目标帧，且解码线程也不是正要解码它：让解码线程跳到目标帧
+            if (decodeNext != index) {
+                decodeNext = index;
+                decodeGeneration++;
+            }
+            decodeCv.notify_all();
+            decodeCv.wait(lock, [&] { return !decoded.empty() || !decoding; });
+            if (!decoding) return false;
+        }
+        decodeCv.notify_all(); // 空出了位置，解码线程继续往前解码
+    }
+    if (img.empty()) {
+        LOG_WARN("Replay: 图片解码失败 [" + sequence[(size_t)index].string() + "]");
+        return false;
+    }
+    // 转为与实时截图一致的 BGRA 写入帧池缓冲
+    cv::cvtColor(img, result, cv::COLOR_BGR2BGRA);
+    return true;
+}
+
+bool ReplayCaptureStrategy::capture(HWND hwnd, cv::Mat& result) {
+    if (finished) return false;
+    if (!opened && !open()) return false;
+
+    long long index = lastIndex + 1;
+    if (config.replayRealtime) {
+        double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+        index = (long long)(elapsed * sourceFps);
+        // 源还没有产生新帧，与 WinGC 取不到新帧的行为一致
+        if (index == lastIndex) return false;
+    }
+
+    if (frameCount > 0 && index >= frameCount) {
+        if (!config.replayLoop) {
+            finished = true;
+            LOG_INFO("Replay: 回放结束", true);
+            return false;
+        }
+        rewind();
+        index = 0;
+    }
+
+    bool ok = false;
+    if (!sequence.empty()) {
+        ok = readSequenceFrame(index, result);
+        // 坏图只跳过这一帧，不终止回放
+        if (!ok) {
+            lastIndex = index;
+            return false;
+        }
+    }
+    else {
+        ok = readVideoFrame(index, result);
+        // 视频帧数只是估计值，真正读到结尾时再处理循环
+        if (!ok && config.replayLoop) {
+            rewind();
+            index = 0;
+            ok = readVideoFrame(index, result);
+        }
+        if (!ok) {
+            finished = true;
+            LOG_INFO("Replay: 回放结束", true);
+        }
+    }
+    if (ok) lastIndex = index;
+    return ok && !result.empty();
 }
 
 
@@ -218,6 +435,7 @@ void WinGCCaptureStrategy::copyTextureToMat(const Microsoft::WRL::ComPtr<ID3D11T
 ScreenGrabber::ScreenGrabber() {
     // 构造时初始化一个默认的
     strategy = std::make_unique<GDICaptureStrategy>();
+    framePool = FramePool::create();
 }
 
 ScreenGrabber::~ScreenGrabber() {
@@ -245,6 +463,9 @@ void ScreenGrabber::setConfig(const CaptureConfig& config)
         // 暂时回退到 GDI
         this->strategy = std::make_unique<WinGCCaptureStrategy>();
         break;
+    case CaptureMethod::Replay:
+        this->strategy = std::make_unique<ReplayCaptureStrategy>(config);
+        break;
     }
 }
 
@@ -254,6 +475,7 @@ void ScreenGrabber::setConfig(const CaptureConfig& config)
 
 
 std::shared_ptr<cv::Mat> ScreenGrabber::grab() {
+    ZYC_PROFILE_SCOPE("ScreenGrabber::grab");
     if (!strategy) return nullptr;
 
     auto& ctx = SharedContext::getInstance();
@@ -264,15 +486,19 @@ std::shared_ptr<cv::Mat> ScreenGrabber::grab() {
         setConfig(newConfig); // 更新 grabber 内部策略
         localConfigVersion = ctx.getCaptureConfigVersion(); // 更新本地版本
     }
-    if (!activeConfig.targetHwnd) return nullptr;
-    cv::Mat rawImg;
-    if (strategy->capture(activeConfig.targetHwnd, rawImg)) {
-        if (rawImg.empty()) return nullptr;
-        // 成功，返回 shared_ptr
-        // 使用 make_shared 创建，引用计数 +1
-        return std::make_shared<cv::Mat>(rawImg);
+    // 回放模式不需要窗口句柄
+    if (!activeConfig.targetHwnd && activeConfig.Method != CaptureMethod::Replay) return nullptr;
+    // 从帧池借一块与上一帧同尺寸的缓冲，策略直接写入，无需再拷贝
+    std::shared_ptr<cv::Mat> frame = framePool->acquire(lastFrameSize, lastFrameType);
+    // 缓冲全部被下游持有（推理/广播积压），丢弃本帧
+    if (!frame) return nullptr;
+    if (strategy->capture(activeConfig.targetHwnd, *frame)) {
+        if (frame->empty()) return nullptr;
+        lastFrameSize = frame->size();
+        lastFrameType = frame->type();
+        return frame;
     }
 
-    // 截图失败（可能是窗口最小化了，或者被遮挡）//日志系统待接入
+    // 截图失败（可能是窗口最小化了，或者被遮挡），缓冲随 frame 析构归还帧池
     return nullptr;
 }
@@ -1,8 +1,15 @@
 ﻿#pragma once
 #include "Data/CommonTypes.h"
+#include "ScreenGrabber/FramePool.h"
 #include <windows.h>
 #include <memory>
 #include <vector>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <filesystem>
+#include <mutex>
+#include <thread>
 
 #include <inspectable.h>
 #include <dwmapi.h>
@@ -17,7 +24,8 @@
 class ICaptureStrategy {
 public:
     virtual ~ICaptureStrategy() = default;
-    // 返回 true 表示截图成功，图像存入 result
+    // 返回 true 表示截图成功，图像存入 result，统一为 BGRA (CV_8UC4)，推理预处理直接消费该格式
+    // result 来自帧池，实现应通过 create()/copyTo()/cvtColor() 原地写入，不要替换其数据指针
     virtual bool capture(HWND hwnd, cv::Mat& result) = 0;
     // 清理资源（当窗口大小改变或策略切换时调用）
     virtual void cleanup() = 0;
@@ -58,7 +66,7 @@ private:
     int width = 0;
     int height = 0;
     bool initWinGC(HWND hwnd);
-    void copyTextureToMat(const Microsoft::WRL::ComPtr<ID3D11Texture2D>& texture, cv::Mat& mat);
+    bool copyTextureToMat(const Microsoft::WRL::ComPtr<ID3D11Texture2D>& texture, cv::Mat& mat);
 public:
     WinGCCaptureStrategy();
     ~WinGCCaptureStrategy() override;
@@ -66,19 +74,64 @@ public:
     void cleanup() override;
 };
 
+// 录制回放策略：从视频文件或图片序列目录读取帧，不依赖任何窗口
+// 用于在固定输入上复现 截图→推理→广播 全链路的性能数据
+class ReplayCaptureStrategy : public ICaptureStrategy {
+private:
+    CaptureConfig config;                 // 回放源、帧率、循环等配置
+    cv::VideoCapture video;               // 视频源
+    std::vector<std::filesystem::path> sequence; // 图片序列源（按文件名排序），由后台线程提前解码
+    bool opened = false;
+    bool finished = false;                // 非循环模式下播放完毕
+    double sourceFps = 30.0;              // 实时回放使用的帧率
+    long long frameCount = 0;             // 源总帧数（视频可能未知，为 0）
+    long long lastIndex = -1;             // 上一次输出的帧序号
+    long long videoPos = 0;               // 视频解码器当前位置（已消费的帧数）
+    cv::Mat decodeBuffer;                 // 视频解码输出 (BGR)，跨帧复用
+    std::chrono::steady_clock::time_point startTime;
+
+    // 图片序列预解码：后台线程按顺序解码到最多 kDecodeAhead 帧的环中，内存占用与序列长度无关
+    static constexpr size_t kDecodeAhead = 8;
+    std::mutex decodeMtx;
+    std::condition_variable decodeCv;
+    std::deque<std::pair<long long, cv::Mat>> decoded; ///< 已解码的 (帧序号, BGR 图像)，按解码顺序排列
+    long long decodeNext = 0;             ///< 解码线程下一个要解码的帧序号，由 decodeMtx 保护
+    uint64_t decodeGeneration = 0;        ///< 读取方跳转时递增，解码线程据此丢弃跳转前解码出的帧
+    bool decoding = false;                ///< 解码线程是否继续运行，由 decodeMtx 保护
+    std::thread decoder;
+
+    bool open();
+    void rewind();
+    bool readVideoFrame(long long index, cv::Mat& result);
+    bool readSequenceFrame(long long index, cv::Mat& result);
+    void decodeWorker();
+    void stopDecoder();
+public:
+    explicit ReplayCaptureStrategy(const CaptureConfig& config);
+    ~ReplayCaptureStrategy() override;
+    // hwnd 被忽略；实时模式返回“当前时刻”应显示的帧，全速模式逐帧返回
+    bool capture(HWND hwnd, cv::Mat& result) override;
+    void cleanup() override;
+};
+
 // 截图器主类
 class ScreenGrabber {
 private:
     std::unique_ptr<ICaptureStrategy> strategy; // 当前策略实例
     CaptureConfig activeConfig; // 内部记录当前正在使用的配置
     uint64_t localConfigVersion = 0; // 本地记录的版本号
+    std::shared_ptr<FramePool> framePool; // 帧缓冲池，所有持有者释放后缓冲自动归还
+    cv::Size lastFrameSize;               // 上一帧尺寸，用于向帧池申请匹配的缓冲
+    int lastFrameType = CV_8UC4;
     void setConfig(const CaptureConfig& config);
 public:
     ScreenGrabber();
     ~ScreenGrabber();
     /**
      * @brief 执行一次截图
-     * @return std::shared_ptr<cv::Mat> 成功返回图像，失败返回 nullptr
+     * @return std::shared_ptr<cv::Mat> 成功返回图像（来自帧池），失败返回 nullptr
      */
     std::shared_ptr<cv::Mat> grab();
+
+    FramePoolStats getFramePoolStats() const { return framePool->getStats(); }
 };
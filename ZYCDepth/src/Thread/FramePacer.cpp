@@ -0,0 +1,71 @@
+﻿#include "FramePacer.h"
+#include "Data/CommonTypes.h"
+#include "Profiler/TraceProfiler.h"
+#include <algorithm>
+#include <thread>
+#include <mmsystem.h>
+#pragma comment(lib, "winmm.lib")
+
+FramePacer::FramePacer() {
+    // 系统时钟粒度默认 15.6 ms，调度器的定时唤醒需要 1 ms 粒度才能落在 kWakeAhead 之内
+    timerResolutionRaised = timeBeginPeriod(1) == TIMERR_NOERROR;
+}
+
+FramePacer::~FramePacer() {
+    if (timerResolutionRaised) timeEndPeriod(1);
+}
+
+void FramePacer::waitForDeadline() {
+    if (!hasDeadline) return;
+    ZYC_PROFILE_SCOPE("FramePacer::wait");
+    auto now = Clock::now();
+    // 调度器提前唤醒，剩余的不到 kWakeAhead 让出 CPU 自旋等待；被调度器晚唤醒时不等待
+    while (now < deadline) {
+        std::this_thread::yield();
+        now = Clock::now();
+    }
+    double jitterMs = std::chrono::duration<double, std::milli>(now - deadline).count();
+    SharedContext::getInstance().getLatencyTracker().recordCaptureJitter(jitterMs);
+}
+
+FramePacer::Clock::time_point FramePacer::schedule(double maxFps, const std::vector<PortConsumer>& consumers) {
+    const double minPeriodMs = 1000.0 / std::max(1.0, maxFps);
+    auto now = Clock::now();
+
+    // 最慢的活跃订阅者：最近 max(1 s, 4 个周期) 内取过包的订阅者里取包间隔最长的
+    const PortConsumer* slowest = nullptr;
+    for (const auto& consumer : consumers) {
+        if (consumer.intervalMs <= 0.0 || consumer.idleMs > std::max(1000.0, 4.0 * consumer.intervalMs)) continue;
+        if (!slowest || consumer.intervalMs > slowest->intervalMs) slowest = &consumer;
+    }
+
+    double correctionMs = 0.0;
+    if (!slowest) {
+        periodMs = minPeriodMs;
+    }
+    else {
+        periodMs = slowest->intervalMs;
+        // 订阅者几乎没等：截图是瓶颈或恰好赶上，试探更高帧率，直到帧开始排队
+        if (slowest->waitMs < kTargetWaitMs * 0.5) periodMs *= 0.97;
+        periodMs = std::clamp(periodMs, minPeriodMs, 1000.0);
+        // 相位：每个新测量只修正一次，单次不超过四分之一周期
+        if (slowest->pops != lastPops) {
+            lastPops = slowest->pops;
+            correctionMs = std::clamp(0.5 * (slowest->waitMs - kTargetWaitMs), -periodMs / 4, periodMs / 4);
+        }
+    }
+
+    auto period = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double, std::milli>(periodMs + correctionMs));
+    if (!hasDeadline) {
+        deadline = now;
+        hasDeadline = true;
+    }
+    deadline += period;
+    // 落后超过一个周期：重新对齐，跳过错过的帧
+    if (deadline + period < now) {
+        SharedContext::getInstance().getPipelineMetrics().countMissedDeadline();
+        deadline = now;
+    }
+    SharedContext::getInstance().getPipelineMetrics().setCapturePeriodMs(periodMs);
+    return deadline - kWakeAhead;
+}
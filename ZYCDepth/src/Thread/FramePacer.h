@@ -0,0 +1,54 @@
+﻿#pragma once
+#include <chrono>
+#include <vector>
+#include "Thread/PipelineGraph.h"
+
+/**
+ * @brief 截图节拍器（截图阶段独占，非线程安全）
+ * @details 按截止时间排期：每帧的截止时间 = 上一帧截止时间 + 周期，不随截图耗时或调度误差漂移；
+ *          落后超过一个周期时直接以当前时刻重新对齐（跳过错过的帧并计数），不会连拍追赶。
+ *
+ *          亚毫秒精度：调度器只负责提前 kWakeAhead 唤醒截图阶段（条件变量超时的精度是系统时钟粒度），
+ *          剩下的一小段在 waitForDeadline 里让出 CPU 自旋到截止时刻。每帧实际开拍时刻相对截止时间的
+ *          偏差记入 LatencyMetric::CaptureJitter。
+ *
+ *          自适应模式：周期与相位锁定到 frames 端口最慢的活跃订阅者（一般是推理预处理）的实际取包节奏，
+ *          目标是帧刚截好 kTargetWaitMs 就被取走——既不让推理空等，也不让帧在队列里变旧：
+ *          - 周期跟随订阅者的取包间隔；订阅者几乎没等就取走了帧（说明它比截图快），周期每帧缩短 3% 试探更高帧率
+ *          - 相位按帧在队列里的等待时间修正：等太久就推迟下一次截图，等太短就提前
+ *          周期下限是配置的 captureFps，没有活跃订阅者（推理未开启、没有网页）时退回固定周期。
+ */
+class FramePacer {
+public:
+    using Clock = std::chrono::steady_clock;
+    static constexpr std::chrono::microseconds kWakeAhead{ 2000 };
+    static constexpr double kTargetWaitMs = 1.0;
+
+    FramePacer();
+    ~FramePacer();
+    FramePacer(const FramePacer&) = delete;
+    FramePacer& operator=(const FramePacer&) = delete;
+
+    // 截图前调用：精确等待到本帧截止时间，并记录抖动
+    void waitForDeadline();
+
+    /**
+     * @brief 截图后调用：排下一帧
+     * @param maxFps 帧率上限（固定模式下即目标帧率）
+     * @param consumers 自适应模式下 frames 端口的订阅者，为空时按固定周期
+     * @return 调度器应唤醒截图阶段的时刻（截止时间 - kWakeAhead）
+     */
+    Clock::time_point schedule(double maxFps, const std::vector<PortConsumer>& consumers = {});
+
+    // 丢弃当前节拍，下一帧立即开始（配置变更时调用）
+    void reset() { hasDeadline = false; lastPops = 0; }
+
+    double getPeriodMs() const { return periodMs; }
+
+private:
+    Clock::time_point deadline{};
+    bool hasDeadline = false;
+    double periodMs = 0.0;       ///< 当前周期（自适应模式下随下游变化）
+    uint64_t lastPops = 0;       ///< 上次用于修正相位的订阅者取包次数，避免同一个测量重复修正
+    bool timerResolutionRaised = false;
+};
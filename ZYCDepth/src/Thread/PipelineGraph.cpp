@@ -0,0 +1,309 @@
+﻿#include "PipelineGraph.h"
+#include "Log/Logger.h"
+#include "Profiler/TraceProfiler.h"
+#include <algorithm>
+#include <stdexcept>
+
+// 阶段的运行时状态（调度字段由调度锁保护；统计计数是原子量，getStats 无锁读取）
+struct PipelineGraph::Stage {
+    StageSpec spec;
+    std::vector<Edge> edges;                  ///< 与 spec.inputs 一一对应
+    size_t nextInput = 0;                     ///< 多输入阶段轮流取各输入边
+    int active = 0;                           ///< 正在运行的实例数
+    std::chrono::steady_clock::time_point nextRun{};  ///< 源阶段下次调用时间
+    bool sourceRunning = false;
+    double creditNs = 0.0;                    ///< CPU 预算令牌桶余额
+    std::chrono::steady_clock::time_point lastRefill{};
+    const char* traceName = nullptr;          ///< 时间线上的区间名（常驻字符串）
+    std::atomic<uint64_t> runs{ 0 };
+    std::atomic<uint64_t> throttled{ 0 };
+    std::atomic<uint64_t> busyNs{ 0 };
+    std::atomic<uint64_t> dropped{ 0 };       ///< 各输入边丢弃数之和
+    std::atomic<size_t> queued{ 0 };          ///< 各输入边排队数之和
+};
+
+void StageRun::emit(const std::string& port, PipelinePacket out) {
+    graph.emit(port, std::move(out));
+}
+
+PipelineGraph::PipelineGraph(int workerThreads) : fixedWorkers(std::max(0, workerThreads)) {}
+
+PipelineGraph::~PipelineGraph() {
+    stop();
+}
+
+void PipelineGraph::addStage(StageSpec spec) {
+    auto stage = std::make_unique<Stage>();
+    spec.concurrency = std::clamp(spec.concurrency, 1, std::max(1, spec.maxConcurrency));
+    for (const auto& input : spec.inputs) {
+        Edge edge;
+        edge.spec = input;
+        if (edge.spec.policy == EdgePolicy::LatestOnly || edge.spec.capacity == 0) edge.spec.capacity = 1;
+        stage->edges.push_back(std::move(edge));
+    }
+    stage->nextRun = Clock::now();
+    stage->lastRefill = Clock::now();
+    stage->creditNs = spec.cpuBudget * 1e9;
+    stage->traceName = TraceProfiler::intern("stage:" + spec.name);
+    std::string summary = spec.name + " (并发 " + std::to_string(spec.concurrency) +
+        (spec.cpuBudget > 0.0 ? ", 预算 " + std::to_string((int)(spec.cpuBudget * 100)) + "% 核" : "") + ")";
+    stage->spec = std::move(spec);
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        if (stages.size() >= kMaxStages) throw std::runtime_error("流水线阶段数超过上限: " + summary);
+        // 先发布到统计表再计数，getStats 读到的下标一定有效
+        stageTable[stages.size()].store(stage.get(), std::memory_order_release);
+        stageCount.store(stages.size() + 1, std::memory_order_release);
+        stages.push_back(std::move(stage));
+        if (running) ensureWorkers();
+    }
+    cv.notify_all();
+    LOG_INFO("流水线阶段: " + summary);
+}
+
+void PipelineGraph::start() {
+    std::lock_guard<std::mutex> lock(mtx);
+    if (running) return;
+    running = true;
+    ensureWorkers();
+}
+
+void PipelineGraph::ensureWorkers() {
+    size_t target = (size_t)fixedWorkers;
+    if (target == 0) {
+        for (const auto& stage : stages) target += (size_t)stage->spec.concurrency;
+    }
+    target = std::clamp<size_t>(target, 1, 64);
+    while (workers.size() < target) {
+        workers.emplace_back(&PipelineGraph::workerLoop, this, workers.size());
+    }
+}
+
+void PipelineGraph::stop() {
+    std::vector<std::thread> joining;
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        if (!running) return;
+        running = false;
+        joining.swap(workers);
+    }
+    cv.notify_all();
+    for (auto& t : joining) {
+        if (t.joinable()) t.join();
+    }
+    // 包在锁外析构：payload 的回收逻辑可能回调 notify
+    std::vector<std::deque<PipelinePacket>> pending;
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        for (auto& stage : stages) {
+            for (auto& edge : stage->edges) pending.push_back(std::move(edge.queue));
+            stage->queued.store(0, std::memory_order_relaxed);
+        }
+    }
+}
+
+void PipelineGraph::notify() {
+    { std::lock_guard<std::mutex> lock(mtx); }
+    cv.notify_all();
+}
+
+void PipelineGraph::emit(const std::string& port, PipelinePacket packet) {
+    std::vector<PipelinePacket> evicted;  // 被挤掉的旧包在锁外析构
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        if (!running) return;
+        packet.emitted = Clock::now();
+        std::vector<std::pair<Stage*, Edge*>> targets;
+        for (auto& stage : stages) {
+            for (auto& edge : stage->edges) {
+                if (edge.spec.port == port) targets.push_back({ stage.get(), &edge });
+            }
+        }
+        for (size_t i = 0; i < targets.size(); ++i) {
+            Stage& stage = *targets[i].first;
+            Edge& edge = *targets[i].second;
+            // Block 边不丢包：调度前已检查过空位，多实例并发产出时允许短暂超出容量
+            if (edge.spec.policy != EdgePolicy::Block) {
+                while (edge.queue.size() >= edge.spec.capacity) {
+                    evicted.push_back(std::move(edge.queue.front()));
+                    edge.queue.pop_front();
+                    stage.dropped.fetch_add(1, std::memory_order_relaxed);
+                    stage.queued.fetch_sub(1, std::memory_order_relaxed);
+                }
+            }
+            // 最后一个订阅者直接拿走原包，其余各复制一份句柄
+            edge.queue.push_back(i + 1 == targets.size() ? std::move(packet) : packet);
+            stage.queued.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    cv.notify_all();
+}
+
+bool PipelineGraph::isRunnable(Stage& stage, Clock::time_point now, Clock::time_point& wake) {
+    const StageSpec& spec = stage.spec;
+    if (stage.active >= spec.concurrency) return false;
+
+    const bool isSource = spec.inputs.empty();
+    if (isSource) {
+        if (stage.sourceRunning) return false;
+        if (stage.nextRun > now) {
+            wake = std::min(wake, stage.nextRun);
+            return false;
+        }
+    }
+    else {
+        bool hasInput = std::any_of(stage.edges.begin(), stage.edges.end(), [](const Edge& e) { return !e.queue.empty(); });
+        if (!hasInput) return false;
+    }
+
+    // CPU 预算：按经过的时间补充额度，最多攒 1 秒
+    if (spec.cpuBudget > 0.0) {
+        double refill = std::chrono::duration<double, std::nano>(now - stage.lastRefill).count() * spec.cpuBudget;
+        stage.creditNs = std::min(stage.creditNs + refill, spec.cpuBudget * 1e9);
+        stage.lastRefill = now;
+        if (stage.creditNs <= 0.0) {
+            auto wait = std::chrono::nanoseconds((long long)(-stage.creditNs / spec.cpuBudget) + 1);
+            wake = std::min(wake, now + std::chrono::duration_cast<Clock::duration>(wait));
+            return false;
+        }
+    }
+
+    // Block 边反压：任一下游 Block 队列已满则暂停该阶段
+    for (const auto& port : spec.outputs) {
+        for (const auto& other : stages) {
+            for (const auto& edge : other->edges) {
+                if (edge.spec.port == port && edge.spec.policy == EdgePolicy::Block && edge.queue.size() >= edge.spec.capacity) {
+                    return false;
+                }
+            }
+        }
+    }
+
+    if (spec.gate && !spec.gate()) return false;
+    return true;
+}
+
+bool PipelineGraph::popInput(Stage& stage, PipelinePacket& packet, size_t& input) {
+    for (size_t i = 0; i < stage.edges.size(); ++i) {
+        size_t idx = (stage.nextInput + i) % stage.edges.size();
+        Edge& edge = stage.edges[idx];
+        auto& queue = edge.queue;
+        if (queue.empty()) continue;
+        packet = std::move(queue.front());
+        queue.pop_front();
+        // 取包节奏：间隔超过 1 秒视为下游停过（如推理暂停），不计入平均
+        auto now = Clock::now();
+        double intervalNs = std::chrono::duration<double, std::nano>(now - edge.lastPop).count();
+        if (edge.pops > 0 && intervalNs < 1e9) {
+            edge.popIntervalNs = edge.popIntervalNs > 0.0 ? 0.8 * edge.popIntervalNs + 0.2 * intervalNs : intervalNs;
+        }
+        edge.lastPop = now;
+        edge.lastWaitNs = std::chrono::duration<double, std::nano>(now - packet.emitted).count();
+        edge.pops++;
+        stage.queued.fetch_sub(1, std::memory_order_relaxed);
+        input = idx;
+        stage.nextInput = idx + 1;
+        return true;
+    }
+    return false;
+}
+
+void PipelineGraph::workerLoop(size_t index) {
+    ZYC_PROFILE_THREAD("pipeline-" + std::to_string(index));
+    std::unique_lock<std::mutex> lock(mtx);
+    while (running) {
+        auto now = Clock::now();
+        auto wake = now + kIdlePoll;
+        Stage* stage = nullptr;
+        StageRun run(*this);
+        for (size_t i = 0; i < stages.size() && !stage; ++i) {
+            size_t idx = (cursor + i) % stages.size();
+            Stage& candidate = *stages[idx];
+            if (!isRunnable(candidate, now, wake)) continue;
+            if (!candidate.spec.inputs.empty() && !popInput(candidate, run.packet, run.input)) continue;
+            stage = &candidate;
+            cursor = idx + 1;
+        }
+        if (!stage) {
+            // 没有可运行的阶段：等输入、并发名额或下次源阶段节拍（醒来时重新取调度锁也算在内）
+            ZYC_PROFILE_SCOPE("PipelineGraph::idleWait");
+            cv.wait_until(lock, wake);
+            continue;
+        }
+
+        stage->active++;
+        const bool isSource = stage->spec.inputs.empty();
+        if (isSource) stage->sourceRunning = true;
+        lock.unlock();
+
+        run.nextRun = Clock::now();
+        auto start = Clock::now();
+        try {
+            ZYC_PROFILE_SCOPE(stage->traceName);
+            stage->spec.fn(run);
+        }
+        catch (const std::exception& e) {
+            LOG_ERR("流水线阶段 " + stage->spec.name + " 异常: " + std::string(e.what()));
+        }
+        double busyNs = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+        run.packet = PipelinePacket();  // 输入包在锁外释放
+
+        {
+            // 调度锁争用：所有工作者交还结果、取下一个任务都要经过这把锁
+            ZYC_PROFILE_SCOPE("PipelineGraph::lockWait");
+            lock.lock();
+        }
+        stage->active--;
+        stage->runs.fetch_add(1, std::memory_order_relaxed);
+        stage->busyNs.fetch_add((uint64_t)busyNs, std::memory_order_relaxed);
+        if (stage->spec.cpuBudget > 0.0) {
+            stage->creditNs -= busyNs;
+            if (stage->creditNs <= 0.0) stage->throttled.fetch_add(1, std::memory_order_relaxed);
+        }
+        if (isSource) {
+            stage->sourceRunning = false;
+            stage->nextRun = run.nextRun;
+        }
+        // 并发名额、Block 队列空位都可能因此释放
+        cv.notify_all();
+    }
+}
+
+std::vector<PortConsumer> PipelineGraph::getConsumers(const std::string& port) const {
+    std::lock_guard<std::mutex> lock(mtx);
+    auto now = Clock::now();
+    std::vector<PortConsumer> consumers;
+    for (const auto& stage : stages) {
+        for (const auto& edge : stage->edges) {
+            if (edge.spec.port != port || edge.pops == 0) continue;
+            PortConsumer c;
+            c.stage = stage->spec.name;
+            c.intervalMs = edge.popIntervalNs / 1e6;
+            c.waitMs = edge.lastWaitNs / 1e6;
+            c.idleMs = std::chrono::duration<double, std::milli>(now - edge.lastPop).count();
+            c.pops = edge.pops;
+            consumers.push_back(std::move(c));
+        }
+    }
+    return consumers;
+}
+
+std::vector<StageStats> PipelineGraph::getStats() const {
+    // 不取调度锁：阶段发布后只读的 name/concurrency 加上原子计数，轮询不会拖慢调度
+    size_t count = stageCount.load(std::memory_order_acquire);
+    std::vector<StageStats> stats;
+    stats.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        const Stage* stage = stageTable[i].load(std::memory_order_acquire);
+        StageStats s;
+        s.name = stage->spec.name;
+        s.concurrency = stage->spec.concurrency;
+        s.runs = stage->runs.load(std::memory_order_relaxed);
+        s.throttled = stage->throttled.load(std::memory_order_relaxed);
+        s.busyMs = stage->busyNs.load(std::memory_order_relaxed) / 1e6;
+        s.dropped = stage->dropped.load(std::memory_order_relaxed);
+        s.queued = stage->queued.load(std::memory_order_relaxed);
+        stats.push_back(s);
+    }
+    return stats;
+}
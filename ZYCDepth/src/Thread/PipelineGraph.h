@@ -0,0 +1,180 @@
+﻿#pragma once
+#include <any>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Data/CommonTypes.h"
+
+/**
+ * @brief 边（阶段输入队列）的溢出策略
+ */
+enum class EdgePolicy {
+    Block,       ///< 队列满时暂停上游：调度器不再运行该生产者阶段（不占用工作线程），直到队列有空位
+    DropOldest,  ///< 队列满时丢弃最旧的包（有界 FIFO）
+    LatestOnly   ///< 只保留最新的一个包，新包顶替未取走的旧包（延迟优先）
+};
+
+/**
+ * @brief 阶段之间传递的数据包
+ * @details 只放句柄：帧是不可变的 FrameHandle，阶段私有数据（如推理上下文）放在 payload 中，
+ *          一般是自带回收逻辑的 shared_ptr，包被丢弃时资源自动归还
+ */
+struct PipelinePacket {
+    FrameHandle frame;
+    std::any payload;
+    std::chrono::steady_clock::time_point emitted{};  ///< 进入队列的时刻，由调度器在 emit 时填写
+};
+
+/**
+ * @brief 阶段的一个输入：订阅某个端口，并决定这条边的容量与溢出策略
+ */
+struct StageInput {
+    std::string port;
+    EdgePolicy policy = EdgePolicy::LatestOnly;
+    size_t capacity = 1;    ///< LatestOnly 忽略该值（固定为 1）
+};
+
+class PipelineGraph;
+
+/**
+ * @brief 一次阶段调用的上下文
+ * @details 处理阶段从 packet/input 取本次的输入；源阶段（无输入）通过 runAgainAt 决定下次调用时间
+ */
+class StageRun {
+public:
+    PipelinePacket packet;  ///< 本次输入（源阶段为空）
+    size_t input = 0;       ///< 输入来自第几个 StageInput
+
+    // 发送到端口，所有订阅该端口的阶段各收到一份（包里只有句柄，复制开销很小）
+    void emit(const std::string& port, PipelinePacket out);
+    // 源阶段：下次调用时间，默认立即再次调用
+    void runAgainAt(std::chrono::steady_clock::time_point when) { nextRun = when; }
+
+private:
+    friend class PipelineGraph;
+    StageRun(PipelineGraph& graph) : graph(graph) {}
+    PipelineGraph& graph;
+    std::chrono::steady_clock::time_point nextRun{};
+};
+
+using StageFunction = std::function<void(StageRun&)>;
+
+/**
+ * @brief 阶段声明
+ */
+struct StageSpec {
+    std::string name;
+    std::vector<StageInput> inputs;       ///< 为空表示源阶段，由调度器按 runAgainAt 定时调用（同一时刻只有一个实例）
+    std::vector<std::string> outputs;     ///< 会 emit 的端口，Block 边的反压按这里声明的端口检查
+    StageFunction fn;
+    int concurrency = 1;                  ///< 最多同时运行的实例数
+    int maxConcurrency = 64;              ///< 非线程安全的阶段（如单写者通道的发布者）设为 1，配置无法突破
+    double cpuBudget = 0.0;               ///< CPU 预算（核数），0 不限制
+    std::function<bool()> gate;           ///< 可选：返回 false 时暂不调度（如没有空闲推理上下文），在调度锁内调用，必须轻量
+};
+
+/**
+ * @brief 阶段运行统计
+ */
+struct StageStats {
+    std::string name;
+    int concurrency = 0;
+    uint64_t runs = 0;       ///< 调用次数
+    uint64_t dropped = 0;    ///< 输入边上因溢出丢弃的包数
+    uint64_t throttled = 0;  ///< CPU 预算耗尽（随后被推迟调度）的次数
+    size_t queued = 0;       ///< 当前排队的包数
+    double busyMs = 0.0;     ///< 累计运行耗时
+};
+
+/**
+ * @brief 某个端口的一个订阅者最近的取包节奏
+ * @details 源阶段据此把产出节奏对齐到下游实际的消费速度（见 FramePacer 的自适应模式）
+ */
+struct PortConsumer {
+    std::string stage;
+    double intervalMs = 0.0;   ///< 相邻两次取包间隔的指数滑动平均
+    double waitMs = 0.0;       ///< 最近一次取走的包在队列里等了多久
+    double idleMs = 0.0;       ///< 距最近一次取包过了多久
+    uint64_t pops = 0;         ///< 累计取包次数（用于判断是否有新的测量）
+};
+
+/**
+ * @brief 声明式流水线图
+ * @details 阶段声明自己订阅的输入端口与产出的端口，阶段之间由有界队列连接，每条边可选溢出策略；
+ *          所有阶段共用一组工作线程，调度器按轮转挑选“有输入 / 到时间、未达并发上限、预算充足、
+ *          下游 Block 边有空位、gate 放行”的阶段执行。阶段函数在调度锁外运行。
+ *          - 新增阶段只需 addStage，可在运行中追加（如模型加载完成后接入推理阶段）
+ *          - 扩容只需调整并发数（如 2 个推理工作者、并行编码），多实例阶段的输出可能乱序，
+ *            下游按序列号自行取舍（发布通道本身会忽略回退的序列号）
+ *          - CPU 预算按令牌桶计：每秒按预算积累运行时间额度（最多攒 1 秒），运行消耗实际耗时，
+ *            额度为负时推迟调度；耗时按墙钟统计，阶段内部阻塞等待也计入
+ */
+class PipelineGraph {
+public:
+    /**
+     * @param workerThreads 共享工作线程数，0 表示自动取各阶段并发数之和（追加阶段时随之增加）
+     */
+    explicit PipelineGraph(int workerThreads = 0);
+    ~PipelineGraph();
+
+    PipelineGraph(const PipelineGraph&) = delete;
+    PipelineGraph& operator=(const PipelineGraph&) = delete;
+
+    // 追加阶段，可在 start 前后调用；阶段名须唯一
+    void addStage(StageSpec spec);
+
+    void start();
+    // 停止调度并等待正在运行的阶段返回，清空所有队列（包在锁外析构，payload 的回收逻辑可以安全回调 notify）
+    void stop();
+
+    // gate 依赖的外部条件变化时唤醒调度器（gate 至多 kIdlePoll 也会被重新检查一次）
+    void notify();
+
+    // 无锁读取（计数为原子量），可在任意线程高频轮询
+    std::vector<StageStats> getStats() const;
+
+    // 订阅 port 的各输入边最近的取包节奏（从未取过包的订阅者不返回）
+    std::vector<PortConsumer> getConsumers(const std::string& port) const;
+
+private:
+    friend class StageRun;
+    using Clock = std::chrono::steady_clock;
+    static constexpr std::chrono::milliseconds kIdlePoll{ 50 };
+    static constexpr size_t kMaxStages = 32;
+
+    struct Edge {
+        StageInput spec;
+        std::deque<PipelinePacket> queue;
+        Clock::time_point lastPop{};
+        double popIntervalNs = 0.0;   ///< 取包间隔的指数滑动平均
+        double lastWaitNs = 0.0;
+        uint64_t pops = 0;
+    };
+    struct Stage;
+
+    void workerLoop(size_t index);
+    // 检查阶段能否被调度，不能时把下次值得检查的时间并入 wake
+    bool isRunnable(Stage& stage, Clock::time_point now, Clock::time_point& wake);
+    bool popInput(Stage& stage, PipelinePacket& packet, size_t& input);
+    void emit(const std::string& port, PipelinePacket packet);
+    void ensureWorkers();
+
+    mutable std::mutex mtx;
+    std::condition_variable cv;
+    std::vector<std::unique_ptr<Stage>> stages;
+    // 供 getStats 无锁遍历：阶段只增不删，追加时先写表项再发布计数
+    std::array<std::atomic<Stage*>, kMaxStages> stageTable{};
+    std::atomic<size_t> stageCount{ 0 };
+    size_t cursor = 0;                ///< 轮转调度起点
+    int fixedWorkers = 0;
+    std::atomic<bool> running{ false };
+    std::vector<std::thread> workers;
+};
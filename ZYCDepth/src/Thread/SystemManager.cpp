@@ -1,9 +1,21 @@
 ﻿#include "SystemManager.h"
 #include <iostream>
 #include <chrono>
+#include <algorithm>
 #include "WebSocket/WebSocketServer.h"
 #include"Inference/DepthInference.h"
+#include"Inference/InferencePipeline.h"
+#include"Inference/DepthPropagator.h"
+#include"ScreenGrabber/FrameRecorder.h"
+#include"ScreenGrabber/ChangeDetector.h"
+#include"Thread/FramePacer.h"
+#include"Mapping/TsdfVolume.h"
+#include"Mapping/IcpTracker.h"
+#include"Mapping/FeatureOdometry.h"
+#include"Mapping/KeyframeDatabase.h"
+#include"Mapping/MeshExtractor.h"
 #include"UIManager/UIManager.h"
+#include "Profiler/TraceProfiler.h"
 SystemManager& SystemManager::getInstance() {
     static SystemManager instance;
     return instance;
@@ -51,22 +63,18 @@ void SystemManager::start() {
     isRunning = true;
     LOG_INFO("System starting threads...");
 
-    // 放入线程池管理，this 指针用于访问成员
-    threadPool.emplace_back(&SystemManager::captureThreadWorker, this);
-    LOG_INFO("Capture thread launched.");
+    PipelineConfig config = SharedContext::getInstance().getPipelineConfig();
+    buildPipeline(config);
+    // /metrics 在 Web 线程上读取阶段统计（无锁）；stop() 先回收 Web 线程再销毁流水线
+    webServer->setStageStatsSource([this] { return pipeline->getStats(); });
+    pipeline->start();
+    LOG_INFO("Pipeline started.");
 
-    //threadPool.emplace_back(&SystemManager::webServerThreadWorker, this);
-    //LOG_INFO("WebServer thread launched.");
-    //threadPool.emplace_back(&SystemManager::webBroadcastThreadWorker, this);
-    //LOG_INFO("Web Broadcast thread launched.");
-
-    threadPool.emplace_back(&SystemManager::depthInferenceThreadWorker, this);
-    LOG_INFO("depthInference thread launched.");
-
-    // 3. 启动建图/AI 线程 (预留)
-    // threadPool.emplace_back(&SystemManager::mappingThreadWorker, this);
-    // LOG_INFO("Mapping thread launched.");
+    threadPool.emplace_back(&SystemManager::webServerThreadWorker, this);
+    LOG_INFO("WebServer thread launched.");
 
+    threadPool.emplace_back(&SystemManager::inferenceLoaderThreadWorker, this);
+    LOG_INFO("depthInference loader launched.");
 }
 
 void SystemManager::stop() {
@@ -75,11 +83,23 @@ void SystemManager::stop() {
     isRunning = false;
     SharedContext::getInstance().setIsMapping(false);
     SharedContext::getInstance().setIsInferencing(false);
-    // 等待后台线程结束
+    if (webServer) webServer->stop();
+    // 等待独立线程结束（模型加载线程可能仍在把推理阶段接入流水线）
     for (auto& t : threadPool) {
         if (t.joinable()) t.join();
     }
     threadPool.clear();
+    // 先停流水线：在途包持有推理上下文与输出缓冲，必须在推理引擎之前释放
+    if (pipeline) {
+        pipeline->stop();
+        for (const auto& stage : pipeline->getStats()) {
+            LOG_INFO("阶段 " + stage.name + ": 运行 " + std::to_string(stage.runs) + " 次, 丢弃 " + std::to_string(stage.dropped) +
+                ", 预算耗尽 " + std::to_string(stage.throttled) + ", 累计 " + std::to_string((long long)stage.busyMs) + " ms");
+        }
+        pipeline.reset();
+    }
+    inference.reset();
+    depthEngine.reset();
     // 清理 UI 资源
     UIManager::getInstance().shutdown();
 
@@ -87,6 +107,7 @@ void SystemManager::stop() {
 }
 
 void SystemManager::runWait() {
+    ZYC_PROFILE_THREAD("ui");
     // 【关键修改】主线程不再 sleep，而是直接运行 UI 循环
     // 这个函数会阻塞在这里，直到用户关闭 ImGui 窗口
     UIManager::getInstance().run();
@@ -95,56 +116,436 @@ void SystemManager::runWait() {
 }
 
 // ==========================================
-// 线程工作函数具体实现
+// 流水线阶段
 // ==========================================
 
-void SystemManager::captureThreadWorker() {
-    LOG_INFO("Capture Worker: Started.");
-    ScreenGrabber grabber;
-    long long frameID = 0;
+void SystemManager::buildPipeline(const PipelineConfig& config) {
+    pipeline = std::make_unique<PipelineGraph>(config.workerThreads);
+    addCaptureStage(config);
+    addEncodeStage(config);
+    addOdometryStage();
+    addMapStage();
+}
 
-    while (isRunning) {
-        // 1. 获取当前配置的频率
+void SystemManager::addCaptureStage(const PipelineConfig& config) {
+    // 截图状态只在截图阶段内访问（单实例，不会并发）
+    struct CaptureState {
+        ScreenGrabber grabber;
+        FrameRecorder recorder;
+        ChangeDetector changeDetector;
+        FramePacer pacer;
+        uint64_t configVersion = 0;
+        long long frameID = 0;
+    };
+    auto state = std::make_shared<CaptureState>();
+
+    StageSpec capture;
+    capture.name = "capture";
+    capture.outputs = { "frames" };
+    capture.maxConcurrency = 1;
+    capture.cpuBudget = config.stage("capture").cpuBudget;
+    PipelineGraph* graph = pipeline.get();
+    capture.fn = [state, graph](StageRun& run) {
+        // 1. 获取当前配置的频率；配置变更后重新开始节拍与变化检测
         auto config = SharedContext::getInstance().getCurrentCaptureConfig();
         int targetFps = (config.captureFps > 0) ? config.captureFps : 30;
-        int targetIntervalMs = 1000 / targetFps;
+        uint64_t configVersion = SharedContext::getInstance().getCaptureConfigVersion();
+        if (configVersion != state->configVersion) {
+            state->configVersion = configVersion;
+            state->changeDetector.reset();
+            state->pacer.reset();
+        }
 
-        // 2. 统计耗时并截图
-        auto startTime = std::chrono::high_resolution_clock::now();
+        // 2. 等到本帧的截止时间（调度器提前一点唤醒，这里补齐亚毫秒部分），统计耗时并截图
+        state->pacer.waitForDeadline();
+        int64_t grabStartNs = FrameTrace::nowNs();
 
-        auto matPtr = grabber.grab();
+        auto matPtr = state->grabber.grab();
 
-        auto endTime = std::chrono::high_resolution_clock::now();
-        double durationMs = std::chrono::duration<double, std::milli>(endTime - startTime).count();
+        int64_t grabEndNs = FrameTrace::nowNs();
+        double durationMs = (grabEndNs - grabStartNs) / 1e6;
 
         if (matPtr && !matPtr->empty()) {
             FrameData frame;
             frame.image = matPtr;
-            frame.sequenceID = ++frameID;
+            frame.trace = std::make_shared<FrameTrace>();
+            frame.trace->markAt(TracePoint::GrabStart, grabStartNs);
+            frame.trace->markAt(TracePoint::GrabEnd, grabEndNs);
+            frame.sequenceID = ++state->frameID;
             frame.timestamp = static_cast<double>(std::chrono::duration_cast<std::chrono::milliseconds>(
                 std::chrono::system_clock::now().time_since_epoch()).count());
             frame.captureDurationMs = durationMs; // 保存耗时
-            SharedContext::getInstance().setCurrentFrame(std::move(frame));
+            // 推理区域与排除区域：原图完整保留（预览、取色用），下游按 region() 取视图，不拷贝
+            frame.roi = config.roiRect(matPtr->size());
+            frame.frameSize = matPtr->size();
+            frame.masks = config.maskRects(matPtr->size());
+            // 画面变化检测：只看 ROI 内、排除区域以外；没有变化的帧只更新界面预览，不进入流水线，深度沿用上一帧
+            std::vector<cv::Rect> ignore;
+            for (const auto& mask : frame.masks) ignore.push_back(mask - frame.roi.tl());
+            frame.unchanged = !state->changeDetector.update((*matPtr)(frame.roi), config.changeThreshold, config.staticRefreshMs, ignore);
+            // 校准帧录制：UI 打开开关后按间隔落盘，录满后自动关闭
+            FrameRecorder& recorder = state->recorder;
+            if (SharedContext::getInstance().getIsRecording()) {
+                if (!recorder.isRecording()) {
+                    InferenceConfig inferConfig = SharedContext::getInstance().getInferenceConfig();
+                    recorder.start(inferConfig.calibrationDir, inferConfig.calibrationInterval, inferConfig.calibrationMaxFrames);
+                }
+                recorder.submit(frame);
+                SharedContext::getInstance().setRecordedFrames(recorder.getSavedCount());
+                if (!recorder.isRecording()) SharedContext::getInstance().setIsRecording(false);
+            }
+            else if (recorder.isRecording()) {
+                recorder.stop();
+            }
             SharedContext::getInstance().setCaptureTime(durationMs); // 新增
-            SharedContext::getInstance().setCurrentFrame(std::move(frame));
+            // 3. 发布给界面，并送入流水线
+            const bool unchanged = frame.unchanged;
+            FrameHandle handle = SharedContext::getInstance().setCurrentFrame(std::move(frame));
+            PipelineMetrics& metrics = SharedContext::getInstance().getPipelineMetrics();
+            metrics.countFrame(FrameStream::Capture);
+            if (unchanged) metrics.countFrame(FrameStream::Unchanged);
+            else run.emit("frames", { std::move(handle) });
         }
+        SharedContext::getInstance().setFramePoolStats(state->grabber.getFramePoolStats());
 
-        // 4. 动态计算睡眠时间，保证频率稳定
-        auto workTime = std::chrono::duration_cast<std::chrono::milliseconds>(
-            std::chrono::high_resolution_clock::now() - startTime).count();
-        long long sleepTime = targetIntervalMs - workTime;
+        // 4. 排下一帧：固定模式按目标频率，自适应模式跟随 frames 端口最慢订阅者的取包节奏；等待期间工作线程去跑其他阶段
+        // 全速回放模式：不限速，用于测量整条流水线的吞吐上限
+        if (config.Method == CaptureMethod::Replay && !config.replayRealtime) {
+            state->pacer.reset();
+            return;
+        }
+        std::vector<PortConsumer> consumers;
+        if (config.adaptivePacing) consumers = graph->getConsumers("frames");
+        run.runAgainAt(state->pacer.schedule(targetFps, consumers));
+    };
+    pipeline->addStage(std::move(capture));
+}
 
-        if (sleepTime > 0) {
-            std::this_thread::sleep_for(std::chrono::milliseconds(sleepTime));
+void SystemManager::addEncodeStage(const PipelineConfig& config) {
+    // 由此阶段专门负责将数据编码后发送给网页渲染显示；没有网页客户端时不调度，跳过编码与深度可视化
+    StageTuning tuning = config.stage("encode");
+    StageSpec encode;
+    encode.name = "encode";
+    encode.inputs = { { "frames", EdgePolicy::LatestOnly }, { "depth", EdgePolicy::LatestOnly }, { "mesh", EdgePolicy::LatestOnly } };
+    encode.concurrency = tuning.concurrency;
+    encode.cpuBudget = tuning.cpuBudget;
+    encode.gate = [this] { return webServer && webServer->getClientCount() > 0; };
+    encode.fn = [this](StageRun& run) {
+        if (run.input == 2) {
+            // 3. 地图网格：与上次发送的快照比较，只发送变化的分块（中间的快照被顶替也不会漏发）
+            webServer->broadcastMesh(std::any_cast<MapMeshHandle>(run.packet.payload));
+            return;
         }
-    }
-    LOG_INFO("Capture Worker: Exiting.");
+        const FrameHandle& frame = run.packet.frame;
+        if (!frame || frame->empty()) return;
+        if (run.input == 0) {
+            // 1. 广播原始游戏画面 (Base64 JSON，用于网页左侧预览)
+            webServer->broadcastImage("raw", *frame->image, frame->captureDurationMs);
+            SharedContext::getInstance().getPipelineMetrics().countFrame(FrameStream::BroadcastRaw);
+            // 新连接的客户端需要完整网格：建图暂停时不会再有网格包，借原图帧补发
+            if (webServer->isMeshResyncPending()) webServer->broadcastMesh(SharedContext::getInstance().getMapMesh());
+            return;
+        }
+        // 2. 广播深度图
+        if (frame->trace) frame->trace->mark(TracePoint::SendStart);
+        // A. 发送可视化图片 (Base64 JSON，用于网页右侧预览)
+        webServer->broadcastImage("depth", *frame->displayImage(), frame->captureDurationMs);
+        // B. 回投成点云发送 (网页 3D 点云直接上传顶点)，逐客户端记录 截图→网页 延迟
+        //    编码阶段可能多实例并发，回投器与点云缓冲按线程持有；隔 1 像素采样，相机系，颜色取最新原图
+        thread_local PointCloudBuilder cloudBuilder;
+        thread_local PointCloud cloud;
+        PointCloudBuilder::Options options;
+        options.stride = 2;
+        options.world = false;
+        FrameHandle colorFrame = SharedContext::getInstance().getCurrentFrame();
+        cloudBuilder.build(*frame, colorFrame->image ? *colorFrame->image : cv::Mat(), options, cloud);
+        webServer->broadcastPointCloud(*frame, cloud);
+        SharedContext::getInstance().getPipelineMetrics().countFrame(FrameStream::BroadcastDepth);
+        if (frame->trace) {
+            frame->trace->mark(TracePoint::SendEnd);
+            SharedContext::getInstance().getLatencyTracker().recordEncode(*frame->trace);
+        }
+    };
+    pipeline->addStage(std::move(encode));
+}
+
+void SystemManager::addPublishStage() {
+    // 深度通道是单写者，发布阶段固定单实例；多个推理工作者乱序完成的旧帧由通道按序列号忽略
+    StageSpec publish;
+    publish.name = "publish";
+    publish.inputs = { { "depth", EdgePolicy::LatestOnly } };
+    publish.maxConcurrency = 1;
+    publish.fn = [this](StageRun& run) {
+        const FrameHandle& depthFrame = run.packet.frame;
+        if (firstDepthFrame) {
+            firstDepthFrame = false;
+            // 从推理放行算起：就绪前已开启推理则从就绪算，否则从开启推理算，不含等待用户开启的时间
+            auto gateOpen = std::max(inferenceReady, SharedContext::getInstance().getInferenceEnabledTime());
+            startup.firstDepthFrameMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - gateOpen).count();
+            SharedContext::getInstance().setStartupMetrics(startup);
+            LOG_INFO("首个深度帧耗时: " + std::to_string((int)startup.firstDepthFrameMs) + " ms（加载 "
+                + std::to_string((int)startup.modelLoadMs) + " ms，预热 " + std::to_string((int)startup.warmupMs) + " ms，就绪 "
+                + std::to_string((int)startup.readyMs) + " ms）", true);
+        }
+        SharedContext::getInstance().setInferenceTime(depthFrame->captureDurationMs); // 新增
+        SharedContext::getInstance().setCurrentDepthFrame(depthFrame);
+        SharedContext::getInstance().getPipelineMetrics().countFrame(FrameStream::Inference);
+        if (depthFrame->trace) {
+            depthFrame->trace->mark(TracePoint::Publish);
+            SharedContext::getInstance().getLatencyTracker().recordPublished(*depthFrame->trace);
+        }
+    };
+    pipeline->addStage(std::move(publish));
+}
+
+void SystemManager::addMapStage() {
+    // 地图与网格只在该阶段内访问（单实例）；关闭建图时不调度，地图保留，再次开启继续融合
+    struct MapState {
+        explicit MapState(const MappingConfig& config) : volume(config) {}
+        TsdfVolume volume;
+        IcpTracker tracker;
+        uint64_t lostFrames = 0;
+        std::map<long long, OdometryPose> odometry;   ///< 最近的里程计位姿（按序列号），等对应的深度帧
+        KeyframeDatabase keyframes;
+        std::map<long long, FrameFeaturesHandle> features;   ///< 比对应深度帧先到的特征（按序列号）
+        double loopMs = 0.0;
+        size_t reanchoredBlocks = 0;
+
+        // 以关键帧 id 做回环检测；闭合时把各关键帧的块搬到校正后的位置，跟踪器的位姿随最新关键帧一起校正
+        void closeLoop(uint32_t id) {
+            KeyframeDatabase::LoopResult loop = keyframes.closeLoop(id);
+            loopMs = loop.ms;
+            if (!loop.closed) return;
+            const TsdfVolume::ReanchorStats moved = volume.reanchor(loop.corrections);
+            reanchoredBlocks = moved.movedBlocks;
+            const uint32_t latest = (uint32_t)keyframes.size();
+            for (const auto& [keyframe, correction] : loop.corrections) {
+                if (keyframe == latest) tracker.correct(correction);
+            }
+            LOG_INFO("闭合回环 " + std::to_string(loop.matched) + " → " + std::to_string(id) + "（" + std::to_string(loop.inliers)
+                + " 内点），搬动 " + std::to_string(moved.movedBlocks) + " 个体素块");
+        }
+
+        MeshExtractor mesher;
+        std::chrono::steady_clock::time_point lastMesh{};
+        MeshExtractor::Update lastUpdate;
+    };
+    auto state = std::make_shared<MapState>(SharedContext::getInstance().getMappingConfig());
+
+    StageSpec map;
+    map.name = "map";
+    // 里程计位姿比深度帧先到，用有界 FIFO 攒着，不能被后来的包顶替
+    map.inputs = { { "depth", EdgePolicy::LatestOnly }, { "poses", EdgePolicy::DropOldest, 32 }, { "features", EdgePolicy::DropOldest, 8 } };
+    map.outputs = { "mesh" };
+    map.maxConcurrency = 1;
+    map.gate = [] { return SharedContext::getInstance().getIsMapping(); };
+    map.fn = [state](StageRun& run) {
+        if (run.input == 1) {
+            const OdometryPose& pose = std::any_cast<const OdometryPose&>(run.packet.payload);
+            state->odometry[pose.sequenceID] = pose;
+            while (state->odometry.size() > 64) state->odometry.erase(state->odometry.begin());
+            return;
+        }
+        if (run.input == 2) {
+            const FrameFeaturesHandle& features = std::any_cast<const FrameFeaturesHandle&>(run.packet.payload);
+            // 深度帧已先一步成为关键帧：补上特征并检测回环；否则留给之后到达的深度帧
+            if (const uint32_t id = state->keyframes.attach(features->sequenceID, features)) {
+                if (SharedContext::getInstance().getMappingConfig().loopClosure) state->closeLoop(id);
+                return;
+            }
+            state->features[features->sequenceID] = features;
+            while (state->features.size() > 16) state->features.erase(state->features.begin());
+            return;
+        }
+        const FrameHandle& depthFrame = run.packet.frame;
+        if (!depthFrame || depthFrame->empty()) return;
+        MappingConfig config = SharedContext::getInstance().getMappingConfig();
+        if (state->volume.configure(config)) {
+            LOG_INFO("体素参数已变化，地图已清空");
+            state->tracker.reset();
+            state->keyframes.clear();
+        }
+        if (!depthFrame->rawDepth || depthFrame->rawDepth->empty()) return;
+
+        // 跟踪：把本帧对齐到地图后以修正位姿融合，再在该位姿下光线投射出下一帧的模型
+        // 关键帧：只有关键帧融合进地图（需要 ICP 跟踪给出的位姿，否则每帧都融合）
+        // 传播帧没有外参，只在 ICP 跟踪成功时以跟踪位姿融合
+        TsdfVolume::IntegrateStats result;
+        IcpTracker::Result tracked;
+        double raycastMs = 0.0;
+        const bool keyframing = config.icpTracking && config.keyframeMapping;
+        if (!keyframing && state->keyframes.size() > 0) {
+            state->keyframes.clear();
+            state->volume.setAnchor(0);
+        }
+        if (config.icpTracking) {
+            const bool hasModel = state->tracker.hasModel();
+            IcpTracker::Odometry odometry;
+            auto it = config.featureOdometry ? state->odometry.find(depthFrame->sequenceID) : state->odometry.end();
+            if (it != state->odometry.end()) odometry = { it->second.pose, it->second.epoch };
+            tracked = state->tracker.track(*depthFrame->rawDepth, depthFrame->roi, depthFrame->intrinsics, depthFrame->extrinsics,
+                it != state->odometry.end() ? &odometry : nullptr);
+            // 更早的位姿不会再用到（深度帧按序列号递增到达）
+            state->odometry.erase(state->odometry.begin(), it != state->odometry.end() ? std::next(it) : state->odometry.lower_bound(depthFrame->sequenceID));
+            if (hasModel && !tracked.tracked) state->lostFrames++;
+            const bool posed = tracked.tracked || !depthFrame->propagated;
+            if (posed && (!keyframing || !hasModel || state->keyframes.shouldAdmit(tracked.pose, tracked.inlierRatio, config))) {
+                uint32_t keyframe = 0;
+                FrameFeaturesHandle features;
+                if (keyframing) {
+                    auto found = state->features.find(depthFrame->sequenceID);
+                    if (found != state->features.end()) features = found->second;
+                    state->features.erase(state->features.begin(), state->features.upper_bound(depthFrame->sequenceID));
+                    keyframe = state->keyframes.admit(depthFrame->sequenceID, tracked.pose, features);
+                    state->volume.setAnchor(keyframe);
+                }
+                result = state->volume.integrate(*depthFrame->rawDepth, depthFrame->roi, depthFrame->intrinsics, tracked.pose.toMat());
+                if (keyframe != 0 && features && config.loopClosure) state->closeLoop(keyframe);
+                raycastMs = state->tracker.updateModel(state->volume);
+            }
+        }
+        else {
+            state->tracker.reset();
+            if (!depthFrame->propagated) result = state->volume.integrate(*depthFrame);
+        }
+
+        // 增量网格：间隔内多次融合的块只三角化一次；有变化时发布快照，网页按分块增量发送
+        auto now = std::chrono::steady_clock::now();
+        if (config.meshIntervalMs >= 0 && now - state->lastMesh >= std::chrono::milliseconds(config.meshIntervalMs)) {
+            state->lastMesh = now;
+            state->lastUpdate = state->mesher.extract(state->volume);
+            if (!state->lastUpdate.changed.empty() || !state->lastUpdate.removed.empty()) {
+                MapMeshHandle mesh = state->mesher.snapshot();
+                SharedContext::getInstance().setMapMesh(mesh);
+                run.emit("mesh", { depthFrame, mesh });
+            }
+        }
+
+        MappingStats stats;
+        stats.blocks = state->volume.blockCount();
+        stats.memoryBytes = state->volume.memoryBytes();
+        stats.touchedBlocks = result.touchedBlocks;
+        stats.allocateMs = result.allocateMs;
+        stats.integrateMs = result.integrateMs;
+        stats.frames = state->volume.frameCount();
+        stats.meshChunks = state->mesher.chunkCount();
+        stats.meshTriangles = state->mesher.triangleCount();
+        stats.remeshedBlocks = state->lastUpdate.remeshedBlocks;
+        stats.meshMs = state->lastUpdate.ms;
+        stats.tracking = tracked.tracked;
+        stats.odometryPrior = tracked.odometryPrior;
+        stats.icpRms = tracked.rms;
+        stats.icpInlierRatio = tracked.inlierRatio;
+        stats.icpMs = tracked.ms;
+        stats.raycastMs = raycastMs;
+        stats.lostFrames = state->lostFrames;
+        stats.keyframes = state->keyframes.size();
+        stats.loops = state->keyframes.loopCount();
+        stats.loopMs = state->loopMs;
+        stats.reanchoredBlocks = state->reanchoredBlocks;
+        SharedContext::getInstance().setMappingStats(stats);
+    };
+    pipeline->addStage(std::move(map));
 }
 
+void SystemManager::addOdometryStage() {
+    // 里程计状态只在该阶段内访问（单实例）；与推理并行消费截图帧，深度帧到达时更新参考关键帧
+    struct OdometryState {
+        explicit OdometryState(const MappingConfig& config) : odometry(config) {}
+        FeatureOdometry odometry;
+        OdometryStats stats;
+    };
+    auto state = std::make_shared<OdometryState>(SharedContext::getInstance().getMappingConfig());
+
+    StageSpec odometry;
+    odometry.name = "odometry";
+    odometry.inputs = { { "frames", EdgePolicy::LatestOnly }, { "depth", EdgePolicy::LatestOnly } };
+    odometry.outputs = { "poses", "features" };
+    odometry.maxConcurrency = 1;
+    odometry.gate = [] {
+        return SharedContext::getInstance().getIsMapping() && SharedContext::getInstance().getMappingConfig().featureOdometry;
+    };
+    odometry.fn = [state](StageRun& run) {
+        const FrameHandle& frame = run.packet.frame;
+        if (!frame || frame->empty()) return;
+        if (state->odometry.configure(SharedContext::getInstance().getMappingConfig())) state->stats = OdometryStats();
+        if (run.input == 1) {
+            // 有深度的特征同时交给建图阶段的关键帧库做地点识别
+            if (state->odometry.onDepth(*frame)) run.emit("features", { frame, state->odometry.depthFeatures() });
+            state->stats.referencePoints = state->odometry.referencePoints();
+            SharedContext::getInstance().setOdometryStats(state->stats);
+            return;
+        }
+        FeatureOdometry::Result result = state->odometry.onFrame(*frame);
+        if (result.tracked) {
+            SharedContext::getInstance().getPipelineMetrics().countFrame(FrameStream::Odometry);
+            run.emit("poses", { frame, result.pose });
+        }
+        else if (state->odometry.referencePoints() > 0) {
+            state->stats.lostFrames++;
+        }
+        state->stats.tracked = result.tracked;
+        state->stats.features = result.features;
+        state->stats.matches = result.matches;
+        state->stats.inliers = result.pose.inliers;
+        state->stats.extractMs = result.extractMs;
+        state->stats.trackMs = result.trackMs;
+        state->stats.referencePoints = state->odometry.referencePoints();
+        SharedContext::getInstance().setOdometryStats(state->stats);
+    };
+    pipeline->addStage(std::move(odometry));
+}
+
+void SystemManager::addPropagateStage(const InferenceConfig& config) {
+    // 传播状态只在该阶段内访问（单实例）
+    struct PropagateState {
+        explicit PropagateState(const InferenceConfig& config) : propagator(config) {}
+        DepthPropagator propagator;
+        long long lastEmitted = -1;
+    };
+    auto state = std::make_shared<PropagateState>(config);
+
+    StageSpec propagate;
+    propagate.name = "propagate";
+    // keydepth 用有界 FIFO：关键帧深度是传播的基准，不能被后来的包顶替
+    propagate.inputs = { { "frames", EdgePolicy::LatestOnly }, { "keydepth", EdgePolicy::DropOldest, 4 } };
+    propagate.outputs = { "keyframes", "depth" };
+    propagate.maxConcurrency = 1;
+    propagate.gate = [] { return SharedContext::getInstance().getIsInferencing(); };
+    propagate.fn = [state](StageRun& run) {
+        const FrameHandle& frame = run.packet.frame;
+        if (!frame || frame->empty()) return;
+        PipelineMetrics& metrics = SharedContext::getInstance().getPipelineMetrics();
+        if (run.input == 1) {
+            // 关键帧深度：成为新的传播基准；比已输出的帧新时直接发布
+            if (state->propagator.onKeyframeDepth(frame) && frame->sequenceID > state->lastEmitted) {
+                state->lastEmitted = frame->sequenceID;
+                run.emit("depth", { frame });
+            }
+            return;
+        }
+        DepthPropagator::Result result = state->propagator.onFrame(frame);
+        if (result.needKeyframe) {
+            metrics.countFrame(FrameStream::Keyframe);
+            run.emit("keyframes", { frame });
+        }
+        if (result.depth) {
+            metrics.countFrame(FrameStream::Propagated);
+            state->lastEmitted = result.depth->sequenceID;
+            run.emit("depth", { std::move(result.depth) });
+        }
+    };
+    pipeline->addStage(std::move(propagate));
+}
+
+// ==========================================
+// 独立线程
+// ==========================================
+
 void SystemManager::webServerThreadWorker() {
     LOG_INFO("Web Server Thread: Started.");
 
-    // 启动 uWS 循环（这会阻塞当前线程）
+    // 启动 uWS 循环（这会阻塞当前线程，stop() 关闭监听与所有连接后返回）
     if (webServer) {
         webServer->run();
     }
@@ -152,70 +553,37 @@ void SystemManager::webServerThreadWorker() {
     LOG_INFO("Web Server Thread: Exiting.");
 }
 
-void SystemManager::depthInferenceThreadWorker() {
-    LOG_INFO("depthInference Worker: Started. Initializing AI Model...");
+void SystemManager::inferenceLoaderThreadWorker() {
+    ZYC_PROFILE_THREAD("model-loader");
+    LOG_INFO("depthInference Loader: Started. Initializing AI Model...");
+    auto loaderStart = std::chrono::steady_clock::now();
+    InferenceConfig config = SharedContext::getInstance().getInferenceConfig();
 
     // 初始化推理引擎 (此处可选 ONNX 或将来扩展 TensorRT)
     auto engine = std::make_unique<ONNXDepthInference>();
-    if (!engine->init("models/DA3-SMALL-504.onnx")) {
+    engine->configure(config);
+    if (!engine->init(config.activeModelPath())) {
         LOG_ERR("AI Model Init Failed!");
         return;
     }
     LOG_INFO("AI Model Loaded Successfully.");
+    if (!isRunning) return;
 
-    long long lastProcessedID = -1;
-
-    while (isRunning) {
-        if (!SharedContext::getInstance().getIsInferencing()) {
-            std::this_thread::sleep_for(std::chrono::milliseconds(100));
-            continue;
-        }
-        FrameData frame = SharedContext::getInstance().waitForNewFrame(lastProcessedID);
-        if (frame.empty()) continue;
-        // 3. 执行 AI 推理
-        DepthResult result = engine->predict(*frame.image);
-        SharedContext::getInstance().setInferenceTime(result.inferTimeMs); // 新增
-        lastProcessedID = frame.sequenceID;
-        // 4. 封装完整结果
-        FrameData depthFrame;
-        // 仍然保留可视化图用于网页端 2D 预览
-        depthFrame.image = std::make_shared<cv::Mat>(result.visualDepth);
-        // 保存原始 float 深度图和矩阵用于 3D 还原
-        depthFrame.rawDepth = std::make_shared<cv::Mat>(result.depthMap);
-        depthFrame.intrinsics = result.intrinsics;
-        depthFrame.extrinsics = result.extrinsics;
-
-        depthFrame.sequenceID = frame.sequenceID;
-        depthFrame.captureDurationMs = result.inferTimeMs;
-        SharedContext::getInstance().setCurrentDepthFrame(std::move(depthFrame));
+    // 启动耗时：模型加载 + 预热 → 就绪；首帧从推理放行算起，在发布阶段记录
+    startup = engine->getStartupMetrics();
+    inferenceReady = std::chrono::steady_clock::now();
+    startup.readyMs = std::chrono::duration<double, std::milli>(inferenceReady - loaderStart).count();
+    SharedContext::getInstance().setStartupMetrics(startup);
+
+    // 预处理 / 推理 / 后处理 三个阶段接入流水线，结果经发布阶段写入深度通道
+    depthEngine = std::move(engine);
+    inference = std::make_unique<InferencePipeline>(*depthEngine, config.pipelineDepth);
+    addPublishStage();
+    if (config.depthPropagation) {
+        addPropagateStage(config);
+        inference->attach(*pipeline, SharedContext::getInstance().getPipelineConfig(), "keyframes", "keydepth");
     }
-    LOG_INFO("depthInference Worker: Exiting.");
-}
-
-// 由此线程专门负责将数据发送给网页渲染显示
-void SystemManager::webBroadcastThreadWorker() {
-    LOG_INFO("Web Broadcast Worker: Started.");
-    long long lastRawID = -1;
-    long long lastDepthID = -1;
-    while (isRunning) {
-        // 1. 广播原始游戏画面 (Base64 JSON，用于网页左侧预览)
-        FrameData rawFrame = SharedContext::getInstance().getCurrentFrame();
-        if (!rawFrame.empty() && rawFrame.sequenceID > lastRawID) {
-            webServer->broadcastImage("raw", *rawFrame.image, rawFrame.captureDurationMs);
-            lastRawID = rawFrame.sequenceID;
-        }
-        // 2. 广播深度图
-        FrameData depthFrame = SharedContext::getInstance().getCurrentDepthFrame();
-        if (!depthFrame.empty() && depthFrame.sequenceID > lastDepthID) {
-            // A. 发送可视化图片 (Base64 JSON，用于网页右侧预览)
-            webServer->broadcastImage("depth", *depthFrame.image, depthFrame.captureDurationMs);
-
-            // B. 发送二进制深度数据 (用于网页 3D 点云还原)
-            webServer->broadcastDepthBinary(depthFrame);
-
-            lastDepthID = depthFrame.sequenceID;
-        }
-        // 保持 30fps 的检查频率
-        std::this_thread::sleep_for(std::chrono::milliseconds(33));
+    else {
+        inference->attach(*pipeline, SharedContext::getInstance().getPipelineConfig());
     }
 }
@@ -4,14 +4,17 @@
 #include <atomic>
 #include <memory>
 #include <functional>
+#include <chrono>
 
 // 引入你的组件
 #include "ScreenGrabber/ScreenGrabber.h"
 #include "Log/Logger.h"
 #include "Data/CommonTypes.h"
+#include "Thread/PipelineGraph.h"
 
-// 前向声明 WebSocket 服务（暂时还没写，留个位置）
 class WebSocketServer;
+class IDepthInference;
+class InferencePipeline;
 
 class SystemManager {
 public:
@@ -31,7 +34,7 @@ public:
 
     /**
      * @brief 启动系统
-     * @details 拉起所有工作线程
+     * @details 搭建流水线图并启动共享工作线程，拉起 Web 服务器与模型加载线程
      */
     void start();
 
@@ -51,21 +54,40 @@ private:
     SystemManager();
     ~SystemManager();
 
-    // 线程工作函数
-    void captureThreadWorker();    // 截图线程逻辑
-    void mappingThreadWorker();    // 建图/AI线程逻辑（预留）
-    void webServerThreadWorker();  // Web服务器线程逻辑
-
-    void depthInferenceThreadWorker();
+    /**
+     * @brief 搭建流水线图
+     * @details capture ─frames→ preprocess → infer → postprocess ─depth→ publish
+     *                   └─────────────────────────────────────────┴→ encode（网页）
+     *                                                                └→ map（TSDF 建图）
+     *          frames + depth → odometry（特征点视觉里程计）─poses→ map（ICP 的帧间运动初值）
+     *                                                       └features→ map（关键帧地点识别与回环）
+     *          推理三段由 InferencePipeline 在模型加载完成后接入，阶段并发数/CPU 预算见 PipelineConfig
+     */
+    void buildPipeline(const PipelineConfig& config);
+    void addCaptureStage(const PipelineConfig& config);
+    void addEncodeStage(const PipelineConfig& config);
+    void addPublishStage();
+    void addMapStage();
+    void addOdometryStage();
+    // 深度传播模式：frames → propagate ─keyframes→ 推理三段 ─keydepth→ propagate ─depth→ 发布/网页
+    void addPropagateStage(const InferenceConfig& config);
 
-    void webBroadcastThreadWorker();
+    // 独立线程：uWS 事件循环与模型加载都会长时间阻塞，不占用流水线工作线程
+    void webServerThreadWorker();       // Web服务器线程逻辑
+    void inferenceLoaderThreadWorker(); // 加载模型并预热，完成后把推理阶段接入流水线
 
 private:
     std::atomic<bool> isRunning{ false }; // 全局运行标志
-    std::vector<std::thread> threadPool;  // 线程池管理所有线程句柄
+    std::vector<std::thread> threadPool;  // 独立线程（Web 服务器、模型加载）
 
     // 子模块实例
-    std::unique_ptr<ScreenGrabber> screenGrabber;
     std::unique_ptr<WebSocketServer> webServer;
-    // std::unique_ptr<WebSocketServer> webServer; // 待实现
-};
\ No newline at end of file
+    std::unique_ptr<PipelineGraph> pipeline;       // 共享工作线程上的阶段图，先于推理引擎停止
+    std::unique_ptr<IDepthInference> depthEngine;
+    std::unique_ptr<InferencePipeline> inference;
+
+    // 启动耗时统计：加载线程写入，之后只在发布阶段（单实例）访问
+    StartupMetrics startup;
+    std::chrono::steady_clock::time_point inferenceReady;
+    bool firstDepthFrame = true;
+};
@@ -2,7 +2,11 @@
 #include "Thread/SystemManager.h"
 #include "Data/CommonTypes.h"
 #include "Log/Logger.h"
+#include "Profiler/TraceProfiler.h"
 #include <algorithm> // 必须包含这个
+#include <cfloat>
+#include <cmath>
+#include <filesystem>
 #include <iostream>
 
 // 导入 ImGui 内部 Win32 处理函数
@@ -199,7 +203,7 @@ void UIManager::updateUI() {
     ImGui::TextColored(ImVec4(0.5f, 0.8f, 0.0f, 1.0f), "SYSTEM CONTROL");
     ImGui::Separator();
     // --- 新增：性能监控仪表盘 ---
-    ImGui::BeginChild("PerfMetrics", ImVec2(0, 80), true);
+    ImGui::BeginChild("PerfMetrics", ImVec2(0, 118), true);
     {
         double capTime = SharedContext::getInstance().getCaptureTime();
         double infTime = SharedContext::getInstance().getInferenceTime();
@@ -210,13 +214,49 @@ void UIManager::updateUI() {
         ImGui::Text("推理耗时");
         ImGui::TextColored(ImVec4(1.0f, 0.8f, 0.0f, 1.0f), "%.1f ms", infTime);
         ImGui::Columns(1);
+        FramePoolStats pool = SharedContext::getInstance().getFramePoolStats();
+        ImGui::TextDisabled("帧池 命中 %llu / 分配 %llu / 在用 %lld / 耗尽丢帧 %llu",
+            (unsigned long long)pool.hits, (unsigned long long)pool.misses, (long long)pool.inFlight,
+            (unsigned long long)pool.exhausted);
+        StartupMetrics startup = SharedContext::getInstance().getStartupMetrics();
+        if (startup.firstDepthFrameMs >= 0.0) {
+            ImGui::TextDisabled("启动 加载 %.0f ms%s / 预热 %.0f ms / 首帧 %.0f ms", startup.modelLoadMs,
+                startup.optimizedCacheHit ? " (缓存)" : "", startup.warmupMs, startup.firstDepthFrameMs);
+        }
     }
     ImGui::EndChild();
+    // 端到端延迟分解：截图开始 → 各段耗时/排队 → 深度发布 → 网页客户端
+    if (ImGui::CollapsingHeader("延迟分位数 (近 10 s)")) {
+        LatencyTracker& latency = SharedContext::getInstance().getLatencyTracker();
+        ImGui::Columns(4, "latency_cols", false);
+        ImGui::SetColumnWidth(0, 90);
+        ImGui::TextDisabled("ms"); ImGui::NextColumn();
+        ImGui::TextDisabled("p50"); ImGui::NextColumn();
+        ImGui::TextDisabled("p95"); ImGui::NextColumn();
+        ImGui::TextDisabled("p99"); ImGui::NextColumn();
+        for (int i = 0; i < (int)LatencyMetric::Count; ++i) {
+            auto metric = (LatencyMetric)i;
+            LatencyHistogram::Summary summary = latency.summary(metric);
+            bool endToEnd = metric == LatencyMetric::GlassToDepth || metric == LatencyMetric::GlassToClient;
+            ImVec4 color = endToEnd ? ImVec4(1.0f, 0.8f, 0.0f, 1.0f) : ImVec4(0.8f, 0.8f, 0.8f, 1.0f);
+            ImGui::TextColored(color, "%s", LatencyTracker::name(metric)); ImGui::NextColumn();
+            if (summary.count == 0) {
+                ImGui::TextDisabled("-"); ImGui::NextColumn();
+                ImGui::TextDisabled("-"); ImGui::NextColumn();
+                ImGui::TextDisabled("-"); ImGui::NextColumn();
+                continue;
+            }
+            ImGui::TextColored(color, "%.2f", summary.p50); ImGui::NextColumn();
+            ImGui::TextColored(color, "%.2f", summary.p95); ImGui::NextColumn();
+            ImGui::TextColored(color, "%.2f", summary.p99); ImGui::NextColumn();
+        }
+        ImGui::Columns(1);
+    }
     ImGui::Spacing();
 
     auto config = SharedContext::getInstance().getCurrentCaptureConfig();
     bool changed = false;
-    const char* methods[] = { "GDI", "DirectX", "WinGC" };
+    const char* methods[] = { "GDI", "DirectX", "WinGC", "Replay" };
     int current_method = (int)config.Method;
     const char* preview = (selectedWindowIdx == -1) ? "选择游戏窗口..." : windowList[selectedWindowIdx].c_str();
     if (ImGui::BeginCombo("##TargetWindow", preview)) {
@@ -231,22 +271,112 @@ void UIManager::updateUI() {
         }
         ImGui::EndCombo();
     }
-    if (ImGui::Combo("Capture Tech", &current_method, methods, 3)) {
+    if (ImGui::Combo("Capture Tech", &current_method, methods, 4)) {
         config.Method = (CaptureMethod)current_method;
         changed = true;
     }
+    if (config.Method == CaptureMethod::Replay) {
+        // 回放源路径：回车确认后才提交，避免每输入一个字符就重建策略
+        static char replayPath[512] = {};
+        if (replayPath[0] == '\0' && !config.replaySource.empty()) {
+            strncpy_s(replayPath, config.replaySource.c_str(), sizeof(replayPath) - 1);
+        }
+        if (ImGui::InputText("Replay Source", replayPath, sizeof(replayPath), ImGuiInputTextFlags_EnterReturnsTrue)) {
+            config.replaySource = replayPath;
+            changed = true;
+        }
+        if (ImGui::Checkbox("Realtime Pacing", &config.replayRealtime)) changed = true;
+        if (ImGui::Checkbox("Loop", &config.replayLoop)) changed = true;
+    }
     if (ImGui::SliderInt("FPS Limit", &config.captureFps, 1, 60)) changed = true;
+    if (ImGui::Checkbox("Adaptive Pacing", &config.adaptivePacing)) changed = true;
+    // 推理区域（归一化 x, y, w, h），排除区域通过网页 set_capture_config 的 exclude_masks 设置
+    float roi[4] = { config.roi.x, config.roi.y, config.roi.width, config.roi.height };
+    if (ImGui::DragFloat4("ROI", roi, 0.005f, 0.0f, 1.0f, "%.3f")) {
+        config.roi = cv::Rect2f(roi[0], roi[1], roi[2], roi[3]);
+        changed = true;
+    }
+    if (config.adaptivePacing) {
+        ImGui::SameLine();
+        ImGui::TextDisabled("%.1f ms", SharedContext::getInstance().getPipelineMetrics().getCapturePeriodMs());
+    }
+    // 画面变化检测阈值：静止画面跳过推理，-1 关闭
+    float changeThreshold = (float)config.changeThreshold;
+    if (ImGui::SliderFloat("Change Threshold", &changeThreshold, -1.0f, 20.0f, "%.1f")) {
+        config.changeThreshold = changeThreshold;
+        changed = true;
+    }
 
     bool isInfer = SharedContext::getInstance().getIsInferencing();
     if (ImGui::Checkbox("Inference Active", &isInfer)) SharedContext::getInstance().setIsInferencing(isInfer);
 
+    bool isRecord = SharedContext::getInstance().getIsRecording();
+    if (ImGui::Checkbox("Record Calib Frames", &isRecord)) SharedContext::getInstance().setIsRecording(isRecord);
+    if (isRecord || SharedContext::getInstance().getRecordedFrames() > 0) {
+        ImGui::SameLine();
+        ImGui::TextDisabled("%d", SharedContext::getInstance().getRecordedFrames());
+    }
+#ifdef ZYC_PROFILER
+    // 导出各线程最近的时间线（也可用 Ctrl+Break 或网页 dump_trace 命令）
+    if (ImGui::Button("Dump Trace")) TraceProfiler::getInstance().dump();
+#endif
+
     if (changed) SharedContext::getInstance().setCurrentCaptureConfig(config);
 
-    // 这里可以放你寻路算法的参数调优
+    // 建图（TSDF 融合）：体素尺寸变化时地图清空重建
     ImGui::Separator();
-    ImGui::Text("Pathfinding Params");
-    static float voxelSize = 0.1f;
-    ImGui::DragFloat("Voxel Size", &voxelSize, 0.01f, 0.01f, 1.0f);
+    ImGui::Text("Mapping");
+    bool isMapping = SharedContext::getInstance().getIsMapping();
+    if (ImGui::Checkbox("Mapping Active", &isMapping)) SharedContext::getInstance().setIsMapping(isMapping);
+    MappingConfig mapping = SharedContext::getInstance().getMappingConfig();
+    if (ImGui::DragFloat("Voxel Size", &mapping.voxelSize, 0.01f, 0.01f, 1.0f)) {
+        SharedContext::getInstance().setMappingConfig(mapping);
+    }
+    if (ImGui::Checkbox("ICP Tracking", &mapping.icpTracking)) {
+        SharedContext::getInstance().setMappingConfig(mapping);
+    }
+    MappingStats mapStats = SharedContext::getInstance().getMappingStats();
+    ImGui::TextDisabled("blocks %zu (%.1f MB), touched %zu", mapStats.blocks, mapStats.memoryBytes / (1024.0 * 1024.0), mapStats.touchedBlocks);
+    ImGui::TextDisabled("alloc %.1f ms, integrate %.1f ms", mapStats.allocateMs, mapStats.integrateMs);
+    if (mapping.icpTracking) {
+        ImGui::TextDisabled("icp %s, rms %.1f cm, inliers %.0f%%, lost %llu", mapStats.tracking ? "ok" : "lost",
+            mapStats.icpRms * 100.0f, mapStats.icpInlierRatio * 100.0f, (unsigned long long)mapStats.lostFrames);
+        ImGui::TextDisabled("icp %.1f ms, raycast %.1f ms, prior %s", mapStats.icpMs, mapStats.raycastMs,
+            mapStats.odometryPrior ? "odometry" : "network");
+    }
+    if (ImGui::Checkbox("Feature Odometry", &mapping.featureOdometry)) {
+        SharedContext::getInstance().setMappingConfig(mapping);
+    }
+    if (mapping.featureOdometry) {
+        OdometryStats odoStats = SharedContext::getInstance().getOdometryStats();
+        ImGui::TextDisabled("vo %s, %d feats, %d/%d inliers, ref %d pts, lost %llu", odoStats.tracked ? "ok" : "lost",
+            odoStats.features, odoStats.inliers, odoStats.matches, odoStats.referencePoints, (unsigned long long)odoStats.lostFrames);
+        ImGui::TextDisabled("extract %.1f ms, track %.1f ms", odoStats.extractMs, odoStats.trackMs);
+    }
+    // 关键帧与回环需要 ICP 跟踪；回环检测还需要视觉里程计提供的特征
+    if (ImGui::Checkbox("Keyframes", &mapping.keyframeMapping)) {
+        SharedContext::getInstance().setMappingConfig(mapping);
+    }
+    ImGui::SameLine();
+    if (ImGui::Checkbox("Loop Closure", &mapping.loopClosure)) {
+        SharedContext::getInstance().setMappingConfig(mapping);
+    }
+    if (mapping.icpTracking && mapping.keyframeMapping) {
+        ImGui::TextDisabled("keyframes %zu, loops %llu, last %.1f ms, moved %zu blocks", mapStats.keyframes,
+            (unsigned long long)mapStats.loops, mapStats.loopMs, mapStats.reanchoredBlocks);
+    }
+    ImGui::Checkbox("Show Mesh", &showMesh);
+    ImGui::SameLine();
+    // 导出最近绘制的点云（世界系，带颜色）
+    if (ImGui::Button("Export Cloud") && cloud.count > 0) {
+        std::error_code ec;
+        std::filesystem::create_directories("exports", ec);
+        const std::string path = "exports/pointcloud_" + std::to_string(cloudSequence) + ".ply";
+        if (PointCloudBuilder::writePly(path, cloud)) LOG_INFO("点云已导出: " + path + "（" + std::to_string(cloud.count) + " 点）", true);
+        else LOG_ERR("点云导出失败: " + path, true);
+    }
+    ImGui::TextDisabled("mesh %zu chunks, %zu tris", mapStats.meshChunks, mapStats.meshTriangles);
+    ImGui::TextDisabled("remeshed %zu blocks in %.1f ms", mapStats.remeshedBlocks, mapStats.meshMs);
 
     ImGui::EndChild();
 
@@ -260,34 +390,46 @@ void UIManager::updateUI() {
         ImGui::BeginChild("RawView", ImVec2(0, contentHeight * 0.5f - 5), true, ImGuiWindowFlags_NoScrollbar);
         ImGui::Text("RAW FEED");
 
-        auto raw = SharedContext::getInstance().getCurrentFrame();
-        if (!raw.empty()) {
-            ImTextureID tex = getTextureFromMat("raw_ui", *raw.image);
+        FrameHandle raw = SharedContext::getInstance().getCurrentFrame();
+        if (!raw->empty()) {
+            ImTextureID tex = getTextureFromMat("raw_ui", *raw->image);
 
             // 获取当前子窗口剩余的可读区域大小
             ImVec2 availSize = ImGui::GetContentRegionAvail();
 
             // 计算自适应大小（保持原图比例，且不超出 availSize）
-            ImVec2 displaySize = CalcMaxFillSize((float)raw.image->cols, (float)raw.image->rows, availSize);
+            ImVec2 displaySize = CalcMaxFillSize((float)raw->image->cols, (float)raw->image->rows, availSize);
 
             // 居中显示（可选）
             float offsetX = (availSize.x - displaySize.x) * 0.5f;
             float offsetY = (availSize.y - displaySize.y) * 0.5f;
             ImGui::SetCursorPos(ImVec2(ImGui::GetCursorPosX() + offsetX, ImGui::GetCursorPosY() + offsetY));
+            ImVec2 imageMin = ImGui::GetCursorScreenPos();
             ImGui::Image(tex, displaySize);
+            // 叠加推理区域（绿）与排除区域（红）
+            ImDrawList* overlay = ImGui::GetWindowDrawList();
+            float scale = displaySize.x / raw->image->cols;
+            auto drawRect = [&](const cv::Rect& r, ImU32 color) {
+                overlay->AddRect(ImVec2(imageMin.x + r.x * scale, imageMin.y + r.y * scale),
+                    ImVec2(imageMin.x + (r.x + r.width) * scale, imageMin.y + (r.y + r.height) * scale), color);
+            };
+            if (raw->region() != cv::Rect(0, 0, raw->image->cols, raw->image->rows)) drawRect(raw->region(), IM_COL32(0, 255, 0, 255));
+            for (const auto& mask : raw->masks) drawRect(mask, IM_COL32(255, 60, 60, 255));
         }
         ImGui::EndChild();
         // 2. 深度图预览 (AI DEPTH)
         ImGui::BeginChild("DepthView", ImVec2(0, 0), true, ImGuiWindowFlags_NoScrollbar);
         ImGui::Text("AI DEPTH");
 
-        auto depth = SharedContext::getInstance().getCurrentDepthFrame();
-        if (!depth.empty()) {
-            ImTextureID tex = getTextureFromMat("depth_ui", *depth.image);
+        FrameHandle depth = SharedContext::getInstance().getCurrentDepthFrame();
+        // 可视化图按需生成，同一帧只生成一次
+        auto depthImage = depth->empty() ? nullptr : depth->displayImage();
+        if (depthImage && !depthImage->empty()) {
+            ImTextureID tex = getTextureFromMat("depth_ui", *depthImage);
 
             ImVec2 availSize = ImGui::GetContentRegionAvail();
             // 同样的缩放算法
-            ImVec2 displaySize = CalcMaxFillSize((float)depth.image->cols, (float)depth.image->rows, availSize);
+            ImVec2 displaySize = CalcMaxFillSize((float)depthImage->cols, (float)depthImage->rows, availSize);
 
             float offsetX = (availSize.x - displaySize.x) * 0.5f;
             float offsetY = (availSize.y - displaySize.y) * 0.5f;
@@ -338,9 +480,11 @@ void UIManager::updateUI() {
 
 void UIManager::renderPointCloud(ImVec2 canvasPos, ImVec2 canvasSize) {
     // 1. 数据获取
-    auto depthFrame = SharedContext::getInstance().getCurrentDepthFrame();
-    auto rawFrame = SharedContext::getInstance().getCurrentFrame();
-    if (depthFrame.empty() || !depthFrame.rawDepth || rawFrame.empty()) return;
+    FrameHandle depthFrame = SharedContext::getInstance().getCurrentDepthFrame();
+    FrameHandle rawFrame = SharedContext::getInstance().getCurrentFrame();
+    const bool hasDepth = !depthFrame->empty() && depthFrame->rawDepth && !rawFrame->empty();
+    if (showMesh) syncMeshCache();
+    if (!hasDepth && (!showMesh || meshCache.empty())) return;
     // --- 2. 交互状态保存 (使用 static 保持状态) ---
     static float zoom = 810.0f;
     static float rotX = -0.25f;   // 初始俯视角度
@@ -380,59 +524,102 @@ void UIManager::renderPointCloud(ImVec2 canvasPos, ImVec2 canvasSize) {
     }
     // --- 4. 准备绘图 ---
     ImDrawList* drawList = ImGui::GetWindowDrawList();
-    cv::Mat& K = depthFrame.intrinsics;
-    cv::Mat& Rt = depthFrame.extrinsics;
-    cv::Mat& dMap = *depthFrame.rawDepth;
-    cv::Mat& colorMap = *rawFrame.image;
-    float fx = K.at<float>(0, 0), fy = K.at<float>(1, 1);
-    float cx = K.at<float>(0, 2), cy = K.at<float>(1, 2);
-    cv::Mat R = Rt(cv::Rect(0, 0, 3, 3));
-    cv::Mat t = Rt(cv::Rect(3, 0, 1, 3));
-    int step =1; // 采样步长（每几个像素采样一次）目前是每个像素都采样，可以增加步长提高性能
-    float uvToColorX = (float)colorMap.cols / dMap.cols;
-    float uvToColorY = (float)colorMap.rows / dMap.rows;
-    // --- 5. 循环渲染点云 ---
-    for (int v = 0; v < dMap.rows; v += step) {
-        for (int u = 0; u < dMap.cols; u += step) {
-            float z = dMap.at<float>(v, u);
-            if (z <= 0.1f || z > 50.0f) continue;
-            // A. 相机系 -> 世界系 (同前)
-            float xc = (u - cx) * z / fx;
-            float yc = (v - cy) * z / fy;
-            float zc = z;
-            float xw = R.at<float>(0, 0) * xc + R.at<float>(0, 1) * yc + R.at<float>(0, 2) * zc + t.at<float>(0, 0);
-            float yw = R.at<float>(1, 0) * xc + R.at<float>(1, 1) * yc + R.at<float>(1, 2) * zc + t.at<float>(1, 0);
-            float zw = R.at<float>(2, 0) * xc + R.at<float>(2, 1) * yc + R.at<float>(2, 2) * zc + t.at<float>(2, 0);
-            // B. 坐标修正
-            float xf = xw;
-            float yf = yw;
-            float zf = zw;
-            // C. 旋转变换
-            // 绕 Y 轴
-            float rx = xf * cos(rotY) + zf * sin(rotY);
-            float rz = -xf * sin(rotY) + zf * cos(rotY);
-            // 绕 X 轴
-            float ry = yf * cos(rotX) - rz * sin(rotX);
-
-            // D. 最终投影到屏幕 (加上 panOffset)
-            float screenX = canvasPos.x + (canvasSize.x * 0.5f) + rx * zoom + panOffset.x;
-            float screenY = canvasPos.y + (canvasSize.y * 0.5f) + ry * zoom + panOffset.y;
-            // E. 画布裁剪检查与取色绘制
-            if (screenX > canvasPos.x && screenX < canvasPos.x + canvasSize.x &&
-                screenY > canvasPos.y && screenY < canvasPos.y + canvasSize.y) {
-
-                int cU = (int)(u * uvToColorX);
-                int cV = (int)(v * uvToColorY);
-                cv::Vec3b bgr = colorMap.at<cv::Vec3b>(std::min(cV, colorMap.rows - 1), std::min(cU, colorMap.cols - 1));
-
-                drawList->AddRectFilled(
-                    ImVec2(screenX, screenY),
-                    ImVec2(screenX + 1.5f, screenY + 1.5f),
-                    IM_COL32(bgr[2], bgr[1], bgr[0], 255)
-                );
+    const float cosY = cos(rotY), sinY = sin(rotY), cosX = cos(rotX), sinX = sin(rotX);
+    const ImVec2 origin(canvasPos.x + canvasSize.x * 0.5f + panOffset.x, canvasPos.y + canvasSize.y * 0.5f + panOffset.y);
+
+    // 地图网格画在点云下面：分块按中心深度由远到近画（画家算法），分块内不排序
+    if (showMesh && !meshCache.empty()) {
+        ZYC_PROFILE_SCOPE("UI::renderMesh");
+        std::vector<std::pair<float, const UiMeshChunk*>> order;
+        order.reserve(meshCache.size());
+        for (const auto& [id, chunk] : meshCache) {
+            const float rz = -chunk.center[0] * sinY + chunk.center[2] * cosY;
+            order.emplace_back(chunk.center[1] * sinX + rz * cosX, &chunk);
+        }
+        std::sort(order.begin(), order.end(), [](const auto& a, const auto& b) { return a.first > b.first; });
+
+        std::vector<ImVec2> screen;
+        for (const auto& [depth, chunk] : order) {
+            const MeshChunk& mesh = *chunk->mesh;
+            screen.resize(mesh.vertexCount());
+            for (size_t i = 0; i < screen.size(); ++i) {
+                const float* p = &mesh.vertices[i * 3];
+                const float rx = p[0] * cosY + p[2] * sinY;
+                const float rz = -p[0] * sinY + p[2] * cosY;
+                screen[i] = ImVec2(origin.x + rx * zoom, origin.y + (p[1] * cosX - rz * sinX) * zoom);
+            }
+            for (size_t t = 0; t < chunk->faceColors.size(); ++t) {
+                const ImVec2& a = screen[mesh.indices[t * 3]];
+                const ImVec2& b = screen[mesh.indices[t * 3 + 1]];
+                const ImVec2& c = screen[mesh.indices[t * 3 + 2]];
+                // 整个三角形都在画布同一侧外面时跳过
+                if ((a.x < canvasPos.x && b.x < canvasPos.x && c.x < canvasPos.x) ||
+                    (a.y < canvasPos.y && b.y < canvasPos.y && c.y < canvasPos.y) ||
+                    (a.x > canvasPos.x + canvasSize.x && b.x > canvasPos.x + canvasSize.x && c.x > canvasPos.x + canvasSize.x) ||
+                    (a.y > canvasPos.y + canvasSize.y && b.y > canvasPos.y + canvasSize.y && c.y > canvasPos.y + canvasSize.y)) continue;
+                drawList->AddTriangleFilled(a, b, c, chunk->faceColors[t]);
             }
         }
     }
+    if (!hasDepth) return;
+
+    // --- 5. 回投（世界系、按原图取色）后投影到画布 ---
+    {
+        ZYC_PROFILE_SCOPE("UI::renderPointCloud");
+        cloudBuilder.build(*depthFrame, *rawFrame->image, PointCloudBuilder::Options(), cloud);
+        cloudSequence = depthFrame->sequenceID;
+    }
+    const float right = canvasPos.x + canvasSize.x, bottom = canvasPos.y + canvasSize.y;
+    const bool hasColor = !cloud.rgba.empty();
+    for (size_t i = 0; i < cloud.count; ++i) {
+        // 绕 Y 轴、再绕 X 轴旋转后正交投影
+        const float rx = cloud.x[i] * cosY + cloud.z[i] * sinY;
+        const float rz = -cloud.x[i] * sinY + cloud.z[i] * cosY;
+        const float screenX = origin.x + rx * zoom;
+        const float screenY = origin.y + (cloud.y[i] * cosX - rz * sinX) * zoom;
+        if (screenX > canvasPos.x && screenX < right && screenY > canvasPos.y && screenY < bottom) {
+            drawList->AddRectFilled(ImVec2(screenX, screenY), ImVec2(screenX + 1.5f, screenY + 1.5f),
+                hasColor ? (ImU32)cloud.rgba[i] : IM_COL32(255, 255, 255, 255));
+        }
+    }
+}
+
+void UIManager::syncMeshCache() {
+    MapMeshHandle mesh = SharedContext::getInstance().getMapMesh();
+    if (!mesh || mesh->version == meshCacheVersion) return;
+    meshCacheVersion = mesh->version;
+
+    for (auto it = meshCache.begin(); it != meshCache.end();) {
+        if (mesh->chunks.count(it->first)) ++it;
+        else it = meshCache.erase(it);
+    }
+    for (const auto& [id, chunk] : mesh->chunks) {
+        UiMeshChunk& cached = meshCache[id];
+        if (cached.mesh == chunk) continue;   // 未重新提取的分块是同一个句柄
+        cached.mesh = chunk;
+
+        float lo[3] = { FLT_MAX, FLT_MAX, FLT_MAX }, hi[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+        for (size_t i = 0; i < chunk->vertices.size(); ++i) {
+            lo[i % 3] = std::min(lo[i % 3], chunk->vertices[i]);
+            hi[i % 3] = std::max(hi[i % 3], chunk->vertices[i]);
+        }
+        for (int a = 0; a < 3; ++a) cached.center[a] = 0.5f * (lo[a] + hi[a]);
+
+        // 平面着色：光从斜上方来（世界系 y 向下），取绝对值让背面也有亮度
+        const float light[3] = { 0.303f, -0.808f, -0.505f };   // 单位向量
+        cached.faceColors.resize(chunk->triangleCount());
+        for (size_t t = 0; t < cached.faceColors.size(); ++t) {
+            const float* a = &chunk->vertices[chunk->indices[t * 3] * 3];
+            const float* b = &chunk->vertices[chunk->indices[t * 3 + 1] * 3];
+            const float* c = &chunk->vertices[chunk->indices[t * 3 + 2] * 3];
+            const float e1[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+            const float e2[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+            const float n[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+            const float len = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+            const float shade = 0.3f + 0.7f * (len > 0.0f ? std::abs(n[0] * light[0] + n[1] * light[1] + n[2] * light[2]) / len : 0.0f);
+            cached.faceColors[t] = IM_COL32((int)(60 * shade), (int)(220 * shade), (int)(170 * shade), 255);
+        }
+    }
 }
 
 ImTextureID UIManager::getTextureFromMat(const std::string& name, const cv::Mat& mat) {
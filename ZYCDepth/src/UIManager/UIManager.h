@@ -6,8 +6,11 @@
 #include <opencv2/opencv.hpp>
 #include <map>
 #include <string>
+#include <unordered_map>
 #include <vector>
 #include <mutex>
+#include "Data/MapMesh.h"
+#include "Data/PointCloud.h"
 
 class UIManager {
 public:
@@ -34,6 +37,7 @@ private:
     UIManager() = default;
     void updateUI();
     void renderPointCloud(ImVec2 canvasPos, ImVec2 canvasSize);
+    void syncMeshCache(); // 与最新地图网格快照比较，只为变化的分块重算着色
     void setupStyle(); // 设置类似图片的暗黑+绿荧光主题
     void refreshWindowList(); // 刷新当前运行的游戏窗口列表
 
@@ -66,6 +70,21 @@ private:
     };
     std::map<std::string, TextureResource> textureCache;
 
+    // 地图网格绘制缓存（分块 ID → 分块），未变化的分块与快照共享同一个 MeshChunk
+    struct UiMeshChunk {
+        MeshChunkHandle mesh;
+        std::vector<ImU32> faceColors;   ///< 每个三角形按法线预先算好的平面着色
+        float center[3] = {};            ///< 顶点包围盒中心，用于分块间由远到近排序
+    };
+    std::unordered_map<uint64_t, UiMeshChunk> meshCache;
+    uint64_t meshCacheVersion = 0;
+    bool showMesh = true;
+
+    // 点云：回投缓冲逐帧复用（射线表按内参缓存），导出时直接写最近绘制的这一份
+    PointCloudBuilder cloudBuilder;
+    PointCloud cloud;
+    long long cloudSequence = -1;
+
     // UI 内部状态
     int activeTab = 0; // 侧边栏选中的索引
 };
\ No newline at end of file
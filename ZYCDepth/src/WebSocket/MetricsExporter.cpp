@@ -0,0 +1,109 @@
+﻿#include "MetricsExporter.h"
+#include "Data/CommonTypes.h"
+#include <algorithm>
+#include <cstdio>
+#include <psapi.h>
+
+namespace {
+    // 直方图上界（秒）：覆盖单段的亚毫秒级到端到端的秒级
+    constexpr double kLatencyBuckets[] = { 0.001, 0.0025, 0.005, 0.01, 0.02, 0.033, 0.05, 0.075, 0.1, 0.15, 0.25, 0.5, 1.0 };
+
+    std::string number(double value) {
+        char buf[32];
+        std::snprintf(buf, sizeof(buf), "%.9g", value);
+        return buf;
+    }
+
+    void header(std::string& out, const char* name, const char* type, const char* help) {
+        out += std::string("# HELP ") + name + " " + help + "\n";
+        out += std::string("# TYPE ") + name + " " + type + "\n";
+    }
+
+    void sample(std::string& out, const std::string& name, const std::string& labels, double value) {
+        out += name;
+        if (!labels.empty()) out += "{" + labels + "}";
+        out += " " + number(value) + "\n";
+    }
+}
+
+std::string MetricsExporter::render(const std::vector<StageStats>& stages, size_t clientCount) {
+    SharedContext& context = SharedContext::getInstance();
+    std::string out;
+    out.reserve(16 * 1024);
+
+    // 1. 延迟直方图（Prometheus 直方图的计数只增不减，用自启动累计值，分位数由 histogram_quantile 计算）
+    header(out, "zyc_latency_seconds", "histogram", "Per-stage and end-to-end frame latency.");
+    const LatencyTracker& latency = context.getLatencyTracker();
+    for (size_t i = 0; i < (size_t)LatencyMetric::Count; ++i) {
+        const LatencyHistogram& histogram = latency.histogram((LatencyMetric)i);
+        const std::string label = std::string("metric=\"") + LatencyTracker::id((LatencyMetric)i) + "\"";
+        uint64_t cumulative = 0;
+        for (double le : kLatencyBuckets) {
+            cumulative = std::max(cumulative, histogram.lifetimeCountAtMost(le * 1000.0));
+            sample(out, "zyc_latency_seconds_bucket", label + ",le=\"" + number(le) + "\"", (double)cumulative);
+        }
+        // 总数在各桶之后读取，并发写入时也不小于最后一个桶
+        uint64_t count = std::max(cumulative, histogram.lifetimeCount());
+        sample(out, "zyc_latency_seconds_bucket", label + ",le=\"+Inf\"", (double)count);
+        sample(out, "zyc_latency_seconds_sum", label, histogram.lifetimeSumMs() / 1000.0);
+        sample(out, "zyc_latency_seconds_count", label, (double)count);
+    }
+
+    // 2. 帧率与帧数
+    const PipelineMetrics& metrics = context.getPipelineMetrics();
+    header(out, "zyc_fps", "gauge", "Frames per second averaged over the last few seconds.");
+    for (size_t i = 0; i < (size_t)FrameStream::Count; ++i) {
+        sample(out, "zyc_fps", std::string("stream=\"") + PipelineMetrics::id((FrameStream)i) + "\"",
+            metrics.frameCounter((FrameStream)i).ratePerSecond());
+    }
+    header(out, "zyc_frames_total", "counter", "Frames produced since start.");
+    for (size_t i = 0; i < (size_t)FrameStream::Count; ++i) {
+        sample(out, "zyc_frames_total", std::string("stream=\"") + PipelineMetrics::id((FrameStream)i) + "\"",
+            (double)metrics.frameCounter((FrameStream)i).total());
+    }
+
+    header(out, "zyc_capture_period_seconds", "gauge", "Current capture pacer period.");
+    sample(out, "zyc_capture_period_seconds", "", metrics.getCapturePeriodMs() / 1000.0);
+    header(out, "zyc_capture_missed_deadlines_total", "counter", "Capture deadlines missed by more than one period.");
+    sample(out, "zyc_capture_missed_deadlines_total", "", (double)metrics.getMissedDeadlines());
+
+    // 3. 流水线阶段
+    header(out, "zyc_stage_runs_total", "counter", "Stage invocations.");
+    for (const auto& stage : stages) sample(out, "zyc_stage_runs_total", "stage=\"" + stage.name + "\"", (double)stage.runs);
+    header(out, "zyc_stage_dropped_total", "counter", "Packets dropped on the stage's input edges due to overflow.");
+    for (const auto& stage : stages) sample(out, "zyc_stage_dropped_total", "stage=\"" + stage.name + "\"", (double)stage.dropped);
+    header(out, "zyc_stage_queue_depth", "gauge", "Packets currently queued on the stage's input edges.");
+    for (const auto& stage : stages) sample(out, "zyc_stage_queue_depth", "stage=\"" + stage.name + "\"", (double)stage.queued);
+    header(out, "zyc_stage_busy_seconds_total", "counter", "Wall time spent running the stage.");
+    for (const auto& stage : stages) sample(out, "zyc_stage_busy_seconds_total", "stage=\"" + stage.name + "\"", stage.busyMs / 1000.0);
+    header(out, "zyc_stage_throttled_total", "counter", "Runs that exhausted the stage's CPU budget.");
+    for (const auto& stage : stages) sample(out, "zyc_stage_throttled_total", "stage=\"" + stage.name + "\"", (double)stage.throttled);
+    header(out, "zyc_stage_concurrency", "gauge", "Configured concurrent instances of the stage.");
+    for (const auto& stage : stages) sample(out, "zyc_stage_concurrency", "stage=\"" + stage.name + "\"", (double)stage.concurrency);
+
+    // 4. 网页连接
+    header(out, "zyc_ws_clients", "gauge", "Connected WebSocket clients.");
+    sample(out, "zyc_ws_clients", "", (double)clientCount);
+    header(out, "zyc_ws_bytes_sent_total", "counter", "Bytes sent to WebSocket clients (message size times client count).");
+    for (size_t i = 0; i < (size_t)ByteStream::Count; ++i) {
+        sample(out, "zyc_ws_bytes_sent_total", std::string("stream=\"") + PipelineMetrics::id((ByteStream)i) + "\"",
+            (double)metrics.bytes((ByteStream)i));
+    }
+    header(out, "zyc_ws_dropped_total", "counter", "WebSocket sends dropped (stale: replaced by a newer frame, overflow: queue full, backpressure: client backlogged).");
+    for (size_t i = 0; i < (size_t)ByteStream::Count; ++i) {
+        for (size_t r = 0; r < (size_t)SendDrop::Count; ++r) {
+            sample(out, "zyc_ws_dropped_total", std::string("stream=\"") + PipelineMetrics::id((ByteStream)i) + "\",reason=\""
+                + PipelineMetrics::id((SendDrop)r) + "\"", (double)metrics.sendDrops((ByteStream)i, (SendDrop)r));
+        }
+    }
+
+    // 5. 进程内存
+    PROCESS_MEMORY_COUNTERS_EX memory = {};
+    if (GetProcessMemoryInfo(GetCurrentProcess(), (PROCESS_MEMORY_COUNTERS*)&memory, sizeof(memory))) {
+        header(out, "zyc_process_working_set_bytes", "gauge", "Process working set size.");
+        sample(out, "zyc_process_working_set_bytes", "", (double)memory.WorkingSetSize);
+        header(out, "zyc_process_private_bytes", "gauge", "Process private (committed) bytes.");
+        sample(out, "zyc_process_private_bytes", "", (double)memory.PrivateUsage);
+    }
+    return out;
+}
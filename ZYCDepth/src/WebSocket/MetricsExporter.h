@@ -0,0 +1,23 @@
+﻿#pragma once
+#include <string>
+#include <vector>
+#include "Thread/PipelineGraph.h"
+
+/**
+ * @brief Prometheus 文本格式 (text/plain; version=0.0.4) 的指标导出
+ * @details 由 WebSocketServer 的 GET /metrics 调用，在 uWS 事件循环线程上渲染；
+ *          读取的延迟直方图、帧计数、阶段统计全部是原子量，不触碰流水线的任何锁。
+ *
+ *          导出的指标：
+ *          - zyc_latency_seconds{metric}            各段 / 端到端延迟直方图（自启动累计）
+ *          - zyc_fps{stream}, zyc_frames_total{stream}  截图 / 推理 / 网页广播的帧率与帧数
+ *          - zyc_stage_*{stage}                     各阶段运行次数、丢帧、排队深度、忙碌时间、预算耗尽次数
+ *          - zyc_ws_clients, zyc_ws_bytes_sent_total{stream}
+ *          - zyc_process_working_set_bytes, zyc_process_private_bytes
+ */
+class MetricsExporter {
+public:
+    static constexpr const char* kContentType = "text/plain; version=0.0.4; charset=utf-8";
+
+    static std::string render(const std::vector<StageStats>& stages, size_t clientCount);
+};
@@ -2,6 +2,8 @@
 #include "Log/Logger.h"
 #include <opencv2/imgcodecs.hpp>
 #include<Data/CommonTypes.h>
+#include "Profiler/TraceProfiler.h"
+#include "WebSocket/MetricsExporter.h"
 
 
 // Base64 编码辅助（发送图像给 Web 最简单的方法）
@@ -27,13 +29,26 @@ WebSocketServer::WebSocketServer(int port) : port(port) {}
 WebSocketServer::~WebSocketServer() { stop(); }
 
 void WebSocketServer::run() {
+    ZYC_PROFILE_THREAD("websocket");
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        if (stopping) return;
+        loop = uWS::Loop::get();
+    }
     uWS::App().ws<PerSocketData>("/*", {
         .compression = uWS::SHARED_COMPRESSOR,
         .maxPayloadLength = 16 * 1024 * 1024, // 16MB 足够传大图
         .open = [this](auto* ws) {
-            std::lock_guard<std::mutex> lock(mtx);
-            sockets.insert(ws);
-            LOG_INFO("网页已连接. Total: " + std::to_string(sockets.size()),true);
+            size_t total;
+            {
+                std::lock_guard<std::mutex> lock(mtx);
+                sockets.insert(ws);
+                total = sockets.size();
+                clientCount.store(total, std::memory_order_relaxed);
+            }
+            // 日志回调会广播给网页（broadcastText 需要 mtx），必须在锁外打印
+            LOG_INFO("网页已连接. Total: " + std::to_string(total),true);
+            meshResync = true;
 
             // --- 新增：推送当前配置 ---
             CaptureConfig current = SharedContext::getInstance().getCurrentCaptureConfig();
@@ -42,6 +57,12 @@ void WebSocketServer::run() {
             j["method"] = (int)current.Method;
             j["window_name"] = current.targetWindowName;
             j["capturefps"] = current.captureFps;
+            j["replay_source"] = current.replaySource;
+            j["replay_realtime"] = current.replayRealtime;
+            j["change_threshold"] = current.changeThreshold;
+            j["roi"] = { current.roi.x, current.roi.y, current.roi.width, current.roi.height };
+            j["exclude_masks"] = nlohmann::json::array();
+            for (const auto& m : current.excludeMasks) j["exclude_masks"].push_back({ m.x, m.y, m.width, m.height });
             // 发送给刚连接的这个客户端
             ws->send(j.dump(), uWS::OpCode::TEXT);
 
@@ -50,23 +71,56 @@ void WebSocketServer::run() {
             handleMessage(message, ws);
         },
         .close = [this](auto* ws, int code, std::string_view message) {
-            std::lock_guard<std::mutex> lock(mtx);
-            sockets.erase(ws);
+            {
+                std::lock_guard<std::mutex> lock(mtx);
+                sockets.erase(ws);
+                clientCount.store(sockets.size(), std::memory_order_relaxed);
+            }
             LOG_INFO("网页断开.", true);
         }
+        }).get("/metrics", [this](auto* res, auto* req) {
+            // Prometheus 拉取：全部是无锁读取，不会阻塞流水线
+            std::vector<StageStats> stages = stageStatsSource ? stageStatsSource() : std::vector<StageStats>();
+            res->writeHeader("Content-Type", MetricsExporter::kContentType)->end(MetricsExporter::render(stages, getClientCount()));
         }).listen(port, [this](auto* listen_socket) {
             if (listen_socket) {
                 this->listen_socket = listen_socket;
+                bool stopRequested;
+                {
+                    std::lock_guard<std::mutex> lock(mtx);
+                    stopRequested = stopping;
+                }
+                // 监听建立前就收到了 stop()，立即关闭，让事件循环退出
+                if (stopRequested) {
+                    us_listen_socket_close(0, listen_socket);
+                    this->listen_socket = nullptr;
+                    return;
+                }
                 LOG_INFO("websocket port " + std::to_string(port));
             }
             }).run();
+    // 事件循环随线程退出销毁，之后不能再向它投递任务
+    std::lock_guard<std::mutex> lock(mtx);
+    loop = nullptr;
 }
 
 void WebSocketServer::stop() {
-    if (listen_socket) {
-        us_listen_socket_close(0, listen_socket);
-        listen_socket = nullptr;
-    }
+    // uWS 只能在事件循环线程中操作：把关闭动作投递过去，监听与所有连接关闭后 run() 返回
+    std::lock_guard<std::mutex> lock(mtx);
+    stopping = true;
+    if (!loop) return;
+    loop->defer([this] {
+        if (listen_socket) {
+            us_listen_socket_close(0, listen_socket);
+            listen_socket = nullptr;
+        }
+        std::set<uWS::WebSocket<false, true, PerSocketData>*> open;
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            open = sockets;   // close 回调会修改 sockets，先拷贝
+        }
+        for (auto* ws : open) ws->close();
+        });
 }
 
 void WebSocketServer::handleMessage(std::string_view message, uWS::WebSocket<false, true, PerSocketData>* ws) {
@@ -87,6 +141,39 @@ void WebSocketServer::handleMessage(std::string_view message, uWS::WebSocket<fal
             if (j.contains("capture_fps")) {
                 config.captureFps = j["capture_fps"].get<int>();
             }
+            if (j.contains("adaptive_pacing")) {
+                config.adaptivePacing = j["adaptive_pacing"].get<bool>();
+            }
+            if (j.contains("replay_source")) {
+                config.replaySource = j["replay_source"].get<std::string>();
+            }
+            if (j.contains("replay_realtime")) {
+                config.replayRealtime = j["replay_realtime"].get<bool>();
+            }
+            if (j.contains("replay_fps")) {
+                config.replayFps = j["replay_fps"].get<double>();
+            }
+            if (j.contains("replay_loop")) {
+                config.replayLoop = j["replay_loop"].get<bool>();
+            }
+            if (j.contains("change_threshold")) {
+                config.changeThreshold = j["change_threshold"].get<double>();
+            }
+            if (j.contains("static_refresh_ms")) {
+                config.staticRefreshMs = j["static_refresh_ms"].get<int>();
+            }
+            // 推理区域与排除区域：归一化 [x, y, w, h]
+            if (j.contains("roi")) {
+                auto r = j["roi"].get<std::vector<float>>();
+                if (r.size() == 4) config.roi = cv::Rect2f(r[0], r[1], r[2], r[3]);
+            }
+            if (j.contains("exclude_masks")) {
+                config.excludeMasks.clear();
+                for (const auto& m : j["exclude_masks"]) {
+                    auto r = m.get<std::vector<float>>();
+                    if (r.size() == 4) config.excludeMasks.emplace_back(r[0], r[1], r[2], r[3]);
+                }
+            }
             SharedContext::getInstance().setCurrentCaptureConfig(config);
             
         }
@@ -97,6 +184,15 @@ void WebSocketServer::handleMessage(std::string_view message, uWS::WebSocket<fal
             LOG_INFO(start ? "Mapping started" : "Mapping stopped");
         }
 
+        else if (type == "dump_trace") {
+            // 导出各线程最近的时间线（Chrome / Perfetto trace JSON），卡顿后立即导出
+            std::string path = TraceProfiler::getInstance().dump();
+            nlohmann::json response;
+            response["type"] = "trace_dumped";
+            response["path"] = path;
+            ws->send(response.dump(), uWS::OpCode::TEXT);
+        }
+
         else if (type == "toggle_Inference") {
             bool start = j.value("state", false);
             SharedContext::getInstance().setIsInferencing(start);
@@ -133,59 +229,175 @@ void WebSocketServer::handleMessage(std::string_view message, uWS::WebSocket<fal
 }
 
 void WebSocketServer::broadcastText(const std::string& message) {
+    ZYC_PROFILE_SCOPE("WebSocket::broadcastText");
+    sendToAll(message, uWS::OpCode::TEXT, ByteStream::Text);
+}
+
+std::string_view WebSocketServer::Outgoing::view() const {
+    return std::visit([](const auto& p) { return std::string_view((const char*)p.data(), p.size() * sizeof(p[0])); }, payload);
+}
+
+void WebSocketServer::sendToAll(Outgoing::Payload payload, uWS::OpCode opCode, ByteStream stream, std::shared_ptr<FrameTrace> trace) {
+    if (getClientCount() == 0) return;
+    Outgoing message{ std::move(payload), opCode, stream, std::move(trace) };
+    PipelineMetrics& metrics = SharedContext::getInstance().getPipelineMetrics();
+    // uWS 只能在事件循环线程操作：负载随任务移交过去，调用方（流水线工作者）不等待发送、也不在 mtx 下发送
     std::lock_guard<std::mutex> lock(mtx);
+    if (!loop || stopping) return;
+    if (stream == ByteStream::Raw || stream == ByteStream::Depth || stream == ByteStream::PointCloud) {
+        // 帧类消息只关心最新一帧（与流水线 LatestOnly 边相同）：上一帧还没轮到发送就直接替换
+        LatestSlot& slot = latestSlots[(size_t)stream];
+        if (slot.pending) metrics.countSendDrop(stream, SendDrop::Stale);
+        slot.pending = std::move(message);
+        if (!slot.scheduled) {
+            slot.scheduled = true;
+            loop->defer([this, stream] { flushLatest(stream); });
+        }
+        return;
+    }
+    // 文本与网格增量必须按序送达，逐条投递；事件循环卡住时积压有上限
+    const size_t size = message.view().size();
+    size_t& queued = queuedBytes[(size_t)stream];
+    if (queued + size > kMaxQueuedBytes) {
+        metrics.countSendDrop(stream, SendDrop::Overflow);
+        if (stream == ByteStream::Mesh) meshResync = true;   // 漏了增量，下次全量同步
+        return;
+    }
+    queued += size;
+    loop->defer([this, message = std::move(message), size] {
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            queuedBytes[(size_t)message.stream] -= size;
+        }
+        deliver(message);
+        });
+}
+
+void WebSocketServer::flushLatest(ByteStream stream) {
+    std::optional<Outgoing> message;
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        LatestSlot& slot = latestSlots[(size_t)stream];
+        slot.scheduled = false;
+        message.swap(slot.pending);
+    }
+    if (message) deliver(*message);
+}
+
+void WebSocketServer::deliver(const Outgoing& message) {
+    const std::string_view data = message.view();
+    PipelineMetrics& metrics = SharedContext::getInstance().getPipelineMetrics();
+    uint64_t sent = 0;
+    // sockets 只在事件循环线程增删，这里读取不用加锁
     for (auto* ws : sockets) {
-        ws->send(message, uWS::OpCode::TEXT);
+        // 慢客户端的发送缓冲积压过多：跳过本条，不让它拖着内存增长；漏发网格增量的客户端靠全量同步补齐
+        if (ws->getBufferedAmount() > kMaxClientBuffered) {
+            metrics.countSendDrop(message.stream, SendDrop::Backpressure);
+            if (message.stream == ByteStream::Mesh) meshResync = true;
+            continue;
+        }
+        ws->send(data, message.opCode);
+        sent++;
+        if (message.trace) SharedContext::getInstance().getLatencyTracker().recordClientSend(*message.trace, FrameTrace::nowNs());
     }
+    metrics.countBytes(message.stream, (uint64_t)data.size() * sent);
 }
 
 void WebSocketServer::broadcastImage(const std::string& type, const cv::Mat& frame, double durationMs) {
     if (frame.empty()) return;
 
     // 1. 编码为 JPG (减少带宽)
-    std::vector<uchar> buf;
-    std::vector<int> params = { cv::IMWRITE_JPEG_QUALITY, 70 };
-    cv::imencode(".jpg", frame, buf, params);
-
-    // 2. 构造 JSON 协议
     json j;
-    j["type"] = "frame_update";
-    j["frame_type"] = type;
-    j["data"] = "data:image/jpeg;base64," + base64_encode(buf);
+    {
+        ZYC_PROFILE_SCOPE("WebSocket::encodeJpeg");
+        std::vector<uchar> buf;
+        std::vector<int> params = { cv::IMWRITE_JPEG_QUALITY, 70 };
+        cv::imencode(".jpg", frame, buf, params);
+
+        // 2. 构造 JSON 协议
+        j["type"] = "frame_update";
+        j["frame_type"] = type;
+        j["data"] = "data:image/jpeg;base64," + base64_encode(buf);
+    }
 
     // 根据类型区分字段，或者 JS 端统一处理
     if (type == "raw") j["capture_time"] = durationMs;
     else if (type == "depth") j["infer_time"] = durationMs; // 确保 JS 能拿到这个 key
-    broadcastText(j.dump());
+    ZYC_PROFILE_SCOPE("WebSocket::broadcastText");
+    sendToAll(j.dump(), uWS::OpCode::TEXT, type == "raw" ? ByteStream::Raw : ByteStream::Depth);
 }
 
-void WebSocketServer::broadcastDepthBinary(const FrameData& fd) {
-    if (fd.rawDepth->empty()) return;
-    // 1. 定义二进制协议头 (确保字节对齐)
-#pragma pack(push, 1)
-    struct DepthHeader {
-        uint32_t magic = 0xDEADBEEF; // 校验码
-        int32_t width;
-        int32_t height;
-        float intrinsics[9];  // fx, 0, cx, 0, fy, cy, 0, 0, 1
-        float extrinsics[12]; // 3x4 R|t 矩阵
-    } header;
-#pragma pack(pop)
-    header.width = fd.rawDepth->cols;
-    header.height = fd.rawDepth->rows;
-
-    // 拷贝矩阵数据
-    std::memcpy(header.intrinsics, fd.intrinsics.data, 9 * sizeof(float));
-    std::memcpy(header.extrinsics, fd.extrinsics.data, 12 * sizeof(float));
-    // 2. 拼接 Buffer
-    size_t depthSize = fd.rawDepth->total() * sizeof(float);
-    std::vector<char> packet(sizeof(header) + depthSize);
-
-    std::memcpy(packet.data(), &header, sizeof(header));
-    std::memcpy(packet.data() + sizeof(header), fd.rawDepth->data, depthSize);
-    // 3. 发送
-    std::lock_guard<std::mutex> lock(mtx);
-    for (auto* ws : sockets) {
-        ws->send(std::string_view(packet.data(), packet.size()), uWS::OpCode::BINARY);
+void WebSocketServer::broadcastPointCloud(const FrameData& fd, const PointCloud& cloud) {
+    ZYC_PROFILE_SCOPE("WebSocket::broadcastPointCloud");
+    // 二进制协议：[magic "PCLD"][点数][是否带颜色]，之后 [x float32 ...][y ...][z ...]，带颜色时再接 [rgba uint32 ...]
+    // 坐标为相机系（米，y 向下、z 向前），网页直接作为顶点上传
+    const uint32_t count = (uint32_t)cloud.count;
+    const bool hasColor = !cloud.rgba.empty();
+    std::vector<uint32_t> packet(3 + (size_t)count * (hasColor ? 4 : 3));
+    packet[0] = 0x444C4350u;
+    packet[1] = count;
+    packet[2] = hasColor ? 1u : 0u;
+    uint32_t* body = packet.data() + 3;
+    std::memcpy(body, cloud.x.data(), count * sizeof(float));
+    std::memcpy(body + count, cloud.y.data(), count * sizeof(float));
+    std::memcpy(body + 2 * (size_t)count, cloud.z.data(), count * sizeof(float));
+    if (hasColor) std::memcpy(body + 3 * (size_t)count, cloud.rgba.data(), count * sizeof(uint32_t));
+
+    // 发送，逐客户端记录 截图→网页 延迟
+    sendToAll(std::move(packet), uWS::OpCode::BINARY, ByteStream::PointCloud, fd.trace);
+}
+
+void WebSocketServer::broadcastMesh(const MapMeshHandle& mesh) {
+    ZYC_PROFILE_SCOPE("WebSocket::broadcastMesh");
+    if (!mesh) return;
+    std::lock_guard<std::mutex> meshLock(meshMtx);
+    const bool resync = meshResync.exchange(false);
+    // 多个编码实例可能乱序拿到快照，旧快照直接忽略
+    if (sentMesh && sentMesh->version >= mesh->version && !resync) return;
+
+    // 二进制协议：[magic "MESH"][分块数]，之后每个分块
+    //   [id 低 32 位][id 高 32 位][版本][顶点数][索引数][顶点 xyz float32 ...][索引 uint32 ...]
+    // 顶点数与索引数都为 0 表示删除该分块；坐标为世界系（米，y 向下、z 向前）
+    std::vector<uint32_t> packet;
+    uint32_t chunkCount = 0;
+    auto begin = [&] {
+        packet.assign({ 0x4853454Du, 0u });
+        chunkCount = 0;
+    };
+    auto flush = [&] {
+        if (chunkCount == 0) return;
+        packet[1] = chunkCount;
+        sendToAll(std::move(packet), uWS::OpCode::BINARY, ByteStream::Mesh);
+        begin();
+    };
+    auto append = [&](uint64_t id, const MeshChunk* chunk) {
+        const uint32_t vertexCount = chunk ? (uint32_t)chunk->vertexCount() : 0;
+        const uint32_t indexCount = chunk ? (uint32_t)chunk->indices.size() : 0;
+        packet.insert(packet.end(), { (uint32_t)id, (uint32_t)(id >> 32), chunk ? (uint32_t)chunk->version : 0u, vertexCount, indexCount });
+        if (chunk) {
+            const size_t offset = packet.size();
+            packet.resize(offset + chunk->vertices.size() + chunk->indices.size());
+            std::memcpy(packet.data() + offset, chunk->vertices.data(), chunk->vertices.size() * sizeof(float));
+            std::memcpy(packet.data() + offset + chunk->vertices.size(), chunk->indices.data(), chunk->indices.size() * sizeof(uint32_t));
+        }
+        // 每条消息控制在 4 MB 左右，避免一次全量同步阻塞事件循环太久
+        chunkCount++;
+        if (packet.size() * sizeof(uint32_t) > (4u << 20)) flush();
+    };
+
+    begin();
+    if (sentMesh) {
+        for (const auto& [id, chunk] : sentMesh->chunks) {
+            if (!mesh->chunks.count(id)) append(id, nullptr);
+        }
     }
-}
\ No newline at end of file
+    for (const auto& [id, chunk] : mesh->chunks) {
+        if (!resync && sentMesh) {
+            auto it = sentMesh->chunks.find(id);
+            if (it != sentMesh->chunks.end() && it->second->version == chunk->version) continue;
+        }
+        append(id, chunk.get());
+    }
+    flush();
+    sentMesh = mesh;
+}
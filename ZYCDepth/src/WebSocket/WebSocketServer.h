@@ -1,11 +1,18 @@
 ﻿#pragma once
 #include <uwebsockets/App.h>
 #include <nlohmann/json.hpp>
+#include <array>
+#include <atomic>
+#include <functional>
 #include <mutex>
+#include <optional>
 #include <set>
 #include <string>
+#include <variant>
 #include <vector>
 #include "Data/CommonTypes.h"
+#include "Data/PointCloud.h"
+#include "Thread/PipelineGraph.h"
 
 using json = nlohmann::json;
 
@@ -21,7 +28,7 @@ public:
 
     // 启动服务器（会阻塞，需要在独立线程运行）
     void run();
-    // 停止服务器
+    // 停止服务器（可在任意线程调用，关闭动作在事件循环线程执行）
     void stop();
 
     // 广播文本消息（如日志、状态更新）
@@ -30,16 +37,75 @@ public:
     // 发送图像帧（二进制或Base64）
     void broadcastImage(const std::string& type, const cv::Mat& frame, double durationMs = 0.0);
 
-    void broadcastDepthBinary(const FrameData& fd);
+    /**
+     * @brief 发送深度帧回投好的点云（二进制，魔数 "PCLD"），网页直接上传顶点，不再自己回投
+     * @details 逐客户端记录 截图→网页 延迟
+     */
+    void broadcastPointCloud(const FrameData& fd, const PointCloud& cloud);
+
+    /**
+     * @brief 增量发送地图网格
+     * @details 与上次发送的快照比较，只打包新增/变化的分块与已删除分块的 ID（二进制，魔数 "MESH"）；
+     *          有新客户端连接后的下一次调用发送全部分块
+     */
+    void broadcastMesh(const MapMeshHandle& mesh);
+    // 有客户端等待完整网格
+    bool isMeshResyncPending() const { return meshResync.load(std::memory_order_relaxed); }
+
+    // 当前连接的客户端数量，广播线程据此跳过无人接收的编码工作（原子读，不加锁）
+    size_t getClientCount() const { return clientCount.load(std::memory_order_relaxed); }
+
+    // GET /metrics 导出阶段统计的来源，须在 run() 之前设置；来源对象的生命周期需长于事件循环
+    void setStageStatsSource(std::function<std::vector<StageStats>()> source) { stageStatsSource = std::move(source); }
 
 private:
     int port;
     struct us_listen_socket_t* listen_socket = nullptr;
-    uWS::Loop* loop = nullptr;
+    uWS::Loop* loop = nullptr;      ///< run() 所在线程的事件循环，由 mtx 保护
+    bool stopping = false;          ///< 已请求停止，由 mtx 保护
 
-    // 记录所有活跃的 WebSocket 实例，用于手动推送数据
+    // 记录所有活跃的 WebSocket 实例，用于手动推送数据；只在事件循环线程增删与遍历
     std::mutex mtx;
     std::set<uWS::WebSocket<false, true, PerSocketData>*> sockets;
+    std::atomic<size_t> clientCount{ 0 };   ///< sockets.size() 的无锁副本
+    std::function<std::vector<StageStats>()> stageStatsSource;
+
+    // 待发送的消息：负载随消息移交给事件循环线程
+    struct Outgoing {
+        using Payload = std::variant<std::string, std::vector<uint32_t>>;   ///< 文本/JSON 或 二进制包
+        Payload payload;
+        uWS::OpCode opCode = uWS::OpCode::TEXT;
+        ByteStream stream = ByteStream::Text;
+        std::shared_ptr<FrameTrace> trace;  ///< 非空时逐客户端记录 截图→网页 延迟
+        std::string_view view() const;
+    };
+    // 帧类字节流（原图/深度/点云）只保留最新一条待发消息，事件循环来不及发时旧帧被替换
+    struct LatestSlot {
+        std::optional<Outgoing> pending;
+        bool scheduled = false;             ///< 已向事件循环投递 flushLatest
+    };
+    std::array<LatestSlot, (size_t)ByteStream::Count> latestSlots;  ///< 由 mtx 保护
+    std::array<size_t, (size_t)ByteStream::Count> queuedBytes{};    ///< 有序消息（文本/网格）已投递未发送的字节数，由 mtx 保护
+    static constexpr size_t kMaxQueuedBytes = 128u << 20;           ///< 有序消息积压上限（网格全量同步可达数十 MB）
+    static constexpr size_t kMaxClientBuffered = 16u << 20;         ///< 单个客户端 uWS 发送缓冲上限，超过后跳过该客户端
+
+    std::mutex meshMtx;                     ///< 网格差分与发送串行化（编码阶段可能多实例）
+    MapMeshHandle sentMesh;                 ///< 上次发送的网格快照，由 meshMtx 保护
+    std::atomic<bool> meshResync{ false };  ///< 新客户端连接后置位，下次发送全部分块
+
+    /**
+     * @brief 发给所有客户端，并按 消息大小 × 实际发送的客户端数 记入对应字节流
+     * @details 负载移交给事件循环线程发送（loop->defer），可在任意线程调用且立即返回。积压有上限：
+     *          - 原图/深度/点云每个字节流最多一条待发消息，新帧替换未发出的旧帧
+     *          - 文本/网格按序逐条投递，积压超过 kMaxQueuedBytes 时丢弃（网格随后全量同步）
+     *          - 发送缓冲超过 kMaxClientBuffered 的客户端跳过本条消息
+     *          丢弃都记入 PipelineMetrics::countSendDrop
+     */
+    void sendToAll(Outgoing::Payload payload, uWS::OpCode opCode, ByteStream stream, std::shared_ptr<FrameTrace> trace = nullptr);
+    // 事件循环线程：取出帧类字节流的最新消息发送
+    void flushLatest(ByteStream stream);
+    // 事件循环线程：逐客户端发送一条消息
+    void deliver(const Outgoing& message);
 
     // 处理来自 Web 端的消息
     void handleMessage(std::string_view message, uWS::WebSocket<false, true, PerSocketData>* ws);
@@ -1,5 +1,9 @@
 ﻿#include "Thread/SystemManager.h"
+#include "Benchmark/ChannelBenchmark.h"
+#include "Benchmark/TsdfBenchmark.h"
+#include "Profiler/TraceProfiler.h"
 #include <iostream>
+#include <string>
 
 // 处理 Ctrl+C 信号 防止卡死退出用
 #include <csignal>
@@ -8,9 +12,39 @@ void signalHandler(int signum) {
     SystemManager::getInstance().stop();
 }
 
-int main() {
+// Ctrl+Break 导出时间线（Windows 在独立线程中调用控制台信号处理函数）
+void traceDumpHandler(int signum) {
+    TraceProfiler::getInstance().dump();
+    signal(signum, traceDumpHandler);
+}
+
+int main(int argc, char** argv) {
     // 注册信号处理
     signal(SIGINT, signalHandler);
+#ifdef SIGBREAK
+    signal(SIGBREAK, traceDumpHandler);
+#endif
+
+    // 命令行参数
+    //   --int8           使用静态量化模型 (models/quantize_onnx.py 生成) 在 CPU 上推理
+    //   --propagate      关键帧深度传播：只对关键帧跑完整网络，中间帧用光流搬运深度
+    //   --bench-channel  运行帧交换通道竞争基准后退出（可选 --bench-hz N --bench-ms N）
+    //   --bench-tsdf     运行 TSDF 融合基准后退出（可选 --bench-frames N --bench-voxel 米 --bench-threads N --bench-track）
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--bench-channel") return runChannelBenchmark(argc, argv);
+        if (arg == "--bench-tsdf") return runTsdfBenchmark(argc, argv);
+        if (arg == "--int8") {
+            InferenceConfig config = SharedContext::getInstance().getInferenceConfig();
+            config.precision = InferencePrecision::INT8;
+            SharedContext::getInstance().setInferenceConfig(config);
+        }
+        if (arg == "--propagate") {
+            InferenceConfig config = SharedContext::getInstance().getInferenceConfig();
+            config.depthPropagation = true;
+            SharedContext::getInstance().setInferenceConfig(config);
+        }
+    }
 
     auto& sys = SystemManager::getInstance();
     sys.init();